@@ -160,6 +160,14 @@ static void * worker_thread_handler(void * x) {
                 assert(req->error);
             }
             break;
+
+        case AsyncReqUser:              /* User function */
+            req->u.user.rval = req->u.user.func(req->u.user.data);
+            if (req->u.user.rval == -1) {
+                req->error = errno;
+                assert(req->error);
+            }
+            break;
         default:
             req->error = ENOSYS;
             break;
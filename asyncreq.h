@@ -38,7 +38,8 @@ enum {
     AsyncReqConnect,                    /* Connect to socket */
     AsyncReqWaitpid,                    /* Wait for process change */
     AsyncReqSelect,                     /* Do select() on file handles */
-    AsyncReqClose                       /* File close */
+    AsyncReqClose,                      /* File close */
+    AsyncReqUser                        /* Call a function, e.g. to offload CPU bound work */
 };
 
 typedef struct AsyncReqInfo AsyncReqInfo;
@@ -120,6 +121,14 @@ struct AsyncReqInfo {
             /* Out */
             int rval;
         } select;
+        struct {
+            /* In */
+            int (*func)(void *);        /* called by a worker thread, must not use dispatch thread only APIs */
+            void * data;
+
+            /* Out */
+            int rval;
+        } user;
     } u;
     int error;                  /* Readable by callback function */
 };
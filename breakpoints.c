@@ -26,12 +26,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
+#include <time.h>
 #include <assert.h>
 #include "breakpoints.h"
 #include "expressions.h"
 #include "channel.h"
 #include "protocol.h"
 #include "errors.h"
+#include "events.h"
 #include "trace.h"
 #include "runctrl.h"
 #include "context.h"
@@ -43,6 +45,7 @@
 #include "linenumbers.h"
 #include "stacktrace.h"
 #include "memorymap.h"
+#include "streamsservice.h"
 
 #if defined(_WRS_KERNEL)
 #  include <private/vxdbgLibP.h>
@@ -51,6 +54,7 @@
 typedef struct BreakpointRef BreakpointRef;
 typedef struct BreakpointAttribute BreakpointAttribute;
 typedef struct BreakInstruction BreakInstruction;
+typedef struct DataBreakpoint DataBreakpoint;
 
 struct BreakpointRef {
     LINK link_inp;
@@ -65,9 +69,16 @@ struct BreakpointAttribute {
     char * value;
 };
 
+typedef struct MemSpaceError {
+    pid_t mem;
+    int error;
+    char * msg;
+} MemSpaceError;
+
 struct BreakpointInfo {
     LINK link_all;
     LINK link_id;
+    LINK link_unresolved;
     LINK refs;
     char id[64];
     int enabled;
@@ -77,6 +88,11 @@ struct BreakpointInfo {
     char * err_msg;
     char * address;
     char * condition;
+
+    /* Address errors by memory space, kept while only other memory spaces are replanted */
+    MemSpaceError * mem_errors;
+    int mem_errors_cnt;
+    int mem_errors_max;
 #if SERVICE_LineNumbers
     char * file;
     int line;
@@ -84,9 +100,26 @@ struct BreakpointInfo {
 #endif
     int ignore_count;
     int hit_count;
+    int access_mode;
+    int size;
     BreakpointAttribute * unsupported;
     int triggered;
 
+    /* Condition evaluation statistics: */
+    unsigned long condition_cnt;
+    unsigned long condition_true_cnt;
+    uint64_t condition_time; /* microseconds */
+
+    /* Tracepoint: expressions to collect on hit, instead of suspending the context */
+    char ** trace_exprs;
+    int trace_cnt;
+#if SERVICE_Streams
+    VirtualStream * trace_stream;
+#endif
+    unsigned long trace_records;
+    unsigned long trace_dropped;
+    unsigned long trace_dropped_last;   /* records dropped since last record added to the stream */
+
     EventPointCallBack * event_callback;
     void * event_callback_args;
 
@@ -94,6 +127,7 @@ struct BreakpointInfo {
     int status_unsupported;
     int status_error;
     int status_planted;
+    unsigned long status_condition_cnt;
 };
 
 struct BreakInstruction {
@@ -116,6 +150,19 @@ struct BreakInstruction {
     int planted;
 };
 
+struct DataBreakpoint {
+    LINK link_all;
+    Context * ctx;
+    ContextAddress address;
+    ContextAddress size;
+    int mode;
+    int slot;
+    int error;
+    BreakpointInfo ** refs;
+    int ref_size;
+    int ref_cnt;
+};
+
 static const char * BREAKPOINTS = "Breakpoints";
 
 #define is_running(ctx) (!(ctx)->stopped && context_has_state(ctx))
@@ -128,25 +175,103 @@ static const char * BREAKPOINTS = "Breakpoints";
 
 #define ID2BP_HASH_SIZE 1023
 
+#define link_all2db(A)  ((DataBreakpoint *)((char *)(A) - offsetof(DataBreakpoint, link_all)))
+
 #define link_all2bp(A)  ((BreakpointInfo *)((char *)(A) - offsetof(BreakpointInfo, link_all)))
 #define link_id2bp(A)   ((BreakpointInfo *)((char *)(A) - offsetof(BreakpointInfo, link_id)))
 
 #define INP2BR_HASH_SIZE 127
 
+#define MAX_PLANT_SPAN 0x100
+
+#define ACCESSMODE_READ     0x01
+#define ACCESSMODE_WRITE    0x02
+#define ACCESSMODE_EXECUTE  0x04
+#define ACCESSMODE_CHANGE   0x08
+
+#define is_data_breakpoint(bp) (((bp)->access_mode & (ACCESSMODE_READ | ACCESSMODE_WRITE | ACCESSMODE_CHANGE)) != 0)
+
+#if SERVICE_LineNumbers
+#define is_line_breakpoint(bp) ((bp)->address == NULL && (bp)->file != NULL)
+#else
+#define is_line_breakpoint(bp) 0
+#endif
+
+#define CONDITION_STATUS_DELAY 1000000
+
+#define TRACE_STREAM_SIZE 0x10000
+#define MAX_TRACE_VALUE_SIZE 0x400
+
+#define TRACE_RECORD_BIG_ENDIAN 0x01
+
 #define link_inp2br(A)  ((BreakpointRef *)((char *)(A) - offsetof(BreakpointRef, link_inp)))
 #define link_bp2br(A)   ((BreakpointRef *)((char *)(A) - offsetof(BreakpointRef, link_bp)))
 
+#define is_unresolved(bp) (!list_is_empty(&(bp)->link_unresolved))
+
 static LINK breakpoints;
 static LINK id2bp[ID2BP_HASH_SIZE];
 
+/*
+ * Enabled breakpoints that are not planted, or have errors in some memory spaces.
+ * When a module is loaded, only these and line breakpoints are evaluated again.
+ */
+static LINK unresolved_breakpoints;
+
 static LINK instructions;
+static MemPool * instruction_pool = NULL;
 static LINK addr2instr[ADDR2INSTR_HASH_SIZE];
+static LINK data_breakpoints;
 
 static LINK inp2br[INP2BR_HASH_SIZE];
 
 static int replanting = 0;
+static int condition_status_posted = 0;
 static TCFBroadcastGroup * broadcast_group = NULL;
 
+/* Memory spaces that need breakpoints replanted, or all memory spaces if replant_all is set */
+static int replant_all = 0;
+static pid_t * replant_mems = NULL;
+static unsigned replant_mems_cnt = 0;
+static unsigned replant_mems_max = 0;
+static pid_t replant_event_mem = 0;
+
+/* Address ranges of newly loaded modules, replanting in a range only adds breakpoints that can bind there */
+typedef struct ReplantRange {
+    pid_t mem;
+    ContextAddress addr;
+    ContextAddress size;
+} ReplantRange;
+
+static ReplantRange * replant_ranges = NULL;
+static unsigned replant_ranges_cnt = 0;
+static unsigned replant_ranges_max = 0;
+static int replant_event_ranges = 0;
+
+#if SERVICE_MemoryMap
+/* File mappings of a memory space, as seen by last module event, sorted by address */
+typedef struct MappedFile {
+    ContextAddress addr;
+    unsigned long size;
+    dev_t dev;
+    ino_t ino;
+} MappedFile;
+
+typedef struct MemSpaceFiles {
+    pid_t mem;
+    MappedFile * files;
+    unsigned files_cnt;
+} MemSpaceFiles;
+
+static MemSpaceFiles * mapped_files = NULL;
+static unsigned mapped_files_cnt = 0;
+static unsigned mapped_files_max = 0;
+#endif
+
+static BreakInstruction ** plant_list = NULL;
+static unsigned plant_list_cnt = 0;
+static unsigned plant_list_max = 0;
+
 static unsigned id2bp_hash(char * id) {
     unsigned hash = 0;
     while (*id) hash = (hash >> 16) + hash + (unsigned char)*id++;
@@ -235,7 +360,7 @@ static void remove_instruction(BreakInstruction * bi) {
 
 static BreakInstruction * add_instruction(Context * ctx, ContextAddress address) {
     int hash = addr2instr_hash(address);
-    BreakInstruction * bi = (BreakInstruction *)loc_alloc_zero(sizeof(BreakInstruction));
+    BreakInstruction * bi = (BreakInstruction *)pool_alloc_zero(instruction_pool);
     list_add_last(&bi->link_all, &instructions);
     list_add_last(&bi->link_adr, addr2instr + hash);
     context_lock(ctx);
@@ -244,38 +369,227 @@ static BreakInstruction * add_instruction(Context * ctx, ContextAddress address)
     return bi;
 }
 
+/* Return 1 if breakpoints in memory space 'mem' are being replanted */
+static int is_replant_scope(pid_t mem) {
+    unsigned i;
+    if (replant_event_mem != 0) return mem == replant_event_mem;
+    if (replant_all) return 1;
+    for (i = 0; i < replant_mems_cnt; i++) {
+        if (replant_mems[i] == mem) return 1;
+    }
+    return 0;
+}
+
+/* Return 1 if breakpoints at 'address' in memory space 'mem' are being replanted */
+static int is_replant_address(pid_t mem, ContextAddress address) {
+    unsigned i;
+    if (!is_replant_scope(mem)) return 0;
+    if (!replant_event_ranges) return 1;
+    for (i = 0; i < replant_ranges_cnt; i++) {
+        ReplantRange * r = replant_ranges + i;
+        if (r->mem == mem && address >= r->addr && address - r->addr < r->size) return 1;
+    }
+    return 0;
+}
+
+static void add_unresolved_breakpoint(BreakpointInfo * bp) {
+    if (!is_unresolved(bp)) list_add_last(&bp->link_unresolved, &unresolved_breakpoints);
+}
+
+static void remove_unresolved_breakpoint(BreakpointInfo * bp) {
+    if (!is_unresolved(bp)) return;
+    list_remove(&bp->link_unresolved);
+    list_init(&bp->link_unresolved);
+}
+
 static void clear_instruction_refs(void) {
     LINK * l = instructions.next;
     while (l != &instructions) {
         BreakInstruction * bi = link_all2bi(l);
-        bi->ctx_cnt = 1;
-        bi->ref_cnt = 0;
         l = l->next;
+        if (is_replant_address(bi->ctx->mem, bi->address)) {
+            if (replant_event_ranges) {
+                /* The breakpoints lose this location, they must be evaluated again */
+                int i;
+                for (i = 0; i < bi->ref_cnt; i++) add_unresolved_breakpoint(bi->refs[i]);
+            }
+            bi->ctx_cnt = 1;
+            bi->ref_cnt = 0;
+        }
+        else {
+            /* Instruction is kept as is, count it as planted breakpoint instance or restore its error */
+            int i;
+            for (i = 0; i < bi->ref_cnt; i++) {
+                BreakpointInfo * bp = bi->refs[i];
+                if (!bi->error) bp->planted++;
+                else if (!bp->error) bp->error = bi->error;
+            }
+        }
+    }
+    l = data_breakpoints.next;
+    while (l != &data_breakpoints) {
+        DataBreakpoint * db = link_all2db(l);
+        l = l->next;
+        if (is_replant_address(db->ctx->mem, db->address)) {
+            if (replant_event_ranges) {
+                int i;
+                for (i = 0; i < db->ref_cnt; i++) add_unresolved_breakpoint(db->refs[i]);
+            }
+            db->ref_cnt = 0;
+        }
+        else {
+            int i;
+            for (i = 0; i < db->ref_cnt; i++) {
+                BreakpointInfo * bp = db->refs[i];
+                if (!db->error) bp->planted++;
+                else if (!bp->error) bp->error = db->error;
+            }
+        }
+    }
+}
+
+static void free_instruction(BreakInstruction * bi) {
+    list_remove(&bi->link_all);
+    list_remove(&bi->link_adr);
+    context_unlock(bi->ctx);
+    loc_free(bi->refs);
+    pool_free(instruction_pool, bi);
+}
+
+#if !defined(_WRS_KERNEL)
+
+static int plant_list_sort_func(const void * x, const void * y) {
+    BreakInstruction * bx = *(BreakInstruction **)x;
+    BreakInstruction * by = *(BreakInstruction **)y;
+    if (bx->ctx->mem < by->ctx->mem) return -1;
+    if (bx->ctx->mem > by->ctx->mem) return +1;
+    if (bx->address < by->address) return -1;
+    if (bx->address > by->address) return +1;
+    return 0;
+}
+
+/*
+ * Plant or remove a group of instructions that are close to each other in same memory space,
+ * using one memory read and one memory write for the whole address span.
+ * Planted instructions in the list are removed, others are planted.
+ */
+static void write_instruction_span(BreakInstruction ** list, unsigned cnt) {
+    static char buf[MAX_PLANT_SPAN];
+    Context * ctx = list[0]->ctx;
+    ContextAddress addr = list[0]->address;
+    size_t size = (size_t)(list[cnt - 1]->address + BREAK_SIZE - addr);
+    int error = 0;
+    unsigned i;
+
+    assert(size <= sizeof(buf));
+    if (context_read_mem(ctx, addr, buf, size) < 0) {
+        /* Try one by one, some of the instructions might be accessible */
+        for (i = 0; i < cnt; i++) {
+            BreakInstruction * bi = list[i];
+            if (bi->planted) remove_instruction(bi);
+            else plant_instruction(bi);
+        }
+        return;
+    }
+    for (i = 0; i < cnt; i++) {
+        BreakInstruction * bi = list[i];
+        char * p = buf + (size_t)(bi->address - addr);
+        if (bi->planted) {
+            memcpy(p, bi->saved_code, BREAK_SIZE);
+        }
+        else {
+            memcpy(bi->saved_code, p, BREAK_SIZE);
+            memcpy(p, BREAK_INST, BREAK_SIZE);
+        }
+    }
+    if (context_write_mem(ctx, addr, buf, size) < 0) error = errno;
+    for (i = 0; i < cnt; i++) {
+        BreakInstruction * bi = list[i];
+        bi->error = error;
+        bi->planted = !bi->planted && error == 0;
     }
 }
 
+/* Plant and remove instructions collected in plant_list, sorted by memory space and address */
+static void flush_plant_list(void) {
+    unsigned i = 0;
+
+    for (i = 0; i < plant_list_cnt; i++) {
+        select_instruction_context(plant_list[i]);
+    }
+    qsort(plant_list, plant_list_cnt, sizeof(BreakInstruction *), plant_list_sort_func);
+    i = 0;
+    while (i < plant_list_cnt) {
+        BreakInstruction * bi = plant_list[i];
+        unsigned n = 1;
+        assert(is_replant_scope(bi->ctx->mem));
+        if (bi->ctx->exited || is_running(bi->ctx)) {
+            if (bi->planted) remove_instruction(bi);
+            else plant_instruction(bi);
+            i++;
+            continue;
+        }
+        while (i + n < plant_list_cnt) {
+            BreakInstruction * nx = plant_list[i + n];
+            if (nx->ctx != bi->ctx) break;
+            if (nx->address < plant_list[i + n - 1]->address + BREAK_SIZE) break;
+            if (nx->address + BREAK_SIZE - bi->address > MAX_PLANT_SPAN) break;
+            n++;
+        }
+        write_instruction_span(plant_list + i, n);
+        i += n;
+    }
+    plant_list_cnt = 0;
+}
+
+#endif /* !defined(_WRS_KERNEL) */
+
+static void add_to_plant_list(BreakInstruction * bi) {
+#if defined(_WRS_KERNEL)
+    if (bi->planted) remove_instruction(bi);
+    else plant_instruction(bi);
+#else
+    if (!bi->planted) {
+        assert(!bi->skip_cnt);
+        bi->error = 0;
+    }
+    if (plant_list_cnt >= plant_list_max) {
+        plant_list_max = plant_list_max == 0 ? 64 : plant_list_max * 2;
+        plant_list = (BreakInstruction **)loc_realloc(plant_list, sizeof(BreakInstruction *) * plant_list_max);
+    }
+    plant_list[plant_list_cnt++] = bi;
+#endif
+}
+
 static void delete_unused_instructions(void) {
     LINK * l = instructions.next;
     while (l != &instructions) {
         BreakInstruction * bi = link_all2bi(l);
         l = l->next;
         if (bi->skip_cnt) continue;
+        if (!is_replant_scope(bi->ctx->mem)) continue;
         if (bi->ref_cnt == 0) {
-            list_remove(&bi->link_all);
-            list_remove(&bi->link_adr);
-            if (bi->planted) remove_instruction(bi);
-            context_unlock(bi->ctx);
-            loc_free(bi->refs);
-            loc_free(bi);
+            if (bi->planted) add_to_plant_list(bi);
+            else free_instruction(bi);
         }
         else if (!bi->planted) {
-            plant_instruction(bi);
+            add_to_plant_list(bi);
         }
         else if (!verify_instruction(bi)) {
             remove_instruction(bi);
-            plant_instruction(bi);
+            add_to_plant_list(bi);
         }
     }
+#if !defined(_WRS_KERNEL)
+    flush_plant_list();
+#endif
+    l = instructions.next;
+    while (l != &instructions) {
+        BreakInstruction * bi = link_all2bi(l);
+        l = l->next;
+        if (bi->skip_cnt) continue;
+        if (bi->ref_cnt == 0 && !bi->planted) free_instruction(bi);
+    }
 }
 
 static BreakInstruction * find_instruction(Context * ctx, ContextAddress address) {
@@ -289,6 +603,85 @@ static BreakInstruction * find_instruction(Context * ctx, ContextAddress address
     return NULL;
 }
 
+static void free_data_breakpoint(DataBreakpoint * db) {
+    list_remove(&db->link_all);
+    context_unlock(db->ctx);
+    loc_free(db->refs);
+    loc_free(db);
+}
+
+/* Set or clear ('mode' 0) hardware watchpoint slot in all threads of the memory space */
+static int set_data_breakpoint(DataBreakpoint * db, int mode) {
+    LINK * qp;
+    assert(db->slot >= 0);
+    for (qp = context_root.next; qp != &context_root; qp = qp->next) {
+        Context * ctx = ctxl2ctxp(qp);
+        if (ctx->mem != db->ctx->mem) continue;
+        if (ctx->exited || !ctx->stopped) continue;
+        if (ctx->stepping_over_wp) continue;
+        if (context_set_hw_watchpoint(ctx, db->slot, db->address, db->size, mode) < 0) return -1;
+    }
+    return 0;
+}
+
+static int alloc_data_breakpoint_slot(Context * ctx) {
+    int slot;
+    unsigned used = 0;
+    int cnt = context_get_hw_watchpoint_cnt(ctx);
+    LINK * l;
+
+    for (l = data_breakpoints.next; l != &data_breakpoints; l = l->next) {
+        DataBreakpoint * db = link_all2db(l);
+        if (db->ctx->mem == ctx->mem && db->slot >= 0) used |= 1u << db->slot;
+    }
+    for (slot = 0; slot < cnt; slot++) {
+        if ((used & (1u << slot)) == 0) return slot;
+    }
+    /* Take over a slot of a watchpoint that is not referenced anymore */
+    for (l = data_breakpoints.next; l != &data_breakpoints; l = l->next) {
+        DataBreakpoint * db = link_all2db(l);
+        if (db->ctx->mem == ctx->mem && db->slot >= 0 && db->ref_cnt == 0) {
+            slot = db->slot;
+            free_data_breakpoint(db);
+            return slot;
+        }
+    }
+    errno = cnt == 0 ? ERR_UNSUPPORTED : ERR_HWBRK_NO_RESOURCES;
+    return -1;
+}
+
+static void delete_unused_data_breakpoints(void) {
+    LINK * l = data_breakpoints.next;
+    while (l != &data_breakpoints) {
+        DataBreakpoint * db = link_all2db(l);
+        l = l->next;
+        if (!is_replant_scope(db->ctx->mem)) continue;
+        if (db->ref_cnt > 0) continue;
+        if (db->slot >= 0 && set_data_breakpoint(db, 0) < 0) {
+            trace(LOG_ALWAYS, "Breakpoints: cannot clear hardware watchpoint: %s", errno_to_str(errno));
+        }
+        free_data_breakpoint(db);
+    }
+}
+
+/* Find watchpoint that stopped the context: by the slot reported by hardware, or by address if the slot is not known */
+static DataBreakpoint * find_data_breakpoint(Context * ctx) {
+    ContextAddress address = ctx->wp_address;
+    LINK * l = data_breakpoints.next;
+    while (l != &data_breakpoints) {
+        DataBreakpoint * db = link_all2db(l);
+        l = l->next;
+        if (db->ctx->mem != ctx->mem || db->slot < 0) continue;
+        if (ctx->wp_slot >= 0) {
+            if (db->slot == ctx->wp_slot) return db;
+        }
+        else if (address >= db->address && address - db->address < db->size) {
+            return db;
+        }
+    }
+    return NULL;
+}
+
 void check_breakpoints_on_memory_read(Context * ctx, ContextAddress address, void * p, size_t size) {
 #if !defined(_WRS_KERNEL)
     int i;
@@ -334,6 +727,7 @@ void check_breakpoints_on_memory_write(Context * ctx, ContextAddress address, vo
 
 static void write_breakpoint_status(OutputStream * out, BreakpointInfo * bp) {
     BreakpointAttribute * u = bp->unsupported;
+    int props = 1;
 
     assert(*bp->id);
     write_stream(out, '{');
@@ -386,6 +780,40 @@ static void write_breakpoint_status(OutputStream * out, BreakpointInfo * bp) {
             write_stream(out, '}');
             cnt++;
         }
+        l = data_breakpoints.next;
+        while (l != &data_breakpoints) {
+            int i = 0;
+            DataBreakpoint * db = link_all2db(l);
+            l = l->next;
+            while (i < db->ref_cnt && db->refs[i] != bp) i++;
+            if (i >= db->ref_cnt) continue;
+            if (cnt > 0) write_stream(out, ',');
+            write_stream(out, '{');
+            json_write_string(out, "LocationContext");
+            write_stream(out, ':');
+            json_write_string(out, container_id(db->ctx));
+            write_stream(out, ',');
+            json_write_string(out, "Type");
+            write_stream(out, ':');
+            json_write_string(out, "Hardware");
+            write_stream(out, ',');
+            if (db->error != 0) {
+                json_write_string(out, "Error");
+                write_stream(out, ':');
+                json_write_string(out, errno_to_str(db->error));
+            }
+            else {
+                json_write_string(out, "Address");
+                write_stream(out, ':');
+                json_write_ulong(out, db->address);
+                write_stream(out, ',');
+                json_write_string(out, "Size");
+                write_stream(out, ':');
+                json_write_ulong(out, db->size);
+            }
+            write_stream(out, '}');
+            cnt++;
+        }
         write_stream(out, ']');
         assert(cnt > 0);
     }
@@ -399,6 +827,45 @@ static void write_breakpoint_status(OutputStream * out, BreakpointInfo * bp) {
             json_write_string(out, errno_to_str(bp->error));
         }
     }
+    else {
+        props = 0;
+    }
+
+    if (bp->condition_cnt > 0) {
+        /* Hit rate and evaluation time of breakpoint condition */
+        if (props) write_stream(out, ',');
+        json_write_string(out, "ConditionHits");
+        write_stream(out, ':');
+        json_write_ulong(out, bp->condition_cnt);
+        write_stream(out, ',');
+        json_write_string(out, "ConditionTrue");
+        write_stream(out, ':');
+        json_write_ulong(out, bp->condition_true_cnt);
+        write_stream(out, ',');
+        json_write_string(out, "ConditionTime");
+        write_stream(out, ':');
+        json_write_uint64(out, bp->condition_time);
+        props = 1;
+    }
+
+#if SERVICE_Streams
+    if (bp->trace_stream != NULL) {
+        char id[256];
+        virtual_stream_get_id(bp->trace_stream, id, sizeof(id));
+        if (props) write_stream(out, ',');
+        json_write_string(out, "TraceStream");
+        write_stream(out, ':');
+        json_write_string(out, id);
+        write_stream(out, ',');
+        json_write_string(out, "TraceRecords");
+        write_stream(out, ':');
+        json_write_ulong(out, bp->trace_records);
+        write_stream(out, ',');
+        json_write_string(out, "TraceDropped");
+        write_stream(out, ':');
+        json_write_ulong(out, bp->trace_dropped);
+    }
+#endif
 
     write_stream(out, '}');
 }
@@ -415,28 +882,167 @@ static void send_event_breakpoint_status(OutputStream * out, BreakpointInfo * bp
     write_stream(out, MARKER_EOM);
 }
 
-static void address_expression_error(BreakpointInfo * bp) {
-    /* TODO: per-context address expression error report */
-    size_t size;
-    const char * err_txt;
-    assert(errno != 0);
+/* Report condition statistics of breakpoints whose conditions were evaluated since last report */
+static void event_condition_status(void * arg) {
+    int event_cnt = 0;
+    LINK * l = breakpoints.next;
+
+    assert(condition_status_posted);
+    condition_status_posted = 0;
+    while (l != &breakpoints) {
+        BreakpointInfo * bp = link_all2bp(l);
+        l = l->next;
+        if (bp->deleted || !*bp->id) continue;
+        if (bp->status_condition_cnt == bp->condition_cnt) continue;
+        send_event_breakpoint_status(&broadcast_group->out, bp);
+        bp->status_condition_cnt = bp->condition_cnt;
+        event_cnt++;
+    }
+    if (event_cnt > 0) flush_stream(&broadcast_group->out);
+}
+
+static void set_breakpoint_error(BreakpointInfo * bp, int error, const char * msg) {
     if (bp->error) return;
-    bp->error = get_exception_errno(errno);
-    err_txt = errno_to_str(errno);
-    size = strlen(bp->address) + strlen(err_txt) + 128;
+    bp->error = error;
     assert(bp->err_msg == NULL);
-    bp->err_msg = loc_alloc(size);
-    snprintf(bp->err_msg, size, "Invalid address '%s': %s", bp->address, err_txt);
+    bp->err_msg = loc_strdup(msg);
+}
+
+/* Remember error of memory space 'mem', so a replant of other memory spaces does not lose it */
+static void add_mem_space_error(BreakpointInfo * bp, pid_t mem, int error, const char * msg) {
+    int i;
+    for (i = 0; i < bp->mem_errors_cnt; i++) {
+        if (bp->mem_errors[i].mem == mem) return;
+    }
+    if (bp->mem_errors_cnt >= bp->mem_errors_max) {
+        bp->mem_errors_max = bp->mem_errors_max == 0 ? 4 : bp->mem_errors_max * 2;
+        bp->mem_errors = (MemSpaceError *)loc_realloc(bp->mem_errors, sizeof(MemSpaceError) * bp->mem_errors_max);
+    }
+    bp->mem_errors[bp->mem_errors_cnt].mem = mem;
+    bp->mem_errors[bp->mem_errors_cnt].error = error;
+    bp->mem_errors[bp->mem_errors_cnt].msg = loc_strdup(msg);
+    bp->mem_errors_cnt++;
+}
+
+/*
+ * Drop errors of memory spaces that are being replanted or are gone,
+ * and report the first remaining one, since it is not evaluated again in this pass.
+ */
+static void restore_mem_space_errors(BreakpointInfo * bp) {
+    int i = 0;
+    while (i < bp->mem_errors_cnt) {
+        MemSpaceError * e = bp->mem_errors + i;
+        Context * ctx = context_find_from_pid(e->mem);
+        if (is_replant_scope(e->mem) || ctx == NULL || ctx->exited) {
+            loc_free(e->msg);
+            *e = bp->mem_errors[--bp->mem_errors_cnt];
+        }
+        else {
+            i++;
+        }
+    }
+    if (bp->mem_errors_cnt > 0) set_breakpoint_error(bp, bp->mem_errors[0].error, bp->mem_errors[0].msg);
+}
+
+static void free_mem_space_errors(BreakpointInfo * bp) {
+    int i;
+    for (i = 0; i < bp->mem_errors_cnt; i++) loc_free(bp->mem_errors[i].msg);
+    bp->mem_errors_cnt = 0;
+}
+
+/* Report address expression error, 'ctx' is NULL if the error does not depend on context */
+static void address_expression_error(BreakpointInfo * bp, Context * ctx) {
+    /* TODO: per-context address expression error report */
+    char msg[256];
+    int error = get_exception_errno(errno);
+    assert(errno != 0);
+    snprintf(msg, sizeof(msg), "Invalid address '%s': %s", bp->address, errno_to_str(errno));
+    if (ctx != NULL) add_mem_space_error(bp, ctx->mem, error, msg);
+    set_breakpoint_error(bp, error, msg);
+    if (error != ERR_SYM_NOT_FOUND) trace(LOG_ALWAYS, "Breakpoints: %s", msg);
+}
+
+static void plant_watchpoint_in_context(BreakpointInfo * bp, Context * ctx, ContextAddress address) {
+    DataBreakpoint * db = NULL;
+    ContextAddress size = bp->size > 0 ? bp->size : 1;
+    int mode = 0;
+    LINK * l;
+
+    if (bp->access_mode & ACCESSMODE_CHANGE) {
+        /* Debug registers cannot compare data values */
+        if (!bp->error) bp->error = ERR_UNSUPPORTED;
+        return;
+    }
+    if (bp->access_mode & ACCESSMODE_READ) mode |= CTX_WP_READ;
+    if (bp->access_mode & ACCESSMODE_WRITE) mode |= CTX_WP_WRITE;
+    /* Watchpoints are set in all threads of a memory space */
+    if (ctx->parent != NULL && ctx->mem == ctx->parent->mem) ctx = ctx->parent;
+
+    for (l = data_breakpoints.next; l != &data_breakpoints; l = l->next) {
+        DataBreakpoint * p = link_all2db(l);
+        if (p->ctx->mem == ctx->mem && p->address == address && p->size == size && p->mode == mode) {
+            db = p;
+            break;
+        }
+    }
+    if (db == NULL) {
+        db = (DataBreakpoint *)loc_alloc_zero(sizeof(DataBreakpoint));
+        list_add_last(&db->link_all, &data_breakpoints);
+        context_lock(ctx);
+        db->ctx = ctx;
+        db->address = address;
+        db->size = size;
+        db->mode = mode;
+        db->slot = -1;
+    }
+    else {
+        int i = 0;
+        while (i < db->ref_cnt && db->refs[i] != bp) i++;
+        if (i < db->ref_cnt) return;
+    }
+    if (db->ref_cnt == 0) {
+        /* First reference in this replant pass: (re)program the slot, new threads might not have it yet */
+        db->error = 0;
+        if (db->slot < 0 && (db->slot = alloc_data_breakpoint_slot(ctx)) < 0) {
+            db->error = errno;
+        }
+        else if (set_data_breakpoint(db, mode) < 0) {
+            db->error = errno;
+            set_data_breakpoint(db, 0);
+            db->slot = -1;
+        }
+        if (db->error) {
+            trace(LOG_ALWAYS, "Breakpoints: cannot set hardware watchpoint at %#lx: %s",
+                address, errno_to_str(db->error));
+        }
+    }
+    if (db->ref_cnt >= db->ref_size) {
+        db->ref_size = db->ref_size == 0 ? 8 : db->ref_size * 2;
+        db->refs = (BreakpointInfo **)loc_realloc(db->refs, sizeof(BreakpointInfo *) * db->ref_size);
+    }
+    db->refs[db->ref_cnt++] = bp;
+    if (db->error) {
+        if (!bp->error) bp->error = db->error;
+    }
+    else {
+        bp->planted++;
+    }
 }
 
 static void plant_breakpoint_in_context(BreakpointInfo * bp, Context * ctx, ContextAddress address) {
     BreakInstruction * bi = NULL;
     if (address == 0) return;
+    if (!is_replant_scope(ctx->mem)) return;
+    if (is_data_breakpoint(bp)) {
+        plant_watchpoint_in_context(bp, ctx, address);
+        return;
+    }
     bi = find_instruction(ctx, address);
     if (bi == NULL) {
         bi = add_instruction(ctx, address);
     }
-    else if (bp->planted) {
+    else if (bp->planted || replant_event_ranges) {
+        /* Instructions outside of replanted ranges keep their references */
         int i = 0;
         while (i < bi->ref_cnt && bi->refs[i] != bp) i++;
         if (i < bi->ref_cnt) return;
@@ -465,25 +1071,39 @@ static void plant_breakpoint_address_iterator(void * x, ContextAddress address)
     plant_breakpoint_in_context(args->bp, args->ctx, address);
 }
 
+#if SERVICE_LineNumbers
+static int plant_line_breakpoint(BreakpointInfo * bp, Context * ctx) {
+    PlantBreakpointArgs args;
+    unsigned i;
+
+    args.ctx = ctx;
+    args.bp = bp;
+    if (!replant_event_ranges || is_unresolved(bp)) {
+        return line_to_address(ctx, bp->file, bp->line, bp->column, plant_breakpoint_address_iterator, &args);
+    }
+    /* Locations of the breakpoint in other modules are kept, search only newly loaded modules */
+    for (i = 0; i < replant_ranges_cnt; i++) {
+        ReplantRange * r = replant_ranges + i;
+        if (r->mem != ctx->mem) continue;
+        if (line_to_address_in_range(ctx, r->addr, r->addr + r->size - 1, bp->file, bp->line, bp->column,
+                plant_breakpoint_address_iterator, &args) < 0) return -1;
+    }
+    return 0;
+}
+#endif
+
 static void plant_breakpoint(BreakpointInfo * bp) {
     LINK * qp;
     int context_sensitive_address = 0;
     ContextAddress bp_addr = 0;
 
-    assert(!bp->planted);
     assert(bp->enabled);
-    bp->error = 0;
-    if (bp->err_msg != NULL) {
-        loc_free(bp->err_msg);
-        bp->err_msg = NULL;
-    }
 
     if (bp->address != NULL) {
         Value v;
         if (evaluate_expression(NULL, STACK_NO_FRAME, bp->address, 1, &v) < 0) {
             if (errno != ERR_INV_CONTEXT) {
-                address_expression_error(bp);
-                trace(LOG_ALWAYS, "Breakpoints: %s", bp->err_msg);
+                address_expression_error(bp, NULL);
                 return;
             }
             context_sensitive_address = 1;
@@ -491,7 +1111,7 @@ static void plant_breakpoint(BreakpointInfo * bp) {
         if (!context_sensitive_address) {
             if (v.type_class != TYPE_CLASS_INTEGER && v.type_class != TYPE_CLASS_CARDINAL) {
                 errno = ERR_INV_DATA_TYPE;
-                address_expression_error(bp);
+                address_expression_error(bp, NULL);
                 return;
             }
             bp_addr = value_to_address(&v);
@@ -512,6 +1132,7 @@ static void plant_breakpoint(BreakpointInfo * bp) {
 
         if (ctx->exited || ctx->exiting) continue;
         if (is_running(ctx)) continue;
+        if (!is_replant_scope(ctx->mem)) continue;
 
         if (bp->condition != NULL) {
             /* Optimize away the breakpoint if condition is always false for given context */
@@ -525,32 +1146,25 @@ static void plant_breakpoint(BreakpointInfo * bp) {
             if (bp->address != NULL) {
                 Value v;
                 if (evaluate_expression(ctx, STACK_NO_FRAME, bp->address, 1, &v) < 0) {
-                    address_expression_error(bp);
-                    if (bp->error != ERR_SYM_NOT_FOUND) {
-                        trace(LOG_ALWAYS, "Breakpoints: %s", bp->err_msg);
-                    }
+                    address_expression_error(bp, ctx);
                     continue;
                 }
                 if (v.type_class != TYPE_CLASS_INTEGER && v.type_class != TYPE_CLASS_CARDINAL && v.type_class != TYPE_CLASS_POINTER) {
                     errno = ERR_INV_DATA_TYPE;
-                    address_expression_error(bp);
+                    address_expression_error(bp, ctx);
                     continue;
                 }
                 plant_breakpoint_in_context(bp, ctx, value_to_address(&v));
             }
 #if SERVICE_LineNumbers
             else if (bp->file != NULL) {
-                PlantBreakpointArgs args;
                 if (ctx->parent != NULL && ctx->mem == ctx->parent->mem) continue;
-                args.ctx = ctx;
-                args.bp = bp;
-                if (line_to_address(ctx, bp->file, bp->line, bp->column,
-                        plant_breakpoint_address_iterator, &args) < 0) {
-                    assert(errno != 0);
+                if (plant_line_breakpoint(bp, ctx) < 0) {
+                    int error = errno;
+                    assert(error != 0);
+                    add_mem_space_error(bp, ctx->mem, error, errno_to_str(error));
                     if (bp->error == 0) {
-                        bp->error = errno;
-                        assert(bp->err_msg == NULL);
-                        bp->err_msg = loc_strdup(errno_to_str(bp->error));
+                        set_breakpoint_error(bp, error, errno_to_str(error));
                         trace(LOG_ALWAYS, "Breakpoints: %s", bp->err_msg);
                     }
                 }
@@ -568,8 +1182,122 @@ static void plant_breakpoint(BreakpointInfo * bp) {
     if (bp->planted) bp->error = 0;
 }
 
+/* Microseconds of monotonic clock, not affected by system time changes */
+static uint64_t time_stamp(void) {
+    struct timespec timenow;
+    if (clock_gettime(CLOCK_MONOTONIC, &timenow)) return 0;
+    return (uint64_t)timenow.tv_sec * 1000000 + timenow.tv_nsec / 1000;
+}
+
+#if SERVICE_Streams
+
+static char * trace_buf = NULL;
+static size_t trace_buf_size = 0;
+static size_t trace_buf_pos = 0;
+
+static void trace_stream_callback(VirtualStream * stream, int event, void * args) {
+    /* Tracepoint data is only written by the agent, no need to handle stream events */
+}
+
+/* Create or delete virtual stream of tracepoint data when tracepoint properties change */
+static void update_trace_stream(BreakpointInfo * bp) {
+    if (bp->trace_cnt > 0 && bp->trace_stream == NULL) {
+        virtual_stream_create(BREAKPOINTS, bp->id, TRACE_STREAM_SIZE, VS_ENABLE_REMOTE_READ,
+            trace_stream_callback, bp, &bp->trace_stream);
+        bp->trace_records = 0;
+        bp->trace_dropped = 0;
+        bp->trace_dropped_last = 0;
+    }
+    else if (bp->trace_cnt == 0 && bp->trace_stream != NULL) {
+        virtual_stream_delete(bp->trace_stream);
+        bp->trace_stream = NULL;
+    }
+}
+
+static void trace_buf_add(const void * data, size_t size) {
+    if (trace_buf_pos + size > trace_buf_size) {
+        trace_buf_size = trace_buf_size == 0 ? 0x1000 : trace_buf_size * 2;
+        if (trace_buf_pos + size > trace_buf_size) trace_buf_size = trace_buf_pos + size;
+        trace_buf = (char *)loc_realloc(trace_buf, trace_buf_size);
+    }
+    memcpy(trace_buf + trace_buf_pos, data, size);
+    trace_buf_pos += size;
+}
+
+static void trace_buf_add_u4(uint32_t n) {
+    unsigned char buf[4];
+    int i;
+    for (i = 0; i < 4; i++) buf[i] = (unsigned char)(n >> (24 - i * 8));
+    trace_buf_add(buf, sizeof(buf));
+}
+
+static void trace_buf_add_u8(uint64_t n) {
+    trace_buf_add_u4((uint32_t)(n >> 32));
+    trace_buf_add_u4((uint32_t)n);
+}
+
+/*
+ * Evaluate tracepoint expressions and append a record to the tracepoint stream.
+ * Record layout, numbers are big endian regardless of agent byte order:
+ *   u4 record size, u4 flags, u4 count of records dropped since previous record,
+ *   u8 time stamp (microseconds of monotonic clock), u4 context ID length, context ID,
+ *   u4 expressions count, then for each expression: u4 error code, u4 value size, value bytes.
+ * Value bytes are in target byte order, TRACE_RECORD_BIG_ENDIAN flag is set if it is big endian.
+ * Records are not overwritten: if the stream buffer has no space for a record, the record is
+ * dropped and counted in TraceDropped breakpoint status property and in the next record.
+ */
+static void collect_trace_data(Context * ctx, BreakpointInfo * bp) {
+    int i;
+    size_t size = 0;
+    uint32_t flags = 0;
+    uint16_t one = 1;
+    char * id = thread_id(ctx);
+    size_t done = 0;
+
+    assert(bp->trace_stream != NULL);
+    if (*(char *)&one != 1) flags |= TRACE_RECORD_BIG_ENDIAN;
+    trace_buf_pos = 0;
+    trace_buf_add_u4(0);
+    trace_buf_add_u4(flags);
+    trace_buf_add_u4((uint32_t)bp->trace_dropped_last);
+    trace_buf_add_u8(time_stamp());
+    trace_buf_add_u4((uint32_t)strlen(id));
+    trace_buf_add(id, strlen(id));
+    trace_buf_add_u4((uint32_t)bp->trace_cnt);
+    for (i = 0; i < bp->trace_cnt; i++) {
+        Value v;
+        if (evaluate_expression(ctx, STACK_TOP_FRAME, bp->trace_exprs[i], 1, &v) < 0) {
+            trace_buf_add_u4((uint32_t)errno);
+            trace_buf_add_u4(0);
+        }
+        else {
+            size = v.size;
+            if (size > MAX_TRACE_VALUE_SIZE) size = MAX_TRACE_VALUE_SIZE;
+            trace_buf_add_u4(0);
+            trace_buf_add_u4((uint32_t)size);
+            trace_buf_add(v.value, size);
+        }
+    }
+    size = trace_buf_pos;
+    trace_buf_pos = 0;
+    trace_buf_add_u4((uint32_t)size);
+    trace_buf_pos = size;
+    if (virtual_stream_get_space(bp->trace_stream) < trace_buf_pos) {
+        bp->trace_dropped++;
+        bp->trace_dropped_last++;
+        return;
+    }
+    virtual_stream_add_data(bp->trace_stream, trace_buf, trace_buf_pos, &done, 0);
+    assert(done == trace_buf_pos);
+    bp->trace_dropped_last = 0;
+    bp->trace_records++;
+}
+
+#endif /* SERVICE_Streams */
+
 static void free_bp(BreakpointInfo * bp) {
     list_remove(&bp->link_all);
+    remove_unresolved_breakpoint(bp);
     if (&bp->id) list_remove(&bp->link_id);
     loc_free(bp->err_msg);
     loc_free(bp->address);
@@ -577,6 +1305,12 @@ static void free_bp(BreakpointInfo * bp) {
     loc_free(bp->file);
 #endif
     loc_free(bp->condition);
+    free_mem_space_errors(bp);
+    loc_free(bp->mem_errors);
+    loc_free(bp->trace_exprs);
+#if SERVICE_Streams
+    if (bp->trace_stream != NULL) virtual_stream_delete(bp->trace_stream);
+#endif
     while (bp->unsupported != NULL) {
         BreakpointAttribute * u = bp->unsupported;
         bp->unsupported = u->next;
@@ -588,22 +1322,54 @@ static void free_bp(BreakpointInfo * bp) {
     loc_free(bp);
 }
 
+static void post_replant_event(void);
+
 static void event_replant_breakpoints(void * arg) {
+    unsigned i;
     int event_cnt = 0;
     LINK * l = breakpoints.next;
 
     replanting = 0;
+    trace(LOG_CONTEXT, "Breakpoints: replanting in %s", replant_event_mem == 0 && replant_all ? "all memory spaces" :
+        replant_event_ranges ? "new modules" : "changed memory spaces");
+    while (l != &breakpoints) {
+        BreakpointInfo * bp = link_all2bp(l);
+        l = l->next;
+        bp->planted = 0;
+        if (bp->enabled && bp->unsupported == NULL) {
+            /*
+             * Planting and watchpoint errors of memory spaces that are not replanted are restored
+             * by clear_instruction_refs(), address errors by restore_mem_space_errors()
+             */
+            bp->error = 0;
+            if (bp->err_msg != NULL) {
+                loc_free(bp->err_msg);
+                bp->err_msg = NULL;
+            }
+            restore_mem_space_errors(bp);
+        }
+        else {
+            free_mem_space_errors(bp);
+        }
+    }
     clear_instruction_refs();
+    l = breakpoints.next;
     while (l != &breakpoints) {
         BreakpointInfo * bp = link_all2bp(l);
         l = l->next;
         if (bp->deleted) {
-            free_bp(bp);
+            /* Deleted breakpoint can be disposed only when all memory spaces are replanted */
+            if (replant_all && replant_event_mem == 0) free_bp(bp);
             continue;
         }
-        bp->planted = 0;
         if (bp->enabled && bp->unsupported == NULL) {
-            plant_breakpoint(bp);
+            /* New modules cannot change locations of resolved address breakpoints */
+            if (!replant_event_ranges || is_unresolved(bp) || is_line_breakpoint(bp)) plant_breakpoint(bp);
+            if (bp->error || !bp->planted || bp->mem_errors_cnt > 0) add_unresolved_breakpoint(bp);
+            else remove_unresolved_breakpoint(bp);
+        }
+        else {
+            remove_unresolved_breakpoint(bp);
         }
         if (*bp->id) {
             if (bp->status_unsupported != (bp->unsupported != NULL) ||
@@ -613,19 +1379,204 @@ static void event_replant_breakpoints(void * arg) {
                 bp->status_unsupported = bp->unsupported != NULL;
                 bp->status_error = bp->error;
                 bp->status_planted = bp->planted;
+                bp->status_condition_cnt = bp->condition_cnt;
                 event_cnt++;
             }
         }
     }
     delete_unused_instructions();
+    delete_unused_data_breakpoints();
     if (event_cnt > 0) flush_stream(&broadcast_group->out);
+    i = 0;
+    while (i < replant_ranges_cnt) {
+        if (is_replant_scope(replant_ranges[i].mem)) replant_ranges[i] = replant_ranges[--replant_ranges_cnt];
+        else i++;
+    }
+    if (replant_event_mem != 0) {
+        /* Only one memory space was stopped, other pending replant requests need another safe event */
+        i = 0;
+        while (i < replant_mems_cnt && !replant_event_ranges) {
+            if (replant_mems[i] == replant_event_mem) replant_mems[i] = replant_mems[--replant_mems_cnt];
+            else i++;
+        }
+        replant_event_ranges = 0;
+        replant_event_mem = 0;
+        if (replant_all || replant_mems_cnt > 0 || replant_ranges_cnt > 0) post_replant_event();
+    }
+    else {
+        replant_all = 0;
+        replant_mems_cnt = 0;
+        if (replant_ranges_cnt > 0) post_replant_event();
+    }
 }
 
-static void replant_breakpoints(void) {
-    if (list_is_empty(&breakpoints) && list_is_empty(&instructions)) return;
+static void post_replant_event(void) {
     if (replanting) return;
     replanting = 1;
-    post_safe_event(0, event_replant_breakpoints, NULL);
+    replant_event_ranges = 0;
+    if (replant_all || replant_mems_cnt > 1) {
+        replant_event_mem = 0;
+    }
+    else if (replant_mems_cnt == 1) {
+        replant_event_mem = replant_mems[0];
+    }
+    else {
+        /* Only modules were loaded: replant in address ranges of the modules of one memory space */
+        assert(replant_ranges_cnt > 0);
+        replant_event_mem = replant_ranges[0].mem;
+        replant_event_ranges = 1;
+    }
+    post_safe_event(replant_event_mem, event_replant_breakpoints, NULL);
+}
+
+/* Replant breakpoints in all memory spaces, used when breakpoint properties change */
+static void replant_breakpoints(void) {
+    if (list_is_empty(&breakpoints) && list_is_empty(&instructions) && list_is_empty(&data_breakpoints)) return;
+    replant_all = 1;
+    post_replant_event();
+}
+
+/* Replant breakpoints in one memory space only, used when contexts or memory map of the space change */
+static void replant_memory_space(pid_t mem) {
+    unsigned i;
+    if (list_is_empty(&breakpoints) && list_is_empty(&instructions) && list_is_empty(&data_breakpoints)) return;
+    if (!replant_all) {
+        for (i = 0; i < replant_mems_cnt; i++) {
+            if (replant_mems[i] == mem) break;
+        }
+        if (i == replant_mems_cnt) {
+            if (replant_mems_cnt >= replant_mems_max) {
+                replant_mems_max = replant_mems_max == 0 ? 16 : replant_mems_max * 2;
+                replant_mems = (pid_t *)loc_realloc(replant_mems, sizeof(pid_t) * replant_mems_max);
+            }
+            replant_mems[replant_mems_cnt++] = mem;
+        }
+    }
+    post_replant_event();
+}
+
+#if SERVICE_MemoryMap
+
+static MemSpaceFiles * find_mapped_files(pid_t mem) {
+    unsigned i;
+    for (i = 0; i < mapped_files_cnt; i++) {
+        if (mapped_files[i].mem == mem) return mapped_files + i;
+    }
+    return NULL;
+}
+
+static void free_mapped_files(pid_t mem) {
+    MemSpaceFiles * m = find_mapped_files(mem);
+    if (m == NULL) return;
+    loc_free(m->files);
+    *m = mapped_files[--mapped_files_cnt];
+}
+
+static void add_replant_range(pid_t mem, ContextAddress addr, ContextAddress size) {
+    ReplantRange * r = NULL;
+    if (replant_ranges_cnt > 0) {
+        /* Adjacent mappings of a module make one range */
+        r = replant_ranges + replant_ranges_cnt - 1;
+        if (r->mem == mem && r->addr + r->size == addr) {
+            r->size += size;
+            return;
+        }
+    }
+    if (replant_ranges_cnt >= replant_ranges_max) {
+        replant_ranges_max = replant_ranges_max == 0 ? 16 : replant_ranges_max * 2;
+        replant_ranges = (ReplantRange *)loc_realloc(replant_ranges, sizeof(ReplantRange) * replant_ranges_max);
+    }
+    r = replant_ranges + replant_ranges_cnt++;
+    r->mem = mem;
+    r->addr = addr;
+    r->size = size;
+}
+
+/*
+ * Remember file mappings of memory space of 'ctx'. If 'add_ranges' is set, file mappings
+ * that were not seen by previous call are added to replant ranges.
+ * Return 0 if file mappings of the memory space were not known.
+ */
+static int update_mapped_files(Context * ctx, int add_ranges) {
+    MemoryRegion * regions = NULL;
+    unsigned region_cnt = 0;
+    MemSpaceFiles * m = find_mapped_files(ctx->mem);
+    MappedFile * files = NULL;
+    unsigned files_cnt = 0;
+    unsigned i;
+    unsigned j = 0;
+
+    memory_map_get_regions(ctx, &regions, &region_cnt);
+    files = (MappedFile *)loc_alloc(sizeof(MappedFile) * (region_cnt + 1));
+    for (i = 0; i < region_cnt; i++) {
+        MemoryRegion * r = regions + i;
+        MappedFile * f = files + files_cnt;
+        if (r->ino == 0) continue;
+        f->addr = r->addr;
+        f->size = r->size;
+        f->dev = r->dev;
+        f->ino = r->ino;
+        files_cnt++;
+        if (m == NULL || !add_ranges) continue;
+        while (j < m->files_cnt && m->files[j].addr < f->addr) j++;
+        if (j < m->files_cnt && m->files[j].addr == f->addr && m->files[j].size == f->size &&
+            m->files[j].dev == f->dev && m->files[j].ino == f->ino) continue;
+        add_replant_range(ctx->mem, f->addr, f->size);
+    }
+    if (files_cnt == 0) {
+        /* Memory map is not available, file mappings cannot be compared */
+        loc_free(files);
+        free_mapped_files(ctx->mem);
+        return 0;
+    }
+    if (m == NULL) {
+        if (mapped_files_cnt >= mapped_files_max) {
+            mapped_files_max = mapped_files_max == 0 ? 16 : mapped_files_max * 2;
+            mapped_files = (MemSpaceFiles *)loc_realloc(mapped_files, sizeof(MemSpaceFiles) * mapped_files_max);
+        }
+        m = mapped_files + mapped_files_cnt++;
+        m->mem = ctx->mem;
+        m->files = files;
+        m->files_cnt = files_cnt;
+        return 0;
+    }
+    loc_free(m->files);
+    m->files = files;
+    m->files_cnt = files_cnt;
+    return 1;
+}
+
+static int has_line_breakpoints(void) {
+    LINK * l;
+    for (l = breakpoints.next; l != &breakpoints; l = l->next) {
+        BreakpointInfo * bp = link_all2bp(l);
+        if (!bp->deleted && bp->enabled && is_line_breakpoint(bp)) return 1;
+    }
+    return 0;
+}
+
+#endif /* SERVICE_MemoryMap */
+
+/*
+ * Replant breakpoints after modules are loaded into memory space of 'ctx'.
+ * Only address ranges of the new modules are searched for line breakpoints,
+ * and only unresolved breakpoints are evaluated again.
+ */
+static void replant_new_modules(Context * ctx) {
+#if SERVICE_MemoryMap
+    unsigned cnt = replant_ranges_cnt;
+    if (update_mapped_files(ctx, 1)) {
+        if (replant_ranges_cnt == cnt) return;
+        if (list_is_empty(&unresolved_breakpoints) && !has_line_breakpoints()) {
+            /* No breakpoint can bind in the new modules */
+            replant_ranges_cnt = cnt;
+            return;
+        }
+        post_replant_event();
+        return;
+    }
+#endif
+    replant_memory_space(ctx->mem);
 }
 
 static int str_equ(char * x, char * y) {
@@ -635,6 +1586,15 @@ static int str_equ(char * x, char * y) {
     return strcmp(x, y) == 0;
 }
 
+static int str_arr_equ(char ** x, int x_cnt, char ** y, int y_cnt) {
+    int i;
+    if (x_cnt != y_cnt) return 0;
+    for (i = 0; i < x_cnt; i++) {
+        if (strcmp(x[i], y[i]) != 0) return 0;
+    }
+    return 1;
+}
+
 static int copy_breakpoint_info(BreakpointInfo * dst, BreakpointInfo * src) {
     int res = 0;
 
@@ -656,6 +1616,10 @@ static int copy_breakpoint_info(BreakpointInfo * dst, BreakpointInfo * src) {
     if (!str_equ(dst->condition, src->condition)) {
         loc_free(dst->condition);
         dst->condition = src->condition;
+        dst->condition_cnt = 0;
+        dst->condition_true_cnt = 0;
+        dst->condition_time = 0;
+        dst->status_condition_cnt = 0;
         res = 1;
     }
     else {
@@ -690,6 +1654,28 @@ static int copy_breakpoint_info(BreakpointInfo * dst, BreakpointInfo * src) {
         res = 1;
     }
 
+    if (dst->access_mode != src->access_mode) {
+        dst->access_mode = src->access_mode;
+        res = 1;
+    }
+
+    if (dst->size != src->size) {
+        dst->size = src->size;
+        res = 1;
+    }
+
+    if (!str_arr_equ(dst->trace_exprs, dst->trace_cnt, src->trace_exprs, src->trace_cnt)) {
+        loc_free(dst->trace_exprs);
+        dst->trace_exprs = src->trace_exprs;
+        dst->trace_cnt = src->trace_cnt;
+        res = 1;
+    }
+    else {
+        loc_free(src->trace_exprs);
+    }
+    src->trace_exprs = NULL;
+    src->trace_cnt = 0;
+
     if (dst->enabled != src->enabled) {
         dst->enabled = src->enabled;
         res = 1;
@@ -735,57 +1721,38 @@ static BreakpointRef * find_breakpoint_ref(BreakpointInfo * bp, InputStream * in
     return NULL;
 }
 
-static void read_breakpoint_properties(InputStream * inp, BreakpointInfo * bp) {
-    memset(bp, 0, sizeof(BreakpointInfo));
-    if (read_stream(inp) != '{') exception(ERR_JSON_SYNTAX);
-    if (peek_stream(inp) == '}') {
-        read_stream(inp);
-    }
-    else {
-        for (;;) {
-            int ch;
-            char name[256];
-            json_read_string(inp, name, sizeof(name));
-            if (read_stream(inp) != ':') exception(ERR_JSON_SYNTAX);
-            if (strcmp(name, "ID") == 0) {
-                json_read_string(inp, bp->id, sizeof(bp->id));
-            }
-            else if (strcmp(name, "Location") == 0) {
-                bp->address = json_read_alloc_string(inp);
-            }
-            else if (strcmp(name, "Condition") == 0) {
-                bp->condition = json_read_alloc_string(inp);
-            }
+static const JsonStructMember breakpoint_members[] = {
+    { "ID", JSON_MEMBER_STRING, offsetof(BreakpointInfo, id), sizeof(((BreakpointInfo *)0)->id) },
+    { "Location", JSON_MEMBER_ALLOC_STRING, offsetof(BreakpointInfo, address), 0 },
+    { "Condition", JSON_MEMBER_ALLOC_STRING, offsetof(BreakpointInfo, condition), 0 },
 #if SERVICE_LineNumbers
-            else if (strcmp(name, "File") == 0) {
-                bp->file = json_read_alloc_string(inp);
-            }
-            else if (strcmp(name, "Line") == 0) {
-                bp->line = json_read_long(inp);
-            }
-            else if (strcmp(name, "Column") == 0) {
-                bp->column = json_read_long(inp);
-            }
+    { "File", JSON_MEMBER_ALLOC_STRING, offsetof(BreakpointInfo, file), 0 },
+    { "Line", JSON_MEMBER_INT, offsetof(BreakpointInfo, line), 0 },
+    { "Column", JSON_MEMBER_INT, offsetof(BreakpointInfo, column), 0 },
 #endif
-            else if (strcmp(name, "IgnoreCount") == 0) {
-                bp->ignore_count = json_read_long(inp);
-            }
-            else if (strcmp(name, "Enabled") == 0) {
-                bp->enabled = json_read_boolean(inp);
-            }
-            else {
-                BreakpointAttribute * u = (BreakpointAttribute *)loc_alloc(sizeof(BreakpointAttribute));
-                u->name = loc_strdup(name);
-                u->value = json_skip_object(inp);
-                u->next = bp->unsupported;
-                bp->unsupported = u;
-            }
-            ch = read_stream(inp);
-            if (ch == ',') continue;
-            if (ch == '}') break;
-            exception(ERR_JSON_SYNTAX);
-        }
-    }
+    { "IgnoreCount", JSON_MEMBER_INT, offsetof(BreakpointInfo, ignore_count), 0 },
+    { "AccessMode", JSON_MEMBER_INT, offsetof(BreakpointInfo, access_mode), 0 },
+    { "Size", JSON_MEMBER_INT, offsetof(BreakpointInfo, size), 0 },
+    { "Enabled", JSON_MEMBER_BOOLEAN, offsetof(BreakpointInfo, enabled), 0 },
+#if SERVICE_Streams
+    { "TraceExpressions", JSON_MEMBER_STRING_ARRAY, offsetof(BreakpointInfo, trace_exprs), offsetof(BreakpointInfo, trace_cnt) },
+#endif
+    { NULL, 0, 0, 0 }
+};
+
+static void read_unsupported_property(InputStream * inp, char * name, void * args) {
+    BreakpointInfo * bp = (BreakpointInfo *)args;
+    BreakpointAttribute * u = (BreakpointAttribute *)loc_alloc(sizeof(BreakpointAttribute));
+    u->name = loc_strdup(name);
+    u->value = json_read_object(inp);
+    u->next = bp->unsupported;
+    bp->unsupported = u;
+}
+
+static void read_breakpoint_properties(InputStream * inp, BreakpointInfo * bp) {
+    memset(bp, 0, sizeof(BreakpointInfo));
+    if (peek_stream(inp) != '{') exception(ERR_JSON_SYNTAX);
+    json_read_struct_members(inp, breakpoint_members, bp, read_unsupported_property, bp);
 }
 
 static void write_breakpoint_properties(OutputStream * out, BreakpointInfo * bp) {
@@ -842,6 +1809,20 @@ static void write_breakpoint_properties(OutputStream * out, BreakpointInfo * bp)
         json_write_long(out, bp->ignore_count);
     }
 
+    if (bp->access_mode != 0) {
+        write_stream(out, ',');
+        json_write_string(out, "AccessMode");
+        write_stream(out, ':');
+        json_write_long(out, bp->access_mode);
+    }
+
+    if (bp->size > 0) {
+        write_stream(out, ',');
+        json_write_string(out, "Size");
+        write_stream(out, ':');
+        json_write_long(out, bp->size);
+    }
+
     if (bp->enabled) {
         write_stream(out, ',');
         json_write_string(out, "Enabled");
@@ -849,6 +1830,19 @@ static void write_breakpoint_properties(OutputStream * out, BreakpointInfo * bp)
         json_write_boolean(out, bp->enabled);
     }
 
+    if (bp->trace_cnt > 0) {
+        int i;
+        write_stream(out, ',');
+        json_write_string(out, "TraceExpressions");
+        write_stream(out, ':');
+        write_stream(out, '[');
+        for (i = 0; i < bp->trace_cnt; i++) {
+            if (i > 0) write_stream(out, ',');
+            json_write_string(out, bp->trace_exprs[i]);
+        }
+        write_stream(out, ']');
+    }
+
     while (u != NULL) {
         write_stream(out, ',');
         json_write_string(out, u->name);
@@ -915,9 +1909,13 @@ static void add_breakpoint(Channel * c, BreakpointInfo * bp) {
         list_init(&p->refs);
         list_add_last(&p->link_all, &breakpoints);
         list_add_last(&p->link_id, id2bp + hash);
+        list_add_last(&p->link_unresolved, &unresolved_breakpoints);
         added = 1;
     }
     chng = copy_breakpoint_info(p, bp);
+#if SERVICE_Streams
+    if (chng || added) update_trace_stream(p);
+#endif
     if (p->deleted) {
         p->deleted = 0;
         added = 1;
@@ -1252,11 +2250,18 @@ static void command_bp_remove(char * token, Channel * c) {
 
 static void command_get_capabilities(char * token, Channel * c) {
     char id[256];
+    Context * ctx = NULL;
+    int access_mode = ACCESSMODE_EXECUTE;
+    int wp_cnt = 0;
 
     json_read_string(&c->inp, id, sizeof(id));
     if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
     if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
 
+    ctx = id2ctx(id);
+    wp_cnt = context_get_hw_watchpoint_cnt(ctx);
+    if (wp_cnt > 0) access_mode |= ACCESSMODE_READ | ACCESSMODE_WRITE;
+
     write_stringz(&c->out, "R");
     write_stringz(&c->out, token);
     write_errno(&c->out, 0);
@@ -1291,6 +2296,18 @@ static void command_get_capabilities(char * token, Channel * c) {
     json_write_string(&c->out, "Condition");
     write_stream(&c->out, ':');
     json_write_boolean(&c->out, 1);
+    write_stream(&c->out, ',');
+    json_write_string(&c->out, "AccessMode");
+    write_stream(&c->out, ':');
+    json_write_long(&c->out, access_mode);
+    write_stream(&c->out, ',');
+    json_write_string(&c->out, "Size");
+    write_stream(&c->out, ':');
+    json_write_boolean(&c->out, wp_cnt > 0);
+    write_stream(&c->out, ',');
+    json_write_string(&c->out, "HardwareWatchpoints");
+    write_stream(&c->out, ':');
+    json_write_long(&c->out, wp_cnt);
     write_stream(&c->out, '}');
     write_stream(&c->out, 0);
 
@@ -1302,23 +2319,35 @@ int is_breakpoint_address(Context * ctx, ContextAddress address) {
     return bi != NULL && bi->planted;
 }
 
-void evaluate_breakpoint_condition(Context * ctx) {
+int evaluate_breakpoint_condition(Context * ctx) {
     int i;
+    int callbacks = 0;
     size_t size = 0;
-    BreakInstruction * bi = find_instruction(ctx, get_regs_PC(ctx->regs));
+    BreakpointInfo ** refs = NULL;
+    int ref_cnt = 0;
 
     assert(ctx->stopped);
-    assert(ctx->stopped_by_bp);
-    loc_free(ctx->bp_ids);
+    assert(ctx->stopped_by_bp || ctx->stopped_by_wp);
     ctx->bp_ids = NULL;
-    if (bi == NULL) return;
+    if (ctx->stopped_by_wp) {
+        DataBreakpoint * db = find_data_breakpoint(ctx);
+        if (db == NULL) return 0;
+        refs = db->refs;
+        ref_cnt = db->ref_cnt;
+    }
+    else {
+        BreakInstruction * bi = find_instruction(ctx, get_regs_PC(ctx->regs));
+        if (bi == NULL) return 0;
+        refs = bi->refs;
+        ref_cnt = bi->ref_cnt;
+    }
 
-    for (i = 0; i < bi->ref_cnt; i++) {
-        bi->refs[i]->triggered = 0;
+    for (i = 0; i < ref_cnt; i++) {
+        refs[i]->triggered = 0;
     }
 
-    for (i = 0; i < bi->ref_cnt; i++) {
-        BreakpointInfo * bp = bi->refs[i];
+    for (i = 0; i < ref_cnt; i++) {
+        BreakpointInfo * bp = refs[i];
         assert(bp->planted);
         assert(bp->error == 0);
         if (bp->deleted) continue;
@@ -1326,19 +2355,37 @@ void evaluate_breakpoint_condition(Context * ctx) {
         if (!bp->enabled) continue;
         if (bp->condition != NULL) {
             Value v;
+            int ok = 0;
+            uint64_t t = time_stamp();
             if (evaluate_expression(ctx, STACK_TOP_FRAME, bp->condition, 1, &v) < 0) {
                 trace(LOG_ALWAYS, "%s: %s", errno_to_str(errno), bp->condition);
+                ok = 1;
+            }
+            else {
+                ok = value_to_boolean(&v);
             }
-            else if (!value_to_boolean(&v)) {
-                continue;
+            bp->condition_time += time_stamp() - t;
+            bp->condition_cnt++;
+            if (!condition_status_posted && *bp->id) {
+                /* Condition statistics are reported by status events, at most once per CONDITION_STATUS_DELAY */
+                post_event_with_delay(event_condition_status, NULL, CONDITION_STATUS_DELAY);
+                condition_status_posted = 1;
             }
+            if (!ok) continue;
+            bp->condition_true_cnt++;
         }
         bp->hit_count++;
         if (bp->hit_count <= bp->ignore_count) continue;
         bp->hit_count = 0;
         if (bp->event_callback != NULL) {
             bp->event_callback(ctx, bp->event_callback_args);
+            callbacks++;
         }
+#if SERVICE_Streams
+        else if (bp->trace_stream != NULL) {
+            collect_trace_data(ctx, bp);
+        }
+#endif
         else {
             ctx->pending_intercept = 1;
             bp->triggered = 1;
@@ -1348,11 +2395,11 @@ void evaluate_breakpoint_condition(Context * ctx) {
 
     if (size > 0) {
         size_t mem_size = size + sizeof(char *);
-        char ** list = loc_alloc(mem_size);
+        char ** list = (char **)arena_alloc(&ctx->stop_arena, mem_size);
         char * pool = (char *)list + mem_size;
         ctx->bp_ids = list;
-        for (i = 0; i < bi->ref_cnt; i++) {
-            BreakpointInfo * bp = bi->refs[i];
+        for (i = 0; i < ref_cnt; i++) {
+            BreakpointInfo * bp = refs[i];
             if (bp->triggered) {
                 size_t n = strlen(bp->id) + 1;
                 pool -= n;
@@ -1363,6 +2410,7 @@ void evaluate_breakpoint_condition(Context * ctx) {
         *list++ = NULL;
         assert((char *)list == pool);
     }
+    return size == 0 && callbacks == 0;
 }
 
 #ifndef _WRS_KERNEL
@@ -1414,6 +2462,55 @@ static void safe_skip_breakpoint(void * arg) {
     }
 }
 
+static void safe_restore_watchpoints(void * arg) {
+    Context * ctx = (Context *)arg;
+    LINK * l = data_breakpoints.next;
+
+    assert(ctx->stepping_over_wp);
+    ctx->stepping_over_wp = 0;
+    while (!ctx->exited && l != &data_breakpoints) {
+        DataBreakpoint * db = link_all2db(l);
+        l = l->next;
+        if (db->ctx->mem != ctx->mem || db->slot < 0) continue;
+        if (context_set_hw_watchpoint(ctx, db->slot, db->address, db->size, db->mode) < 0) {
+            trace(LOG_ALWAYS, "Breakpoints: cannot restore hardware watchpoint: %s", errno_to_str(errno));
+        }
+    }
+    context_unlock(ctx);
+}
+
+static void safe_skip_watchpoints(void * arg) {
+    Context * ctx = (Context *)arg;
+    LINK * l = data_breakpoints.next;
+    int error = 0;
+
+    if (ctx->exited) {
+        safe_restore_watchpoints(ctx);
+        return;
+    }
+
+    assert(ctx->stopped);
+    assert(!ctx->intercepted);
+    while (error == 0 && l != &data_breakpoints) {
+        DataBreakpoint * db = link_all2db(l);
+        l = l->next;
+        if (db->ctx->mem != ctx->mem || db->slot < 0) continue;
+        if (context_set_hw_watchpoint(ctx, db->slot, 0, 0, 0) < 0) error = errno;
+    }
+
+    if (error == 0) {
+        post_safe_event(ctx->mem, safe_restore_watchpoints, ctx);
+        if (context_single_step(ctx) < 0) error = errno;
+    }
+    else {
+        safe_restore_watchpoints(ctx);
+    }
+
+    if (error) {
+        trace(LOG_ALWAYS, "Skip watchpoint error: %d %s", error, errno_to_str(error));
+    }
+}
+
 #endif /* ifndef _WRS_KERNEL */
 
 /*
@@ -1430,14 +2527,23 @@ int skip_breakpoint(Context * ctx, int single_step) {
     assert(!ctx->exited);
     assert(ctx->stopped);
     assert(single_step || ctx->stepping_over_bp == NULL);
+    assert(single_step || !ctx->stepping_over_wp);
 
-    if (ctx->stepping_over_bp != NULL) return 0;
-    if (ctx->exited || ctx->exiting || !ctx->stopped_by_bp) return 0;
+    if (ctx->stepping_over_bp != NULL || ctx->stepping_over_wp) return 0;
+    if (ctx->exited || ctx->exiting) return 0;
 
 #ifdef _WRS_KERNEL
     /* VxWork debug library can skip breakpoint when neccesary, no code is needed here */
     return 0;
 #else
+    if (ctx->stopped_by_wp && ctx->wp_step_over) {
+        /* The watched access is done when the context resumes: step over it with watchpoints disabled */
+        ctx->stepping_over_wp = 1;
+        context_lock(ctx);
+        post_safe_event(ctx->mem, safe_skip_watchpoints, ctx);
+        return 1;
+    }
+    if (!ctx->stopped_by_bp) return 0;
     assert(!ctx->regs_error);
     bi = find_instruction(ctx, get_regs_PC(ctx->regs));
     if (bi == NULL || bi->error) return 0;
@@ -1445,7 +2551,9 @@ int skip_breakpoint(Context * ctx, int single_step) {
     ctx->stepping_over_bp = bi;
     assert(bi->skip_cnt > 0);
     context_lock(ctx);
-    post_safe_event(ctx->mem, safe_skip_breakpoint, ctx);
+    /* If other threads of the memory are stopped already, step over the breakpoint now */
+    if (is_safe_event_ready(ctx->mem)) safe_skip_breakpoint(ctx);
+    else post_safe_event(ctx->mem, safe_skip_breakpoint, ctx);
     return 1;
 #endif
 }
@@ -1459,6 +2567,7 @@ BreakpointInfo * create_eventpoint(char * location, EventPointCallBack * callbac
     list_init(&p->refs);
     assert(breakpoints.next != NULL);
     list_add_last(&p->link_all, &breakpoints);
+    list_add_last(&p->link_unresolved, &unresolved_breakpoints);
     replant_breakpoints();
     return p;
 }
@@ -1468,7 +2577,25 @@ void destroy_eventpoint(BreakpointInfo * eventpoint) {
 }
 
 static void event_context_changed(Context * ctx, void * client_data) {
-    replant_breakpoints();
+#if SERVICE_MemoryMap
+    if (ctx->parent == NULL) {
+        /* Process created, exited or executed new program: start tracking its file mappings again */
+        free_mapped_files(ctx->mem);
+        if (!ctx->exited) update_mapped_files(ctx, 0);
+    }
+#endif
+    replant_memory_space(ctx->mem);
+}
+
+static void event_module_loaded(Context * ctx, void * client_data) {
+    replant_new_modules(ctx);
+}
+
+static void event_module_unloaded(Context * ctx, void * client_data) {
+#if SERVICE_MemoryMap
+    /* Forget unloaded mappings, so a module loaded at same address is seen as new */
+    if (find_mapped_files(ctx->mem) != NULL) update_mapped_files(ctx, 0);
+#endif
 }
 
 static void event_code_unmapped(Context * ctx, ContextAddress addr, ContextAddress size, void * client_data) {
@@ -1493,6 +2620,7 @@ static void channel_close_listener(Channel * c) {
 void ini_breakpoints_service(Protocol * proto, TCFBroadcastGroup * bcg) {
     int i;
     broadcast_group = bcg;
+    instruction_pool = mem_pool_create("BreakInstruction", sizeof(BreakInstruction), 0);
 
     {
         static ContextEventListener listener = {
@@ -1506,13 +2634,16 @@ void ini_breakpoints_service(Protocol * proto, TCFBroadcastGroup * bcg) {
     }
     {
         static MemoryMapEventListener listener = {
-            event_context_changed,
+            event_module_loaded,
             event_code_unmapped,
+            event_module_unloaded,
         };
         add_memory_map_event_listener(&listener, NULL);
     }
     list_init(&breakpoints);
+    list_init(&unresolved_breakpoints);
     list_init(&instructions);
+    list_init(&data_breakpoints);
     for (i = 0; i < ADDR2INSTR_HASH_SIZE; i++) list_init(addr2instr + i);
     for (i = 0; i < ID2BP_HASH_SIZE; i++) list_init(id2bp + i);
     for (i = 0; i < INP2BR_HASH_SIZE; i++) list_init(inp2br + i);
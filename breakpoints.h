@@ -32,8 +32,9 @@ typedef struct BreakpointInfo BreakpointInfo;
 /*
  * The function is called from context.c every time a context is stopped by breakpoint.
  * The function evaluates breakpoint condition and sets ctx->intercepted = 1 if the condition is true.
+ * Return 1 if no breakpoint was triggered, so the context can be resumed right away.
  */
-extern void evaluate_breakpoint_condition(Context * ctx);
+extern int evaluate_breakpoint_condition(Context * ctx);
 
 /*
  * When a context is stopped by breakpoint, it is necessary to disable
@@ -66,7 +67,7 @@ extern void destroy_eventpoint(BreakpointInfo * eventpoint);
 
 #else /* SERVICE_Breakpoints */
 
-#define evaluate_breakpoint_condition(ctx)
+#define evaluate_breakpoint_condition(ctx) 0
 #define skip_breakpoint(ctx, single_step) 0
 #define is_breakpoint_address(ctx, address) 0
 #define check_breakpoints_on_memory_read(ctx, address, buf, size)
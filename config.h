@@ -103,6 +103,9 @@
 #if !defined(ENABLE_ELF)
 #define ENABLE_ELF              ((TARGET_UNIX || TARGET_VXWORKS) && (SERVICE_Symbols || SERVICE_LineNumbers))
 #endif
+#if !defined(ENABLE_DwarfIndex)
+#define ENABLE_DwarfIndex       (ENABLE_ELF && TARGET_UNIX)
+#endif
 #if !defined(ENABLE_SSL)
 #define ENABLE_SSL              ((TARGET_UNIX) && !defined(__APPLE__))
 #endif
@@ -112,6 +115,12 @@
 #if !defined(ENABLE_AIO)
 #define ENABLE_AIO              defined(_POSIX_ASYNCHRONOUS_IO)
 #endif
+#if !defined(ENABLE_MemPool)
+#define ENABLE_MemPool          1
+#endif
+#if !defined(ENABLE_AllocStats)
+#define ENABLE_AllocStats       0
+#endif
 
 #ifdef CONFIG_MAIN
 /*
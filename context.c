@@ -219,6 +219,7 @@ unsigned signal_code(int signal) {
 #define CONTEXT_PID_ROOT_SIZE 1024
 #define CONTEXT_PID_HASH(PID) ((unsigned)(PID) % CONTEXT_PID_ROOT_SIZE)
 static LINK context_pid_root[CONTEXT_PID_ROOT_SIZE];
+static MemPool * context_pool = NULL;
 
 LINK context_root = { NULL, NULL };
 
@@ -248,8 +249,8 @@ void context_unlock(Context * ctx) {
         assert(ctx->parent == NULL);
         list_remove(&ctx->ctxl);
         list_remove(&ctx->pidl);
-        loc_free(ctx->bp_ids);
-        loc_free(ctx);
+        arena_dispose(&ctx->stop_arena);
+        pool_free(context_pool, ctx);
     }
 }
 
@@ -265,7 +266,7 @@ static void link_context(Context * ctx) {
 }
 
 static Context * create_context(pid_t pid) {
-    Context * ctx = (Context *)loc_alloc_zero(sizeof(Context));
+    Context * ctx = (Context *)pool_alloc_zero(context_pool);
 
     ctx->pid = pid;
     list_init(&ctx->children);
@@ -307,8 +308,11 @@ static void event_context_changed(Context * ctx) {
 static void event_context_stopped(Context * ctx) {
     ContextEventListener * listener = event_listeners;
     assert(ctx->ref_count > 0);
-    if (ctx->stopped_by_bp) {
-        evaluate_breakpoint_condition(ctx);
+    if ((ctx->stopped_by_bp || ctx->stopped_by_wp) && evaluate_breakpoint_condition(ctx) &&
+            !ctx->pending_intercept && !ctx->pending_safe_event &&
+            ctx->pending_signals == 0 && !ctx->exiting) {
+        /* Breakpoint conditions are false: resume the context without broadcasting the stop */
+        if (context_continue(ctx) == 0) return;
     }
     while (listener != NULL) {
         if (listener->context_stopped != NULL) {
@@ -327,6 +331,9 @@ static void event_context_started(Context * ctx) {
         }
         listener = listener->next;
     }
+    /* Stop-scoped data is no longer valid */
+    ctx->bp_ids = NULL;
+    arena_reset(&ctx->stop_arena);
 }
 
 static void event_context_exited(Context * ctx) {
@@ -1601,6 +1608,7 @@ int context_continue(Context * ctx) {
             while ((ctx->pending_signals & (1 << signal)) == 0) signal++;
             if (ctx->sig_dont_pass & (1 << signal)) {
                 ctx->pending_signals &= ~(1 << signal);
+                ctx->sig_resent &= ~(1 << signal);
                 signal = 0;
             }
             else {
@@ -1644,6 +1652,7 @@ int context_continue(Context * ctx) {
         return -1;
     }
     ctx->pending_signals &= ~(1 << signal);
+    ctx->sig_resent &= ~(1 << signal);
     if (syscall_never_returns(ctx)) {
         ctx->syscall_enter = 0;
         ctx->syscall_exit = 0;
@@ -1803,7 +1812,7 @@ static void event_pid_exited(pid_t pid, int status, int signal) {
             assert(list_is_empty(&ctx->children));
             assert(ctx->parent == NULL);
             list_remove(&ctx->ctxl);
-            loc_free(ctx);
+            pool_free(context_pool, ctx);
         }
     }
     else {
@@ -1990,11 +1999,16 @@ static void init(void) {
 #include <sys/ptrace.h>
 #include <asm/unistd.h>
 #include <sched.h>
+#include <fcntl.h>
 
 #define PTRACE_SETOPTIONS       0x4200
 #define PTRACE_GETEVENTMSG      0x4201
 #define PTRACE_GETSIGINFO       0x4202
 #define PTRACE_SETSIGINFO       0x4203
+#ifndef PTRACE_SEIZE
+#define PTRACE_SEIZE            0x4206
+#define PTRACE_INTERRUPT        0x4207
+#endif
 
 #define PTRACE_O_TRACESYSGOOD   0x00000001
 #define PTRACE_O_TRACEFORK      0x00000002
@@ -2010,10 +2024,14 @@ static void init(void) {
 #define PTRACE_EVENT_EXEC       4
 #define PTRACE_EVENT_VFORK_DONE 5
 #define PTRACE_EVENT_EXIT       6
+#define PTRACE_EVENT_STOP       128
 
 #define USE_ESRCH_WORKAROUND    1
 #define USE_PTRACE_SYSCALL      0
 
+/* Memory transfers of at least this size are done through /proc/<pid>/mem instead of PEEK/POKE */
+#define MEM_BULK_MIN_SIZE       64
+
 #if USE_PTRACE_SYSCALL
 #define PTRACE_FLAGS ( \
     PTRACE_O_TRACESYSGOOD | \
@@ -2061,6 +2079,7 @@ char * context_suspend_reason(Context * ctx) {
     static char reason[128];
 
     if (ctx->stopped_by_bp) return "Breakpoint";
+    if (ctx->stopped_by_wp) return "Watchpoint";
     if (ctx->end_of_step) return "Step";
     if (ctx->ptrace_event != 0) {
         assert(ctx->signal == SIGTRAP);
@@ -2096,18 +2115,36 @@ int context_attach_self(void) {
 
 int context_attach(pid_t pid, ContextAttachCallBack * done, void * data, int selfattach) {
     Context * ctx = NULL;
+    int seized = 0;
 
     assert(done != NULL);
-    if (!selfattach && ptrace(PTRACE_ATTACH, pid, 0, 0) < 0) {
-        int err = errno;
-        trace(LOG_ALWAYS, "error: ptrace(PTRACE_ATTACH) failed: pid %d, error %d %s",
-            pid, err, errno_to_str(err));
-        errno = err;
-        return -1;
+    if (!selfattach) {
+        /* PTRACE_SEIZE allows to stop the process and its threads with PTRACE_INTERRUPT
+         * instead of SIGSTOP, it is not supported by kernels older than 3.4 */
+        if (ptrace(PTRACE_SEIZE, pid, 0, PTRACE_FLAGS) == 0) {
+            seized = 1;
+            if (ptrace(PTRACE_INTERRUPT, pid, 0, 0) < 0) {
+                int err = errno;
+                trace(LOG_ALWAYS, "error: ptrace(PTRACE_INTERRUPT) failed: pid %d, error %d %s",
+                    pid, err, errno_to_str(err));
+                ptrace(PTRACE_DETACH, pid, 0, 0);
+                errno = err;
+                return -1;
+            }
+        }
+        else if (ptrace(PTRACE_ATTACH, pid, 0, 0) < 0) {
+            int err = errno;
+            trace(LOG_ALWAYS, "error: ptrace(PTRACE_ATTACH) failed: pid %d, error %d %s",
+                pid, err, errno_to_str(err));
+            errno = err;
+            return -1;
+        }
     }
     ctx = create_context(pid);
     list_add_first(&ctx->ctxl, &pending_list);
     ctx->mem = pid;
+    ctx->ptrace_seized = seized;
+    if (seized) ctx->ptrace_flags = PTRACE_FLAGS;
     ctx->attach_callback = done;
     ctx->attach_data = data;
     ctx->pending_intercept = 1;
@@ -2128,10 +2165,11 @@ int context_stop(Context * ctx) {
     assert(!ctx->stopped);
     assert(!ctx->regs_dirty);
     assert(!ctx->intercepted);
-    if (tkill(ctx->pid, SIGSTOP) < 0) {
+    if (ctx->ptrace_seized ? ptrace(PTRACE_INTERRUPT, ctx->pid, 0, 0) < 0 : tkill(ctx->pid, SIGSTOP) < 0) {
         int err = errno;
         if (err != ESRCH) {
-            trace(LOG_ALWAYS, "error: tkill(SIGSTOP) failed: ctx %#lx, pid %d, error %d %s",
+            trace(LOG_ALWAYS, "error: %s failed: ctx %#lx, pid %d, error %d %s",
+                ctx->ptrace_seized ? "ptrace(PTRACE_INTERRUPT)" : "tkill(SIGSTOP)",
                 ctx, ctx->pid, err, errno_to_str(err));
         }
         errno = err;
@@ -2154,6 +2192,7 @@ static int syscall_never_returns(Context * ctx) {
 
 int context_continue(Context * ctx) {
     int signal = 0;
+    int cont_signal = 0;
 
     assert(is_dispatch_thread());
     assert(ctx->stopped);
@@ -2177,6 +2216,7 @@ int context_continue(Context * ctx) {
         assert(signal != SIGSTOP);
         assert(signal != SIGTRAP);
     }
+    cont_signal = signal;
 
     trace(LOG_CONTEXT, "context: resuming ctx %#lx, pid %d, with signal %d", ctx, ctx->pid, signal);
 #if defined(__i386__) || defined(__x86_64__)
@@ -2203,7 +2243,22 @@ int context_continue(Context * ctx) {
         }
         ctx->regs_dirty = 0;
     }
-    if (ptrace((ctx->ptrace_flags & PTRACE_O_TRACESYSGOOD) != 0 ? PTRACE_SYSCALL : PTRACE_CONT, ctx->pid, 0, signal) < 0) {
+    if (signal != 0 && ctx->ptrace_interrupted) {
+        /* PTRACE_CONT does not deliver a signal when resuming from PTRACE_INTERRUPT stop,
+         * the signal is sent with tkill() and passed on when the thread stops to deliver it */
+        if (tkill(ctx->pid, signal) < 0) {
+            int err = errno;
+            if (err != ESRCH) {
+                trace(LOG_ALWAYS, "error: tkill(%d) failed: ctx %#lx, pid %d, error %d %s",
+                    signal, ctx, ctx->pid, err, errno_to_str(err));
+            }
+        }
+        else {
+            ctx->interrupt_signal = signal;
+        }
+        cont_signal = 0;
+    }
+    if (ptrace((ctx->ptrace_flags & PTRACE_O_TRACESYSGOOD) != 0 ? PTRACE_SYSCALL : PTRACE_CONT, ctx->pid, 0, cont_signal) < 0) {
         int err = errno;
 #if USE_ESRCH_WORKAROUND
         if (err == ESRCH) {
@@ -2218,6 +2273,7 @@ int context_continue(Context * ctx) {
         return -1;
     }
     ctx->pending_signals &= ~(1 << signal);
+    ctx->sig_resent &= ~(1 << signal);
     if (syscall_never_returns(ctx)) {
         ctx->syscall_enter = 0;
         ctx->syscall_exit = 0;
@@ -2278,6 +2334,21 @@ int context_single_step(Context * ctx) {
     return 0;
 }
 
+/* Read or write memory through /proc/<pid>/mem, return -1 if the transfer is not complete */
+static int proc_mem_transfer(Context * ctx, ContextAddress address, void * buf, size_t size, int write) {
+    char fnm[64];
+    ssize_t done = -1;
+    int fd;
+
+    snprintf(fnm, sizeof(fnm), "/proc/%d/mem", ctx->pid);
+    fd = open(fnm, write ? O_WRONLY : O_RDONLY);
+    if (fd < 0) return -1;
+    if (write) done = pwrite(fd, buf, size, (off_t)address);
+    else done = pread(fd, buf, size, (off_t)address);
+    close(fd);
+    return done == (ssize_t)size ? 0 : -1;
+}
+
 int context_write_mem(Context * ctx, ContextAddress address, void * buf, size_t size) {
     ContextAddress word_addr;
     unsigned word_size = context_word_size(ctx);
@@ -2286,6 +2357,7 @@ int context_write_mem(Context * ctx, ContextAddress address, void * buf, size_t
     trace(LOG_CONTEXT, "context: write memory ctx %#lx, pid %d, address %#lx, size %zd",
         ctx, ctx->pid, address, size);
     assert(word_size <= sizeof(unsigned long));
+    if (size >= MEM_BULK_MIN_SIZE && proc_mem_transfer(ctx, address, buf, size, 1) == 0) return 0;
     for (word_addr = address & ~((ContextAddress)word_size - 1); word_addr < address + size; word_addr += word_size) {
         unsigned long word = 0;
         if (word_addr < address || word_addr + word_size > address + size) {
@@ -2327,6 +2399,7 @@ int context_read_mem(Context * ctx, ContextAddress address, void * buf, size_t s
     trace(LOG_CONTEXT, "context: read memory ctx %#lx, pid %d, address %#lx, size %zd",
         ctx, ctx->pid, address, size);
     assert(word_size <= sizeof(unsigned long));
+    if (size >= MEM_BULK_MIN_SIZE && proc_mem_transfer(ctx, address, buf, size, 0) == 0) return 0;
     for (word_addr = address & ~((ContextAddress)word_size - 1); word_addr < address + size; word_addr += word_size) {
         unsigned long word = 0;
         errno = 0;
@@ -2353,6 +2426,201 @@ int context_read_mem(Context * ctx, ContextAddress address, void * buf, size_t s
     return 0;
 }
 
+static int hw_watchpoint_error(Context * ctx, const char * req) {
+    int err = errno;
+#if USE_ESRCH_WORKAROUND
+    if (err == ESRCH) return 0;
+#endif
+    trace(LOG_ALWAYS, "error: ptrace(%s) failed: ctx %#lx, pid %d, error %d %s",
+        req, ctx, ctx->pid, err, errno_to_str(err));
+    errno = err;
+    return -1;
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+
+#define MAX_HW_WATCHPOINTS      4
+#define DR_OFFSET(n)            offsetof(struct user, u_debugreg[n])
+
+int context_get_hw_watchpoint_cnt(Context * ctx) {
+    return MAX_HW_WATCHPOINTS;
+}
+
+int context_set_hw_watchpoint(Context * ctx, int slot, ContextAddress address, ContextAddress size, int mode) {
+    unsigned long dr7 = 0;
+    unsigned long bits = 0;
+
+    assert(is_dispatch_thread());
+    assert(ctx->stopped);
+    assert(slot >= 0 && slot < MAX_HW_WATCHPOINTS);
+    if (mode == 0 && (ctx->hw_wp_mask & (1 << slot)) == 0) return 0;
+    if (mode != 0) {
+        unsigned long len = 0;
+        switch (size) {
+        case 1: len = 0; break;
+        case 2: len = 1; break;
+        case 4: len = 3; break;
+#if defined(__x86_64__)
+        case 8: len = 2; break;
+#endif
+        default:
+            errno = ERR_INV_DATA_SIZE;
+            return -1;
+        }
+        if (address & (size - 1)) {
+            errno = ERR_INV_ADDRESS;
+            return -1;
+        }
+        /* Debug registers cannot watch reads only, read watchpoints trigger on writes too */
+        bits = ((len << 2) | ((mode & CTX_WP_READ) ? 3 : 1)) << (16 + slot * 4);
+        bits |= 1ul << (slot * 2);
+    }
+    trace(LOG_CONTEXT, "context: set hardware watchpoint ctx %#lx, pid %d, slot %d, address %#lx, size %d, mode %d",
+        ctx, ctx->pid, slot, address, (int)size, mode);
+    errno = 0;
+    dr7 = ptrace(PTRACE_PEEKUSER, ctx->pid, DR_OFFSET(7), 0);
+    if (errno != 0) return hw_watchpoint_error(ctx, "PTRACE_PEEKUSER");
+    if (ctx->hw_wp_mask & (1 << slot)) {
+        /* Disable the slot before changing its address */
+        dr7 &= ~((0xful << (16 + slot * 4)) | (3ul << (slot * 2)));
+        if (ptrace(PTRACE_POKEUSER, ctx->pid, DR_OFFSET(7), dr7) < 0) return hw_watchpoint_error(ctx, "PTRACE_POKEUSER");
+        ctx->hw_wp_mask &= ~(1 << slot);
+    }
+    if (mode == 0) return 0;
+    if (ptrace(PTRACE_POKEUSER, ctx->pid, DR_OFFSET(slot), address) < 0) return hw_watchpoint_error(ctx, "PTRACE_POKEUSER");
+    if (ptrace(PTRACE_POKEUSER, ctx->pid, DR_OFFSET(7), dr7 | bits) < 0) return hw_watchpoint_error(ctx, "PTRACE_POKEUSER");
+    ctx->hw_wp_mask |= 1 << slot;
+    return 0;
+}
+
+/* Check debug status register, return 1 if the context was stopped by a watchpoint */
+static int get_hw_watchpoint_hit(Context * ctx) {
+    int slot;
+    unsigned long dr6 = 0;
+
+    errno = 0;
+    dr6 = ptrace(PTRACE_PEEKUSER, ctx->pid, DR_OFFSET(6), 0);
+    if (errno != 0) return 0;
+    for (slot = 0; slot < MAX_HW_WATCHPOINTS; slot++) {
+        if ((dr6 & ctx->hw_wp_mask & (1 << slot)) == 0) continue;
+        ctx->wp_address = ptrace(PTRACE_PEEKUSER, ctx->pid, DR_OFFSET(slot), 0);
+        ctx->wp_slot = slot;
+        ctx->wp_step_over = 0;
+        ptrace(PTRACE_POKEUSER, ctx->pid, DR_OFFSET(6), 0);
+        return 1;
+    }
+    return 0;
+}
+
+#elif defined(__ARMEL__)
+
+#ifndef PTRACE_GETHBPREGS
+#define PTRACE_GETHBPREGS       29
+#define PTRACE_SETHBPREGS       30
+#endif
+#ifndef TRAP_HWBKPT
+#define TRAP_HWBKPT             4
+#endif
+
+#define ARM_WP_LOAD             1
+#define ARM_WP_STORE            2
+#define ARM_WP_USER             2
+
+static int hw_watchpoint_cnt = -1;
+static int hw_watchpoint_max_len = 0;
+
+/* Read debug resources info, ptrace needs a stopped thread, so it is done on the first stop */
+static void get_hw_watchpoint_info(Context * ctx) {
+    /* Watchpoint length in bits 16..23, number of watchpoints in bits 8..15 */
+    unsigned long info = 0;
+    assert(ctx->stopped);
+    if (hw_watchpoint_cnt >= 0) return;
+    if (ptrace(PTRACE_GETHBPREGS, ctx->pid, 0, &info) < 0) {
+        trace(LOG_CONTEXT, "context: cannot read hardware debug info, pid %d: %s", ctx->pid, errno_to_str(errno));
+        return;
+    }
+    hw_watchpoint_cnt = (info >> 8) & 0xff;
+    hw_watchpoint_max_len = (info >> 16) & 0xff;
+}
+
+int context_get_hw_watchpoint_cnt(Context * ctx) {
+    if (hw_watchpoint_cnt < 0 && ctx != NULL && ctx->stopped) get_hw_watchpoint_info(ctx);
+    return hw_watchpoint_cnt < 0 ? 0 : hw_watchpoint_cnt;
+}
+
+int context_set_hw_watchpoint(Context * ctx, int slot, ContextAddress address, ContextAddress size, int mode) {
+    /* Watchpoint registers are numbered negative: address -(2 * slot + 1), control -(2 * slot + 2) */
+    unsigned long ctrl = (0x1 << 5) | (ARM_WP_STORE << 3) | (ARM_WP_USER << 1);
+
+    assert(is_dispatch_thread());
+    assert(ctx->stopped);
+    assert(slot >= 0 && slot < context_get_hw_watchpoint_cnt(ctx));
+    if (mode == 0 && (ctx->hw_wp_mask & (1 << slot)) == 0) return 0;
+    if (mode != 0) {
+        if (size != 1 && size != 2 && size != 4 && (size != 8 || hw_watchpoint_max_len < 8)) {
+            errno = ERR_INV_DATA_SIZE;
+            return -1;
+        }
+        if (address & (size - 1)) {
+            errno = ERR_INV_ADDRESS;
+            return -1;
+        }
+    }
+    trace(LOG_CONTEXT, "context: set hardware watchpoint ctx %#lx, pid %d, slot %d, address %#lx, size %d, mode %d",
+        ctx, ctx->pid, slot, address, (int)size, mode);
+    if (ctx->hw_wp_mask & (1 << slot)) {
+        if (ptrace(PTRACE_SETHBPREGS, ctx->pid, -((slot << 1) + 2), &ctrl) < 0) return hw_watchpoint_error(ctx, "PTRACE_SETHBPREGS");
+        ctx->hw_wp_mask &= ~(1 << slot);
+    }
+    if (mode == 0) return 0;
+    ctrl = ((1ul << size) - 1) << 5;
+    ctrl |= (((mode & CTX_WP_READ) ? ARM_WP_LOAD : 0) | ((mode & CTX_WP_WRITE) ? ARM_WP_STORE : 0)) << 3;
+    ctrl |= (ARM_WP_USER << 1) | 1;
+    if (ptrace(PTRACE_SETHBPREGS, ctx->pid, -((slot << 1) + 1), &address) < 0) return hw_watchpoint_error(ctx, "PTRACE_SETHBPREGS");
+    if (ptrace(PTRACE_SETHBPREGS, ctx->pid, -((slot << 1) + 2), &ctrl) < 0) return hw_watchpoint_error(ctx, "PTRACE_SETHBPREGS");
+    ctx->hw_wp_mask |= 1 << slot;
+    return 0;
+}
+
+/* Check signal info, return 1 if the context was stopped by a watchpoint */
+static int get_hw_watchpoint_hit(Context * ctx) {
+    siginfo_t info;
+
+    memset(&info, 0, sizeof(info));
+    if (ptrace(PTRACE_GETSIGINFO, ctx->pid, 0, &info) < 0) return 0;
+    if (info.si_code != TRAP_HWBKPT) return 0;
+    /* si_addr is the accessed data address, si_errno is the watchpoint address register number */
+    ctx->wp_address = (ContextAddress)info.si_addr;
+    ctx->wp_slot = -1;
+    if (info.si_errno < 0 && (-info.si_errno & 1) != 0) {
+        int slot = (-info.si_errno - 1) >> 1;
+        unsigned long address = 0;
+        if (slot < hw_watchpoint_cnt && (ctx->hw_wp_mask & (1 << slot)) != 0 &&
+                ptrace(PTRACE_GETHBPREGS, ctx->pid, info.si_errno, &address) == 0) {
+            ctx->wp_address = address;
+            ctx->wp_slot = slot;
+        }
+    }
+    /* ARM reports the hit before the access is done */
+    ctx->wp_step_over = 1;
+    return 1;
+}
+
+#else
+
+int context_get_hw_watchpoint_cnt(Context * ctx) {
+    return 0;
+}
+
+int context_set_hw_watchpoint(Context * ctx, int slot, ContextAddress address, ContextAddress size, int mode) {
+    errno = ERR_UNSUPPORTED;
+    return -1;
+}
+
+#define get_hw_watchpoint_hit(ctx) 0
+
+#endif
+
 static Context * find_pending(pid_t pid) {
     LINK * qp = pending_list.next;
     while (qp != &pending_list) {
@@ -2383,7 +2651,7 @@ static void event_pid_exited(pid_t pid, int status, int signal) {
             assert(list_is_empty(&ctx->children));
             assert(ctx->parent == NULL);
             list_remove(&ctx->ctxl);
-            loc_free(ctx);
+            pool_free(context_pool, ctx);
         }
     }
     else {
@@ -2446,6 +2714,14 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
     Context * ctx = NULL;
     Context * ctx2 = NULL;
     Context * pending_eap = NULL;
+    int interrupted = 0;
+
+    if (event == PTRACE_EVENT_STOP) {
+        /* PTRACE_INTERRUPT or group-stop of a seized tracee, handled same way as SIGSTOP */
+        interrupted = 1;
+        event = 0;
+        signal = SIGSTOP;
+    }
 
     trace(LOG_EVENTS, "event: pid %d stopped, signal %d, event %s", pid, signal, event_name(event));
 
@@ -2527,6 +2803,8 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
         trace(LOG_EVENTS, "event: new context 0x%x, pid %d", ctx2, ctx2->pid);
         ctx2->sig_dont_stop = ctx->sig_dont_stop;
         ctx2->sig_dont_pass = ctx->sig_dont_pass;
+        /* Auto-attached children of a seized tracee are seized too */
+        ctx2->ptrace_seized = ctx->ptrace_seized;
         if (event == PTRACE_EVENT_CLONE) {
             ctx2->mem = ctx->mem;
             ctx2->parent = ctx->parent != NULL ? ctx->parent : ctx;
@@ -2541,6 +2819,8 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
         break;
 
     case PTRACE_EVENT_EXEC:
+        /* exec() clears debug registers */
+        ctx->hw_wp_mask = 0;
         if (!ctx->attach_callback) {
             event_context_changed(ctx);
         }
@@ -2550,7 +2830,12 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
     if (signal != SIGSTOP && signal != SIGTRAP) {
         assert(signal < 32);
         ctx->pending_signals |= 1 << signal;
-        if ((ctx->sig_dont_stop & (1 << signal)) == 0) ctx->pending_intercept = 1;
+        if (signal == ctx->interrupt_signal) {
+            /* The signal was reported when it first stopped the thread, now it is only delivered */
+            ctx->sig_resent |= 1 << signal;
+            ctx->interrupt_signal = 0;
+        }
+        else if ((ctx->sig_dont_stop & (1 << signal)) == 0) ctx->pending_intercept = 1;
     }
     if (event == PTRACE_EVENT_EXIT) {
         ctx->exiting = 1;
@@ -2629,9 +2914,14 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
         else {
             ctx->signal = signal;
             ctx->ptrace_event = event;
+            ctx->ptrace_interrupted = interrupted;
             ctx->stopped = 1;
             ctx->stopped_by_bp = 0;
+            ctx->stopped_by_wp = 0;
             ctx->end_of_step = 0;
+#if defined(__ARMEL__)
+            get_hw_watchpoint_info(ctx);
+#endif
             if (ctx->signal == SIGTRAP && ctx->ptrace_event == 0 && !syscall) {
 #if defined(__ARMEL__)
                 ctx->stopped_by_bp = !ctx->regs_error &&
@@ -2640,7 +2930,10 @@ static void event_pid_stopped(pid_t pid, int signal, int event, int syscall) {
                 ctx->stopped_by_bp = !ctx->regs_error &&
                     is_breakpoint_address(ctx, get_regs_PC(ctx->regs) - BREAK_SIZE);
 #endif
-                ctx->end_of_step = !ctx->stopped_by_bp && ctx->pending_step;
+                if (!ctx->stopped_by_bp && ctx->hw_wp_mask != 0) {
+                    ctx->stopped_by_wp = get_hw_watchpoint_hit(ctx);
+                }
+                ctx->end_of_step = !ctx->stopped_by_bp && !ctx->stopped_by_wp && ctx->pending_step;
             }
             ctx->pending_step = 0;
             if (ctx->stopped_by_bp) {
@@ -2681,6 +2974,19 @@ static void init(void) {
 
 #endif
 
+#if defined(WIN32) || defined(_WRS_KERNEL) || defined(__APPLE__)
+
+int context_get_hw_watchpoint_cnt(Context * ctx) {
+    return 0;
+}
+
+int context_set_hw_watchpoint(Context * ctx, int slot, ContextAddress address, ContextAddress size, int mode) {
+    errno = ERR_UNSUPPORTED;
+    return -1;
+}
+
+#endif
+
 unsigned context_word_size(Context * ctx) {
     /* Place holder to support variable context word size */
     return sizeof(ContextAddress);
@@ -2698,6 +3004,7 @@ static void eventpoint_at_main(Context * ctx, void * args) {
 void ini_contexts(void) {
     int i;
 
+    context_pool = mem_pool_create("Context", sizeof(Context), 0);
     list_init(&context_root);
     for (i = 0; i < CONTEXT_PID_ROOT_SIZE; i++) {
         list_init(&context_pid_root[i]);
@@ -21,6 +21,7 @@
 
 #include "config.h"
 #include "link.h"
+#include "myalloc.h"
 
 extern LINK context_root;
 
@@ -45,7 +46,12 @@ struct Context {
     pid_t               mem;                /* context memory space identifier */
     int                 stopped;            /* OS kernel has stopped this context */
     int                 stopped_by_bp;      /* stopped by breakpoint */
+    int                 stopped_by_wp;      /* stopped by hardware watchpoint */
+    ContextAddress      wp_address;         /* if stopped by watchpoint, address of the watchpoint */
+    int                 wp_slot;            /* if stopped by watchpoint, hardware slot that was hit, -1 if not known */
+    int                 wp_step_over;       /* watched memory access is not done yet, it must be stepped over before resuming */
     void *              stepping_over_bp;   /* if not NULL context is stepping over a breakpoint */
+    int                 stepping_over_wp;   /* context is stepping over a watched memory access */
     char **             bp_ids;             /* if stopped by breakpoint, contains NULL-terminated list of breakpoint IDs */
     int                 exiting;            /* context is about to exit */
     int                 exited;             /* context exited */
@@ -56,12 +62,14 @@ struct Context {
     unsigned long       pending_signals;    /* bitset of signals that were received, but not handled yet */
     unsigned long       sig_dont_stop;      /* bitset of signals that should not be intercepted by the debugger */
     unsigned long       sig_dont_pass;      /* bitset of signals that should not be delivered to the context */
+    unsigned long       sig_resent;         /* bitset of pending signals that were already reported and are re-sent by the debugger */
     int                 signal;             /* signal that stopped this context */
     REG_SET             regs;               /* copy of context registers, updated when context stops */
     int                 regs_error;         /* if not 0, 'regs' is invalid */
     int                 regs_dirty;         /* if not 0, 'regs' is modified and needs to be saved before context is continued */
     void *              stack_trace;        /* pointer to StackTrace service data cache */
     void *              memory_map;         /* pointer to MemoryMap service data cache */
+    MemArena            stop_arena;         /* memory for data that is valid while the context is stopped, released when it resumes */
 #if ENABLE_RCBP_TEST
     int                 test_process;       /* if not 0, the process is test process started by Diagnostics service */
 #endif
@@ -88,12 +96,16 @@ struct Context {
     void *              attach_data;
     void *              pending_events;  /* waiting for clone or fork to bind this to parent */
     int                 ptrace_flags;
+    int                 ptrace_seized;   /* attached with PTRACE_SEIZE, can be stopped with PTRACE_INTERRUPT */
+    int                 ptrace_interrupted; /* stopped by PTRACE_INTERRUPT, PTRACE_CONT cannot deliver a signal */
+    int                 interrupt_signal; /* signal sent with tkill() after PTRACE_INTERRUPT stop */
     int                 ptrace_event;
     int                 syscall_enter;
     int                 syscall_exit;
     int                 syscall_id;
     ContextAddress      syscall_pc;
     int                 end_of_step;
+    unsigned            hw_wp_mask;      /* bitset of hardware watchpoint slots set in the thread */
 #endif
 #if ENABLE_ELF
     int                 debug_structure_searched;
@@ -211,6 +223,24 @@ extern int context_read_mem(Context * ctx, ContextAddress address, void * buf, s
  */
 extern unsigned context_word_size(Context * ctx);
 
+/* Hardware watchpoint access modes */
+#define CTX_WP_READ     1
+#define CTX_WP_WRITE    2
+
+/*
+ * Return number of hardware watchpoint (data breakpoint) slots of the context,
+ * return 0 if hardware watchpoints are not supported or the number is not known yet.
+ * 'ctx' can be NULL.
+ */
+extern int context_get_hw_watchpoint_cnt(Context * ctx);
+
+/*
+ * Set hardware watchpoint 'slot' of the context (thread), 'mode' 0 clears the slot.
+ * The context must be stopped.
+ * Return -1 and set errno if the watchpoint cannot be set.
+ */
+extern int context_set_hw_watchpoint(Context * ctx, int slot, ContextAddress address, ContextAddress size, int mode);
+
 #else /* ENABLE_DebugContext */
 
 #define context_find_from_pid(pid) NULL
@@ -220,6 +250,8 @@ extern unsigned context_word_size(Context * ctx);
 #define context_read_mem(ctx, address, buf, size) (errno = ERR_INV_CONTEXT, -1)
 #define context_write_mem(ctx, address, buf, size) (errno = ERR_INV_CONTEXT, -1)
 #define context_word_size(ctx) sizeof(void *)
+#define context_get_hw_watchpoint_cnt(ctx) 0
+#define context_set_hw_watchpoint(ctx, slot, address, size, mode) (errno = ERR_UNSUPPORTED, -1)
 
 #endif /* ENABLE_DebugContext */
 
@@ -313,6 +313,214 @@ static void command_dispose_test_stream(char * token, Channel * c) {
     write_stream(&c->out, MARKER_EOM);
 }
 
+typedef struct PoolStatsArgs {
+    OutputStream * out;
+    int cnt;
+} PoolStatsArgs;
+
+static void write_pool_stats(const MemPoolStats * s, void * x) {
+    PoolStatsArgs * args = (PoolStatsArgs *)x;
+    OutputStream * out = args->out;
+
+    if (args->cnt++ > 0) write_stream(out, ',');
+    write_stream(out, '{');
+    json_write_string(out, "Name");
+    write_stream(out, ':');
+    json_write_string(out, s->name);
+    write_stream(out, ',');
+    json_write_string(out, "ObjSize");
+    write_stream(out, ':');
+    json_write_ulong(out, (unsigned long)s->obj_size);
+    write_stream(out, ',');
+    json_write_string(out, "Allocs");
+    write_stream(out, ':');
+    json_write_ulong(out, s->alloc_cnt);
+    write_stream(out, ',');
+    json_write_string(out, "Frees");
+    write_stream(out, ':');
+    json_write_ulong(out, s->free_cnt);
+    write_stream(out, ',');
+    json_write_string(out, "Slabs");
+    write_stream(out, ':');
+    json_write_ulong(out, s->slab_cnt);
+    write_stream(out, ',');
+    json_write_string(out, "Objects");
+    write_stream(out, ':');
+    json_write_ulong(out, s->obj_cnt);
+    write_stream(out, '}');
+}
+
+#if ENABLE_AllocStats
+
+static int cmp_site_live_bytes(const void * x, const void * y) {
+    const AllocSiteStats * a = (const AllocSiteStats *)x;
+    const AllocSiteStats * b = (const AllocSiteStats *)y;
+    if (a->live_bytes > b->live_bytes) return -1;
+    if (a->live_bytes < b->live_bytes) return 1;
+    return 0;
+}
+
+static void write_site_stats(OutputStream * out) {
+    unsigned cnt = 0;
+    unsigned i;
+    AllocSiteStats * sites = get_alloc_site_stats(&cnt);
+
+    qsort(sites, cnt, sizeof(AllocSiteStats), cmp_site_live_bytes);
+    write_stream(out, '[');
+    for (i = 0; i < cnt; i++) {
+        AllocSiteStats * s = sites + i;
+        if (i > 0) write_stream(out, ',');
+        write_stream(out, '{');
+        json_write_string(out, "File");
+        write_stream(out, ':');
+        json_write_string(out, s->file);
+        write_stream(out, ',');
+        json_write_string(out, "Line");
+        write_stream(out, ':');
+        json_write_long(out, s->line);
+        write_stream(out, ',');
+        json_write_string(out, "Allocs");
+        write_stream(out, ':');
+        json_write_ulong(out, s->alloc_cnt);
+        write_stream(out, ',');
+        json_write_string(out, "Frees");
+        write_stream(out, ':');
+        json_write_ulong(out, s->free_cnt);
+        write_stream(out, ',');
+        json_write_string(out, "LiveBytes");
+        write_stream(out, ':');
+        json_write_ulong(out, (unsigned long)s->live_bytes);
+        write_stream(out, ',');
+        json_write_string(out, "MaxLiveBytes");
+        write_stream(out, ':');
+        json_write_ulong(out, (unsigned long)s->max_live_bytes);
+        write_stream(out, ',');
+        json_write_string(out, "LiveObjectsDelta");
+        write_stream(out, ':');
+        json_write_long(out, s->live_cnt_delta);
+        write_stream(out, ',');
+        json_write_string(out, "LiveBytesDelta");
+        write_stream(out, ':');
+        json_write_long(out, s->live_bytes_delta);
+        write_stream(out, '}');
+    }
+    write_stream(out, ']');
+}
+
+#endif /* ENABLE_AllocStats */
+
+static void command_get_alloc_stats(char * token, Channel * c) {
+    AllocStats stats;
+    PoolStatsArgs args;
+    OutputStream * out = &c->out;
+
+    if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
+
+    get_alloc_stats(&stats);
+    write_stringz(out, "R");
+    write_stringz(out, token);
+    write_errno(out, 0);
+    write_stream(out, '{');
+    json_write_string(out, "Allocs");
+    write_stream(out, ':');
+    json_write_ulong(out, stats.alloc_cnt);
+    write_stream(out, ',');
+    json_write_string(out, "Reallocs");
+    write_stream(out, ':');
+    json_write_ulong(out, stats.realloc_cnt);
+    write_stream(out, ',');
+    json_write_string(out, "Frees");
+    write_stream(out, ':');
+    json_write_ulong(out, stats.free_cnt);
+    write_stream(out, ',');
+    json_write_string(out, "ArenaAllocs");
+    write_stream(out, ':');
+    json_write_ulong(out, stats.tmp_cnt);
+    write_stream(out, ',');
+    json_write_string(out, "ArenaBlocks");
+    write_stream(out, ':');
+    json_write_ulong(out, stats.arena_block_cnt);
+#if ENABLE_AllocStats
+    write_stream(out, ',');
+    json_write_string(out, "LiveBytes");
+    write_stream(out, ':');
+    json_write_ulong(out, (unsigned long)stats.live_bytes);
+    write_stream(out, ',');
+    json_write_string(out, "MaxLiveBytes");
+    write_stream(out, ':');
+    json_write_ulong(out, (unsigned long)stats.max_live_bytes);
+    write_stream(out, ',');
+    json_write_string(out, "Sites");
+    write_stream(out, ':');
+    write_site_stats(out);
+#endif
+    write_stream(out, ',');
+    json_write_string(out, "Pools");
+    write_stream(out, ':');
+    write_stream(out, '[');
+    args.out = out;
+    args.cnt = 0;
+    iterate_mem_pools(write_pool_stats, &args);
+    write_stream(out, ']');
+    write_stream(out, '}');
+    write_stream(out, 0);
+    write_stream(out, MARKER_EOM);
+}
+
+static void command_snapshot_alloc_stats(char * token, Channel * c) {
+    int err = 0;
+
+    if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
+
+#if ENABLE_AllocStats
+    alloc_stats_snapshot();
+#else
+    err = ERR_UNSUPPORTED;
+#endif
+    write_stringz(&c->out, "R");
+    write_stringz(&c->out, token);
+    write_errno(&c->out, err);
+    write_stream(&c->out, MARKER_EOM);
+}
+
+static void command_get_symbol_cache_stats(char * token, Channel * c) {
+    OutputStream * out = &c->out;
+
+    if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
+
+    write_stringz(out, "R");
+    write_stringz(out, token);
+#if SERVICE_Symbols
+    {
+        SymbolCacheStats stats;
+        get_symbol_cache_stats(&stats);
+        write_errno(out, 0);
+        write_stream(out, '{');
+        json_write_string(out, "Hits");
+        write_stream(out, ':');
+        json_write_ulong(out, stats.hits);
+        write_stream(out, ',');
+        json_write_string(out, "Misses");
+        write_stream(out, ':');
+        json_write_ulong(out, stats.misses);
+        write_stream(out, ',');
+        json_write_string(out, "Flushes");
+        write_stream(out, ':');
+        json_write_ulong(out, stats.flushes);
+        write_stream(out, ',');
+        json_write_string(out, "Entries");
+        write_stream(out, ':');
+        json_write_ulong(out, stats.entries);
+        write_stream(out, '}');
+        write_stream(out, 0);
+    }
+#else
+    write_errno(out, ERR_UNSUPPORTED);
+    write_stringz(out, "null");
+#endif
+    write_stream(out, MARKER_EOM);
+}
+
 void ini_diagnostics_service(Protocol * proto) {
     add_command_handler(proto, DIAGNOSTICS, "echo", command_echo);
     add_command_handler(proto, DIAGNOSTICS, "echoFP", command_echo_fp);
@@ -322,6 +530,9 @@ void ini_diagnostics_service(Protocol * proto) {
     add_command_handler(proto, DIAGNOSTICS, "getSymbol", command_get_symbol);
     add_command_handler(proto, DIAGNOSTICS, "createTestStreams", command_create_test_streams);
     add_command_handler(proto, DIAGNOSTICS, "disposeTestStream", command_dispose_test_stream);
+    add_command_handler(proto, DIAGNOSTICS, "getAllocStats", command_get_alloc_stats);
+    add_command_handler(proto, DIAGNOSTICS, "snapshotAllocStats", command_snapshot_alloc_stats);
+    add_command_handler(proto, DIAGNOSTICS, "getSymbolCacheStats", command_get_symbol_cache_stats);
 }
 
 
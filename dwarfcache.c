@@ -28,18 +28,24 @@
 #include "dwarfio.h"
 #include "dwarfcache.h"
 #include "dwarfexpr.h"
+#include "dwarfindex.h"
 #include "exceptions.h"
 #include "breakpoints.h"
 #include "myalloc.h"
+#include "events.h"
+#include "asyncreq.h"
+#include "stacktrace.h"
+#include "trace.h"
 
 #define OBJ_HASH_SIZE          (0x10000-1)
+#define DEF_CACHE_SIZE_LIMIT   (64 * 1024 * 1024)
+#define MAX_LINE_NUMBERS_JOBS  4
+
+#define link2unit(A)  ((CompUnit *)((char *)(A) - offsetof(CompUnit, mLink)))
 
 static DWARFCache * sCache;
 static ELF_Section * sDebugSection;
 static DIO_UnitDescriptor sUnitDesc;
-static ObjectInfo * sObjectList;
-static ObjectInfo * sObjectListTail;
-static unsigned sSymbolTableLen;
 static CompUnit * sCompUnit;
 static unsigned sCompUnitsMax;
 static ObjectInfo * sParentObject;
@@ -47,6 +53,15 @@ static ObjectInfo * sPrevSibling;
 
 static int sCloseListenerOK = 0;
 
+static LINK sUnitLRU;
+static size_t sCachedObjectsSize = 0;
+static size_t sCacheSizeLimit = DEF_CACHE_SIZE_LIMIT;
+static int sEvictPosted = 0;
+static unsigned sGeneration = 0;
+static CompUnit ** sPendingUnits;
+static unsigned sPendingUnitsCnt;
+static unsigned sPendingUnitsMax;
+
 unsigned calc_symbol_name_hash(char * s) {
     unsigned h = 0;
     while (*s) {
@@ -58,8 +73,8 @@ unsigned calc_symbol_name_hash(char * s) {
     return h % SYM_HASH_SIZE;
 }
 
-static U8_T get_elf_symbol_address(Elf_Sym * x) {
-    if (sCache->mFile->elf64) {
+static U8_T get_elf_symbol_address(ELF_File * File, Elf_Sym * x) {
+    if (File->elf64) {
         Elf64_Sym * s = (Elf64_Sym *)x;
         switch (ELF64_ST_TYPE(s->st_info)) {
         case STT_OBJECT:
@@ -78,34 +93,203 @@ static U8_T get_elf_symbol_address(Elf_Sym * x) {
     return 0;
 }
 
-static CompUnit * find_comp_unit(U8_T ID) {
-    unsigned i;
+typedef struct WorkerJob WorkerJob;
+
+/*
+ * Worker jobs run CPU bound parts of cache loading on asyncreq worker threads.
+ * Dispatch thread waits for a job only when it needs the job results.
+ */
+struct WorkerJob {
+    AsyncReqInfo req;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int done;
+    int ref_cnt;
+    void (*func)(WorkerJob *);
+    int error;
+    char msg[256];
+    DWARFCache * cache;
+    CompUnit ** units;
+    unsigned units_cnt;
+};
+
+static int worker_job_func(void * x) {
+    WorkerJob * job = (WorkerJob *)x;
+    Trap trap;
+
+    exceptions_worker_enter();
+    if (set_trap(&trap)) {
+        job->func(job);
+        clear_trap(&trap);
+    }
+    else {
+        job->error = trap.error;
+        strncpy(job->msg, trap.msg, sizeof(job->msg) - 1);
+    }
+    exceptions_worker_exit();
+    check_error(pthread_mutex_lock(&job->lock));
+    job->done = 1;
+    check_error(pthread_cond_signal(&job->cond));
+    check_error(pthread_mutex_unlock(&job->lock));
+    return 0;
+}
+
+static void release_worker_job(WorkerJob * job) {
+    assert(job->ref_cnt > 0);
+    if (--job->ref_cnt > 0) return;
+    check_error(pthread_cond_destroy(&job->cond));
+    check_error(pthread_mutex_destroy(&job->lock));
+    loc_free(job->units);
+    loc_free(job);
+}
+
+static void worker_job_done(void * x) {
+    release_worker_job((WorkerJob *)((AsyncReqInfo *)x)->client_data);
+}
+
+static WorkerJob * create_worker_job(DWARFCache * Cache, void (*func)(WorkerJob *)) {
+    WorkerJob * job = (WorkerJob *)loc_alloc_zero(sizeof(WorkerJob));
+    check_error(pthread_mutex_init(&job->lock, NULL));
+    check_error(pthread_cond_init(&job->cond, NULL));
+    job->ref_cnt = 1;
+    job->func = func;
+    job->cache = Cache;
+    return job;
+}
+
+static void start_worker_job(WorkerJob * job) {
+    job->ref_cnt++;
+    job->req.done = worker_job_done;
+    job->req.client_data = job;
+    job->req.type = AsyncReqUser;
+    job->req.u.user.func = worker_job_func;
+    job->req.u.user.data = job;
+    async_req_post(&job->req);
+    /* If a worker thread cannot be created, the request fails synchronously */
+    if (job->req.error) worker_job_func(job);
+}
+
+/* Wait for job completion and release the job, return job error code and message */
+static int wait_worker_job(WorkerJob * job, char * msg, size_t msg_size) {
+    int error = 0;
+    check_error(pthread_mutex_lock(&job->lock));
+    while (!job->done) check_error(pthread_cond_wait(&job->cond, &job->lock));
+    check_error(pthread_mutex_unlock(&job->lock));
+    error = job->error;
+    if (error) {
+        strncpy(msg, job->msg, msg_size - 1);
+        msg[msg_size - 1] = 0;
+    }
+    release_worker_job(job);
+    return error;
+}
+
+/*
+ * Units are kept sorted by ID, they are usually added in section order, which is an append.
+ * A unit is created only if 'Add' is set, that is while unit entries are scanned by load_debug_sections().
+ */
+static CompUnit * find_comp_unit(U8_T ID, int Add) {
+    unsigned L = 0;
+    unsigned H = sCache->mCompUnitsCnt;
     CompUnit * Unit;
 
-    for (i = 0; i < sCache->mCompUnitsCnt; i++) {
-        Unit = sCache->mCompUnits[i];
-        if (Unit->mID == ID) return Unit;
+    if (H > 0 && sCache->mCompUnits[H - 1]->mID < ID) {
+        L = H;
     }
+    else {
+        while (L < H) {
+            unsigned M = (L + H) / 2;
+            Unit = sCache->mCompUnits[M];
+            if (Unit->mID == ID) return Unit;
+            if (Unit->mID < ID) L = M + 1;
+            else H = M;
+        }
+    }
+    if (!Add) return NULL;
     if (sCache->mCompUnitsCnt >= sCompUnitsMax) {
         sCompUnitsMax = sCompUnitsMax == 0 ? 16 : sCompUnitsMax * 2;
         sCache->mCompUnits = loc_realloc(sCache->mCompUnits, sizeof(CompUnit *) * sCompUnitsMax);
     }
     Unit = loc_alloc_zero(sizeof(CompUnit));
     Unit->mID = ID;
-    sCache->mCompUnits[sCache->mCompUnitsCnt++] = Unit;
+    memmove(sCache->mCompUnits + L + 1, sCache->mCompUnits + L, sizeof(CompUnit *) * (sCache->mCompUnitsCnt - L));
+    sCache->mCompUnits[L] = Unit;
+    sCache->mCompUnitsCnt++;
     return Unit;
 }
 
+static ObjectInfo * find_object_in_hash(DWARFCache * Cache, U8_T ID) {
+    ObjectInfo * Info = Cache->mObjectHash[(U4_T)ID % OBJ_HASH_SIZE];
+
+    while (Info != NULL) {
+        if (Info->mID == ID) return Info;
+        Info = Info->mHashNext;
+    }
+    return NULL;
+}
+
+static int is_unit_object(CompUnit * Unit, U8_T ID) {
+    U8_T Addr = Unit->mSection->addr + Unit->mDesc.mUnitOffs;
+    return ID >= Addr && ID < Addr + Unit->mDesc.mUnitSize;
+}
+
+/* Find unit that contains given debug info entry, units are sorted by address */
+static CompUnit * find_object_unit(DWARFCache * Cache, U8_T ID) {
+    unsigned L = 0;
+    unsigned H = Cache->mCompUnitsCnt;
+    while (L < H) {
+        unsigned M = (L + H) / 2;
+        CompUnit * Unit = Cache->mCompUnits[M];
+        if (Unit->mSection->addr + Unit->mDesc.mUnitOffs <= ID) L = M + 1;
+        else H = M;
+    }
+    if (L > 0 && is_unit_object(Cache->mCompUnits[L - 1], ID)) return Cache->mCompUnits[L - 1];
+    return NULL;
+}
+
+static void pin_unit(CompUnit * Unit) {
+    if (Unit->mPinned) return;
+    Unit->mPinned = 1;
+    if (Unit->mObjectsLoaded) {
+        list_remove(&Unit->mLink);
+        sCachedObjectsSize -= Unit->mObjectsCnt * sizeof(ObjectInfo);
+    }
+}
+
+static void add_pending_unit(CompUnit * Unit) {
+    if (Unit->mObjectsLoaded || Unit->mObjectsPending) return;
+    if (sPendingUnitsCnt >= sPendingUnitsMax) {
+        sPendingUnitsMax = sPendingUnitsMax == 0 ? 16 : sPendingUnitsMax * 2;
+        sPendingUnits = (CompUnit **)loc_realloc(sPendingUnits, sizeof(CompUnit *) * sPendingUnitsMax);
+    }
+    sPendingUnits[sPendingUnitsCnt++] = Unit;
+    Unit->mObjectsPending = 1;
+}
+
 static ObjectInfo * find_object_info(U8_T ID) {
-    ObjectInfo * Info = find_object(sCache, ID);
+    ObjectInfo * Info = NULL;
+    CompUnit * Unit = sCompUnit;
+
+    assert(Unit != NULL);
+    if (!is_unit_object(Unit, ID)) {
+        /* Reference to other unit: the unit is loaded too, and its objects must stay in memory */
+        CompUnit * Ref = find_object_unit(sCache, ID);
+        if (Ref != NULL) {
+            pin_unit(Ref);
+            add_pending_unit(Ref);
+            Unit = Ref;
+        }
+    }
+    Info = find_object_in_hash(sCache, ID);
     if (Info == NULL) {
         U4_T Hash = (U4_T)ID % OBJ_HASH_SIZE;
         Info = (ObjectInfo *)loc_alloc_zero(sizeof(ObjectInfo));
         Info->mHashNext = sCache->mObjectHash[Hash];
         sCache->mObjectHash[Hash] = Info;
-        if (sObjectList == NULL) sObjectList = Info;
-        else sObjectListTail->mListNext = Info;
-        sObjectListTail = Info;
+        Info->mListNext = Unit->mObjectList;
+        Unit->mObjectList = Info;
+        Unit->mObjectsCnt++;
+        if (!Unit->mPinned) sCachedObjectsSize += sizeof(ObjectInfo);
         Info->mID = ID;
     }
     return Info;
@@ -185,7 +369,9 @@ static void read_tag_com_unit(U2_T Attr, U2_T Form) {
     switch (Attr) {
     case 0:
         if (Form) {
-            Unit = find_comp_unit(sDebugSection->addr + dio_gEntryPos);
+            /* sCompUnit is set if the unit entries are loaded after the unit itself */
+            Unit = sCompUnit != NULL ? sCompUnit : find_comp_unit(sDebugSection->addr + dio_gEntryPos, 1);
+            assert(Unit->mID == sDebugSection->addr + dio_gEntryPos);
             Unit->mFile = sCache->mFile;
             Unit->mSection = sDebugSection;
             Unit->mDebugRangesOffs = ~(U8_T)0;
@@ -221,7 +407,9 @@ static void read_tag_com_unit(U2_T Attr, U2_T Form) {
         Unit->mLineInfoOffs = dio_gFormData;
         break;
     case AT_base_types:
-        Unit->mBaseTypes = find_comp_unit(dio_gFormRef);
+        /* Units are known when entries are loaded later, sCompUnit is set then */
+        Unit->mBaseTypes = find_comp_unit(dio_gFormRef, sCompUnit == NULL);
+        if (Unit->mBaseTypes == NULL) str_exception(ERR_INV_DWARF, "Invalid AT_base_types attribute");
         break;
     }
 }
@@ -314,24 +502,107 @@ static void entry_callback(U2_T Tag, U2_T Attr, U2_T Form) {
 }
 
 static int symbol_sort_func(const void * X, const void * Y) {
-    U8_T AddrX = get_elf_symbol_address(*(Elf_Sym **)X);
-    U8_T AddrY = get_elf_symbol_address(*(Elf_Sym **)Y);
-    if (AddrX < AddrY) return -1;
-    if (AddrX > AddrY) return +1;
+    const SymbolAddress * x = (const SymbolAddress *)X;
+    const SymbolAddress * y = (const SymbolAddress *)Y;
+    if (x->mAddress < y->mAddress) return -1;
+    if (x->mAddress > y->mAddress) return +1;
+    /* Symbols at same address: functions first, then bigger first */
+    if (x->mType != y->mType) return x->mType == STT_FUNC ? -1 : +1;
+    if (x->mSize > y->mSize) return -1;
+    if (x->mSize < y->mSize) return +1;
     return 0;
 }
 
-static void load_symbol_tables(void) {
+/* Build symbol name hash and address index, called on a worker thread */
+static void build_symbol_tables(WorkerJob * Job) {
     unsigned idx;
     unsigned cnt = 0;
+    DWARFCache * Cache = Job->cache;
+    ELF_File * File = Cache->mFile;
+    SymbolAddress * Addrs = NULL;
+
+    for (idx = 0; idx < Cache->mSymSectionsCnt; idx++) {
+        SymbolSection * tbl = Cache->mSymSections[idx];
+        unsigned i;
+        for (i = 0; i < tbl->sym_cnt; i++) {
+            U8_T Name = 0;
+            if (File->elf64) {
+                Elf64_Sym * s = (Elf64_Sym *)tbl->mSymPool + i;
+                if (get_elf_symbol_address(File, (Elf_Sym *)s) != 0) cnt++;
+                Name = s->st_name;
+            }
+            else {
+                Elf32_Sym * s = (Elf32_Sym *)tbl->mSymPool + i;
+                if (get_elf_symbol_address(File, (Elf_Sym *)s) != 0) cnt++;
+                Name = s->st_name;
+            }
+            if (Name >= tbl->mStrPoolSize) str_exception(ERR_INV_FORMAT, "Invalid symbol name offset");
+            if (tbl->mHashNext == NULL) {
+                /* Names are looked up using ELF hash section */
+            }
+            else if (Name == 0) {
+                tbl->mHashNext[i] = 0;
+            }
+            else {
+                unsigned h = calc_symbol_name_hash(tbl->mStrPool + Name);
+                tbl->mHashNext[i] = tbl->mSymbolHash[h];
+                tbl->mSymbolHash[h] = i;
+            }
+        }
+    }
+    Addrs = (SymbolAddress *)loc_alloc(sizeof(SymbolAddress) * cnt);
+    Cache->mSymbolAddrs = Addrs;
+    Cache->mSymbolTableLen = cnt;
+    cnt = 0;
+    for (idx = 0; idx < Cache->mSymSectionsCnt; idx++) {
+        SymbolSection * tbl = Cache->mSymSections[idx];
+        unsigned i;
+        for (i = 0; i < tbl->sym_cnt; i++) {
+            SymbolAddress * a = Addrs + cnt;
+            if (File->elf64) {
+                Elf64_Sym * s = (Elf64_Sym *)tbl->mSymPool + i;
+                if (get_elf_symbol_address(File, (Elf_Sym *)s) == 0) continue;
+                a->mAddress = (ContextAddress)s->st_value;
+                a->mSize = (ContextAddress)s->st_size;
+                a->mName = (U4_T)s->st_name;
+                a->mType = (U1_T)ELF64_ST_TYPE(s->st_info);
+            }
+            else {
+                Elf32_Sym * s = (Elf32_Sym *)tbl->mSymPool + i;
+                if (get_elf_symbol_address(File, (Elf_Sym *)s) == 0) continue;
+                a->mAddress = (ContextAddress)s->st_value;
+                a->mSize = (ContextAddress)s->st_size;
+                a->mName = (U4_T)s->st_name;
+                a->mType = (U1_T)ELF32_ST_TYPE(s->st_info);
+            }
+            a->mIndex = i;
+            a->mSection = (U2_T)idx;
+            if (a->mSize > Cache->mSymbolMaxSize) Cache->mSymbolMaxSize = a->mSize;
+            cnt++;
+        }
+    }
+    assert(Cache->mSymbolTableLen == cnt);
+    qsort(Addrs, cnt, sizeof(SymbolAddress), symbol_sort_func);
+}
+
+/*
+ * Load symbol sections, and start building of symbol indices on a worker thread.
+ * Dynamic symbol table is used if the file is stripped, it has ELF hash section for name lookup.
+ */
+static void load_symbol_tables(void) {
+    unsigned idx;
     ELF_File * File = sCache->mFile;
     unsigned sym_size = File->elf64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+    U4_T sym_type = SHT_DYNSYM;
 
+    for (idx = 1; idx < File->section_cnt; idx++) {
+        ELF_Section * sym_sec = File->sections + idx;
+        if (sym_sec->size > 0 && sym_sec->type == SHT_SYMTAB) sym_type = SHT_SYMTAB;
+    }
     for (idx = 1; idx < File->section_cnt; idx++) {
         ELF_Section * sym_sec = File->sections + idx;
         if (sym_sec->size == 0) continue;
-        if (sym_sec->type == SHT_SYMTAB) {
-            unsigned i;
+        if (sym_sec->type == sym_type) {
             ELF_Section * str_sec;
             U1_T * str_data = NULL;
             U1_T * sym_data = NULL;
@@ -358,50 +629,321 @@ static void load_symbol_tables(void) {
             tbl->mSymPool = (Elf_Sym *)sym_data;
             tbl->mSymPoolSize = (size_t)sym_sec->size;
             tbl->sym_cnt = (unsigned)(sym_sec->size / sym_size);
-            tbl->mHashNext = (unsigned *)loc_alloc(tbl->sym_cnt * sizeof(unsigned));
-            for (i = 0; i < tbl->sym_cnt; i++) {
-                U8_T Name = 0;
-                if (File->elf64) {
-                    Elf64_Sym * s = (Elf64_Sym *)tbl->mSymPool + i;
-                    if (get_elf_symbol_address((Elf_Sym *)s) != 0) cnt++;
-                    Name = s->st_name;
-                }
-                else {
-                    Elf32_Sym * s = (Elf32_Sym *)tbl->mSymPool + i;
-                    if (get_elf_symbol_address((Elf_Sym *)s) != 0) cnt++;
-                    Name = s->st_name;
-                }
-                assert(Name < tbl->mStrPoolSize);
-                if (Name == 0) {
-                    tbl->mHashNext[i] = 0;
-                }
-                else {
-                    unsigned h = calc_symbol_name_hash(tbl->mStrPool + Name);
-                    tbl->mHashNext[i] = tbl->mSymbolHash[h];
-                    tbl->mSymbolHash[h] = i;
-                }
+            if (sym_type == SHT_DYNSYM) tbl->mHashSection = elf_find_hash_section(sym_sec);
+            if (tbl->mHashSection == NULL) tbl->mHashNext = (unsigned *)loc_alloc(tbl->sym_cnt * sizeof(unsigned));
+        }
+    }
+#if ENABLE_DwarfIndex
+    if (sCache->mIndex != NULL && dwarf_index_read_symbols(sCache)) return;
+#endif
+    sCache->mSymbolTablesJob = create_worker_job(sCache, build_symbol_tables);
+    start_worker_job(sCache->mSymbolTablesJob);
+}
+
+void wait_symbol_tables(DWARFCache * Cache) {
+    WorkerJob * Job = Cache->mSymbolTablesJob;
+
+    assert(Cache->magic == SYM_CACHE_MAGIC);
+    if (Job != NULL) {
+        char Msg[sizeof(Cache->mErrorMsg)];
+        int Error = wait_worker_job(Job, Msg, sizeof(Msg));
+        Cache->mSymbolTablesJob = NULL;
+        if (Error && Cache->mErrorCode == 0) {
+            Cache->mErrorCode = Error;
+            strcpy(Cache->mErrorMsg, Msg);
+        }
+    }
+    if (Cache->mErrorCode) str_exception(Cache->mErrorCode, Cache->mErrorMsg);
+}
+
+SymbolAddress * find_symbol_address(DWARFCache * Cache, ContextAddress Addr) {
+    SymbolAddress * Tbl = NULL;
+    SymbolAddress * Sym = NULL;
+    SymbolAddress * Res = NULL;
+    unsigned L = 0;
+    unsigned H = 0;
+
+    wait_symbol_tables(Cache);
+    Tbl = Cache->mSymbolAddrs;
+    H = Cache->mSymbolTableLen;
+    /* Find last symbol with address <= Addr */
+    while (L < H) {
+        unsigned M = (L + H) / 2;
+        if (Tbl[M].mAddress <= Addr) L = M + 1;
+        else H = M;
+    }
+    if (L == 0) return NULL;
+    Sym = Tbl + L - 1;
+    /* Use preferred symbol among symbols with same address */
+    while (Sym > Tbl && (Sym - 1)->mAddress == Sym->mAddress) Sym--;
+    if (Sym->mSize == 0 || Addr - Sym->mAddress < Sym->mSize) return Sym;
+    /*
+     * Addr is past the end of the nearest symbol, but it can be inside a bigger symbol
+     * at lower address, like an outer function of a nested one. Scan back while a symbol
+     * can still cover Addr, and use the preferred one of the nearest covering symbols.
+     */
+    Sym = Tbl + L;
+    while (Sym > Tbl) {
+        Sym--;
+        if (Res != NULL && Sym->mAddress != Res->mAddress) break;
+        if (Res == NULL && Addr - Sym->mAddress >= Cache->mSymbolMaxSize) break;
+        if (Sym->mSize != 0 && Addr - Sym->mAddress < Sym->mSize) Res = Sym;
+    }
+    return Res;
+}
+
+static void add_addr_range(DWARFCache * Cache, unsigned * Max, CompUnit * Unit, U8_T Addr, U8_T Size) {
+    UnitAddressRange * Range;
+    /* Ranges of sections discarded by the linker start at 0 */
+    if (Addr == 0 || Size == 0) return;
+    if (Cache->mAddrRangesCnt >= *Max) {
+        *Max = *Max == 0 ? 64 : *Max * 2;
+        Cache->mAddrRanges = (UnitAddressRange *)loc_realloc(Cache->mAddrRanges, sizeof(UnitAddressRange) * *Max);
+    }
+    Range = Cache->mAddrRanges + Cache->mAddrRangesCnt++;
+    Range->mAddr = (ContextAddress)Addr;
+    Range->mSize = (ContextAddress)Size;
+    Range->mUnit = Unit;
+}
+
+static int unit_offs_sort_func(const void * X, const void * Y) {
+    U8_T OffsX = (*(CompUnit **)X)->mDesc.mUnitOffs;
+    U8_T OffsY = (*(CompUnit **)Y)->mDesc.mUnitOffs;
+    if (OffsX < OffsY) return -1;
+    if (OffsX > OffsY) return +1;
+    return 0;
+}
+
+static ContextAddress addr_range_end(UnitAddressRange * Range) {
+    ContextAddress End = Range->mAddr + Range->mSize;
+    /* Clip ranges that wrap around the end of address space */
+    if (End < Range->mAddr) End = ~(ContextAddress)0;
+    return End;
+}
+
+static int addr_range_sort_func(const void * X, const void * Y) {
+    UnitAddressRange * x = (UnitAddressRange *)X;
+    UnitAddressRange * y = (UnitAddressRange *)Y;
+    ContextAddress EndX = 0;
+    ContextAddress EndY = 0;
+    if (x->mAddr < y->mAddr) return -1;
+    if (x->mAddr > y->mAddr) return +1;
+    /* Ranges with same start: longer range first, it is overridden by the shorter one */
+    EndX = addr_range_end(x);
+    EndY = addr_range_end(y);
+    if (EndX > EndY) return -1;
+    if (EndX < EndY) return +1;
+    if (x->mUnit->mUnitPos > y->mUnit->mUnitPos) return -1;
+    if (x->mUnit->mUnitPos < y->mUnit->mUnitPos) return +1;
+    return 0;
+}
+
+/* Add range [Pos, End) of Unit to split ranges table, merge it with previous range if adjacent */
+static void add_split_range(UnitAddressRange * Res, unsigned * Cnt, CompUnit * Unit, ContextAddress Pos, ContextAddress End) {
+    UnitAddressRange * Prev = *Cnt > 0 ? Res + *Cnt - 1 : NULL;
+    if (Prev != NULL && Prev->mUnit == Unit && Prev->mAddr + Prev->mSize == Pos) {
+        Prev->mSize += End - Pos;
+        return;
+    }
+    Res[*Cnt].mAddr = Pos;
+    Res[*Cnt].mSize = End - Pos;
+    Res[*Cnt].mUnit = Unit;
+    (*Cnt)++;
+}
+
+/*
+ * Split sorted unit ranges into non-overlapping ranges, so a lookup needs to check only one entry.
+ * Nested and overlapping ranges come from DW_AT_ranges fragments and inexact unit low/high PC:
+ * in an overlap, the range that starts last, usually the inner one, is used.
+ * Ranges are processed in start order, Stack holds ranges that cover current position.
+ */
+static void split_addr_ranges(DWARFCache * Cache) {
+    unsigned Cnt = Cache->mAddrRangesCnt;
+    UnitAddressRange * Tbl = Cache->mAddrRanges;
+    UnitAddressRange ** Stack = NULL;
+    UnitAddressRange * Res = NULL;
+    unsigned StackCnt = 0;
+    unsigned ResCnt = 0;
+    unsigned ResMax = 0;
+    ContextAddress Pos = 0;
+    unsigned i;
+
+    if (Cnt < 2) return;
+    /* Each range adds at most two split ranges */
+    ResMax = Cnt * 2;
+    Res = (UnitAddressRange *)loc_alloc(sizeof(UnitAddressRange) * ResMax);
+    Stack = (UnitAddressRange **)loc_alloc(sizeof(UnitAddressRange *) * Cnt);
+    for (i = 0; i <= Cnt; i++) {
+        ContextAddress Limit = i < Cnt ? Tbl[i].mAddr : ~(ContextAddress)0;
+        /* Emit parts of covering ranges up to the start of next range */
+        while (StackCnt > 0) {
+            UnitAddressRange * Top = Stack[StackCnt - 1];
+            ContextAddress End = addr_range_end(Top);
+            if (End > Limit) {
+                if (Limit > Pos) add_split_range(Res, &ResCnt, Top->mUnit, Pos, Limit);
+                Pos = Limit;
+                break;
+            }
+            if (End > Pos) {
+                add_split_range(Res, &ResCnt, Top->mUnit, Pos, End);
+                Pos = End;
             }
+            StackCnt--;
+        }
+        if (i < Cnt) {
+            Stack[StackCnt++] = Tbl + i;
+            Pos = Tbl[i].mAddr;
         }
     }
-    sCache->mSymbolHash = loc_alloc(sizeof(void *) * cnt);
-    sCache->mSymbolTableLen = cnt;
-    cnt = 0;
-    for (idx = 0; idx < sCache->mSymSectionsCnt; idx++) {
-        SymbolSection * tbl = sCache->mSymSections[idx];
-        unsigned i;
-        for (i = 0; i < tbl->sym_cnt; i++) {
-            if (File->elf64) {
-                Elf_Sym * s = (Elf_Sym *)((Elf64_Sym *)tbl->mSymPool + i);
-                if (get_elf_symbol_address(s) != 0) sCache->mSymbolHash[cnt++] = s;
+    assert(ResCnt <= ResMax);
+    loc_free(Stack);
+    loc_free(Cache->mAddrRanges);
+    Cache->mAddrRanges = (UnitAddressRange *)loc_realloc(Res, sizeof(UnitAddressRange) * (ResCnt > 0 ? ResCnt : 1));
+    Cache->mAddrRangesCnt = ResCnt;
+}
+
+static void load_aranges(DWARFCache * Cache, unsigned * Max, CompUnit ** Units, U1_T * Covered) {
+    ELF_Section * Sec = Cache->mDebugARanges;
+    DIO_UnitDescriptor Desc;
+
+    memset(&Desc, 0, sizeof(Desc));
+    Desc.mFile = Cache->mFile;
+    Desc.mSection = Sec;
+    dio_EnterDebugSection(&Desc, Sec, 0);
+    while (dio_GetPos() < Sec->size) {
+        U8_T SetPos = dio_GetPos();
+        U8_T SetEnd = 0;
+        U8_T InfoOffs = 0;
+        U8_T TupleSize = 0;
+        U1_T SegSize = 0;
+        CompUnit * Unit = NULL;
+        unsigned L = 0;
+        unsigned H = Cache->mCompUnitsCnt;
+        U8_T Size = dio_ReadU4();
+
+        Desc.m64bit = 0;
+        if (Size == 0xffffffffu) {
+            Size = dio_ReadU8();
+            Desc.m64bit = 1;
+        }
+        SetEnd = dio_GetPos() + Size;
+        dio_ReadU2(); /* version */
+        InfoOffs = Desc.m64bit ? dio_ReadU8() : dio_ReadU4();
+        Desc.mAddressSize = dio_ReadU1();
+        SegSize = dio_ReadU1();
+        while (L < H) {
+            unsigned M = (L + H) / 2;
+            if (Units[M]->mDesc.mUnitOffs < InfoOffs) L = M + 1;
+            else H = M;
+        }
+        if (L < Cache->mCompUnitsCnt && Units[L]->mDesc.mUnitOffs == InfoOffs) Unit = Units[L];
+        if (Unit != NULL && SegSize == 0 && (Desc.mAddressSize == 2 || Desc.mAddressSize == 4 || Desc.mAddressSize == 8)) {
+            /* First tuple is aligned to tuple size */
+            TupleSize = Desc.mAddressSize * 2;
+            dio_Skip((TupleSize - (dio_GetPos() - SetPos) % TupleSize) % TupleSize);
+            while (dio_GetPos() + TupleSize <= SetEnd) {
+                U8_T Addr = dio_ReadAddress();
+                U8_T Len = dio_ReadAddress();
+                if (Addr == 0 && Len == 0) break;
+                add_addr_range(Cache, Max, Unit, Addr, Len);
             }
-            else {
-                Elf_Sym * s = (Elf_Sym *)((Elf32_Sym *)tbl->mSymPool + i);
-                if (get_elf_symbol_address(s) != 0) sCache->mSymbolHash[cnt++] = s;
+            Covered[L] = 1;
+        }
+        dio_Skip(SetEnd - dio_GetPos());
+    }
+    dio_ExitSection();
+}
+
+static void load_unit_ranges(DWARFCache * Cache, unsigned * Max, CompUnit * Unit) {
+    if (Unit->mDebugRangesOffs != ~(U8_T)0 && Cache->mDebugRanges != NULL) {
+        U8_T Base = Unit->mLowPC;
+        U8_T MaxAddr = Unit->mDesc.mAddressSize < 8 ? ((U8_T)1 << Unit->mDesc.mAddressSize * 8) - 1 : ~(U8_T)0;
+        if (elf_load(Cache->mDebugRanges)) exception(errno);
+        dio_EnterDataSection(&Unit->mDesc, Cache->mDebugRanges->data, Unit->mDebugRangesOffs, Cache->mDebugRanges->size);
+        for (;;) {
+            U8_T x = dio_ReadAddress();
+            U8_T y = dio_ReadAddress();
+            if (x == 0 && y == 0) break;
+            if (x == MaxAddr) {
+                Base = y;
+            }
+            else if (y > x) {
+                add_addr_range(Cache, Max, Unit, Base + x, y - x);
             }
         }
+        dio_ExitSection();
+    }
+    else if (Unit->mHighPC > Unit->mLowPC) {
+        add_addr_range(Cache, Max, Unit, Unit->mLowPC, Unit->mHighPC - Unit->mLowPC);
+    }
+}
+
+static void load_addr_ranges(DWARFCache * Cache) {
+    Trap trap;
+    unsigned i;
+    unsigned Max = 0;
+    unsigned Cnt = Cache->mCompUnitsCnt;
+    CompUnit ** Units = NULL;
+    U1_T * Covered = NULL;
+
+#if ENABLE_DwarfIndex
+    if (Cache->mIndex != NULL && dwarf_index_read_addr_ranges(Cache)) return;
+#endif
+    Units = (CompUnit **)loc_alloc(sizeof(CompUnit *) * (Cnt + 1));
+    Covered = (U1_T *)loc_alloc_zero(Cnt + 1);
+    memcpy(Units, Cache->mCompUnits, sizeof(CompUnit *) * Cnt);
+    qsort(Units, Cnt, sizeof(CompUnit *), unit_offs_sort_func);
+    if (set_trap(&trap)) {
+        if (Cache->mDebugARanges != NULL) load_aranges(Cache, &Max, Units, Covered);
+        /* Units that are not listed in .debug_aranges */
+        for (i = 0; i < Cnt; i++) {
+            if (!Covered[i]) load_unit_ranges(Cache, &Max, Units[i]);
+        }
+        clear_trap(&trap);
+    }
+    loc_free(Units);
+    loc_free(Covered);
+    if (trap.error) {
+        loc_free(Cache->mAddrRanges);
+        Cache->mAddrRanges = NULL;
+        Cache->mAddrRangesCnt = 0;
+        str_exception(trap.error, trap.msg);
+    }
+    if (Cache->mAddrRanges == NULL) {
+        Cache->mAddrRanges = (UnitAddressRange *)loc_alloc(sizeof(UnitAddressRange));
+    }
+    qsort(Cache->mAddrRanges, Cache->mAddrRangesCnt, sizeof(UnitAddressRange), addr_range_sort_func);
+    split_addr_ranges(Cache);
+}
+
+UnitAddressRange * find_unit_addr_range(DWARFCache * Cache, ContextAddress Addr0, ContextAddress Addr1) {
+    UnitAddressRange * Tbl;
+    unsigned L = 0;
+    unsigned H = 0;
+
+    assert(Cache->magic == SYM_CACHE_MAGIC);
+    if (Cache->mAddrRanges == NULL) load_addr_ranges(Cache);
+    Tbl = Cache->mAddrRanges;
+    H = Cache->mAddrRangesCnt;
+    /* Find first range with address > Addr0 */
+    while (L < H) {
+        unsigned M = (L + H) / 2;
+        if (Tbl[M].mAddr <= Addr0) L = M + 1;
+        else H = M;
     }
-    assert(sCache->mSymbolTableLen == cnt);
-    qsort(sCache->mSymbolHash, sCache->mSymbolTableLen, sizeof(Elf_Sym *), symbol_sort_func);
+    if (L > 0 && Addr0 - Tbl[L - 1].mAddr < Tbl[L - 1].mSize) return Tbl + L - 1;
+    if (L < Cache->mAddrRangesCnt && Tbl[L].mAddr < Addr1) return Tbl + L;
+    return NULL;
+}
+
+static int unit_addr_sort_func(const void * X, const void * Y) {
+    CompUnit * x = *(CompUnit **)X;
+    CompUnit * y = *(CompUnit **)Y;
+    U8_T AddrX = x->mSection->addr + x->mDesc.mUnitOffs;
+    U8_T AddrY = y->mSection->addr + y->mDesc.mUnitOffs;
+    if (AddrX < AddrY) return -1;
+    if (AddrX > AddrY) return +1;
+    return 0;
 }
 
 static void load_debug_sections(void) {
@@ -410,9 +952,6 @@ static void load_debug_sections(void) {
     ELF_File * File = sCache->mFile;
 
     memset(&trap, 0, sizeof(trap));
-    sSymbolTableLen = sCache->mSymbolTableLen;
-    sObjectList = NULL;
-    sObjectListTail = NULL;
     sCompUnitsMax = 0;
 
     for (idx = 1; idx < File->section_cnt; idx++) {
@@ -420,13 +959,16 @@ static void load_debug_sections(void) {
         if (sec->size == 0) continue;
         if (sec->name == NULL) continue;
         if (strcmp(sec->name, ".debug") == 0 || strcmp(sec->name, ".debug_info") == 0) {
+            if (strcmp(sec->name, ".debug_info") == 0) sCache->mDebugInfo = sec;
             sDebugSection = sec;
             sParentObject = NULL;
             sPrevSibling = NULL;
             dio_EnterDebugSection(NULL, sec, 0);
             if (set_trap(&trap)) {
+                /* Only unit entries are read here, see load_unit_objects() */
                 while (dio_GetPos() < sec->size) {
-                    dio_ReadUnit(&sUnitDesc, entry_callback);
+                    sCompUnit = NULL;
+                    dio_ReadUnitEntry(&sUnitDesc, entry_callback);
                     sCompUnit->mDesc = sUnitDesc;
                 }
                 clear_trap(&trap);
@@ -450,18 +992,128 @@ static void load_debug_sections(void) {
         else if (strcmp(sec->name, ".debug_loc") == 0) {
             sCache->mDebugLoc = sec;
         }
+        else if (strcmp(sec->name, ".debug_pubnames") == 0) {
+            sCache->mDebugPubNames = sec;
+        }
+        else if (strcmp(sec->name, ".debug_pubtypes") == 0) {
+            sCache->mDebugPubTypes = sec;
+        }
     }
 
-    if (sObjectList == NULL) {
-        loc_free(sCache->mObjectHash);
-        sCache->mObjectHash = NULL;
-    }
-    sCache->mObjectList = sObjectList;
-    sSymbolTableLen = 0;
-    sObjectList = NULL;
-    sObjectListTail = NULL;
     sCompUnitsMax = 0;
     if (trap.error) str_exception(trap.error, trap.msg);
+    for (idx = 0; idx < sCache->mCompUnitsCnt; idx++) {
+        /* A unit that was only referenced by AT_base_types */
+        if (sCache->mCompUnits[idx]->mSection == NULL) str_exception(ERR_INV_DWARF, "Invalid AT_base_types attribute");
+    }
+    qsort(sCache->mCompUnits, sCache->mCompUnitsCnt, sizeof(CompUnit *), unit_addr_sort_func);
+    for (idx = 0; idx < sCache->mCompUnitsCnt; idx++) sCache->mCompUnits[idx]->mUnitPos = idx;
+}
+
+static void free_unit_objects(DWARFCache * Cache, CompUnit * Unit) {
+    if (Unit->mObjectsLoaded && !Unit->mPinned) {
+        list_remove(&Unit->mLink);
+        sCachedObjectsSize -= Unit->mObjectsCnt * sizeof(ObjectInfo);
+    }
+    while (Unit->mObjectList != NULL) {
+        ObjectInfo * Info = Unit->mObjectList;
+        ObjectInfo ** Ref = Cache->mObjectHash + (U4_T)Info->mID % OBJ_HASH_SIZE;
+        while (*Ref != Info) Ref = &(*Ref)->mHashNext;
+        *Ref = Info->mHashNext;
+        Unit->mObjectList = Info->mListNext;
+        loc_free(Info);
+    }
+    Unit->mObjectsCnt = 0;
+    Unit->mObjectsLoaded = 0;
+    Unit->mChildren = NULL;
+    sGeneration++;
+}
+
+void set_dwarf_cache_size_limit(size_t size) {
+    sCacheSizeLimit = size;
+}
+
+static void evict_units_event(void * arg) {
+    unsigned cnt = 0;
+    assert(sEvictPosted);
+    sEvictPosted = 0;
+    while (sCachedObjectsSize > sCacheSizeLimit && !list_is_empty(&sUnitLRU)) {
+        CompUnit * Unit = link2unit(sUnitLRU.prev);
+        free_unit_objects((DWARFCache *)Unit->mFile->dwarf_dt_cache, Unit);
+        cnt++;
+    }
+    trace(LOG_ELF, "Disposed debug info entries of %u compilation units, %lu bytes cached",
+        cnt, (unsigned long)sCachedObjectsSize);
+}
+
+static void read_unit_objects(CompUnit * Unit) {
+    Trap trap;
+
+    assert(!Unit->mObjectsLoaded);
+    assert(Unit->mObjectList == NULL || Unit->mPinned);
+    if (Unit->mObjectsError) str_exception(Unit->mObjectsError, Unit->mObjectsErrorMsg);
+    sCompUnit = Unit;
+    sDebugSection = Unit->mSection;
+    sParentObject = NULL;
+    sPrevSibling = NULL;
+    Unit->mChildren = NULL;
+    dio_EnterDebugSection(NULL, sDebugSection, Unit->mDesc.mUnitOffs);
+    if (set_trap(&trap)) {
+        dio_ReadUnit(&sUnitDesc, entry_callback);
+        clear_trap(&trap);
+    }
+    dio_ExitSection();
+    sParentObject = NULL;
+    sPrevSibling = NULL;
+    sCompUnit = NULL;
+    sDebugSection = NULL;
+    if (trap.error) {
+        if (Unit->mPinned) {
+            /* Objects of the unit are referenced by other units, keep them and fail next loads too */
+            Unit->mObjectsError = trap.error;
+            Unit->mObjectsErrorMsg = loc_strdup(trap.msg);
+        }
+        else {
+            free_unit_objects(sCache, Unit);
+        }
+        str_exception(trap.error, trap.msg);
+    }
+    Unit->mObjectsLoaded = 1;
+    if (!Unit->mPinned) list_add_first(&Unit->mLink, &sUnitLRU);
+}
+
+void load_unit_objects(DWARFCache * Cache, CompUnit * Unit) {
+    Trap trap;
+
+    assert(Cache->magic == SYM_CACHE_MAGIC);
+    assert(Unit->mFile == Cache->mFile);
+    if (Unit->mObjectsLoaded) {
+        if (!Unit->mPinned) {
+            list_remove(&Unit->mLink);
+            list_add_first(&Unit->mLink, &sUnitLRU);
+        }
+        return;
+    }
+    assert(sCache == NULL);
+    sCache = Cache;
+    add_pending_unit(Unit);
+    if (set_trap(&trap)) {
+        while (sPendingUnitsCnt > 0) {
+            CompUnit * Next = sPendingUnits[--sPendingUnitsCnt];
+            Next->mObjectsPending = 0;
+            read_unit_objects(Next);
+        }
+        clear_trap(&trap);
+    }
+    else {
+        while (sPendingUnitsCnt > 0) sPendingUnits[--sPendingUnitsCnt]->mObjectsPending = 0;
+    }
+    sCache = NULL;
+    if (sCachedObjectsSize > sCacheSizeLimit && !sEvictPosted) {
+        post_event(evict_units_event, NULL);
+        sEvictPosted = 1;
+    }
+    if (trap.error) str_exception(trap.error, trap.msg);
 }
 
 static U2_T gop_gAttr = 0;
@@ -536,9 +1188,18 @@ int read_dwarf_object_property(Context * Ctx, int Frame, ObjectInfo * Obj, int A
     case FORM_REF8      :
     case FORM_REF_UDATA :
         {
-            ObjectInfo * RefObj = find_object(sCache, gop_gFormRef);
+            ObjectInfo * RefObj = NULL;
             PropertyValue ValueAddr;
 
+            if (set_trap(&trap)) {
+                RefObj = find_object((DWARFCache *)Obj->mCompUnit->mFile->dwarf_dt_cache, gop_gFormRef);
+                clear_trap(&trap);
+            }
+            if (trap.error) return -1;
+            if (RefObj == NULL) {
+                errno = ERR_INV_DWARF;
+                return -1;
+            }
             if (read_and_evaluate_dwarf_object_property(Ctx, Frame, 0, RefObj, AT_location, &ValueAddr) < 0) return -1;
             if (ValueAddr.mAccessFunc != NULL) {
                 ValueAddr.mAccessFunc(&ValueAddr, 0, &Value->mValue);
@@ -636,9 +1297,44 @@ static void free_unit_cache(CompUnit * Unit) {
     Unit->mDirs = NULL;
 
     Unit->mStatesCnt = 0;
-    Unit->mStatesMax = 0;
-    loc_free(Unit->mStates);
-    Unit->mStates = NULL;
+    Unit->mStatesDataSize = 0;
+    loc_free(Unit->mStatesBlocks);
+    Unit->mStatesBlocks = NULL;
+    loc_free(Unit->mStatesData);
+    Unit->mStatesData = NULL;
+
+    Unit->mLineRefsCnt = 0;
+    Unit->mLineRefsDataSize = 0;
+    loc_free(Unit->mLineRefsBlocks);
+    Unit->mLineRefsBlocks = NULL;
+    loc_free(Unit->mLineRefsData);
+    Unit->mLineRefsData = NULL;
+
+    Unit->mLineInfoLoaded = 0;
+}
+
+static void free_file_name_hash(DWARFCache * Cache) {
+    unsigned i;
+    if (Cache->mFileNameHash == NULL) return;
+    for (i = 0; i < SYM_HASH_SIZE; i++) {
+        while (Cache->mFileNameHash[i] != NULL) {
+            UnitFileName * Entry = Cache->mFileNameHash[i];
+            Cache->mFileNameHash[i] = Entry->mNext;
+            loc_free(Entry->mUnits);
+            loc_free(Entry);
+        }
+    }
+    loc_free(Cache->mFileNameHash);
+    Cache->mFileNameHash = NULL;
+}
+
+static void free_pub_names(DWARFCache * Cache) {
+    loc_free(Cache->mPubNames);
+    loc_free(Cache->mPubNamesHash);
+    Cache->mPubNames = NULL;
+    Cache->mPubNamesHash = NULL;
+    Cache->mPubNamesCnt = 0;
+    Cache->mPubNamesMax = 0;
 }
 
 static void free_dwarf_cache(ELF_File * File) {
@@ -646,10 +1342,18 @@ static void free_dwarf_cache(ELF_File * File) {
     if (Cache != NULL) {
         unsigned i;
         assert(Cache->magic == SYM_CACHE_MAGIC);
+        if (Cache->mSymbolTablesJob != NULL) {
+            char msg[256];
+            wait_worker_job(Cache->mSymbolTablesJob, msg, sizeof(msg));
+            Cache->mSymbolTablesJob = NULL;
+        }
         Cache->magic = 0;
+        sGeneration++;
         for (i = 0; i < Cache->mCompUnitsCnt; i++) {
             CompUnit * Unit = Cache->mCompUnits[i];
+            free_unit_objects(Cache, Unit);
             free_unit_cache(Unit);
+            loc_free(Unit->mObjectsErrorMsg);
             loc_free(Unit);
         }
         loc_free(Cache->mCompUnits);
@@ -658,13 +1362,14 @@ static void free_dwarf_cache(ELF_File * File) {
             loc_free(tbl->mHashNext);
             loc_free(tbl);
         }
-        while (Cache->mObjectList != NULL) {
-            ObjectInfo * Info = Cache->mObjectList;
-            Cache->mObjectList = Info->mListNext;
-            loc_free(Info);
-        }
         loc_free(Cache->mObjectHash);
-        loc_free(Cache->mSymbolHash);
+        loc_free(Cache->mSymbolAddrs);
+        loc_free(Cache->mAddrRanges);
+        free_file_name_hash(Cache);
+        free_pub_names(Cache);
+#if ENABLE_DwarfIndex
+        dwarf_index_close(Cache->mIndex);
+#endif
         loc_free(Cache);
         File->dwarf_dt_cache = NULL;
     }
@@ -676,6 +1381,7 @@ DWARFCache * get_dwarf_cache(ELF_File * File) {
         Trap trap;
         if (!sCloseListenerOK) {
             elf_add_close_listener(free_dwarf_cache);
+            list_init(&sUnitLRU);
             sCloseListenerOK = 1;
         }
         sCache = Cache = (DWARFCache *)(File->dwarf_dt_cache = loc_alloc_zero(sizeof(DWARFCache)));
@@ -684,8 +1390,14 @@ DWARFCache * get_dwarf_cache(ELF_File * File) {
         sCache->mObjectHash = loc_alloc_zero(sizeof(ObjectInfo *) * OBJ_HASH_SIZE);
         if (set_trap(&trap)) {
             dio_LoadAbbrevTable(File);
+#if ENABLE_DwarfIndex
+            sCache->mIndex = dwarf_index_open(sCache);
+#endif
             load_symbol_tables();
             load_debug_sections();
+#if ENABLE_DwarfIndex
+            if (sCache->mIndex == NULL) dwarf_index_save_later(sCache);
+#endif
             clear_trap(&trap);
         }
         else {
@@ -715,18 +1427,249 @@ static void add_file(CompUnit * Unit, FileInfo * File) {
     Unit->mFiles[Unit->mFilesCnt++] = *File;
 }
 
-static void add_state(CompUnit * Unit, LineNumbersState * state) {
-    if (Unit->mStatesCnt >= Unit->mStatesMax) {
-        Unit->mStatesMax = Unit->mStatesMax == 0 ? 128 : Unit->mStatesMax * 2;
-        Unit->mStates = (LineNumbersState *)loc_realloc(Unit->mStates, sizeof(LineNumbersState) * Unit->mStatesMax);
+/* Line number states encoder, keeps allocation sizes and last added state */
+typedef struct LineStatesBuf {
+    U4_T mBlocksMax;
+    U4_T mDataMax;
+    LineNumbersState mLast;
+} LineStatesBuf;
+
+/* Append LEB128 encoded number, or raw byte if 'sign' < 0, to growing buffer 'Data' */
+static void put_data(U1_T ** Data, U4_T * Size, U4_T * Max, U8_T n, int sign) {
+    U1_T * p = NULL;
+    if (*Size + 10 > *Max) {
+        *Max = *Max == 0 ? 256 : *Max * 2;
+        *Data = (U1_T *)loc_realloc(*Data, *Max);
     }
-    Unit->mStates[Unit->mStatesCnt++] = *state;
+    p = *Data + *Size;
+    if (sign < 0) {
+        /* Raw byte */
+    }
+    else if (!sign) {
+        while (n >= 0x80) {
+            *p++ = (U1_T)(n | 0x80);
+            n >>= 7;
+        }
+    }
+    else {
+        I8_T v = (I8_T)n;
+        while (v < -0x40 || v >= 0x40) {
+            *p++ = (U1_T)(v | 0x80);
+            v >>= 7;
+        }
+        n = (U8_T)v & 0x7f;
+    }
+    *p++ = (U1_T)n;
+    *Size = (U4_T)(p - *Data);
 }
 
-void load_line_numbers(DWARFCache * Cache, CompUnit * Unit) {
+/* Append LEB128 encoded number to the unit states data */
+static void put_state_data(CompUnit * Unit, LineStatesBuf * Buf, U8_T n, int sign) {
+    put_data(&Unit->mStatesData, &Unit->mStatesDataSize, &Buf->mDataMax, n, sign);
+}
+
+static void add_state(CompUnit * Unit, LineStatesBuf * Buf, LineNumbersState * State) {
+    LineNumbersBlock * Block = NULL;
+    if (Unit->mStatesCnt % LINE_BLOCK_STATES == 0) {
+        U4_T n = Unit->mStatesCnt / LINE_BLOCK_STATES;
+        if (n >= Buf->mBlocksMax) {
+            Buf->mBlocksMax = Buf->mBlocksMax == 0 ? 4 : Buf->mBlocksMax * 2;
+            Unit->mStatesBlocks = (LineNumbersBlock *)loc_realloc(Unit->mStatesBlocks, sizeof(LineNumbersBlock) * Buf->mBlocksMax);
+        }
+        if (n > 0) {
+            /* Address ranges of blocks include first state of next block */
+            Block = Unit->mStatesBlocks + n - 1;
+            if (Block->mMinAddress > State->mAddress) Block->mMinAddress = State->mAddress;
+            if (Block->mMaxAddress < State->mAddress) Block->mMaxAddress = State->mAddress;
+        }
+        Block = Unit->mStatesBlocks + n;
+        Block->mState = *State;
+        Block->mMinAddress = State->mAddress;
+        Block->mMaxAddress = State->mAddress;
+        Block->mDataOffs = Unit->mStatesDataSize;
+    }
+    else {
+        U1_T Flags = State->mFlags;
+        Block = Unit->mStatesBlocks + Unit->mStatesCnt / LINE_BLOCK_STATES;
+        if (Block->mMinAddress > State->mAddress) Block->mMinAddress = State->mAddress;
+        if (Block->mMaxAddress < State->mAddress) Block->mMaxAddress = State->mAddress;
+        if (State->mFile != Buf->mLast.mFile) Flags |= LINE_DELTA_FILE;
+        if (State->mColumn != Buf->mLast.mColumn) Flags |= LINE_DELTA_COLUMN;
+        if (State->mISA != Buf->mLast.mISA) Flags |= LINE_DELTA_ISA;
+        put_state_data(Unit, Buf, Flags, -1);
+        put_state_data(Unit, Buf, (U8_T)State->mAddress - (U8_T)Buf->mLast.mAddress, 1);
+        put_state_data(Unit, Buf, (U8_T)((I8_T)State->mLine - (I8_T)Buf->mLast.mLine), 1);
+        if (Flags & LINE_DELTA_FILE) put_state_data(Unit, Buf, State->mFile, 0);
+        if (Flags & LINE_DELTA_COLUMN) put_state_data(Unit, Buf, State->mColumn, 0);
+        if (Flags & LINE_DELTA_ISA) put_state_data(Unit, Buf, State->mISA, 0);
+    }
+    Buf->mLast = *State;
+    Unit->mStatesCnt++;
+}
+
+/* Release unused space of encoded line number states */
+static void trim_states(CompUnit * Unit, LineStatesBuf * Buf) {
+    U4_T n = (Unit->mStatesCnt + LINE_BLOCK_STATES - 1) / LINE_BLOCK_STATES;
+    if (n < Buf->mBlocksMax) {
+        Unit->mStatesBlocks = (LineNumbersBlock *)loc_realloc(Unit->mStatesBlocks, sizeof(LineNumbersBlock) * (n > 0 ? n : 1));
+    }
+    if (Unit->mStatesDataSize < Buf->mDataMax) {
+        Unit->mStatesData = (U1_T *)loc_realloc(Unit->mStatesData, Unit->mStatesDataSize > 0 ? Unit->mStatesDataSize : 1);
+    }
+}
+
+static U8_T get_state_data(U1_T ** Data, int sign) {
+    U1_T * p = *Data;
+    U8_T n = 0;
+    unsigned i = 0;
+    for (;;) {
+        U1_T b = *p++;
+        n |= (U8_T)(b & 0x7f) << i;
+        i += 7;
+        if ((b & 0x80) == 0) {
+            if (sign && i < 64 && (b & 0x40) != 0) n |= ~(U8_T)0 << i;
+            break;
+        }
+    }
+    *Data = p;
+    return n;
+}
+
+void seek_line_state(LineNumbersReader * Reader, CompUnit * Unit, U4_T Index) {
+    LineNumbersBlock * Block = Unit->mStatesBlocks + Index / LINE_BLOCK_STATES;
+    assert(Index < Unit->mStatesCnt);
+    Reader->mUnit = Unit;
+    Reader->mIndex = Index - Index % LINE_BLOCK_STATES;
+    Reader->mData = Unit->mStatesData + Block->mDataOffs;
+    Reader->mState = Block->mState;
+    while (Reader->mIndex < Index) next_line_state(Reader);
+}
+
+void next_line_state(LineNumbersReader * Reader) {
+    CompUnit * Unit = Reader->mUnit;
+    LineNumbersState * State = &Reader->mState;
+    U1_T Flags = 0;
+    assert(Reader->mIndex + 1 < Unit->mStatesCnt);
+    if (++Reader->mIndex % LINE_BLOCK_STATES == 0) {
+        LineNumbersBlock * Block = Unit->mStatesBlocks + Reader->mIndex / LINE_BLOCK_STATES;
+        Reader->mData = Unit->mStatesData + Block->mDataOffs;
+        *State = Block->mState;
+        return;
+    }
+    Flags = *Reader->mData++;
+    State->mFlags = (U1_T)(Flags & ~(LINE_DELTA_FILE | LINE_DELTA_COLUMN | LINE_DELTA_ISA));
+    State->mAddress = (ContextAddress)((U8_T)State->mAddress + get_state_data(&Reader->mData, 1));
+    State->mLine = (U4_T)((I8_T)State->mLine + (I8_T)get_state_data(&Reader->mData, 1));
+    if (Flags & LINE_DELTA_FILE) State->mFile = (U4_T)get_state_data(&Reader->mData, 0);
+    if (Flags & LINE_DELTA_COLUMN) State->mColumn = (U2_T)get_state_data(&Reader->mData, 0);
+    if (Flags & LINE_DELTA_ISA) State->mISA = (U1_T)get_state_data(&Reader->mData, 0);
+}
+
+static int line_ref_sort_func(const void * X, const void * Y) {
+    const LineNumbersRef * x = (const LineNumbersRef *)X;
+    const LineNumbersRef * y = (const LineNumbersRef *)Y;
+    if (x->mFile < y->mFile) return -1;
+    if (x->mFile > y->mFile) return +1;
+    if (x->mLine < y->mLine) return -1;
+    if (x->mLine > y->mLine) return +1;
+    if (x->mState < y->mState) return -1;
+    if (x->mState > y->mState) return +1;
+    return 0;
+}
+
+/*
+ * Build line numbers index of a unit. The entries are sorted in a temporary array, and then delta encoded:
+ * file delta, line (delta if same file), next line - line and state index delta.
+ * mMaxNextLine is not stored, it is computed by next_line_ref().
+ */
+static void load_line_refs(CompUnit * Unit) {
+    U4_T i;
+    U4_T n = 0;
+    U4_T DataMax = 0;
+    LineNumbersRef * Refs = NULL;
+    LineNumbersReader Reader;
+
+    if (Unit->mStatesCnt < 2) return;
+    Refs = (LineNumbersRef *)loc_alloc(sizeof(LineNumbersRef) * (Unit->mStatesCnt - 1));
+    seek_line_state(&Reader, Unit, 0);
+    for (i = 0; i < Unit->mStatesCnt - 1; i++) {
+        LineNumbersState State = Reader.mState;
+        LineNumbersRef * Ref = NULL;
+        next_line_state(&Reader);
+        if (State.mFlags & LINE_EndSequence) continue;
+        Ref = Refs + n++;
+        Ref->mFile = State.mFile >= 1 && State.mFile <= Unit->mFilesCnt ? State.mFile : 0;
+        Ref->mLine = State.mLine;
+        Ref->mNextLine = Reader.mState.mLine;
+        Ref->mState = i;
+    }
+    qsort(Refs, n, sizeof(LineNumbersRef), line_ref_sort_func);
+    if (n > 0) Unit->mLineRefsBlocks = (LineRefsBlock *)loc_alloc(sizeof(LineRefsBlock) * ((n + LINE_BLOCK_REFS - 1) / LINE_BLOCK_REFS));
+    for (i = 0; i < n; i++) {
+        LineNumbersRef * Ref = Refs + i;
+        Ref->mMaxNextLine = Ref->mNextLine;
+        if (i > 0 && Ref[-1].mFile == Ref->mFile && Ref[-1].mMaxNextLine > Ref->mMaxNextLine) {
+            Ref->mMaxNextLine = Ref[-1].mMaxNextLine;
+        }
+        if (i % LINE_BLOCK_REFS == 0) {
+            LineRefsBlock * Block = Unit->mLineRefsBlocks + i / LINE_BLOCK_REFS;
+            Block->mRef = *Ref;
+            Block->mDataOffs = Unit->mLineRefsDataSize;
+        }
+        else {
+            U1_T ** Data = &Unit->mLineRefsData;
+            U4_T * Size = &Unit->mLineRefsDataSize;
+            put_data(Data, Size, &DataMax, Ref->mFile - Ref[-1].mFile, 0);
+            put_data(Data, Size, &DataMax, Ref->mFile == Ref[-1].mFile ? Ref->mLine - Ref[-1].mLine : Ref->mLine, 0);
+            put_data(Data, Size, &DataMax, (U8_T)((I8_T)Ref->mNextLine - (I8_T)Ref->mLine), 1);
+            put_data(Data, Size, &DataMax, (U8_T)((I8_T)Ref->mState - (I8_T)Ref[-1].mState), 1);
+        }
+    }
+    loc_free(Refs);
+    if (Unit->mLineRefsDataSize < DataMax) {
+        Unit->mLineRefsData = (U1_T *)loc_realloc(Unit->mLineRefsData, Unit->mLineRefsDataSize > 0 ? Unit->mLineRefsDataSize : 1);
+    }
+    Unit->mLineRefsCnt = n;
+}
+
+void seek_line_ref(LineRefsReader * Reader, CompUnit * Unit, U4_T Index) {
+    LineRefsBlock * Block = Unit->mLineRefsBlocks + Index / LINE_BLOCK_REFS;
+    assert(Index < Unit->mLineRefsCnt);
+    Reader->mUnit = Unit;
+    Reader->mIndex = Index - Index % LINE_BLOCK_REFS;
+    Reader->mData = Unit->mLineRefsData + Block->mDataOffs;
+    Reader->mRef = Block->mRef;
+    while (Reader->mIndex < Index) next_line_ref(Reader);
+}
+
+void next_line_ref(LineRefsReader * Reader) {
+    CompUnit * Unit = Reader->mUnit;
+    LineNumbersRef * Ref = &Reader->mRef;
+    U4_T File = 0;
+    assert(Reader->mIndex + 1 < Unit->mLineRefsCnt);
+    if (++Reader->mIndex % LINE_BLOCK_REFS == 0) {
+        LineRefsBlock * Block = Unit->mLineRefsBlocks + Reader->mIndex / LINE_BLOCK_REFS;
+        Reader->mData = Unit->mLineRefsData + Block->mDataOffs;
+        *Ref = Block->mRef;
+        return;
+    }
+    File = Ref->mFile + (U4_T)get_state_data(&Reader->mData, 0);
+    if (File == Ref->mFile) {
+        Ref->mLine += (U4_T)get_state_data(&Reader->mData, 0);
+    }
+    else {
+        Ref->mFile = File;
+        Ref->mLine = (U4_T)get_state_data(&Reader->mData, 0);
+        Ref->mMaxNextLine = 0;
+    }
+    Ref->mNextLine = (U4_T)((I8_T)Ref->mLine + (I8_T)get_state_data(&Reader->mData, 1));
+    Ref->mState = (U4_T)((I8_T)Ref->mState + (I8_T)get_state_data(&Reader->mData, 1));
+    if (Ref->mMaxNextLine < Ref->mNextLine) Ref->mMaxNextLine = Ref->mNextLine;
+}
+
+/* Decode line number program of a unit, can be called by a worker thread */
+static void read_line_numbers(DWARFCache * Cache, CompUnit * Unit) {
     Trap trap;
-    if (Unit->mFiles != NULL && Unit->mDirs != NULL) return;
-    if (elf_load(Cache->mDebugLine)) exception(errno);
     dio_EnterDataSection(&Unit->mDesc, Cache->mDebugLine->data, Unit->mLineInfoOffs, Cache->mDebugLine->size);
     if (set_trap(&trap)) {
         U8_T header_pos = 0;
@@ -740,6 +1683,7 @@ void load_line_numbers(DWARFCache * Cache, CompUnit * Unit) {
         U8_T unit_size = 0;
         int dwarf64 = 0;
         LineNumbersState state;
+        LineStatesBuf states;
 
         /* Read header */
         unit_size = dio_ReadU4();
@@ -787,6 +1731,7 @@ void load_line_numbers(DWARFCache * Cache, CompUnit * Unit) {
         if (header_pos + header_size != dio_GetPos())
             str_exception(ERR_INV_DWARF, "Invalid line info header");
         memset(&state, 0, sizeof(state));
+        memset(&states, 0, sizeof(states));
         state.mFile = 1;
         state.mLine = 1;
         if (is_stmt_default) state.mFlags |= LINE_IsStmt;
@@ -795,7 +1740,7 @@ void load_line_numbers(DWARFCache * Cache, CompUnit * Unit) {
             if (opcode >= opcode_base) {
                 state.mLine += (unsigned)((int)((opcode - opcode_base) % line_range) + line_base);
                 state.mAddress += (opcode - opcode_base) / line_range * min_instruction_length;
-                add_state(Unit, &state);
+                add_state(Unit, &states, &state);
                 state.mFlags &= ~(LINE_BasicBlock | LINE_PrologueEnd | LINE_EpilogueBegin);
             }
             else if (opcode == 0) {
@@ -816,7 +1761,7 @@ void load_line_numbers(DWARFCache * Cache, CompUnit * Unit) {
                 }
                 case DW_LNE_end_sequence:
                     state.mFlags |= LINE_EndSequence;
-                    add_state(Unit, &state);
+                    add_state(Unit, &states, &state);
                     memset(&state, 0, sizeof(state));
                     state.mFile = 1;
                     state.mLine = 1;
@@ -836,7 +1781,7 @@ void load_line_numbers(DWARFCache * Cache, CompUnit * Unit) {
             else {
                 switch (opcode) {
                 case DW_LNS_copy:
-                    add_state(Unit, &state);
+                    add_state(Unit, &states, &state);
                     state.mFlags &= ~(LINE_BasicBlock | LINE_PrologueEnd | LINE_EpilogueBegin);
                     break;
                 case DW_LNS_advance_pc:
@@ -879,6 +1824,9 @@ void load_line_numbers(DWARFCache * Cache, CompUnit * Unit) {
             }
         }
         dio_ExitSection();
+        trim_states(Unit, &states);
+        load_line_refs(Unit);
+        Unit->mLineInfoLoaded = 1;
         clear_trap(&trap);
     }
     else {
@@ -888,15 +1836,286 @@ void load_line_numbers(DWARFCache * Cache, CompUnit * Unit) {
     }
 }
 
-ObjectInfo * find_object(DWARFCache * Cache, U8_T ID) {
-    U4_T Hash = (U4_T)ID % OBJ_HASH_SIZE;
-    ObjectInfo * Info = Cache->mObjectHash[Hash];
+void load_line_numbers(DWARFCache * Cache, CompUnit * Unit) {
+    if (Unit->mLineInfoLoaded) return;
+#if ENABLE_DwarfIndex
+    if (Cache->mIndex != NULL && dwarf_index_read_line_numbers(Cache, Unit)) return;
+#endif
+    if (elf_load(Cache->mDebugLine)) exception(errno);
+    read_line_numbers(Cache, Unit);
+#if ENABLE_DwarfIndex
+    dwarf_index_save_later(Cache);
+#endif
+}
 
-    while (Info != NULL) {
-        if (Info->mID == ID) return Info;
-        Info = Info->mHashNext;
+static void read_units_line_numbers(WorkerJob * Job) {
+    unsigned i;
+    for (i = 0; i < Job->units_cnt; i++) read_line_numbers(Job->cache, Job->units[i]);
+}
+
+void load_units_line_numbers(DWARFCache * Cache, CompUnit ** Units, unsigned Cnt) {
+    WorkerJob * Jobs[MAX_LINE_NUMBERS_JOBS];
+    unsigned JobsCnt = 0;
+    unsigned Todo = 0;
+    unsigned i, n;
+    int Error = 0;
+    char Msg[256];
+    Trap trap;
+
+    for (i = 0; i < Cnt; i++) {
+#if ENABLE_DwarfIndex
+        if (!Units[i]->mLineInfoLoaded && Cache->mIndex != NULL) dwarf_index_read_line_numbers(Cache, Units[i]);
+#endif
+        if (!Units[i]->mLineInfoLoaded) Todo++;
+    }
+    if (Todo < 2) {
+        for (i = 0; i < Cnt; i++) load_line_numbers(Cache, Units[i]);
+        return;
+    }
+    /* Section data must be loaded by dispatch thread */
+    if (elf_load(Cache->mDebugLine)) exception(errno);
+    JobsCnt = Todo < MAX_LINE_NUMBERS_JOBS ? Todo : MAX_LINE_NUMBERS_JOBS;
+    for (i = 0; i < JobsCnt; i++) {
+        Jobs[i] = create_worker_job(Cache, read_units_line_numbers);
+        Jobs[i]->units = (CompUnit **)loc_alloc(sizeof(CompUnit *) * ((Todo + JobsCnt - 1) / JobsCnt));
+    }
+    for (i = 0, n = 0; i < Cnt; i++) {
+        WorkerJob * Job = NULL;
+        if (Units[i]->mLineInfoLoaded) continue;
+        Job = Jobs[n++ % JobsCnt];
+        Job->units[Job->units_cnt++] = Units[i];
+    }
+    for (i = 1; i < JobsCnt; i++) start_worker_job(Jobs[i]);
+    /* Dispatch thread decodes first share of the units itself */
+    if (set_trap(&trap)) {
+        read_units_line_numbers(Jobs[0]);
+        clear_trap(&trap);
+    }
+    else {
+        Error = trap.error;
+        strncpy(Msg, trap.msg, sizeof(Msg) - 1);
+        Msg[sizeof(Msg) - 1] = 0;
+    }
+    release_worker_job(Jobs[0]);
+    for (i = 1; i < JobsCnt; i++) {
+        char JobMsg[256];
+        int JobError = wait_worker_job(Jobs[i], JobMsg, sizeof(JobMsg));
+        if (JobError && !Error) {
+            Error = JobError;
+            strcpy(Msg, JobMsg);
+        }
+    }
+#if ENABLE_DwarfIndex
+    dwarf_index_save_later(Cache);
+#endif
+    if (Error == 0) return;
+    if (Msg[0] == 0) exception(Error);
+    str_exception(Error, Msg);
+}
+
+static const char * file_base_name(const char * Name) {
+    const char * Base = Name;
+    while (*Name) {
+        if (*Name == '/' || *Name == '\\') Base = Name + 1;
+        Name++;
+    }
+    return Base;
+}
+
+static void add_unit_file_name(DWARFCache * Cache, CompUnit * Unit, char * Name) {
+    UnitFileName * Entry = NULL;
+    unsigned h = 0;
+
+    if (Name == NULL) return;
+    Name = (char *)file_base_name(Name);
+    if (*Name == 0) return;
+    h = calc_symbol_name_hash(Name);
+    for (Entry = Cache->mFileNameHash[h]; Entry != NULL; Entry = Entry->mNext) {
+        if (strcmp(Entry->mName, Name) == 0) break;
+    }
+    if (Entry == NULL) {
+        Entry = (UnitFileName *)loc_alloc_zero(sizeof(UnitFileName));
+        Entry->mName = Name;
+        Entry->mNext = Cache->mFileNameHash[h];
+        Cache->mFileNameHash[h] = Entry;
+    }
+    if (Entry->mUnitsCnt > 0 && Entry->mUnits[Entry->mUnitsCnt - 1] == Unit) return;
+    if (Entry->mUnitsCnt >= Entry->mUnitsMax) {
+        Entry->mUnitsMax = Entry->mUnitsMax == 0 ? 4 : Entry->mUnitsMax * 2;
+        Entry->mUnits = (CompUnit **)loc_realloc(Entry->mUnits, sizeof(CompUnit *) * Entry->mUnitsMax);
+    }
+    Entry->mUnits[Entry->mUnitsCnt++] = Unit;
+}
+
+/* Add file names from line info header of a unit, the line number program is not loaded */
+static void load_unit_file_names(DWARFCache * Cache, CompUnit * Unit) {
+    U1_T opcode_base = 0;
+    U8_T unit_size = 0;
+    int dwarf64 = 0;
+
+    add_unit_file_name(Cache, Unit, Unit->mName);
+    if (Cache->mDebugLine == NULL) return;
+    if (elf_load(Cache->mDebugLine)) exception(errno);
+    dio_EnterDataSection(&Unit->mDesc, Cache->mDebugLine->data, Unit->mLineInfoOffs, Cache->mDebugLine->size);
+    unit_size = dio_ReadU4();
+    if (unit_size == 0xffffffffu) {
+        dio_ReadU8();
+        dwarf64 = 1;
+    }
+    dio_ReadU2(); /* line info version */
+    if (dwarf64) dio_ReadU8();
+    else dio_ReadU4();
+    dio_Skip(4); /* min_instruction_length, default_is_stmt, line_base, line_range */
+    opcode_base = dio_ReadU1();
+    dio_Skip(opcode_base - 1);
+    /* Skip directory names */
+    while (dio_ReadString() != NULL) {}
+    for (;;) {
+        char * Name = dio_ReadString();
+        if (Name == NULL) break;
+        dio_ReadULEB128(); /* directory */
+        dio_ReadULEB128(); /* modification time */
+        dio_ReadULEB128(); /* size */
+        add_unit_file_name(Cache, Unit, Name);
+    }
+    dio_ExitSection();
+}
+
+UnitFileName * find_unit_file_name(DWARFCache * Cache, const char * FileName) {
+    UnitFileName * Entry = NULL;
+    const char * Base = NULL;
+
+    assert(Cache->magic == SYM_CACHE_MAGIC);
+    if (Cache->mFileNameHash == NULL) {
+        Trap trap;
+        unsigned i;
+        Cache->mFileNameHash = (UnitFileName **)loc_alloc_zero(sizeof(UnitFileName *) * SYM_HASH_SIZE);
+        if (set_trap(&trap)) {
+            for (i = 0; i < Cache->mCompUnitsCnt; i++) {
+                load_unit_file_names(Cache, Cache->mCompUnits[i]);
+            }
+            clear_trap(&trap);
+        }
+        else {
+            dio_ExitSection();
+            free_file_name_hash(Cache);
+            str_exception(trap.error, trap.msg);
+        }
+    }
+    Base = file_base_name(FileName);
+    Entry = Cache->mFileNameHash[calc_symbol_name_hash((char *)Base)];
+    while (Entry != NULL) {
+        if (strcmp(Entry->mName, Base) == 0) return Entry;
+        Entry = Entry->mNext;
     }
     return NULL;
 }
 
+static void add_pub_name(DWARFCache * Cache, char * Name, U8_T ID) {
+    PubName * Entry = NULL;
+    unsigned h = calc_symbol_name_hash(Name);
+
+    if (Cache->mPubNamesCnt >= Cache->mPubNamesMax) {
+        Cache->mPubNamesMax = Cache->mPubNamesMax == 0 ? 256 : Cache->mPubNamesMax * 2;
+        Cache->mPubNames = (PubName *)loc_realloc(Cache->mPubNames, sizeof(PubName) * Cache->mPubNamesMax);
+    }
+    Entry = Cache->mPubNames + Cache->mPubNamesCnt;
+    Entry->mName = Name;
+    Entry->mID = ID;
+    Entry->mNext = Cache->mPubNamesHash[h];
+    Cache->mPubNamesHash[h] = Cache->mPubNamesCnt++;
+}
+
+/* Add name sets of .debug_pubnames or .debug_pubtypes section to the global names index */
+static void load_pub_names(DWARFCache * Cache, ELF_Section * Sec) {
+    DIO_UnitDescriptor Desc;
+
+    if (Sec == NULL || Cache->mDebugInfo == NULL) return;
+    memset(&Desc, 0, sizeof(Desc));
+    Desc.mFile = Cache->mFile;
+    Desc.mSection = Sec;
+    dio_EnterDebugSection(&Desc, Sec, 0);
+    while (dio_GetPos() < Sec->size) {
+        U8_T SetEnd = 0;
+        U8_T InfoOffs = 0;
+        CompUnit * Unit = NULL;
+        U8_T Size = dio_ReadU4();
+
+        Desc.m64bit = 0;
+        if (Size == 0xffffffffu) {
+            Size = dio_ReadU8();
+            Desc.m64bit = 1;
+        }
+        SetEnd = dio_GetPos() + Size;
+        dio_ReadU2(); /* version */
+        InfoOffs = Desc.m64bit ? dio_ReadU8() : dio_ReadU4();
+        if (Desc.m64bit) dio_ReadU8(); /* unit size */
+        else dio_ReadU4();
+        Unit = find_object_unit(Cache, Cache->mDebugInfo->addr + InfoOffs);
+        if (Unit != NULL && Unit->mSection == Cache->mDebugInfo && Unit->mDesc.mUnitOffs == InfoOffs) {
+            while (dio_GetPos() < SetEnd) {
+                U8_T EntryOffs = Desc.m64bit ? dio_ReadU8() : dio_ReadU4();
+                char * Name = NULL;
+                if (EntryOffs == 0) break;
+                Name = dio_ReadString();
+                if (Name != NULL) add_pub_name(Cache, Name, Cache->mDebugInfo->addr + InfoOffs + EntryOffs);
+            }
+        }
+        dio_Skip(SetEnd - dio_GetPos());
+    }
+    dio_ExitSection();
+}
+
+ObjectInfo * find_pub_object(DWARFCache * Cache, const char * Name) {
+    ObjectInfo * Decl = NULL;
+    unsigned n = 0;
+
+    assert(Cache->magic == SYM_CACHE_MAGIC);
+    if (Cache->mPubNamesHash == NULL) {
+        Trap trap;
+        Cache->mPubNamesHash = (unsigned *)loc_alloc_zero(sizeof(unsigned) * SYM_HASH_SIZE);
+        /* Entry 0 is not used, index 0 terminates hash chains */
+        Cache->mPubNamesMax = 256;
+        Cache->mPubNames = (PubName *)loc_alloc_zero(sizeof(PubName) * Cache->mPubNamesMax);
+        Cache->mPubNamesCnt = 1;
+        if (set_trap(&trap)) {
+            /* Hash chains are LIFO, types are added first so objects are found before types */
+            load_pub_names(Cache, Cache->mDebugPubTypes);
+            load_pub_names(Cache, Cache->mDebugPubNames);
+            clear_trap(&trap);
+        }
+        else {
+            dio_ExitSection();
+            free_pub_names(Cache);
+            str_exception(trap.error, trap.msg);
+        }
+    }
+    n = Cache->mPubNamesHash[calc_symbol_name_hash((char *)Name)];
+    while (n != 0) {
+        PubName * Entry = Cache->mPubNames + n;
+        if (strcmp(Entry->mName, Name) == 0) {
+            ObjectInfo * Obj = find_object(Cache, Entry->mID);
+            if (Obj != NULL) {
+                /* Units can list declarations of external objects too, a definition is preferred */
+                PropertyValue Value;
+                if (read_dwarf_object_property(NULL, STACK_NO_FRAME, Obj, AT_declaration, &Value) < 0 ||
+                        get_numeric_property_value(&Value) == 0) return Obj;
+                if (Decl == NULL) Decl = Obj;
+            }
+        }
+        n = Entry->mNext;
+    }
+    return Decl;
+}
+
+unsigned get_dwarf_cache_generation(void) {
+    return sGeneration;
+}
+
+ObjectInfo * find_object(DWARFCache * Cache, U8_T ID) {
+    CompUnit * Unit = find_object_unit(Cache, ID);
+    if (Unit != NULL) load_unit_objects(Cache, Unit);
+    return find_object_in_hash(Cache, ID);
+}
+
 #endif /* ENABLE_ELF */
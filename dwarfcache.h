@@ -30,14 +30,24 @@
 #include "context.h"
 #include "tcf_elf.h"
 #include "dwarfio.h"
+#include "link.h"
 
 typedef struct FileInfo FileInfo;
 typedef struct LocationInfo LocationInfo;
 typedef struct ObjectInfo ObjectInfo;
 typedef struct PropertyValue PropertyValue;
 typedef struct LineNumbersState LineNumbersState;
+typedef struct LineNumbersBlock LineNumbersBlock;
+typedef struct LineNumbersReader LineNumbersReader;
+typedef struct LineNumbersRef LineNumbersRef;
+typedef struct LineRefsBlock LineRefsBlock;
+typedef struct LineRefsReader LineRefsReader;
 typedef struct CompUnit CompUnit;
 typedef struct SymbolSection SymbolSection;
+typedef struct SymbolAddress SymbolAddress;
+typedef struct UnitAddressRange UnitAddressRange;
+typedef struct UnitFileName UnitFileName;
+typedef struct PubName PubName;
 typedef struct DWARFCache DWARFCache;
 
 
@@ -58,10 +68,21 @@ struct SymbolSection {
     unsigned sym_cnt;
     Elf_Sym * mSymPool;    /* pointer to ELF section data: array of Elf32_Sym or Elf64_Sym */
     size_t mSymPoolSize;
+    ELF_Section * mHashSection; /* ELF hash section of the table, if not NULL, mSymbolHash and mHashNext are not used */
     unsigned mSymbolHash[SYM_HASH_SIZE];
     unsigned * mHashNext;
 };
 
+/* Entry of address sorted index of ELF function and data object symbols */
+struct SymbolAddress {
+    ContextAddress mAddress;    /* link-time address */
+    ContextAddress mSize;
+    U4_T mName;                 /* offset in section string pool */
+    U4_T mIndex;                /* symbol index in the section */
+    U2_T mSection;              /* index in DWARFCache.mSymSections */
+    U1_T mType;                 /* STT_FUNC or STT_OBJECT */
+};
+
 struct ObjectInfo {
     ObjectInfo * mHashNext;
     ObjectInfo * mListNext;
@@ -109,6 +130,60 @@ struct LineNumbersState {
     U1_T mISA;
 };
 
+/*
+ * Line number states of a unit are kept in blocks of LINE_BLOCK_STATES states:
+ * first state of a block is stored as is, following states are delta encoded in CompUnit.mStatesData.
+ * Use seek_line_state() and next_line_state() to read the states.
+ */
+#define LINE_BLOCK_STATES   32
+
+/* Flags of delta encoded line number state, low bits are LINE_* flags of the state */
+#define LINE_DELTA_FILE     0x20
+#define LINE_DELTA_COLUMN   0x40
+#define LINE_DELTA_ISA      0x80
+
+struct LineNumbersBlock {
+    LineNumbersState mState;    /* first state of the block */
+    ContextAddress mMinAddress; /* address range of the block states and first state of next block */
+    ContextAddress mMaxAddress;
+    U4_T mDataOffs;             /* offset of the block encoded states in CompUnit.mStatesData */
+};
+
+struct LineNumbersReader {
+    CompUnit * mUnit;
+    U4_T mIndex;                /* index of mState in the unit states */
+    U1_T * mData;               /* next encoded state */
+    LineNumbersState mState;
+};
+
+/*
+ * Entry of line numbers index, sorted by file, line and state index.
+ * Entries are kept in blocks of LINE_BLOCK_REFS entries, like the states: first entry of a block is
+ * stored as is, following entries are delta encoded in CompUnit.mLineRefsData.
+ * Use seek_line_ref() and next_line_ref() to read the entries.
+ */
+#define LINE_BLOCK_REFS     32
+
+struct LineNumbersRef {
+    U4_T mFile;             /* index in CompUnit.mFiles + 1, 0 if the state refers to the unit source file */
+    U4_T mLine;
+    U4_T mNextLine;         /* line of next state in address order */
+    U4_T mMaxNextLine;      /* max mNextLine of this and preceding entries of same file */
+    U4_T mState;            /* index of line number state in the unit */
+};
+
+struct LineRefsBlock {
+    LineNumbersRef mRef;    /* first entry of the block */
+    U4_T mDataOffs;         /* offset of the block encoded entries in CompUnit.mLineRefsData */
+};
+
+struct LineRefsReader {
+    CompUnit * mUnit;
+    U4_T mIndex;            /* index of mRef in the unit entries */
+    U1_T * mData;           /* next encoded entry */
+    LineNumbersRef mRef;
+};
+
 struct CompUnit {
     ELF_File * mFile;
     ELF_Section * mSection;
@@ -116,6 +191,7 @@ struct CompUnit {
     U8_T mID;
     ContextAddress mLowPC;
     ContextAddress mHighPC;
+    unsigned mUnitPos;          /* position in DWARFCache.mCompUnits */
 
     DIO_UnitDescriptor mDesc;
 
@@ -133,11 +209,51 @@ struct CompUnit {
     char ** mDirs;
 
     U4_T mStatesCnt;
-    U4_T mStatesMax;
-    LineNumbersState * mStates;
+    LineNumbersBlock * mStatesBlocks;   /* (mStatesCnt + LINE_BLOCK_STATES - 1) / LINE_BLOCK_STATES blocks */
+    U1_T * mStatesData;
+    U4_T mStatesDataSize;
+
+    U4_T mLineRefsCnt;
+    LineRefsBlock * mLineRefsBlocks;    /* (mLineRefsCnt + LINE_BLOCK_REFS - 1) / LINE_BLOCK_REFS blocks */
+    U1_T * mLineRefsData;
+    U4_T mLineRefsDataSize;
+    U1_T mLineInfoLoaded;
 
     CompUnit * mBaseTypes;
     ObjectInfo * mChildren;
+
+    /* Debug info entries are loaded on demand, see load_unit_objects() */
+    ObjectInfo * mObjectList;
+    unsigned mObjectsCnt;
+    U1_T mObjectsLoaded;
+    U1_T mObjectsPending;
+    U1_T mPinned;               /* referenced by other units, never evicted */
+    int mObjectsError;          /* error code if reading entries of a pinned unit failed */
+    char * mObjectsErrorMsg;
+    LINK mLink;                 /* LRU list of loaded units */
+};
+
+/* Entry of address sorted index of compilation unit address ranges, the ranges don't overlap */
+struct UnitAddressRange {
+    ContextAddress mAddr;       /* link-time address */
+    ContextAddress mSize;
+    CompUnit * mUnit;
+};
+
+/* List of compilation units that refer to source files with same base name */
+struct UnitFileName {
+    UnitFileName * mNext;
+    char * mName;
+    U4_T mUnitsCnt;
+    U4_T mUnitsMax;
+    CompUnit ** mUnits;
+};
+
+/* Entry of global names index, read from .debug_pubnames and .debug_pubtypes */
+struct PubName {
+    char * mName;
+    U8_T mID;                   /* debug info entry ID, see find_object() */
+    unsigned mNext;             /* index of next entry with same name hash, 0 if none */
 };
 
 #define SYM_CACHE_MAGIC         0x84625490
@@ -153,14 +269,29 @@ struct DWARFCache {
     ELF_Section * mDebugARanges;
     ELF_Section * mDebugLine;
     ELF_Section * mDebugLoc;
+    ELF_Section * mDebugInfo;
+    ELF_Section * mDebugPubNames;
+    ELF_Section * mDebugPubTypes;
     SymbolSection ** mSymSections;
     unsigned mSymSectionsCnt;
     unsigned mSymSectionsLen;
     ObjectInfo ** mObjectHash;
-    ObjectInfo * mObjectList;
-    Elf_Sym ** mSymbolHash;
+    SymbolAddress * mSymbolAddrs;
     unsigned mSymbolTableLen;
+    ContextAddress mSymbolMaxSize;          /* max size of symbols in mSymbolAddrs */
+    struct WorkerJob * mSymbolTablesJob;    /* symbol indices are built by a worker thread, see wait_symbol_tables() */
+    UnitAddressRange * mAddrRanges;
+    unsigned mAddrRangesCnt;
+    UnitFileName ** mFileNameHash;
+    PubName * mPubNames;                    /* global names index, entry 0 is not used, see find_pub_object() */
+    unsigned mPubNamesCnt;
+    unsigned mPubNamesMax;
+    unsigned * mPubNamesHash;
     DWARFCache * mLineInfoNext;
+    struct DWARFIndex * mIndex;             /* persistent index file, see dwarfindex.h */
+    int mIndexSavePosted;                   /* index file write is scheduled or in progress, see dwarf_index_save_later() */
+    int mIndexSaveAgain;                    /* more line info was loaded after the write was scheduled */
+    unsigned mIndexSaveDelays;              /* count of times the write was postponed for more loads */
 };
 
 /* Return DWARF cache for given file, create and populate the cache if needed, throw an exception if error */
@@ -168,10 +299,76 @@ extern DWARFCache * get_dwarf_cache(ELF_File * file);
 
 extern unsigned calc_symbol_name_hash(char * s);
 
+/*
+ * Load debug info entries of given compilation unit, and of units it refers to.
+ * The cache loads only unit entries when created, other entries are loaded when needed,
+ * and can be disposed later, between dispatch events, if the cache grows too large.
+ * Throw an exception if error.
+ */
+extern void load_unit_objects(DWARFCache * cache, CompUnit * unit);
+
+/* Set max size in bytes of debug info entries that are kept loaded by all caches, pinned units are not counted */
+extern void set_dwarf_cache_size_limit(size_t size);
+
 /* Load line number information for given compilation unit, throw an exception if error */
 extern void load_line_numbers(DWARFCache * cache, CompUnit * unit);
 
-/* Find ObjectInfo by ID */
+/*
+ * Load line number information for several distinct compilation units.
+ * Line number programs are decoded concurrently by worker threads and the dispatch thread,
+ * the function returns when all units are loaded. Throw an exception if error.
+ */
+extern void load_units_line_numbers(DWARFCache * cache, CompUnit ** units, unsigned cnt);
+
+/* Read line number state 'index' of a unit into reader->mState, the unit line info must be loaded */
+extern void seek_line_state(LineNumbersReader * reader, CompUnit * unit, U4_T index);
+
+/* Read next line number state into reader->mState */
+extern void next_line_state(LineNumbersReader * reader);
+
+/* Read line numbers index entry 'index' of a unit into reader->mRef, the unit line info must be loaded */
+extern void seek_line_ref(LineRefsReader * reader, CompUnit * unit, U4_T index);
+
+/* Read next line numbers index entry into reader->mRef */
+extern void next_line_ref(LineRefsReader * reader);
+
+/*
+ * Wait until symbol name hash and address index are built.
+ * The indices are built by a worker thread after the cache is created,
+ * clients must call this function before accessing SymbolSection.mSymbolHash, mHashNext or mSymbolAddrs.
+ * Throw an exception if error.
+ */
+extern void wait_symbol_tables(DWARFCache * cache);
+
+/* Find ELF symbol that contains given link-time address, return NULL if not found, throw an exception if error */
+extern SymbolAddress * find_symbol_address(DWARFCache * cache, ContextAddress addr);
+
+/*
+ * Find compilation unit address range that intersects link-time address range [addr0, addr1).
+ * If several ranges intersect, the one with lowest address is returned. Return NULL if not found.
+ * The address range index is built on first call, throw an exception if error.
+ */
+extern UnitAddressRange * find_unit_addr_range(DWARFCache * cache, ContextAddress addr0, ContextAddress addr1);
+
+/*
+ * Find compilation units that refer to source files with same base name as "file_name".
+ * The file name index is built on first call, throw an exception if error.
+ * Return NULL if not found.
+ */
+extern UnitFileName * find_unit_file_name(DWARFCache * cache, const char * file_name);
+
+/*
+ * Find global object or type by name in .debug_pubnames and .debug_pubtypes sections,
+ * and load entries of the unit that contains it. Objects are searched before types,
+ * and definitions before declarations.
+ * Return NULL if the name is not found or the file has no such sections, throw an exception if error.
+ */
+extern ObjectInfo * find_pub_object(DWARFCache * cache, const char * name);
+
+/* Return a number that is incremented when cached debug info entries are disposed */
+extern unsigned get_dwarf_cache_generation(void);
+
+/* Find ObjectInfo by ID, load the compilation unit that contains the object if needed, throw an exception if error */
 extern ObjectInfo * find_object(DWARFCache * cache, U8_T ID);
 
 /* Read a property of a DWARF object, on error set errno and return -1 */
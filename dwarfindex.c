@@ -0,0 +1,915 @@
+/*******************************************************************************
+ * Copyright (c) 2026 TCF Target Agent for ARM contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *     TCF Target Agent for ARM contributors - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * This module implements persistent index files of DWARF cache data.
+ *
+ * Index file data is in agent native byte order and structure layout.
+ * Strings are stored as section index and offset in ELF file, since they point into ELF section data.
+ */
+
+#include "config.h"
+
+#if ENABLE_DwarfIndex
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "dwarfindex.h"
+#include "myalloc.h"
+#include "exceptions.h"
+#include "events.h"
+#include "asyncreq.h"
+#include "trace.h"
+
+#define INDEX_MAGIC         0x58444954
+#define INDEX_VERSION       5
+#define MAX_KEY_SIZE        64
+#define NT_GNU_BUILD_ID     3
+#define INDEX_SAVE_DELAY    10000000
+#define INDEX_SAVE_MAX_DELAYS 6
+
+#define INDEX_LAYOUT        ((U4_T)sizeof(ContextAddress) | (U4_T)sizeof(SymbolAddress) << 8 | \
+                             (U4_T)sizeof(LineNumbersBlock) << 16 | (U4_T)sizeof(LineRefsBlock) << 24)
+
+#define ALIGN(x)            (((x) + 7) & ~(U8_T)7)
+#define ALIGN4(x)           (((x) + 3) & ~(U8_T)3)
+
+typedef struct IndexHeader {
+    U4_T mMagic;
+    U4_T mVersion;
+    U4_T mLayout;               /* sizes of cached structures, files of other agent builds are rejected */
+    U4_T mKeySize;
+    U1_T mKey[MAX_KEY_SIZE];    /* GNU build ID or file ID */
+    U4_T mSectionCnt;
+    U4_T mSymSectionsCnt;
+    U4_T mSymbolTableLen;
+    U4_T mCompUnitsCnt;
+    U4_T mAddrRangesCnt;
+    U4_T mReserved;
+    U8_T mSymSectionsOffs;
+    U8_T mSymbolAddrsOffs;
+    U8_T mAddrRangesOffs;
+    U8_T mUnitsOffs;
+    U8_T mFileSize;
+} IndexHeader;
+
+/* Symbol section entry, followed by SymbolSection.mHashNext array at next aligned offset */
+typedef struct IndexSymSection {
+    U4_T mSymCnt;
+    U4_T mHashNextCnt;          /* 0 if the section uses ELF hash section */
+    U8_T mStrPoolSize;
+    unsigned mSymbolHash[SYM_HASH_SIZE];
+} IndexSymSection;
+
+typedef struct IndexAddrRange {
+    ContextAddress mAddr;
+    ContextAddress mSize;
+    U4_T mUnit;                 /* index in DWARFCache.mCompUnits */
+} IndexAddrRange;
+
+/*
+ * Unit entry, line info is array of directories, array of files,
+ * array of state blocks, encoded states data, array of ref blocks and encoded refs data
+ */
+typedef struct IndexUnit {
+    U8_T mID;
+    U8_T mLinesOffs;            /* 0 if line info of the unit is not in the index */
+    U4_T mDirsCnt;
+    U4_T mFilesCnt;
+    U4_T mStatesCnt;
+    U4_T mStatesDataSize;
+    U4_T mLineRefsCnt;
+    U4_T mLineRefsDataSize;
+} IndexUnit;
+
+/* String in ELF section data, mSection is 0 for NULL string */
+typedef struct IndexString {
+    U4_T mSection;
+    U4_T mOffset;
+} IndexString;
+
+typedef struct IndexFile {
+    IndexString mName;
+    IndexString mDir;
+    U4_T mModTime;
+    U4_T mSize;
+} IndexFile;
+
+struct DWARFIndex {
+    U1_T * mData;
+    size_t mSize;
+    int mUnitsOK;               /* -1 if not checked yet */
+    int mRefCnt;                /* the cache and index writers that copy data of the mapped file */
+};
+
+/* Part of index file data, points to cache data, to the mapped old index file, or to "owned" memory */
+typedef struct IndexChunk {
+    const void * data;
+    size_t size;
+} IndexChunk;
+
+/*
+ * Index file is written by an async request thread. The dispatch thread builds only the list of chunks,
+ * bulk data is not copied: the writer keeps a reference to the ELF file, so the cache and its loaded
+ * line info are not disposed, and a reference to the old index file, so it stays mapped.
+ */
+typedef struct IndexWriter {
+    AsyncReqInfo req;
+    DWARFCache * cache;
+    DWARFIndex * index;         /* old index file or NULL */
+    char * dir;                 /* copy of index_dir, the global can be changed while the file is written */
+    char * path;
+    IndexChunk * chunks;
+    unsigned chunks_cnt;
+    unsigned chunks_max;
+    void ** owned;              /* memory allocated for headers and tables built by the dispatch thread */
+    unsigned owned_cnt;
+    unsigned owned_max;
+    size_t size;
+} IndexWriter;
+
+static const U1_T zero_bytes[8];
+
+static char * index_dir = NULL;
+
+void set_dwarf_index_dir(const char * dir) {
+    loc_free(index_dir);
+    index_dir = dir == NULL || *dir == 0 ? NULL : loc_strdup(dir);
+}
+
+static U4_T get_note_word(ELF_File * File, U1_T * p) {
+    U4_T x = 0;
+    int i;
+    for (i = 0; i < 4; i++) {
+        x |= (U4_T)p[File->big_endian ? 3 - i : i] << (i * 8);
+    }
+    return x;
+}
+
+static unsigned get_build_id(ELF_File * File, U1_T * buf, unsigned max) {
+    unsigned idx;
+    for (idx = 1; idx < File->section_cnt; idx++) {
+        ELF_Section * sec = File->sections + idx;
+        U8_T pos = 0;
+        if (sec->type != SHT_NOTE || sec->size == 0) continue;
+        if (elf_load(sec) < 0) continue;
+        while (pos + 12 <= sec->size) {
+            U1_T * p = (U1_T *)sec->data + pos;
+            U4_T name_size = get_note_word(File, p);
+            U4_T desc_size = get_note_word(File, p + 4);
+            U4_T type = get_note_word(File, p + 8);
+            U8_T desc_pos = pos + 12 + ALIGN4(name_size);
+            if (desc_pos + desc_size > sec->size) break;
+            if (type == NT_GNU_BUILD_ID && name_size == 4 && memcmp(p + 12, "GNU", 4) == 0) {
+                if (desc_size == 0 || desc_size > max) return 0;
+                memcpy(buf, (U1_T *)sec->data + desc_pos, desc_size);
+                return desc_size;
+            }
+            pos = desc_pos + ALIGN4(desc_size);
+        }
+    }
+    return 0;
+}
+
+/* Compute index key and file name, return key size */
+static unsigned get_index_key(ELF_File * File, U1_T * key, char * path, size_t path_size) {
+    unsigned i;
+    unsigned n = get_build_id(File, key, MAX_KEY_SIZE);
+    int len = 0;
+
+    if (n > 0) {
+        len = snprintf(path, path_size, "%s/", index_dir);
+        for (i = 0; i < n && len < (int)path_size; i++) {
+            len += snprintf(path + len, path_size - len, "%02x", key[i]);
+        }
+    }
+    else {
+        U8_T id[3];
+        id[0] = (U8_T)File->dev;
+        id[1] = (U8_T)File->ino;
+        id[2] = (U8_T)File->mtime;
+        n = sizeof(id);
+        memcpy(key, id, n);
+        len = snprintf(path, path_size, "%s/%llx-%llx-%llx", index_dir,
+            (unsigned long long)id[0], (unsigned long long)id[1], (unsigned long long)id[2]);
+    }
+    if (len < (int)path_size) snprintf(path + len, path_size - len, ".idx");
+    return n;
+}
+
+static void * get_data(DWARFIndex * Index, U8_T Offs, U8_T Size) {
+    if (Offs > Index->mSize || Size > Index->mSize - Offs) return NULL;
+    return Index->mData + Offs;
+}
+
+DWARFIndex * dwarf_index_open(DWARFCache * Cache) {
+    ELF_File * File = Cache->mFile;
+    U1_T key[MAX_KEY_SIZE];
+    char path[FILE_PATH_SIZE];
+    unsigned key_size = 0;
+    struct stat st;
+    void * data = NULL;
+    IndexHeader * hdr = NULL;
+    DWARFIndex * Index = NULL;
+    int fd = -1;
+
+    if (index_dir == NULL) return NULL;
+    memset(key, 0, sizeof(key));
+    key_size = get_index_key(File, key, path, sizeof(path));
+    if ((fd = open(path, O_RDONLY, 0)) < 0) return NULL;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(IndexHeader)) {
+        close(fd);
+        return NULL;
+    }
+    data = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    hdr = (IndexHeader *)data;
+    if (hdr->mMagic != INDEX_MAGIC || hdr->mVersion != INDEX_VERSION || hdr->mLayout != INDEX_LAYOUT ||
+            hdr->mKeySize != key_size || memcmp(hdr->mKey, key, key_size) != 0 ||
+            hdr->mFileSize != (U8_T)st.st_size || hdr->mSectionCnt != File->section_cnt) {
+        trace(LOG_ELF, "Index file %s does not match ELF file %s", path, File->name);
+        munmap(data, (size_t)st.st_size);
+        return NULL;
+    }
+    Index = (DWARFIndex *)loc_alloc_zero(sizeof(DWARFIndex));
+    Index->mData = (U1_T *)data;
+    Index->mSize = (size_t)st.st_size;
+    Index->mUnitsOK = -1;
+    Index->mRefCnt = 1;
+    trace(LOG_ELF, "Index file %s is mapped for ELF file %s", path, File->name);
+    return Index;
+}
+
+void dwarf_index_close(DWARFIndex * Index) {
+    if (Index == NULL) return;
+    assert(Index->mRefCnt > 0);
+    if (--Index->mRefCnt > 0) return;
+    munmap(Index->mData, Index->mSize);
+    loc_free(Index);
+}
+
+/* Disable index of the cache after a consistency check failed */
+static int index_failed(DWARFCache * Cache, const char * what) {
+    trace(LOG_ELF, "Invalid %s in index of ELF file %s", what, Cache->mFile->name);
+    dwarf_index_close(Cache->mIndex);
+    Cache->mIndex = NULL;
+    return 0;
+}
+
+int dwarf_index_read_symbols(DWARFCache * Cache) {
+    DWARFIndex * Index = Cache->mIndex;
+    IndexHeader * hdr = (IndexHeader *)Index->mData;
+    SymbolAddress * Addrs = NULL;
+    ContextAddress MaxSize = 0;
+    U8_T Offs = hdr->mSymSectionsOffs;
+    unsigned i;
+
+    if (hdr->mSymSectionsCnt != Cache->mSymSectionsCnt) return index_failed(Cache, "symbol sections");
+    for (i = 0; i < Cache->mSymSectionsCnt; i++) {
+        SymbolSection * tbl = Cache->mSymSections[i];
+        IndexSymSection * s = (IndexSymSection *)get_data(Index, Offs, sizeof(IndexSymSection));
+        unsigned * HashNext = NULL;
+        unsigned j;
+        Offs = ALIGN(Offs + sizeof(IndexSymSection));
+        if (s == NULL || s->mSymCnt != tbl->sym_cnt || s->mStrPoolSize != tbl->mStrPoolSize ||
+                s->mHashNextCnt != (tbl->mHashNext != NULL ? tbl->sym_cnt : 0) ||
+                (HashNext = (unsigned *)get_data(Index, Offs, sizeof(unsigned) * (U8_T)s->mHashNextCnt)) == NULL) {
+            return index_failed(Cache, "symbol section");
+        }
+        for (j = 0; j < SYM_HASH_SIZE; j++) {
+            if (s->mSymbolHash[j] >= tbl->sym_cnt && s->mSymbolHash[j] != 0) return index_failed(Cache, "symbol hash");
+        }
+        /* Hash chains go from higher to lower symbol index and end at 0, so they cannot loop */
+        for (j = 0; j < s->mHashNextCnt; j++) {
+            if (HashNext[j] >= j && HashNext[j] != 0) return index_failed(Cache, "symbol hash");
+        }
+        Offs = ALIGN(Offs + sizeof(unsigned) * (U8_T)s->mHashNextCnt);
+    }
+    Addrs = (SymbolAddress *)get_data(Index, hdr->mSymbolAddrsOffs, sizeof(SymbolAddress) * (U8_T)hdr->mSymbolTableLen);
+    if (Addrs == NULL) return index_failed(Cache, "symbol address table");
+    for (i = 0; i < hdr->mSymbolTableLen; i++) {
+        SymbolSection * tbl = NULL;
+        if (Addrs[i].mSection >= Cache->mSymSectionsCnt) return index_failed(Cache, "symbol address table");
+        tbl = Cache->mSymSections[Addrs[i].mSection];
+        if (Addrs[i].mIndex >= tbl->sym_cnt || Addrs[i].mName >= tbl->mStrPoolSize) {
+            return index_failed(Cache, "symbol address table");
+        }
+        if (Addrs[i].mSize > MaxSize) MaxSize = Addrs[i].mSize;
+    }
+
+    Offs = hdr->mSymSectionsOffs;
+    for (i = 0; i < Cache->mSymSectionsCnt; i++) {
+        SymbolSection * tbl = Cache->mSymSections[i];
+        IndexSymSection * s = (IndexSymSection *)(Index->mData + Offs);
+        memcpy(tbl->mSymbolHash, s->mSymbolHash, sizeof(tbl->mSymbolHash));
+        Offs = ALIGN(Offs + sizeof(IndexSymSection));
+        if (s->mHashNextCnt > 0) memcpy(tbl->mHashNext, Index->mData + Offs, sizeof(unsigned) * s->mHashNextCnt);
+        Offs = ALIGN(Offs + sizeof(unsigned) * (U8_T)s->mHashNextCnt);
+    }
+    Cache->mSymbolAddrs = (SymbolAddress *)loc_alloc(sizeof(SymbolAddress) * hdr->mSymbolTableLen);
+    memcpy(Cache->mSymbolAddrs, Addrs, sizeof(SymbolAddress) * hdr->mSymbolTableLen);
+    Cache->mSymbolTableLen = hdr->mSymbolTableLen;
+    Cache->mSymbolMaxSize = MaxSize;
+    return 1;
+}
+
+static IndexUnit * get_units(DWARFCache * Cache) {
+    DWARFIndex * Index = Cache->mIndex;
+    IndexHeader * hdr = (IndexHeader *)Index->mData;
+    IndexUnit * Units = NULL;
+
+    if (Index->mUnitsOK < 0) {
+        unsigned i;
+        Index->mUnitsOK = 0;
+        if (hdr->mCompUnitsCnt != Cache->mCompUnitsCnt) return NULL;
+        Units = (IndexUnit *)get_data(Index, hdr->mUnitsOffs, sizeof(IndexUnit) * (U8_T)hdr->mCompUnitsCnt);
+        if (Units == NULL) return NULL;
+        for (i = 0; i < Cache->mCompUnitsCnt; i++) {
+            if (Units[i].mID != Cache->mCompUnits[i]->mID) return NULL;
+        }
+        Index->mUnitsOK = 1;
+    }
+    if (!Index->mUnitsOK) return NULL;
+    return (IndexUnit *)(Index->mData + hdr->mUnitsOffs);
+}
+
+int dwarf_index_read_addr_ranges(DWARFCache * Cache) {
+    DWARFIndex * Index = Cache->mIndex;
+    IndexHeader * hdr = (IndexHeader *)Index->mData;
+    IndexAddrRange * Ranges = NULL;
+    unsigned i;
+
+    if (get_units(Cache) == NULL) return index_failed(Cache, "compilation units");
+    Ranges = (IndexAddrRange *)get_data(Index, hdr->mAddrRangesOffs, sizeof(IndexAddrRange) * (U8_T)hdr->mAddrRangesCnt);
+    if (Ranges == NULL) return index_failed(Cache, "address ranges");
+    /* Ranges must be sorted and must not overlap, find_unit_addr_range() checks one range only */
+    for (i = 0; i < hdr->mAddrRangesCnt; i++) {
+        IndexAddrRange * r = Ranges + i;
+        if (r->mUnit >= Cache->mCompUnitsCnt) return index_failed(Cache, "address ranges");
+        if (r->mSize == 0 || r->mSize > ~r->mAddr) return index_failed(Cache, "address ranges");
+        if (i > 0 && r[-1].mAddr + r[-1].mSize > r->mAddr) return index_failed(Cache, "address ranges");
+    }
+    Cache->mAddrRanges = (UnitAddressRange *)loc_alloc(sizeof(UnitAddressRange) * (hdr->mAddrRangesCnt + 1));
+    for (i = 0; i < hdr->mAddrRangesCnt; i++) {
+        UnitAddressRange * r = Cache->mAddrRanges + i;
+        r->mAddr = Ranges[i].mAddr;
+        r->mSize = Ranges[i].mSize;
+        r->mUnit = Cache->mCompUnits[Ranges[i].mUnit];
+    }
+    Cache->mAddrRangesCnt = hdr->mAddrRangesCnt;
+    return 1;
+}
+
+static int read_string(ELF_File * File, IndexString * s, char ** str) {
+    ELF_Section * sec = NULL;
+    if (s->mSection == 0) {
+        *str = NULL;
+        return 1;
+    }
+    if (s->mSection >= File->section_cnt) return 0;
+    sec = File->sections + s->mSection;
+    if (s->mOffset >= sec->size) return 0;
+    if (elf_load(sec) < 0) return 0;
+    *str = (char *)sec->data + s->mOffset;
+    /* The string must be terminated inside the section */
+    return memchr(*str, 0, (size_t)(sec->size - s->mOffset)) != NULL;
+}
+
+/* Read LEB128 number of encoded line states or refs, return 0 if it does not end before 'end' */
+static int check_state_data(U1_T ** Data, U1_T * end, U8_T * n, int sign) {
+    U1_T * p = *Data;
+    unsigned i = 0;
+    *n = 0;
+    for (;;) {
+        U1_T b = 0;
+        if (p >= end || i >= 70) return 0;
+        b = *p++;
+        if (i < 64) *n |= (U8_T)(b & 0x7f) << i;
+        i += 7;
+        if ((b & 0x80) == 0) {
+            if (sign && i < 64 && (b & 0x40) != 0) *n |= ~(U8_T)0 << i;
+            break;
+        }
+    }
+    *Data = p;
+    return 1;
+}
+
+/*
+ * Decode all states like next_line_state() does, but without trusting the data:
+ * encoded states of a block must stay inside the block data, file indexes must be valid.
+ */
+static int check_line_states(IndexUnit * u, LineNumbersBlock * Blocks, U4_T BlocksCnt, U1_T * StatesData) {
+    U4_T i;
+    for (i = 0; i < BlocksCnt; i++) {
+        U4_T Cnt = i + 1 < BlocksCnt ? LINE_BLOCK_STATES : u->mStatesCnt - i * LINE_BLOCK_STATES;
+        U4_T End = i + 1 < BlocksCnt ? Blocks[i + 1].mDataOffs : u->mStatesDataSize;
+        U1_T * p = StatesData + Blocks[i].mDataOffs;
+        U4_T j;
+        if (Blocks[i].mDataOffs > End || End > u->mStatesDataSize) return 0;
+        if (Blocks[i].mState.mFile > u->mFilesCnt) return 0;
+        for (j = 1; j < Cnt; j++) {
+            U1_T Flags = 0;
+            U8_T n = 0;
+            if (p >= StatesData + End) return 0;
+            Flags = *p++;
+            if (!check_state_data(&p, StatesData + End, &n, 0)) return 0;
+            if (!check_state_data(&p, StatesData + End, &n, 0)) return 0;
+            if (Flags & LINE_DELTA_FILE) {
+                if (!check_state_data(&p, StatesData + End, &n, 0)) return 0;
+                if (n > u->mFilesCnt) return 0;
+            }
+            if ((Flags & LINE_DELTA_COLUMN) && !check_state_data(&p, StatesData + End, &n, 0)) return 0;
+            if ((Flags & LINE_DELTA_ISA) && !check_state_data(&p, StatesData + End, &n, 0)) return 0;
+        }
+    }
+    return 1;
+}
+
+/* Decode all refs like next_line_ref() does, checking data bounds, file and state indexes */
+static int check_line_refs(IndexUnit * u, LineRefsBlock * Blocks, U4_T BlocksCnt, U1_T * RefsData) {
+    U4_T i;
+    for (i = 0; i < BlocksCnt; i++) {
+        U4_T Cnt = i + 1 < BlocksCnt ? LINE_BLOCK_REFS : u->mLineRefsCnt - i * LINE_BLOCK_REFS;
+        U4_T End = i + 1 < BlocksCnt ? Blocks[i + 1].mDataOffs : u->mLineRefsDataSize;
+        U1_T * p = RefsData + Blocks[i].mDataOffs;
+        U8_T File = Blocks[i].mRef.mFile;
+        I8_T State = Blocks[i].mRef.mState;
+        U4_T j;
+        if (Blocks[i].mDataOffs > End || End > u->mLineRefsDataSize) return 0;
+        if (File > u->mFilesCnt || Blocks[i].mRef.mState >= u->mStatesCnt) return 0;
+        for (j = 1; j < Cnt; j++) {
+            U8_T n = 0;
+            if (!check_state_data(&p, RefsData + End, &n, 0)) return 0;
+            if (n > u->mFilesCnt - File) return 0;
+            File += n;
+            if (!check_state_data(&p, RefsData + End, &n, 0)) return 0;
+            if (!check_state_data(&p, RefsData + End, &n, 1)) return 0;
+            if (!check_state_data(&p, RefsData + End, &n, 1)) return 0;
+            if ((I8_T)n >= (I8_T)u->mStatesCnt || (I8_T)n <= -(I8_T)u->mStatesCnt) return 0;
+            State += (I8_T)n;
+            if (State < 0 || State >= (I8_T)u->mStatesCnt) return 0;
+        }
+    }
+    return 1;
+}
+
+int dwarf_index_read_line_numbers(DWARFCache * Cache, CompUnit * Unit) {
+    DWARFIndex * Index = Cache->mIndex;
+    IndexUnit * Units = get_units(Cache);
+    IndexUnit * u = NULL;
+    IndexString * Dirs = NULL;
+    IndexFile * Files = NULL;
+    LineNumbersBlock * Blocks = NULL;
+    U1_T * StatesData = NULL;
+    LineRefsBlock * RefsBlocks = NULL;
+    U1_T * RefsData = NULL;
+    U4_T BlocksCnt = 0;
+    U4_T RefsBlocksCnt = 0;
+    U8_T Offs = 0;
+    U4_T i;
+
+    if (Units == NULL) return 0;
+    u = Units + Unit->mUnitPos;
+    if (u->mLinesOffs == 0) return 0;
+    Offs = u->mLinesOffs;
+    Dirs = (IndexString *)get_data(Index, Offs, sizeof(IndexString) * (U8_T)u->mDirsCnt);
+    Offs += sizeof(IndexString) * (U8_T)u->mDirsCnt;
+    Files = (IndexFile *)get_data(Index, Offs, sizeof(IndexFile) * (U8_T)u->mFilesCnt);
+    Offs = ALIGN(Offs + sizeof(IndexFile) * (U8_T)u->mFilesCnt);
+    BlocksCnt = (U4_T)(((U8_T)u->mStatesCnt + LINE_BLOCK_STATES - 1) / LINE_BLOCK_STATES);
+    Blocks = (LineNumbersBlock *)get_data(Index, Offs, sizeof(LineNumbersBlock) * (U8_T)BlocksCnt);
+    Offs = ALIGN(Offs + sizeof(LineNumbersBlock) * (U8_T)BlocksCnt);
+    StatesData = (U1_T *)get_data(Index, Offs, u->mStatesDataSize);
+    Offs = ALIGN(Offs + u->mStatesDataSize);
+    RefsBlocksCnt = (U4_T)(((U8_T)u->mLineRefsCnt + LINE_BLOCK_REFS - 1) / LINE_BLOCK_REFS);
+    RefsBlocks = (LineRefsBlock *)get_data(Index, Offs, sizeof(LineRefsBlock) * (U8_T)RefsBlocksCnt);
+    Offs = ALIGN(Offs + sizeof(LineRefsBlock) * (U8_T)RefsBlocksCnt);
+    RefsData = (U1_T *)get_data(Index, Offs, u->mLineRefsDataSize);
+    if (Dirs == NULL || Files == NULL || Blocks == NULL || StatesData == NULL || RefsBlocks == NULL || RefsData == NULL) return 0;
+    if (!check_line_states(u, Blocks, BlocksCnt, StatesData)) return index_failed(Cache, "line number states");
+    if (u->mLineRefsCnt > u->mStatesCnt) return index_failed(Cache, "line number refs");
+    if (!check_line_refs(u, RefsBlocks, RefsBlocksCnt, RefsData)) return index_failed(Cache, "line number refs");
+
+    assert(!Unit->mLineInfoLoaded);
+    assert(Unit->mFiles == NULL && Unit->mDirs == NULL && Unit->mStatesBlocks == NULL);
+    if (u->mDirsCnt > 0) Unit->mDirs = (char **)loc_alloc(sizeof(char *) * u->mDirsCnt);
+    Unit->mDirsCnt = Unit->mDirsMax = u->mDirsCnt;
+    if (u->mFilesCnt > 0) Unit->mFiles = (FileInfo *)loc_alloc_zero(sizeof(FileInfo) * u->mFilesCnt);
+    Unit->mFilesCnt = Unit->mFilesMax = u->mFilesCnt;
+    for (i = 0; i < u->mDirsCnt; i++) {
+        if (!read_string(Cache->mFile, Dirs + i, Unit->mDirs + i)) break;
+    }
+    if (i == u->mDirsCnt) {
+        for (i = 0; i < u->mFilesCnt; i++) {
+            FileInfo * f = Unit->mFiles + i;
+            if (!read_string(Cache->mFile, &Files[i].mName, &f->mName)) break;
+            if (!read_string(Cache->mFile, &Files[i].mDir, &f->mDir)) break;
+            f->mModTime = Files[i].mModTime;
+            f->mSize = Files[i].mSize;
+        }
+    }
+    if (i < u->mDirsCnt || i < u->mFilesCnt) {
+        /* Leave the unit as if it was never loaded */
+        loc_free(Unit->mDirs);
+        loc_free(Unit->mFiles);
+        Unit->mDirs = NULL;
+        Unit->mFiles = NULL;
+        Unit->mDirsCnt = Unit->mDirsMax = 0;
+        Unit->mFilesCnt = Unit->mFilesMax = 0;
+        return 0;
+    }
+    if (BlocksCnt > 0) {
+        Unit->mStatesBlocks = (LineNumbersBlock *)loc_alloc(sizeof(LineNumbersBlock) * BlocksCnt);
+        memcpy(Unit->mStatesBlocks, Blocks, sizeof(LineNumbersBlock) * BlocksCnt);
+    }
+    if (u->mStatesDataSize > 0) {
+        Unit->mStatesData = (U1_T *)loc_alloc(u->mStatesDataSize);
+        memcpy(Unit->mStatesData, StatesData, u->mStatesDataSize);
+    }
+    Unit->mStatesCnt = u->mStatesCnt;
+    Unit->mStatesDataSize = u->mStatesDataSize;
+    if (RefsBlocksCnt > 0) {
+        Unit->mLineRefsBlocks = (LineRefsBlock *)loc_alloc(sizeof(LineRefsBlock) * RefsBlocksCnt);
+        memcpy(Unit->mLineRefsBlocks, RefsBlocks, sizeof(LineRefsBlock) * RefsBlocksCnt);
+    }
+    if (u->mLineRefsDataSize > 0) {
+        Unit->mLineRefsData = (U1_T *)loc_alloc(u->mLineRefsDataSize);
+        memcpy(Unit->mLineRefsData, RefsData, u->mLineRefsDataSize);
+    }
+    Unit->mLineRefsCnt = u->mLineRefsCnt;
+    Unit->mLineRefsDataSize = u->mLineRefsDataSize;
+    Unit->mLineInfoLoaded = 1;
+    return 1;
+}
+
+/* Add chunk of index data, the data is not copied, return its offset in the file */
+static U8_T add_data(IndexWriter * w, const void * data, size_t size) {
+    U8_T offs = ALIGN(w->size);
+    if (w->chunks_cnt + 2 > w->chunks_max) {
+        w->chunks_max = w->chunks_max == 0 ? 256 : w->chunks_max * 2;
+        w->chunks = (IndexChunk *)loc_realloc(w->chunks, sizeof(IndexChunk) * w->chunks_max);
+    }
+    if (offs > w->size) {
+        IndexChunk * c = w->chunks + w->chunks_cnt++;
+        c->data = zero_bytes;
+        c->size = (size_t)(offs - w->size);
+    }
+    if (size > 0) {
+        IndexChunk * c = w->chunks + w->chunks_cnt++;
+        c->data = data;
+        c->size = size;
+    }
+    w->size = (size_t)(offs + size);
+    return offs;
+}
+
+/* Add chunk of zeroed memory owned by the writer, to be filled by the caller */
+static void * alloc_data(IndexWriter * w, size_t size, U8_T * offs) {
+    void * data = loc_alloc_zero(size > 0 ? size : 1);
+    if (w->owned_cnt >= w->owned_max) {
+        w->owned_max = w->owned_max == 0 ? 64 : w->owned_max * 2;
+        w->owned = (void **)loc_realloc(w->owned, sizeof(void *) * w->owned_max);
+    }
+    w->owned[w->owned_cnt++] = data;
+    *offs = add_data(w, data, size);
+    return data;
+}
+
+/* Encode a string pointer as ELF section index and offset, return 0 if the string is not in section data */
+static int add_string(ELF_File * File, char * str, IndexString * s) {
+    unsigned idx;
+    s->mSection = 0;
+    s->mOffset = 0;
+    if (str == NULL) return 1;
+    for (idx = 1; idx < File->section_cnt; idx++) {
+        ELF_Section * sec = File->sections + idx;
+        char * data = (char *)sec->data;
+        if (data == NULL || str < data || str >= data + sec->size) continue;
+        s->mSection = idx;
+        s->mOffset = (U4_T)(str - data);
+        return 1;
+    }
+    return 0;
+}
+
+static U8_T add_line_numbers(IndexWriter * w, ELF_File * File, CompUnit * Unit) {
+    IndexString * Dirs = NULL;
+    IndexFile * Files = NULL;
+    U8_T offs = 0;
+    U4_T i;
+
+    if (Unit->mStatesCnt > 0) {
+        /* States with invalid file index would fail check_line_states(), don't index the unit */
+        LineNumbersReader Reader;
+        seek_line_state(&Reader, Unit, 0);
+        for (i = 0;; i++) {
+            if (Reader.mState.mFile > Unit->mFilesCnt) return 0;
+            if (i + 1 >= Unit->mStatesCnt) break;
+            next_line_state(&Reader);
+        }
+    }
+    /* Entries are multiples of 8 bytes, so directories and files are contiguous */
+    Dirs = (IndexString *)alloc_data(w, sizeof(IndexString) * Unit->mDirsCnt + sizeof(IndexFile) * Unit->mFilesCnt, &offs);
+    Files = (IndexFile *)(Dirs + Unit->mDirsCnt);
+    for (i = 0; i < Unit->mDirsCnt; i++) {
+        if (!add_string(File, Unit->mDirs[i], Dirs + i)) return 0;
+    }
+    for (i = 0; i < Unit->mFilesCnt; i++) {
+        IndexFile * f = Files + i;
+        if (!add_string(File, Unit->mFiles[i].mName, &f->mName)) return 0;
+        if (!add_string(File, Unit->mFiles[i].mDir, &f->mDir)) return 0;
+        f->mModTime = Unit->mFiles[i].mModTime;
+        f->mSize = Unit->mFiles[i].mSize;
+    }
+    add_data(w, Unit->mStatesBlocks, sizeof(LineNumbersBlock) * ((Unit->mStatesCnt + LINE_BLOCK_STATES - 1) / LINE_BLOCK_STATES));
+    add_data(w, Unit->mStatesData, Unit->mStatesDataSize);
+    add_data(w, Unit->mLineRefsBlocks, sizeof(LineRefsBlock) * ((Unit->mLineRefsCnt + LINE_BLOCK_REFS - 1) / LINE_BLOCK_REFS));
+    add_data(w, Unit->mLineRefsData, Unit->mLineRefsDataSize);
+    return offs;
+}
+
+/* Add line info of a unit that is not loaded from the mapped index file, return offset of the data or 0 */
+static U8_T copy_line_numbers(IndexWriter * w, DWARFIndex * Index, IndexUnit * u) {
+    U8_T BlocksCnt = ((U8_T)u->mStatesCnt + LINE_BLOCK_STATES - 1) / LINE_BLOCK_STATES;
+    U8_T Size = 0;
+    void * Data = NULL;
+
+    /* Same layout as written by add_line_numbers() */
+    Size = ALIGN(sizeof(IndexString) * (U8_T)u->mDirsCnt + sizeof(IndexFile) * (U8_T)u->mFilesCnt);
+    Size = ALIGN(Size + sizeof(LineNumbersBlock) * BlocksCnt);
+    Size = ALIGN(Size + u->mStatesDataSize);
+    Size = ALIGN(Size + sizeof(LineRefsBlock) * (((U8_T)u->mLineRefsCnt + LINE_BLOCK_REFS - 1) / LINE_BLOCK_REFS));
+    Size += u->mLineRefsDataSize;
+    Data = get_data(Index, u->mLinesOffs, Size);
+    if (Data == NULL) return 0;
+    return add_data(w, Data, (size_t)Size);
+}
+
+/* Create directory and its missing parents, like "mkdir -p" */
+static int make_dirs(char * dir) {
+    struct stat st;
+    char * p = dir;
+
+    while (*p == '/') p++;
+    for (;;) {
+        char c;
+        while (*p != 0 && *p != '/') p++;
+        c = *p;
+        *p = 0;
+        if (mkdir(dir, 0777) < 0 && errno != EEXIST) {
+            int error = errno;
+            *p = c;
+            errno = error;
+            return -1;
+        }
+        *p = c;
+        while (*p == '/') p++;
+        if (*p == 0) break;
+    }
+    if (stat(dir, &st) < 0) return -1;
+    if (!S_ISDIR(st.st_mode)) {
+        errno = ENOTDIR;
+        return -1;
+    }
+    return 0;
+}
+
+static int write_index_file(void * x) {
+    IndexWriter * w = (IndexWriter *)x;
+    char tmp[FILE_PATH_SIZE];
+    unsigned i;
+    int fd = -1;
+
+    if (make_dirs(w->dir) < 0) return -1;
+    if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", w->path) >= (int)sizeof(tmp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    /* Unique name and O_EXCL, so a file or link planted in a shared directory is never written through */
+    if ((fd = mkstemp(tmp)) < 0) return -1;
+    if (fchmod(fd, 0644) < 0) {
+        int error = errno;
+        close(fd);
+        unlink(tmp);
+        errno = error;
+        return -1;
+    }
+    for (i = 0; i < w->chunks_cnt; i++) {
+        IndexChunk * c = w->chunks + i;
+        size_t pos = 0;
+        while (pos < c->size) {
+            ssize_t n = write(fd, (const U1_T *)c->data + pos, c->size - pos);
+            if (n <= 0) {
+                int error = n < 0 ? errno : EIO;
+                close(fd);
+                unlink(tmp);
+                errno = error;
+                return -1;
+            }
+            pos += (size_t)n;
+        }
+    }
+    if (close(fd) < 0 || rename(tmp, w->path) < 0) {
+        int error = errno;
+        unlink(tmp);
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+static void save_index_event(void * arg);
+
+static void write_index_done(void * x) {
+    IndexWriter * w = (IndexWriter *)((AsyncReqInfo *)x)->client_data;
+    DWARFCache * Cache = w->cache;
+    unsigned i;
+
+    if (w->req.error) {
+        trace(LOG_ELF, "Cannot write index file %s: %s", w->path, errno_to_str(w->req.error));
+    }
+    else {
+        trace(LOG_ELF, "Index file %s is written, %lu bytes", w->path, (unsigned long)w->size);
+    }
+    for (i = 0; i < w->owned_cnt; i++) loc_free(w->owned[i]);
+    dwarf_index_close(w->index);
+    loc_free(w->owned);
+    loc_free(w->chunks);
+    loc_free(w->dir);
+    loc_free(w->path);
+    loc_free(w);
+    /* Line info loaded while the file was written is saved by next write */
+    if (Cache->mIndexSaveAgain) {
+        Cache->mIndexSaveAgain = 0;
+        Cache->mIndexSaveDelays = 0;
+        post_event_with_delay(save_index_event, Cache, INDEX_SAVE_DELAY);
+        return;
+    }
+    Cache->mIndexSavePosted = 0;
+    elf_close(Cache->mFile);
+}
+
+/* Build list of index data chunks and post async request to write them, return 0 if there is nothing new to save */
+static int save_index(DWARFCache * Cache) {
+    ELF_File * File = Cache->mFile;
+    IndexWriter * w = NULL;
+    IndexUnit * OldUnits = NULL;
+    IndexHeader * hdr = NULL;
+    IndexUnit * Units = NULL;
+    IndexAddrRange * Ranges = NULL;
+    char path[FILE_PATH_SIZE];
+    unsigned NewUnits = 0;
+    U8_T offs = 0;
+    unsigned i;
+
+    /* Line info is saved for units that are loaded or are in the old index file */
+    if (Cache->mIndex != NULL) OldUnits = get_units(Cache);
+    wait_symbol_tables(Cache);
+    find_unit_addr_range(Cache, 0, 0);
+    if (OldUnits != NULL) {
+        for (i = 0; i < Cache->mCompUnitsCnt; i++) {
+            if (Cache->mCompUnits[i]->mLineInfoLoaded && OldUnits[i].mLinesOffs == 0) NewUnits++;
+        }
+        if (NewUnits == 0) return 0;
+    }
+
+    w = (IndexWriter *)loc_alloc_zero(sizeof(IndexWriter));
+    hdr = (IndexHeader *)alloc_data(w, sizeof(IndexHeader), &offs);
+    hdr->mMagic = INDEX_MAGIC;
+    hdr->mVersion = INDEX_VERSION;
+    hdr->mLayout = INDEX_LAYOUT;
+    hdr->mKeySize = get_index_key(File, hdr->mKey, path, sizeof(path));
+    hdr->mSectionCnt = File->section_cnt;
+    hdr->mSymSectionsCnt = Cache->mSymSectionsCnt;
+    hdr->mSymbolTableLen = Cache->mSymbolTableLen;
+    hdr->mCompUnitsCnt = Cache->mCompUnitsCnt;
+    hdr->mAddrRangesCnt = Cache->mAddrRangesCnt;
+
+    for (i = 0; i < Cache->mSymSectionsCnt; i++) {
+        SymbolSection * tbl = Cache->mSymSections[i];
+        IndexSymSection * s = (IndexSymSection *)alloc_data(w, sizeof(IndexSymSection), &offs);
+        s->mSymCnt = tbl->sym_cnt;
+        s->mHashNextCnt = tbl->mHashNext != NULL ? tbl->sym_cnt : 0;
+        s->mStrPoolSize = tbl->mStrPoolSize;
+        memcpy(s->mSymbolHash, tbl->mSymbolHash, sizeof(s->mSymbolHash));
+        if (i == 0) hdr->mSymSectionsOffs = offs;
+        add_data(w, tbl->mHashNext, sizeof(unsigned) * s->mHashNextCnt);
+    }
+    hdr->mSymbolAddrsOffs = add_data(w, Cache->mSymbolAddrs, sizeof(SymbolAddress) * Cache->mSymbolTableLen);
+    Ranges = (IndexAddrRange *)alloc_data(w, sizeof(IndexAddrRange) * Cache->mAddrRangesCnt, &hdr->mAddrRangesOffs);
+    for (i = 0; i < Cache->mAddrRangesCnt; i++) {
+        IndexAddrRange * r = Ranges + i;
+        r->mAddr = Cache->mAddrRanges[i].mAddr;
+        r->mSize = Cache->mAddrRanges[i].mSize;
+        r->mUnit = Cache->mAddrRanges[i].mUnit->mUnitPos;
+    }
+    Units = (IndexUnit *)alloc_data(w, sizeof(IndexUnit) * Cache->mCompUnitsCnt, &hdr->mUnitsOffs);
+    for (i = 0; i < Cache->mCompUnitsCnt; i++) {
+        CompUnit * Unit = Cache->mCompUnits[i];
+        U8_T lines = 0;
+        IndexUnit * u = Units + i;
+        if (Unit->mLineInfoLoaded) {
+            size_t size = w->size;
+            unsigned cnt = w->chunks_cnt;
+            lines = add_line_numbers(w, File, Unit);
+            if (lines == 0) {
+                w->size = size;
+                w->chunks_cnt = cnt;
+            }
+        }
+        else if (OldUnits != NULL && OldUnits[i].mLinesOffs != 0) {
+            lines = copy_line_numbers(w, Cache->mIndex, OldUnits + i);
+        }
+        u->mID = Unit->mID;
+        if (lines != 0 && !Unit->mLineInfoLoaded) {
+            *u = OldUnits[i];
+            u->mLinesOffs = lines;
+        }
+        else if (lines != 0) {
+            u->mLinesOffs = lines;
+            u->mDirsCnt = Unit->mDirsCnt;
+            u->mFilesCnt = Unit->mFilesCnt;
+            u->mStatesCnt = Unit->mStatesCnt;
+            u->mStatesDataSize = Unit->mStatesDataSize;
+            u->mLineRefsCnt = Unit->mLineRefsCnt;
+            u->mLineRefsDataSize = Unit->mLineRefsDataSize;
+        }
+    }
+    hdr->mFileSize = w->size;
+
+    w->cache = Cache;
+    if (OldUnits != NULL) {
+        w->index = Cache->mIndex;
+        w->index->mRefCnt++;
+    }
+    w->dir = loc_strdup(index_dir);
+    w->path = loc_strdup(path);
+    w->req.done = write_index_done;
+    w->req.client_data = w;
+    w->req.type = AsyncReqUser;
+    w->req.u.user.func = write_index_file;
+    w->req.u.user.data = w;
+    async_req_post(&w->req);
+    return 1;
+}
+
+static void save_index_event(void * arg) {
+    DWARFCache * Cache = (DWARFCache *)arg;
+    ELF_File * File = Cache->mFile;
+    Trap trap;
+
+    /* The cache is alive, the file reference taken by dwarf_index_save_later() keeps it */
+    if (Cache->mIndexSaveAgain && Cache->mIndexSaveDelays < INDEX_SAVE_MAX_DELAYS) {
+        /* More units are being loaded, write them all at once */
+        Cache->mIndexSaveAgain = 0;
+        Cache->mIndexSaveDelays++;
+        post_event_with_delay(save_index_event, Cache, INDEX_SAVE_DELAY);
+        return;
+    }
+    Cache->mIndexSaveAgain = 0;
+    Cache->mIndexSaveDelays = 0;
+    if (index_dir != NULL && set_trap(&trap)) {
+        int posted = save_index(Cache);
+        clear_trap(&trap);
+        /* The write request keeps the file reference until it is done */
+        if (posted) return;
+    }
+    else if (index_dir != NULL) {
+        trace(LOG_ELF, "Cannot create index of ELF file %s: %s", File->name, errno_to_str(trap.error));
+    }
+    Cache->mIndexSavePosted = 0;
+    elf_close(File);
+}
+
+void dwarf_index_save_later(DWARFCache * Cache) {
+    if (index_dir == NULL) return;
+    if (Cache->mIndexSavePosted) {
+        Cache->mIndexSaveAgain = 1;
+        return;
+    }
+    Cache->mIndexSavePosted = 1;
+    /* Keep the file open until the index is written, the delay lets clients load line info of units they use */
+    Cache->mFile->ref_cnt++;
+    post_event_with_delay(save_index_event, Cache, INDEX_SAVE_DELAY);
+}
+
+#endif /* ENABLE_DwarfIndex */
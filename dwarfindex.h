@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * Copyright (c) 2026 TCF Target Agent for ARM contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *     TCF Target Agent for ARM contributors - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * This module implements persistent index files of DWARF cache data.
+ *
+ * An index file holds symbol name hash and address tables, compilation unit
+ * address ranges and line number tables of an ELF file, so they don't need to be
+ * built again when the agent is restarted or the file is loaded by another process.
+ * Index files are stored in a directory set by set_dwarf_index_dir(), and are named and
+ * validated by GNU build ID of the ELF file, or by file device, inode and modification time
+ * if the file has no build ID.
+ *
+ * The index is written by the agent that builds it, and is read by the same agent build only.
+ * Functions in this module can be used by dispatch thread only.
+ */
+#ifndef D_dwarfindex
+#define D_dwarfindex
+
+#include "config.h"
+
+#if ENABLE_DwarfIndex
+
+#include "dwarfcache.h"
+
+typedef struct DWARFIndex DWARFIndex;
+
+/* Set directory of index files, NULL disables the index */
+extern void set_dwarf_index_dir(const char * dir);
+
+/* Map index file of the cache ELF file, return NULL if the index is disabled, not found or not valid */
+extern DWARFIndex * dwarf_index_open(DWARFCache * cache);
+
+extern void dwarf_index_close(DWARFIndex * index);
+
+/*
+ * Functions below read cache data from cache->mIndex.
+ * Each returns 1 if the data is read, or 0 if it is not in the index,
+ * in which case the caller should build the data from ELF file.
+ */
+extern int dwarf_index_read_symbols(DWARFCache * cache);
+extern int dwarf_index_read_addr_ranges(DWARFCache * cache);
+extern int dwarf_index_read_line_numbers(DWARFCache * cache, CompUnit * unit);
+
+/*
+ * Build index data of the cache and write index file, done in a delayed event.
+ * Called when the cache is created without index, and again when line info of more units is loaded.
+ * Calls made while a write is pending are batched into one write, the file is written by an async request thread.
+ */
+extern void dwarf_index_save_later(DWARFCache * cache);
+
+#endif /* ENABLE_DwarfIndex */
+
+#endif /* D_dwarfindex */
@@ -57,19 +57,20 @@ struct DIO_Cache {
 
 typedef struct DIO_Cache DIO_Cache;
 
-U8_T dio_gEntryPos = 0;
+/* Reader state is thread local, so worker threads can read DWARF data concurrently */
+THREAD_LOCAL U8_T dio_gEntryPos = 0;
 
-U8_T dio_gFormRef = 0;
-U8_T dio_gFormData = 0;
-size_t dio_gFormDataSize = 0;
-void * dio_gFormDataAddr = NULL;
+THREAD_LOCAL U8_T dio_gFormRef = 0;
+THREAD_LOCAL U8_T dio_gFormData = 0;
+THREAD_LOCAL size_t dio_gFormDataSize = 0;
+THREAD_LOCAL void * dio_gFormDataAddr = NULL;
 
-static ELF_Section * sSection;
-static U1_T sBigEndian;
-static U1_T * sData;
-static U8_T sDataPos;
-static U8_T sDataLen;
-static DIO_UnitDescriptor * sUnit;
+static THREAD_LOCAL ELF_Section * sSection;
+static THREAD_LOCAL U1_T sByteSwap;
+static THREAD_LOCAL U1_T * sData;
+static THREAD_LOCAL U8_T sDataPos;
+static THREAD_LOCAL U8_T sDataLen;
+static THREAD_LOCAL DIO_UnitDescriptor * sUnit;
 
 static void dio_CloseELF(ELF_File * File) {
     U4_T n, m;
@@ -115,7 +116,7 @@ void dio_EnterDebugSection(DIO_UnitDescriptor * Unit, ELF_Section * Section, U8_
     sData = Section->data;
     sDataPos = Offset;
     sDataLen = Section->size;
-    sBigEndian = Section->file->big_endian;
+    sByteSwap = Section->file->byte_swap > 0;
     sUnit = Unit;
     dio_gEntryPos = 0;
     assert(sData != NULL);
@@ -126,7 +127,7 @@ void dio_EnterDataSection(DIO_UnitDescriptor * Unit, U1_T * Data, U8_T Offset, U
     sData = Data;
     sDataPos = Offset;
     sDataLen = Size;
-    sBigEndian = Unit->mFile->big_endian;
+    sByteSwap = Unit->mFile->byte_swap > 0;
     sUnit = Unit;
     dio_gEntryPos = 0;
     assert(sData != NULL);
@@ -166,72 +167,89 @@ U1_T dio_ReadU1(void) {
 
 #define dio_ReadU1() (sDataPos < sDataLen ? sData[sDataPos++] : dio_ReadU1F())
 
+/* Reverse byte order of fixed size numbers, compilers turn these into single byte swap instructions */
+static inline U2_T swap2(U2_T x) {
+    return (U2_T)(x >> 8 | x << 8);
+}
+
+static inline U4_T swap4(U4_T x) {
+    return x >> 24 | (x >> 8 & 0xff00u) | (x << 8 & 0xff0000u) | x << 24;
+}
+
+static inline U8_T swap8(U8_T x) {
+    return (U8_T)swap4((U4_T)x) << 32 | swap4((U4_T)(x >> 32));
+}
+
+/*
+ * Fixed size numbers are loaded with memcpy(), which compilers turn into single unaligned loads,
+ * and then byte swapped if data endianness is not same as the agent endianness.
+ */
 U2_T dio_ReadU2(void) {
-    U1_T x0 = dio_ReadU1();
-    U1_T x1 = dio_ReadU1();
-    return sBigEndian ? (x0 << 8) | x1 : x0 | (x1 << 8);
+    U2_T x;
+    if (sDataPos + 2 > sDataLen) exception(ERR_EOF);
+    memcpy(&x, sData + sDataPos, 2);
+    sDataPos += 2;
+    return sByteSwap ? swap2(x) : x;
 }
 
 U4_T dio_ReadU4(void) {
-    U2_T x0 = dio_ReadU2();
-    U2_T x1 = dio_ReadU2();
-    return sBigEndian ? (x0 << 16) | x1 : x0 | (x1 << 16);
+    U4_T x;
+    if (sDataPos + 4 > sDataLen) exception(ERR_EOF);
+    memcpy(&x, sData + sDataPos, 4);
+    sDataPos += 4;
+    return sByteSwap ? swap4(x) : x;
 }
 
 U8_T dio_ReadU8(void) {
-    U8_T x0 = dio_ReadU4();
-    U8_T x1 = dio_ReadU4();
-    return sBigEndian ? (x0 << 32) | x1 : x0 | (x1 << 32);
+    U8_T x;
+    if (sDataPos + 8 > sDataLen) exception(ERR_EOF);
+    memcpy(&x, sData + sDataPos, 8);
+    sDataPos += 8;
+    return sByteSwap ? swap8(x) : x;
 }
 
-U4_T dio_ReadULEB128(void) {
-    U4_T Res = 0;
-    int i = 0;
-    for (;; i += 7) {
-        U1_T n = dio_ReadU1();
-        Res |= (n & 0x7Fu) << i;
-        if ((n & 0x80) == 0) break;
+/* Max size of LEB128 encoded 64-bit number */
+#define MAX_LEB128_SIZE 10
+
+/* Read LEB128 number, sign extended to 64 bits if 'Signed' */
+static U8_T dio_ReadLEB128(int Signed) {
+    U8_T Res = 0;
+    unsigned i = 0;
+    U1_T n = 0x80;
+    if (sDataLen - sDataPos >= MAX_LEB128_SIZE) {
+        /* Fast path: data bounds are checked once for the whole number */
+        U1_T * p = sData + sDataPos;
+        do {
+            n = *p++;
+            Res |= (U8_T)(n & 0x7Fu) << i;
+            i += 7;
+        }
+        while ((n & 0x80) != 0 && i < MAX_LEB128_SIZE * 7);
+        sDataPos = p - sData;
+    }
+    while (n & 0x80) {
+        n = dio_ReadU1();
+        if (i < 64) Res |= (U8_T)(n & 0x7Fu) << i;
+        i += 7;
     }
+    if (Signed && (n & 0x40) != 0 && i < 64) Res |= ~(U8_T)0 << i;
     return Res;
 }
 
+U4_T dio_ReadULEB128(void) {
+    return (U4_T)dio_ReadLEB128(0);
+}
+
 I4_T dio_ReadSLEB128(void) {
-    U4_T Res = 0;
-    int i = 0;
-    for (;; i += 7) {
-        U1_T n = dio_ReadU1();
-        Res |= (n & 0x7Fu) << i;
-        if ((n & 0x80) == 0) {
-            Res |= -(n & 0x40) << i;
-            break;
-        }
-    }
-    return (I4_T)Res;
+    return (I4_T)dio_ReadLEB128(1);
 }
 
 U8_T dio_ReadU8LEB128(void) {
-    U8_T Res = 0;
-    int i = 0;
-    for (;; i += 7) {
-        U1_T n = dio_ReadU1();
-        Res |= (n & 0x7Fu) << i;
-        if ((n & 0x80) == 0) break;
-    }
-    return Res;
+    return dio_ReadLEB128(0);
 }
 
 I8_T dio_ReadS8LEB128(void) {
-    U8_T Res = 0;
-    int i = 0;
-    for (;; i += 7) {
-        U1_T n = dio_ReadU1();
-        Res |= (n & 0x7Fu) << i;
-        if ((n & 0x80) == 0) {
-            Res |= -(n & 0x40) << i;
-            break;
-        }
-    }
-    return (I8_T)Res;
+    return (I8_T)dio_ReadLEB128(1);
 }
 
 U8_T dio_ReadUX(int Size) {
@@ -338,24 +356,22 @@ static void dio_ReadFormRefAddr(void) {
 }
 
 static void dio_ReadFormString(void) {
+    U1_T * End = (U1_T *)memchr(sData + sDataPos, 0, (size_t)(sDataLen - sDataPos));
+    if (End == NULL) exception(ERR_EOF);
     dio_gFormDataAddr = sData + sDataPos;
-    dio_gFormDataSize = 1;
-    while (dio_ReadU1()) dio_gFormDataSize++;
+    dio_gFormDataSize = End - (sData + sDataPos) + 1;
+    sDataPos += dio_gFormDataSize;
 }
 
 static void dio_ReadFormStringRef(void) {
     U8_T Offset = dio_ReadUX(sUnit->m64bit ? 8 : 4);
     U4_T StringTableSize = 0;
     U1_T * StringTable = dio_LoadStringTable(&StringTableSize);
+    U1_T * End = NULL;
+    if (Offset < StringTableSize) End = (U1_T *)memchr(StringTable + Offset, 0, (size_t)(StringTableSize - Offset));
+    if (End == NULL) str_exception(ERR_INV_DWARF, "invalid FORM_STRP attribute");
     dio_gFormDataAddr = StringTable + Offset;
-    dio_gFormDataSize = 1;
-    for (;;) {
-        if (Offset >= StringTableSize) {
-            str_exception(ERR_INV_DWARF, "invalid FORM_STRP attribute");
-        }
-        if (StringTable[Offset++] == 0) break;
-        dio_gFormDataSize++;
-    }
+    dio_gFormDataSize = End - (StringTable + Offset) + 1;
 }
 
 static void dio_ReadAttribute(U2_T Attr, U2_T Form) {
@@ -458,7 +474,7 @@ void dio_ReadEntry(DIO_EntryCallBack CallBack) {
 
 static void dio_FindAbbrevTable(void);
 
-void dio_ReadUnit(DIO_UnitDescriptor * Unit, DIO_EntryCallBack CallBack) {
+static void dio_ReadUnitHeader(DIO_UnitDescriptor * Unit) {
     memset(Unit, 0, sizeof(DIO_UnitDescriptor));
     sUnit = Unit;
     sUnit->mFile = sSection->file;
@@ -484,12 +500,24 @@ void dio_ReadUnit(DIO_UnitDescriptor * Unit, DIO_EntryCallBack CallBack) {
         sUnit->mVersion = 1;
         sUnit->mAddressSize = 4;
     }
+}
+
+void dio_ReadUnit(DIO_UnitDescriptor * Unit, DIO_EntryCallBack CallBack) {
+    dio_ReadUnitHeader(Unit);
     while (sUnit->mUnitSize == 0 || dio_GetPos() < sUnit->mUnitOffs + sUnit->mUnitSize) {
         dio_ReadEntry(CallBack);
     }
     sUnit = NULL;
 }
 
+void dio_ReadUnitEntry(DIO_UnitDescriptor * Unit, DIO_EntryCallBack CallBack) {
+    dio_ReadUnitHeader(Unit);
+    dio_ReadEntry(CallBack);
+    if (sUnit->mUnitSize == 0) str_exception(ERR_INV_DWARF, "missing compilation unit sibling attribute");
+    sDataPos = sUnit->mUnitOffs + sUnit->mUnitSize;
+    sUnit = NULL;
+}
+
 #define dio_AbbrevTableHash(Offset) (((unsigned)(Offset)) / 16 % ABBREV_TABLE_SIZE)
 
 void dio_LoadAbbrevTable(ELF_File * File) {
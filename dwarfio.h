@@ -16,6 +16,10 @@
  * This module implements low-level functions for reading DWARF debug information.
  *
  * Functions in this module use exceptions to report errors, see exceptions.h
+ *
+ * Reader state is kept per thread, so raw section data, e.g. line number programs,
+ * can be read by worker threads. Debug info entries must be read by dispatch thread,
+ * since abbreviation and string tables are loaded on demand.
  */
 #ifndef D_dwarfio
 #define D_dwarfio
@@ -35,12 +39,12 @@ typedef struct DIO_UnitDescriptor {
     U4_T mAbbrevTableSize;
 } DIO_UnitDescriptor;
 
-extern U8_T dio_gEntryPos;
+extern THREAD_LOCAL U8_T dio_gEntryPos;
 
-extern U8_T dio_gFormRef;   /* Absolute address */
-extern U8_T dio_gFormData;
-extern size_t dio_gFormDataSize;
-extern void * dio_gFormDataAddr;
+extern THREAD_LOCAL U8_T dio_gFormRef;   /* Absolute address */
+extern THREAD_LOCAL U8_T dio_gFormData;
+extern THREAD_LOCAL size_t dio_gFormDataSize;
+extern THREAD_LOCAL void * dio_gFormDataAddr;
 
 extern void dio_EnterDebugSection(DIO_UnitDescriptor * Unit, ELF_Section * Section, U8_T Offset);
 extern void dio_EnterDataSection(DIO_UnitDescriptor * Unit, U1_T * Data, U8_T Offset, U8_T Size);
@@ -73,6 +77,8 @@ typedef void (*DIO_EntryCallBack)(U2_T /* Tag */, U2_T /* Attr */, U2_T /* Form
  * This sequence is repeated for each entry in the debug info unit.
  */
 extern void dio_ReadUnit(DIO_UnitDescriptor * Unit, DIO_EntryCallBack CallBack);
+/* Same as dio_ReadUnit(), but only the unit entry is read, the rest of the unit is skipped */
+extern void dio_ReadUnitEntry(DIO_UnitDescriptor * Unit, DIO_EntryCallBack CallBack);
 extern void dio_ReadEntry(DIO_EntryCallBack CallBack);
 
 extern void dio_LoadAbbrevTable(ELF_File * File);
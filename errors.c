@@ -140,6 +140,8 @@ const char * errno_to_str(int err) {
         return "Command is not recognized";
     case ERR_INV_TRANSPORT:
         return "Invalid transport name";
+    case ERR_HWBRK_NO_RESOURCES:
+        return "Not enough hardware breakpoint resources";
     case ERR_EXCEPTION:
         snprintf(buf, sizeof(buf), "%s: %s", exception_msg, errno_to_str(exception_no));
         return buf;
@@ -155,8 +157,8 @@ const char * errno_to_str(int err) {
 }
 
 void set_exception_errno(int no, char * msg) {
-    assert(is_dispatch_thread());
-    if (msg == NULL) {
+    /* Exception messages are kept for dispatch thread only, other threads get the error code */
+    if (msg == NULL || !is_dispatch_thread()) {
         errno = no;
     }
     else {
@@ -49,6 +49,7 @@
 #define ERR_INV_DATA_TYPE       (STD_ERR_BASE + 24)
 #define ERR_INV_COMMAND         (STD_ERR_BASE + 25)
 #define ERR_INV_TRANSPORT       (STD_ERR_BASE + 26)
+#define ERR_HWBRK_NO_RESOURCES  (STD_ERR_BASE + 27)
 
 #define ERR_EXCEPTION           (STD_ERR_BASE + 100)
 
@@ -51,8 +51,7 @@ static pthread_cond_t cancel_cond;
 static event_node * event_queue = NULL;
 static event_node * event_last = NULL;
 static event_node * timer_queue = NULL;
-static event_node * free_queue = NULL;
-static int free_queue_size = 0;
+static MemPool * event_pool = NULL;   /* guarded by event_lock */
 static EventCallBack * cancel_handler = NULL;
 static void * cancel_arg = NULL;
 static int process_events = 1;
@@ -78,30 +77,14 @@ static void time_add_usec(struct timespec * tv, unsigned long usec) {
 }
 
 static event_node * alloc_node(void (*handler)(void *), void * arg) {
-    event_node * node;
-    if (free_queue != NULL) {
-        node = free_queue;
-        free_queue = node->next;
-        free_queue_size--;
-    }
-    else {
-        node = (event_node *)loc_alloc(sizeof(event_node));
-    }
-    memset(node, 0, sizeof(event_node));
+    event_node * node = (event_node *)pool_alloc_zero(event_pool);
     node->handler = handler;
     node->arg = arg;
     return node;
 }
 
 static void free_node(event_node * node) {
-    if (free_queue_size < 500) {
-        node->next = free_queue;
-        free_queue = node;
-        free_queue_size++;
-    }
-    else {
-        loc_free(node);
-    }
+    pool_free(event_pool, node);
 }
 
 void post_event_with_delay(EventCallBack * handler, void * arg, unsigned long delay) {
@@ -236,6 +219,7 @@ int is_dispatch_thread(void) {
 void ini_events_queue(void) {
     /* Initial thread is event dispatcher. */
     event_thread = pthread_self();
+    event_pool = mem_pool_create("Event", sizeof(event_node), 0);
     check_error(pthread_mutex_init(&event_lock, NULL));
     check_error(pthread_cond_init(&event_cond, NULL));
     check_error(pthread_cond_init(&cancel_cond, NULL));
@@ -287,6 +271,7 @@ void run_event_loop(void) {
             check_error(pthread_mutex_unlock(&event_lock));
             trace(LOG_EVENTCORE, "run_event_loop: event %#lx, handler %#lx, arg %#lx", ev, ev->handler, ev->arg);
             ev->handler(ev->arg);
+            tmp_gc();
             check_error(pthread_mutex_lock(&event_lock));
             free_node(ev);
             event_cnt++;
@@ -27,7 +27,8 @@
         if (trap.error == ...
         ...
     }
- * Only main thread is allowed to use exceptions.
+ * Only dispatch thread and worker threads registered with exceptions_worker_enter()
+ * are allowed to use exceptions. Each thread has its own chain of traps.
  */
 
 #include "config.h"
@@ -38,10 +39,22 @@
 #include "events.h"
 #include "trace.h"
 
-static Trap * chain = NULL;
+static THREAD_LOCAL Trap * chain = NULL;
+static THREAD_LOCAL int worker_thread = 0;
+
+#define is_exceptions_thread() (worker_thread > 0 || is_dispatch_thread())
+
+void exceptions_worker_enter(void) {
+    worker_thread++;
+}
+
+void exceptions_worker_exit(void) {
+    assert(worker_thread > 0);
+    worker_thread--;
+}
 
 int set_trap_a(Trap * trap) {
-    assert(is_dispatch_thread());
+    assert(is_exceptions_thread());
     memset(trap, 0, sizeof(Trap));
     trap->next = chain;
     chain = trap;
@@ -56,13 +69,13 @@ int set_trap_b(Trap * trap) {
 }
 
 void clear_trap(Trap * trap) {
-    assert(is_dispatch_thread());
+    assert(is_exceptions_thread());
     assert(trap == chain);
     chain = trap->next;
 }
 
 void exception(int error) {
-    assert(is_dispatch_thread());
+    assert(is_exceptions_thread());
     assert(error != 0);
     if (chain == NULL) {
         trace(LOG_ALWAYS, "Unhandled exception %d: %s.",
@@ -74,7 +87,7 @@ void exception(int error) {
 }
 
 void str_exception(int error, char * msg) {
-    assert(is_dispatch_thread());
+    assert(is_exceptions_thread());
     assert(error != 0);
     if (chain == NULL) {
         trace(LOG_ALWAYS, "Unhandled exception %d: %s:\n  %s",
@@ -27,7 +27,8 @@
         if (trap.error == ...
         ...
     }
- * Only main thread is allowed to use exceptions.
+ * Only dispatch thread and worker threads registered with exceptions_worker_enter()
+ * are allowed to use exceptions. Each thread has its own chain of traps.
  */
 
 #ifndef D_exceptions
@@ -54,4 +55,11 @@ extern void clear_trap(Trap * trap);
 extern void exception(int error);
 extern void str_exception(int error, char * msg);
 
+/*
+ * Register current thread as a worker thread that is allowed to use exceptions.
+ * Calls can be nested, exceptions_worker_exit() must be called before the thread returns.
+ */
+extern void exceptions_worker_enter(void);
+extern void exceptions_worker_exit(void);
+
 #endif /* D_exceptions */
@@ -35,15 +35,12 @@
 #include "stacktrace.h"
 #include "breakpoints.h"
 #include "symbols.h"
+#include "memorymap.h"
 
 #define STR_POOL_SIZE 1024
 
-struct StringValue {
-    struct StringValue * next;
-    char buf[1];
-};
-
-typedef struct StringValue StringValue;
+#define CODE_HASH_SIZE 127
+#define MAX_CACHED_CODES 256
 
 #define SY_LEQ   256
 #define SY_GEQ   257
@@ -81,9 +78,48 @@ static int text_ch = 0;
 static int text_sy = 0;
 static Value text_val;
 
+/*
+ * Identifier resolved to a value that does not depend on stack frame:
+ * a constant, a function address, a type or a static variable address.
+ * It is valid for the context and frame address it was resolved at,
+ * while symbols generation does not change.
+ */
+typedef struct ExpressionIdCache {
+    Context * ctx;
+    ContextAddress ip;
+    unsigned generation;
+    int sym_class;
+    Value value;
+} ExpressionIdCache;
+
+typedef struct ExpressionToken {
+    int sy;
+    int pos;
+    Value val;
+    ExpressionIdCache * id;
+} ExpressionToken;
+
+/* Expression text compiled into a token stream, cached by text */
+typedef struct ExpressionCode {
+    LINK link_hash;
+    LINK link_lru;
+    char * text;
+    int tokens_cnt;
+    ExpressionToken * tokens;
+} ExpressionCode;
+
+#define hash2code(A)  ((ExpressionCode *)((char *)(A) - offsetof(ExpressionCode, link_hash)))
+#define lru2code(A)   ((ExpressionCode *)((char *)(A) - offsetof(ExpressionCode, link_lru)))
+
+static LINK code_hash[CODE_HASH_SIZE];
+static LINK code_lru;
+static int code_cnt = 0;
+
+static ExpressionCode * text_code = NULL;
+static int text_token = 0;
+
 static char str_pool[STR_POOL_SIZE];
 static int str_pool_cnt = 0;
-static StringValue * str_alloc_list = NULL;
 
 static Context * expression_context = NULL;
 static int expression_frame = STACK_NO_FRAME;
@@ -99,10 +135,8 @@ static void * alloc_str(int size) {
         return s;
     }
     else {
-        StringValue * s = (StringValue *)loc_alloc(sizeof(StringValue) + size - 1);
-        s->next = str_alloc_list;
-        str_alloc_list = s;
-        return s->buf;
+        /* Released at the end of current dispatch cycle */
+        return tmp_alloc(size);
     }
 }
 
@@ -226,7 +260,7 @@ static int is_name_character(int ch) {
     return 0;
 }
 
-static void next_sy(void) {
+static void scan_sy(void) {
     for (;;) {
         int ch = text_ch;
         next_ch();
@@ -519,8 +553,129 @@ static void next_sy(void) {
     }
 }
 
-static int identifier(char * name, Value * v) {
+static void next_sy(void) {
+    ExpressionToken * t = NULL;
+    if (text_token + 1 < text_code->tokens_cnt) text_token++;
+    t = text_code->tokens + text_token;
+    text_sy = t->sy;
+    text_pos = t->pos;
+    text_val = t->val;
+}
+
+static void free_id_cache(ExpressionToken * t) {
+    if (t->id == NULL) return;
+    loc_free(t->id->value.value);
+    loc_free(t->id);
+    t->id = NULL;
+}
+
+static void free_expression_code(ExpressionCode * code) {
     int i;
+    list_remove(&code->link_hash);
+    list_remove(&code->link_lru);
+    for (i = 0; i < code->tokens_cnt; i++) {
+        ExpressionToken * t = code->tokens + i;
+        free_id_cache(t);
+        loc_free(t->val.value);
+    }
+    loc_free(code->tokens);
+    loc_free(code->text);
+    loc_free(code);
+    code_cnt--;
+}
+
+static unsigned code_hash_index(char * s) {
+    unsigned h = 0;
+    while (*s) h = h * 31 + (unsigned char)*s++;
+    return h % CODE_HASH_SIZE;
+}
+
+static void compile_expression(ExpressionCode * code) {
+    int tokens_max = 0;
+    text = code->text;
+    text_pos = 0;
+    text_len = strlen(text) + 1;
+    next_ch();
+    for (;;) {
+        ExpressionToken * t = NULL;
+        scan_sy();
+        if (code->tokens_cnt >= tokens_max) {
+            tokens_max = tokens_max == 0 ? 16 : tokens_max * 2;
+            code->tokens = (ExpressionToken *)loc_realloc(code->tokens, sizeof(ExpressionToken) * tokens_max);
+        }
+        t = code->tokens + code->tokens_cnt++;
+        memset(t, 0, sizeof(ExpressionToken));
+        t->sy = text_sy;
+        t->pos = text_pos;
+        if (text_sy == SY_VAL || text_sy == SY_ID || text_sy == SY_SIZEOF) {
+            t->val = text_val;
+            t->val.value = loc_alloc(text_val.size);
+            memcpy(t->val.value, text_val.value, text_val.size);
+        }
+        if (text_sy == 0) break;
+    }
+}
+
+/* Find or create compiled code of expression text, exception if the text is not valid */
+static ExpressionCode * get_expression_code(char * s) {
+    Trap trap;
+    LINK * h = code_hash + code_hash_index(s);
+    LINK * l = h->next;
+    ExpressionCode * code = NULL;
+
+    while (l != h) {
+        code = hash2code(l);
+        if (strcmp(code->text, s) == 0) {
+            list_remove(&code->link_lru);
+            list_add_first(&code->link_lru, &code_lru);
+            return code;
+        }
+        l = l->next;
+    }
+    while (code_cnt >= MAX_CACHED_CODES) {
+        free_expression_code(lru2code(code_lru.prev));
+    }
+    code = (ExpressionCode *)loc_alloc_zero(sizeof(ExpressionCode));
+    code->text = loc_strdup(s);
+    list_add_first(&code->link_hash, h);
+    list_add_first(&code->link_lru, &code_lru);
+    code_cnt++;
+    if (set_trap(&trap)) {
+        compile_expression(code);
+        clear_trap(&trap);
+    }
+    else {
+        free_expression_code(code);
+        str_exception(trap.error, trap.msg);
+    }
+    return code;
+}
+
+/* Dispose identifiers resolved in context 'ctx', or in all contexts if 'ctx' is NULL */
+static void flush_id_cache(Context * ctx) {
+    LINK * l = code_lru.next;
+    while (l != &code_lru) {
+        ExpressionCode * code = lru2code(l);
+        int i;
+        for (i = 0; i < code->tokens_cnt; i++) {
+            ExpressionToken * t = code->tokens + i;
+            if (t->id != NULL && (ctx == NULL || t->id->ctx == ctx)) free_id_cache(t);
+        }
+        l = l->next;
+    }
+}
+
+static void set_cached_value(Value * v, ExpressionIdCache * c) {
+    *v = c->value;
+    if (c->value.value != NULL) {
+        v->value = alloc_str(v->size);
+        memcpy(v->value, c->value.value, v->size);
+    }
+}
+
+static int identifier(ExpressionToken * token, Value * v) {
+    int i;
+    char * name = (char *)token->val.value;
     memset(v, 0, sizeof(Value));
     for (i = 0; i < id_callback_cnt; i++) {
         if (id_callbacks[i](expression_context, expression_frame, name, v)) return SYM_CLASS_VALUE;
@@ -541,6 +696,15 @@ static int identifier(char * name, Value * v) {
 #if SERVICE_Symbols
     {
         Symbol sym;
+        ContextAddress ip = 0;
+        int ip_ok = expression_frame == STACK_NO_FRAME ||
+            get_frame_info(expression_context, expression_frame, &ip, NULL, NULL) == 0;
+        ExpressionIdCache * c = token->id;
+        if (c != NULL && ip_ok && c->ctx == expression_context && c->ip == ip &&
+                c->generation == get_symbols_generation()) {
+            set_cached_value(v, c);
+            return c->sym_class;
+        }
         if (find_symbol(expression_context, expression_frame, name, &sym) < 0) {
             error(errno, "Invalid identifier");
         }
@@ -591,6 +755,30 @@ static int identifier(char * name, Value * v) {
             default:
                 error(ERR_UNSUPPORTED, "Invalid symbol class");
             }
+            if (ip_ok) {
+                int frame_independent = sym.sym_class != SYM_CLASS_REFERENCE;
+                if (!frame_independent && expression_frame != STACK_NO_FRAME) {
+                    /* Static variables have same address and size in any frame */
+                    ContextAddress addr = 0;
+                    size_t size = 0;
+                    frame_independent =
+                        get_symbol_address(&sym, STACK_NO_FRAME, &addr) == 0 && addr == v->address &&
+                        get_symbol_size(&sym, STACK_NO_FRAME, &size) == 0 && size == v->size;
+                }
+                free_id_cache(token);
+                if (frame_independent) {
+                    c = token->id = (ExpressionIdCache *)loc_alloc_zero(sizeof(ExpressionIdCache));
+                    c->ctx = expression_context;
+                    c->ip = ip;
+                    c->generation = get_symbols_generation();
+                    c->sym_class = sym.sym_class;
+                    c->value = *v;
+                    if (v->value != NULL) {
+                        c->value.value = loc_alloc(v->size);
+                        memcpy(c->value.value, v->value, v->size);
+                    }
+                }
+            }
             return sym.sym_class;
         }
     }
@@ -602,12 +790,12 @@ static int identifier(char * name, Value * v) {
 
 static int type_name(int mode, Symbol * type) {
     Value v;
-    char * name = text_val.value;
+    ExpressionToken * token = text_code->tokens + text_token;
     int sym_class;
 
     if (text_sy != SY_ID) return 0;
     next_sy();
-    sym_class = identifier(name, &v);
+    sym_class = identifier(token, &v);
     if (sym_class != SYM_CLASS_TYPE) return 0;
     while (text_sy == '*') {
         next_sy();
@@ -814,12 +1002,16 @@ static void primary_expression(int mode, Value * v) {
         next_sy();
     }
     else if (text_sy == SY_VAL) {
-        if (mode != MODE_SKIP) *v = text_val;
+        if (mode != MODE_SKIP) {
+            *v = text_val;
+            v->value = alloc_str(v->size);
+            memcpy(v->value, text_val.value, v->size);
+        }
         next_sy();
     }
     else if (text_sy == SY_ID) {
         if (mode != MODE_SKIP) {
-            int sym_class = identifier((char *)text_val.value, v);
+            int sym_class = identifier(text_code->tokens + text_token, v);
             if (sym_class == SYM_CLASS_TYPE) error(ERR_INV_EXPRESSION, "Illegal usage of type name");
         }
         next_sy();
@@ -1012,7 +1204,7 @@ static void op_sizeof(int mode, Value * v) {
     int p = text_sy == '(';
 
     if (p) next_sy();
-    pos = text_pos - 2;
+    pos = text_token;
     if (type_name(mode, &type)) {
         if (mode != MODE_SKIP) {
             size_t type_size = 0;
@@ -1028,8 +1220,7 @@ static void op_sizeof(int mode, Value * v) {
         }
     }
     else {
-        text_pos = pos;
-        next_ch();
+        text_token = pos - 1;
         next_sy();
         unary_expression(mode == MODE_NORMAL ? MODE_TYPE : mode, v);
         if (mode != MODE_SKIP) {
@@ -1164,13 +1355,11 @@ static void cast_expression(int mode, Value * v) {
         Symbol type;
         int type_class = TYPE_CLASS_UNKNOWN;
         size_t type_size = 0;
-        int pos = text_pos - 2;
+        int pos = text_token;
 
-        assert(text[pos] == '(');
         next_sy();
         if (!type_name(mode, &type)) {
-            text_pos = pos;
-            next_ch();
+            text_token = pos - 1;
             next_sy();
             assert(text_sy == '(');
             unary_expression(mode, v);
@@ -1684,15 +1873,8 @@ static int evaluate_type(Context * ctx, int frame, char * s, Value * v) {
     expression_frame = frame;
     if (set_trap(&trap)) {
         str_pool_cnt = 0;
-        while (str_alloc_list != NULL) {
-            StringValue * str = str_alloc_list;
-            str_alloc_list = str->next;
-            loc_free(str);
-        }
-        text = s;
-        text_pos = 0;
-        text_len = strlen(s) + 1;
-        next_ch();
+        text_code = get_expression_code(s);
+        text_token = -1;
         next_sy();
         expression(MODE_TYPE, v);
         if (text_sy != 0) error(ERR_INV_EXPRESSION, "Illegal characters at the end of expression");
@@ -1709,15 +1891,8 @@ int evaluate_expression(Context * ctx, int frame, char * s, int load, Value * v)
     expression_frame = frame;
     if (set_trap(&trap)) {
         str_pool_cnt = 0;
-        while (str_alloc_list != NULL) {
-            StringValue * str = str_alloc_list;
-            str_alloc_list = str->next;
-            loc_free(str);
-        }
-        text = s;
-        text_pos = 0;
-        text_len = strlen(s) + 1;
-        next_ch();
+        text_code = get_expression_code(s);
+        text_token = -1;
         next_sy();
         expression(MODE_NORMAL, v);
         if (text_sy != 0) error(ERR_INV_EXPRESSION, "Illegal characters at the end of expression");
@@ -2313,6 +2488,20 @@ static void on_channel_close(Channel * c) {
     }
 }
 
+static void event_context_exited(Context * ctx, void * client_data) {
+    flush_id_cache(ctx);
+}
+
+#if SERVICE_MemoryMap
+static void event_module_changed(Context * ctx, void * client_data) {
+    flush_id_cache(NULL);
+}
+
+static void event_code_unmapped(Context * ctx, ContextAddress addr, ContextAddress size, void * client_data) {
+    flush_id_cache(NULL);
+}
+#endif
+
 void add_identifier_callback(ExpressionIdentifierCallBack * callback) {
     assert(id_callback_cnt < MAX_ID_CALLBACKS);
     id_callbacks[id_callback_cnt++] = callback;
@@ -2322,6 +2511,25 @@ void ini_expressions_service(Protocol * proto) {
     unsigned i;
     list_init(&expressions);
     for (i = 0; i < ID2EXP_HASH_SIZE; i++) list_init(id2exp + i);
+    for (i = 0; i < CODE_HASH_SIZE; i++) list_init(code_hash + i);
+    list_init(&code_lru);
+    {
+        static ContextEventListener listener = {
+            NULL,
+            event_context_exited,
+        };
+        add_context_event_listener(&listener, NULL);
+    }
+#if SERVICE_MemoryMap
+    {
+        static MemoryMapEventListener listener = {
+            event_module_changed,
+            event_code_unmapped,
+            event_module_changed,
+        };
+        add_memory_map_event_listener(&listener, NULL);
+    }
+#endif
     add_channel_close_listener(on_channel_close);
     add_command_handler(proto, EXPRESSIONS, "getContext", command_get_context);
     add_command_handler(proto, EXPRESSIONS, "getChildren", command_get_children);
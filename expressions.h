@@ -48,6 +48,8 @@ typedef int ExpressionIdentifierCallBack(Context *, int /*frame*/, char * /*name
 /*
  * Evaluate given expression in given context.
  * If load != 0 then result value is always loaded into a local buffer.
+ * The buffer is valid until next evaluation or until the current event handler returns,
+ * whichever comes first.
  * Return 0 if no errors, otherwise return -1 and sets errno.
  */
 extern int evaluate_expression(Context * ctx, int frame, char * s, int load, Value * v);
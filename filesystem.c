@@ -112,6 +112,7 @@ struct IORequest {
 #define reqs2req(A)     ((IORequest *)((char *)(A) - offsetof(IORequest, link_reqs)))
 
 static unsigned long handle_cnt = 0;
+static MemPool * io_request_pool = NULL;
 
 #define HANDLE_HASH_SIZE 0x100
 static LINK handle_hash[HANDLE_HASH_SIZE];
@@ -197,7 +198,7 @@ static void channel_close_listener(Channel * c) {
                     }
                     else {
                         loc_free(req->info.u.fio.bufp);
-                        loc_free(req);
+                        pool_free(io_request_pool, req);
                     }
                 }
             }
@@ -461,7 +462,7 @@ static void done_io_request(void * arg) {
 
     if (handle == NULL) {
         loc_free(req->info.u.fio.bufp);
-        loc_free(req);
+        pool_free(io_request_pool, req);
         return;
     }
 
@@ -490,7 +491,7 @@ static void done_io_request(void * arg) {
         err = req->info.error;
         reply_close(req->token, handle->out, err);
         if (err == 0) {
-            loc_free(req);
+            pool_free(io_request_pool, req);
             while (!list_is_empty(&handle->link_reqs)) {
                 LINK * link = handle->link_reqs.next;
                 req = reqs2req(link);
@@ -515,7 +516,7 @@ static void done_io_request(void * arg) {
                 }
                 list_remove(link);
                 loc_free(req->info.u.fio.bufp);
-                loc_free(req);
+                pool_free(io_request_pool, req);
             }
             flush_stream(handle->out);
             delete_open_file_info(handle);
@@ -527,7 +528,7 @@ static void done_io_request(void * arg) {
     }
 
     loc_free(req->info.u.fio.bufp);
-    loc_free(req);
+    pool_free(io_request_pool, req);
     post_io_requst(handle);
     flush_stream(handle->out);
 }
@@ -583,7 +584,7 @@ static void post_io_requst(OpenFileInfo * handle) {
 }
 
 static IORequest * create_io_request(char * token, OpenFileInfo * handle, int type) {
-    IORequest * req = loc_alloc_zero(sizeof(IORequest));
+    IORequest * req = (IORequest *)pool_alloc_zero(io_request_pool);
     req->req = type;
     req->handle = handle;
     req->info.done = done_io_request;
@@ -1209,6 +1210,7 @@ static void command_roots(char * token, Channel * c) {
 void ini_file_system_service(Protocol * proto) {
     int i;
 
+    io_request_pool = mem_pool_create("IORequest", sizeof(IORequest), 0);
     add_channel_close_listener(channel_close_listener);
     list_init(&file_info_ring);
     for (i = 0; i < HANDLE_HASH_SIZE; i++) {
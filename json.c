@@ -52,38 +52,88 @@ static void realloc_buf(void) {
 
 #define buf_add(ch) { if (buf_pos >= buf_size) realloc_buf(); buf[buf_pos++] = (char)(ch); }
 
-void json_write_ulong(OutputStream * out, unsigned long n) {
+/* Two-digit decimal strings "00".."99", used to emit two digits per division */
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Format "n" backwards into a buffer ending at "end", return pointer to the first digit */
+static char * format_ulong(char * end, unsigned long n) {
+    char * p = end;
+    while (n >= 100) {
+        unsigned i = (unsigned)(n % 100) * 2;
+        n /= 100;
+        *--p = digit_pairs[i + 1];
+        *--p = digit_pairs[i];
+    }
     if (n >= 10) {
-        json_write_ulong(out, n / 10);
-        n = n % 10;
+        unsigned i = (unsigned)n * 2;
+        *--p = digit_pairs[i + 1];
+        *--p = digit_pairs[i];
+    }
+    else {
+        *--p = (char)('0' + n);
     }
-    write_stream(out, n + '0');
+    return p;
+}
+
+static char * format_uint64(char * end, uint64_t n) {
+    char * p = end;
+    /* Avoid 64-bit division on 32-bit targets unless the value really needs it */
+    while (n > (unsigned long)~0ul) {
+        unsigned long low = (unsigned long)(n % 1000000000u);
+        char * q = p - 9;
+        n /= 1000000000u;
+        p = format_ulong(p, low);
+        while (p > q) *--p = '0';
+    }
+    return format_ulong(p, (unsigned long)n);
+}
+
+static void write_chars(OutputStream * out, const char * p, const char * end) {
+    while (p < end) write_stream(out, *p++);
+}
+
+void json_write_ulong(OutputStream * out, unsigned long n) {
+    char buf[32];
+    char * end = buf + sizeof(buf);
+    write_chars(out, format_ulong(end, n), end);
 }
 
 void json_write_long(OutputStream * out, long n) {
     if (n < 0) {
         write_stream(out, '-');
-        n = -n;
+        json_write_ulong(out, 0ul - (unsigned long)n);
+        return;
     }
     json_write_ulong(out, (unsigned long)n);
 }
 
+void json_write_uint64(OutputStream * out, uint64_t n) {
+    char buf[32];
+    char * end = buf + sizeof(buf);
+    write_chars(out, format_uint64(end, n), end);
+}
+
 void json_write_int64(OutputStream * out, int64_t n) {
     if (n < 0) {
         write_stream(out, '-');
-        n = -n;
-        if (n < 0) exception(EINVAL);
-    }
-    if (n >= 10) {
-        json_write_int64(out, n / 10);
-        n = n % 10;
+        json_write_uint64(out, (uint64_t)0 - (uint64_t)n);
+        return;
     }
-    write_stream(out, (int)n + '0');
+    json_write_uint64(out, (uint64_t)n);
 }
 
 void json_write_double(OutputStream * out, double n) {
-    char buf[256];
-    snprintf(buf, sizeof(buf), "%.18g", n);
+    /* Use the shortest representation that reads back as exactly the same value */
+    char buf[64];
+    int prec;
+    for (prec = 15; prec < 17; prec++) {
+        snprintf(buf, sizeof(buf), "%.*g", prec, n);
+        if (strtod(buf, NULL) == n) break;
+    }
+    if (prec == 17) snprintf(buf, sizeof(buf), "%.17g", n);
     write_string(out, buf);
 }
 
@@ -238,64 +288,67 @@ int json_read_boolean(InputStream * inp) {
     return 0;
 }
 
-long json_read_long(InputStream * inp) {
-    long res = 0;
-    int neg = 0;
-    int ch = read_stream(inp);
-    if (ch == '-') {
-        neg = 1;
-        ch = read_stream(inp);
-    }
+/*
+ * Read a run of decimal digits. Digits are consumed directly from the
+ * contiguous inp->cur..inp->end window; the stream is only called
+ * when the window is exhausted.
+ */
+static unsigned long read_ulong_digits(InputStream * inp, int ch) {
+    unsigned long res = 0;
     if (ch < '0' || ch > '9') exception(ERR_JSON_SYNTAX);
     res = ch - '0';
     for (;;) {
+        unsigned char * p = inp->cur;
+        unsigned char * e = inp->end;
+        while (p < e && (unsigned)(*p - '0') <= 9) res = res * 10 + (*p++ - '0');
+        inp->cur = p;
+        if (p < e) break;
         ch = peek_stream(inp);
         if (ch < '0' || ch > '9') break;
-        read_stream(inp);
-        res = res * 10 + (ch - '0');
+        if (inp->cur == inp->end) res = res * 10 + (read_stream(inp) - '0');
     }
-    if (neg) return -res;
     return res;
 }
 
-unsigned long json_read_ulong(InputStream * inp) {
-    unsigned long res = 0;
-    int neg = 0;
-    int ch = read_stream(inp);
-    if (ch == '-') {
-        neg = 1;
-        ch = read_stream(inp);
-    }
+static uint64_t read_uint64_digits(InputStream * inp, int ch) {
+    uint64_t res = 0;
     if (ch < '0' || ch > '9') exception(ERR_JSON_SYNTAX);
     res = ch - '0';
     for (;;) {
+        unsigned char * p = inp->cur;
+        unsigned char * e = inp->end;
+        while (p < e && (unsigned)(*p - '0') <= 9) res = res * 10 + (*p++ - '0');
+        inp->cur = p;
+        if (p < e) break;
         ch = peek_stream(inp);
         if (ch < '0' || ch > '9') break;
-        read_stream(inp);
-        res = res * 10 + (ch - '0');
+        if (inp->cur == inp->end) res = res * 10 + (read_stream(inp) - '0');
     }
-    if (neg) return ~res + 1;
     return res;
 }
 
+long json_read_long(InputStream * inp) {
+    int ch = read_stream(inp);
+    if (ch == '-') return (long)(0ul - read_ulong_digits(inp, read_stream(inp)));
+    return (long)read_ulong_digits(inp, ch);
+}
+
+unsigned long json_read_ulong(InputStream * inp) {
+    int ch = read_stream(inp);
+    if (ch == '-') return 0ul - read_ulong_digits(inp, read_stream(inp));
+    return read_ulong_digits(inp, ch);
+}
+
 int64_t json_read_int64(InputStream * inp) {
-    int64_t res = 0;
-    int neg = 0;
     int ch = read_stream(inp);
-    if (ch == '-') {
-        neg = 1;
-        ch = read_stream(inp);
-    }
-    if (ch < '0' || ch > '9') exception(ERR_JSON_SYNTAX);
-    res = ch - '0';
-    for (;;) {
-        ch = peek_stream(inp);
-        if (ch < '0' || ch > '9') break;
-        read_stream(inp);
-        res = res * 10 + (ch - '0');
-    }
-    if (neg) return -res;
-    return res;
+    if (ch == '-') return (int64_t)((uint64_t)0 - read_uint64_digits(inp, read_stream(inp)));
+    return (int64_t)read_uint64_digits(inp, ch);
+}
+
+uint64_t json_read_uint64(InputStream * inp) {
+    int ch = read_stream(inp);
+    if (ch == '-') return (uint64_t)0 - read_uint64_digits(inp, read_stream(inp));
+    return read_uint64_digits(inp, ch);
 }
 
 double json_read_double(InputStream * inp) {
@@ -389,7 +442,7 @@ int json_read_struct(InputStream * inp, JsonStructCallBack * call_back, void * a
     return 0;
 }
 
-char ** json_read_alloc_string_array(InputStream * inp, int * pos) {
+static char ** read_string_array(InputStream * inp, int * pos, int tmp) {
     int ch = read_stream(inp);
     *pos = 0;
     if (ch == 'n') {
@@ -408,6 +461,7 @@ char ** json_read_alloc_string_array(InputStream * inp, int * pos) {
         unsigned len_pos = 0;
 
         unsigned i, j;
+        size_t size = 0;
         char * str = NULL;
         char ** arr = NULL;
 
@@ -448,7 +502,8 @@ char ** json_read_alloc_string_array(InputStream * inp, int * pos) {
             }
         }
         buf_add(0);
-        arr = (char **)loc_alloc((len_pos + 1) * sizeof(char *) + buf_pos);
+        size = (len_pos + 1) * sizeof(char *) + buf_pos;
+        arr = (char **)(tmp ? tmp_alloc(size) : loc_alloc(size));
         str = (char *)(arr + len_pos + 1);
         memcpy(str, buf, buf_pos);
         j = 0;
@@ -462,6 +517,14 @@ char ** json_read_alloc_string_array(InputStream * inp, int * pos) {
     }
 }
 
+char ** json_read_alloc_string_array(InputStream * inp, int * pos) {
+    return read_string_array(inp, pos, 0);
+}
+
+char ** json_read_tmp_string_array(InputStream * inp, int * pos) {
+    return read_string_array(inp, pos, 1);
+}
+
 /*
 * json_read_array - generic read array function
 *
@@ -710,45 +773,73 @@ void json_splice_binary_offset(OutputStream * out, int fd, size_t size, off_t *
     }
 }
 
-static int skip_char(InputStream * inp) {
+static int skip_char(InputStream * inp, int copy) {
     int ch = read_stream(inp);
-    buf_add(ch);
+    if (copy) buf_add(ch);
     return ch;
 }
 
-static void skip_object(InputStream * inp) {
-    int ch = skip_char(inp);
+static void skip_object(InputStream * inp, int copy) {
+    int ch = skip_char(inp, copy);
     if (ch == 'n') {
-        if (skip_char(inp) != 'u') exception(ERR_JSON_SYNTAX);
-        if (skip_char(inp) != 'l') exception(ERR_JSON_SYNTAX);
-        if (skip_char(inp) != 'l') exception(ERR_JSON_SYNTAX);
+        if (skip_char(inp, copy) != 'u') exception(ERR_JSON_SYNTAX);
+        if (skip_char(inp, copy) != 'l') exception(ERR_JSON_SYNTAX);
+        if (skip_char(inp, copy) != 'l') exception(ERR_JSON_SYNTAX);
+        return;
+    }
+    if (ch == 't') {
+        if (skip_char(inp, copy) != 'r') exception(ERR_JSON_SYNTAX);
+        if (skip_char(inp, copy) != 'u') exception(ERR_JSON_SYNTAX);
+        if (skip_char(inp, copy) != 'e') exception(ERR_JSON_SYNTAX);
+        return;
+    }
+    if (ch == 'f') {
+        if (skip_char(inp, copy) != 'a') exception(ERR_JSON_SYNTAX);
+        if (skip_char(inp, copy) != 'l') exception(ERR_JSON_SYNTAX);
+        if (skip_char(inp, copy) != 's') exception(ERR_JSON_SYNTAX);
+        if (skip_char(inp, copy) != 'e') exception(ERR_JSON_SYNTAX);
         return;
     }
     if (ch == '"') {
+        if (!copy) {
+            /* Fast path: scan the input buffer window for the closing quote */
+            for (;;) {
+                unsigned char * p = inp->cur;
+                unsigned char * e = inp->end;
+                while (p < e && *p != '"' && *p != '\\') p++;
+                inp->cur = p;
+                ch = read_stream(inp);
+                if (ch == '"') break;
+                if (ch == '\\') read_stream(inp);
+                else if (ch < 0) exception(ERR_JSON_SYNTAX);
+            }
+            return;
+        }
         for (;;) {
-            ch = skip_char(inp);
+            ch = skip_char(inp, copy);
             if (ch == '"') break;
-            if (ch == '\\') skip_char(inp);
+            if (ch == '\\') skip_char(inp, copy);
+            else if (ch < 0) exception(ERR_JSON_SYNTAX);
         }
         return;
     }
     if (ch == '-' || ch >= '0' && ch <= '9') {
         for (;;) {
             ch = peek_stream(inp);
-            if (ch < '0' || ch > '9') break;
-            skip_char(inp);
+            if ((ch < '0' || ch > '9') && ch != '.' && ch != 'e' && ch != 'E' && ch != '+' && ch != '-') break;
+            skip_char(inp, copy);
         }
         return;
     }
     if (ch == '[') {
         if (peek_stream(inp) == ']') {
-            skip_char(inp);
+            skip_char(inp, copy);
         }
         else {
             for (;;) {
                 int ch;
-                skip_object(inp);
-                ch = skip_char(inp);
+                skip_object(inp, copy);
+                ch = skip_char(inp, copy);
                 if (ch == ',') continue;
                 if (ch == ']') break;
                 exception(ERR_JSON_SYNTAX);
@@ -758,15 +849,15 @@ static void skip_object(InputStream * inp) {
     }
     if (ch == '{') {
         if (peek_stream(inp) == '}') {
-            skip_char(inp);
+            skip_char(inp, copy);
         }
         else {
             for (;;) {
                 int ch;
-                skip_object(inp);
-                if (skip_char(inp) != ':') exception(ERR_JSON_SYNTAX);
-                skip_object(inp);
-                ch = skip_char(inp);
+                skip_object(inp, copy);
+                if (skip_char(inp, copy) != ':') exception(ERR_JSON_SYNTAX);
+                skip_object(inp, copy);
+                ch = skip_char(inp, copy);
                 if (ch == ',') continue;
                 if (ch == '}') break;
                 exception(ERR_JSON_SYNTAX);
@@ -777,16 +868,96 @@ static void skip_object(InputStream * inp) {
     exception(ERR_JSON_SYNTAX);
 }
 
-char * json_skip_object(InputStream * inp) {
+void json_skip_object(InputStream * inp) {
+    skip_object(inp, 0);
+}
+
+char * json_read_object(InputStream * inp) {
     char * str = NULL;
     buf_pos = 0;
-    skip_object(inp);
+    skip_object(inp, 1);
     buf_add(0);
     str = (char *)loc_alloc(buf_pos);
     memcpy(str, buf, buf_pos);
     return str;
 }
 
+static const JsonStructMember * find_struct_member(const JsonStructMember * members, const char * name) {
+    while (members->name != NULL) {
+        if (strcmp(members->name, name) == 0) return members;
+        members++;
+    }
+    return NULL;
+}
+
+int json_read_struct_members(InputStream * inp, const JsonStructMember * members, void * obj,
+                             JsonStructCallBack * unknown, void * arg) {
+    int ch = peek_stream(inp);
+    if (ch == 'n') {
+        read_stream(inp);
+        if (read_stream(inp) != 'u') exception(ERR_JSON_SYNTAX);
+        if (read_stream(inp) != 'l') exception(ERR_JSON_SYNTAX);
+        if (read_stream(inp) != 'l') exception(ERR_JSON_SYNTAX);
+        return 0;
+    }
+    if (read_stream(inp) != '{') exception(ERR_JSON_SYNTAX);
+    if (peek_stream(inp) == '}') {
+        read_stream(inp);
+        return 1;
+    }
+    for (;;) {
+        char name[256];
+        const JsonStructMember * m = NULL;
+        json_read_string(inp, name, sizeof(name));
+        if (read_stream(inp) != ':') exception(ERR_JSON_SYNTAX);
+        m = find_struct_member(members, name);
+        if (m == NULL) {
+            if (unknown != NULL) unknown(inp, name, arg);
+            else json_skip_object(inp);
+        }
+        else {
+            char * field = (char *)obj + m->offset;
+            switch (m->type) {
+            case JSON_MEMBER_STRING:
+                json_read_string(inp, field, m->size);
+                break;
+            case JSON_MEMBER_ALLOC_STRING:
+                loc_free(*(char **)field);
+                *(char **)field = json_read_alloc_string(inp);
+                break;
+            case JSON_MEMBER_BOOLEAN:
+                *(int *)field = json_read_boolean(inp);
+                break;
+            case JSON_MEMBER_INT:
+                *(int *)field = (int)json_read_long(inp);
+                break;
+            case JSON_MEMBER_LONG:
+                *(long *)field = json_read_long(inp);
+                break;
+            case JSON_MEMBER_INT64:
+                *(int64_t *)field = json_read_int64(inp);
+                break;
+            case JSON_MEMBER_DOUBLE:
+                *(double *)field = json_read_double(inp);
+                break;
+            case JSON_MEMBER_STRING_ARRAY:
+                loc_free(*(char ***)field);
+                *(char ***)field = json_read_alloc_string_array(inp, (int *)((char *)obj + m->size));
+                break;
+            default:
+                assert(0);
+                json_skip_object(inp);
+                break;
+            }
+        }
+        ch = read_stream(inp);
+        if (ch == ',') continue;
+        if (ch == '}') break;
+        exception(ERR_JSON_SYNTAX);
+    }
+    return 1;
+}
+
 static void write_error_code(OutputStream * out, int err, int code) {
     /* code - TCF error code */
     /* err - errno value*/
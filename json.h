@@ -33,10 +33,17 @@ extern int json_read_boolean(InputStream * inp);
 extern long json_read_long(InputStream * inp);
 extern unsigned long json_read_ulong(InputStream * inp);
 extern int64_t json_read_int64(InputStream * inp);
+extern uint64_t json_read_uint64(InputStream * inp);
 extern double json_read_double(InputStream * inp);
 extern char * json_read_alloc_string(InputStream * inp);
 extern char ** json_read_alloc_string_array(InputStream * inp, int * len);
 
+/*
+ * Same as json_read_alloc_string_array(), but the array is allocated with tmp_alloc(),
+ * it is released when the current event handler returns, even if the handler throws an exception.
+ */
+extern char ** json_read_tmp_string_array(InputStream * inp, int * len);
+
 typedef void JsonArrayCallBack(InputStream *, void *);
 /* Read JSON array. Call "call_back" for each array element. Return 0 if array if null, return 1 if not null */
 extern int json_read_array(InputStream * inp, JsonArrayCallBack * call_back, void * arg);
@@ -45,11 +52,48 @@ typedef void JsonStructCallBack(InputStream *, char *, void *);
 /* Read JSON object (struct). Call "call_back" for each struct member. Return 0 if object if null, return 1 if not null */
 extern int json_read_struct(InputStream * inp, JsonStructCallBack * call_back, void * arg);
 
-extern char * json_skip_object(InputStream * inp);
+/*
+ * Descriptor driven JSON object reader.
+ * Each JsonStructMember binds an object member name to a typed field at "offset" in the destination struct.
+ * The members array is terminated by an entry with NULL name.
+ * Members that are not in the array are passed to "unknown" call back, or skipped without
+ * any memory allocation if "unknown" is NULL.
+ * JSON_MEMBER_ALLOC_STRING and JSON_MEMBER_STRING_ARRAY fields must be initialized,
+ * previous value is disposed with loc_free().
+ * Return 0 if object is null, return 1 if not null.
+ */
+enum {
+    JSON_MEMBER_STRING,         /* char array of "size" bytes */
+    JSON_MEMBER_ALLOC_STRING,   /* char *, allocated with loc_alloc() */
+    JSON_MEMBER_BOOLEAN,        /* int */
+    JSON_MEMBER_INT,            /* int */
+    JSON_MEMBER_LONG,           /* long */
+    JSON_MEMBER_INT64,          /* int64_t */
+    JSON_MEMBER_DOUBLE,         /* double */
+    JSON_MEMBER_STRING_ARRAY    /* char **, allocated with json_read_alloc_string_array(),
+                                   "size" is offset of int field that receives the array length */
+};
+
+typedef struct JsonStructMember {
+    const char * name;
+    int type;
+    size_t offset;
+    size_t size;
+} JsonStructMember;
+
+extern int json_read_struct_members(InputStream * inp, const JsonStructMember * members, void * obj,
+                                    JsonStructCallBack * unknown, void * arg);
+
+/* Skip JSON value of any type, no memory is allocated */
+extern void json_skip_object(InputStream * inp);
+
+/* Read JSON value of any type, return its text in a buffer allocated with loc_alloc() */
+extern char * json_read_object(InputStream * inp);
 
 extern void json_write_ulong(OutputStream * out, unsigned long n);
 extern void json_write_long(OutputStream * out, long n);
 extern void json_write_int64(OutputStream * out, int64_t n);
+extern void json_write_uint64(OutputStream * out, uint64_t n);
 extern void json_write_double(OutputStream * out, double n);
 extern void json_write_char(OutputStream * out, char ch);
 extern void json_write_string(OutputStream * out, const char * str);
@@ -28,6 +28,12 @@ typedef void LineToAddressCallBack(void *, ContextAddress);
 
 extern int line_to_address(Context * ctx, char * file, int line, int column, LineToAddressCallBack *, void * args);
 
+/*
+ * Same as line_to_address(), but only object files mapped in address range [addr0, addr1] are searched.
+ */
+extern int line_to_address_in_range(Context * ctx, ContextAddress addr0, ContextAddress addr1,
+                                    char * file, int line, int column, LineToAddressCallBack *, void * args);
+
 /*
  * Initialize Line Numbers service.
  */
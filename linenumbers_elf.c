@@ -40,59 +40,55 @@
 
 static const char * LINENUMBERS = "LineNumbers";
 
+/*
+ * Find compilation unit that covers lowest address of run-time range [addr0, addr1).
+ * The range is mapped to link time addresses segment by segment, gaps between segments are skipped.
+ * On return, "addr_next" is run-time address of the end of the unit range, clipped to the segment.
+ */
 static CompUnit * find_unit(Context * ctx, DWARFCache * cache, ContextAddress addr0, ContextAddress addr1, ContextAddress * addr_next) {
-    U4_T i;
-    ContextAddress addr_min = 0;
-    CompUnit * unit = NULL;
-    /* TODO: faster unit search */
-    for (i = 0; i < cache->mCompUnitsCnt; i++) {
-        CompUnit * u = cache->mCompUnits[i];
-        ContextAddress base = elf_map_to_run_time_address(ctx, cache->mFile, u->mLowPC);
-        ContextAddress size = u->mHighPC - u->mLowPC;
-        if (base == 0 || size == 0) continue;
-        if (u->mDebugRangesOffs != ~(U8_T)0 && cache->mDebugRanges != NULL) {
-            if (elf_load(cache->mDebugRanges)) exception(errno);
-            dio_EnterDataSection(&u->mDesc, cache->mDebugRanges->data, u->mDebugRangesOffs, cache->mDebugRanges->size);
-            for (;;) {
-                U8_T x = dio_ReadAddress();
-                U8_T y = dio_ReadAddress();
-                if (x == 0 && y == 0) break;
-                if (x == ((U8_T)1 << u->mDesc.mAddressSize * 8) - 1) {
-                    base = (ContextAddress)y;
-                }
-                else {
-                    x = base + x;
-                    y = base + y;
-                    if (addr0 < y && addr1 > x) {
-                        if (unit == NULL || addr_min > x) {
-                            unit = u;
-                            addr_min = (ContextAddress)x;
-                            *addr_next = (ContextAddress)y;
-                        }
-                    }
-                }
-            }
-            dio_ExitSection();
-        }
-        else if (addr0 < base + size && addr1 > base) {
-            if (unit == NULL || addr_min > base) {
-                unit = u;
-                addr_min = base;
-                *addr_next = base + size;
-            }
+    ContextAddress rt_addr = 0;
+    ContextAddress lt_addr = 0;
+    ContextAddress size = 0;
+
+    while (elf_map_to_link_time_range(ctx, cache->mFile, addr0, addr1, &rt_addr, &lt_addr, &size)) {
+        ContextAddress lt_end = size > ~lt_addr ? ~(ContextAddress)0 : lt_addr + size;
+        UnitAddressRange * range = find_unit_addr_range(cache, lt_addr, lt_end);
+        if (range != NULL) {
+            ContextAddress end = range->mAddr + range->mSize - lt_addr;
+            *addr_next = rt_addr + (end < size ? end : size);
+            return range->mUnit;
         }
+        addr0 = rt_addr + size;
+        if (addr0 < rt_addr) break;
     }
-    return unit;
+    return NULL;
 }
 
 static void load_line_numbers_in_range(Context * ctx, DWARFCache * cache, ContextAddress addr0, ContextAddress addr1) {
-    while (addr0 < addr1) {
+    unsigned cnt = 0;
+    unsigned max = 0;
+    CompUnit ** units = NULL;
+    ContextAddress addr = addr0;
+
+    while (addr < addr1) {
+        ContextAddress next = 0;
+        if (find_unit(ctx, cache, addr, addr1, &next) == NULL) break;
+        max++;
+        addr = next;
+    }
+    if (max == 0) return;
+    units = (CompUnit **)tmp_alloc(sizeof(CompUnit *) * max);
+    addr = addr0;
+    while (addr < addr1) {
         ContextAddress next = 0;
-        CompUnit * unit = find_unit(ctx, cache, addr0, addr1, &next);
+        CompUnit * unit = find_unit(ctx, cache, addr, addr1, &next);
+        unsigned i = 0;
         if (unit == NULL) break;
-        load_line_numbers(cache, unit);
-        addr0 = next;
+        while (i < cnt && units[i] != unit) i++;
+        if (i == cnt) units[cnt++] = unit;
+        addr = next;
     }
+    load_units_line_numbers(cache, units, cnt);
 }
 
 static int cmp_file(char * file, char * dir, char * name) {
@@ -115,13 +111,31 @@ static void write_line_info(Context * ctx, OutputStream * out, CompUnit * unit,
                             int * cnt, FileInfo ** file_info) {
     U4_T i;
     FileInfo * state_file = NULL;
+    LineNumbersReader reader;
     if (unit->mStatesCnt < 2) return;
     for (i = 0; i < unit->mStatesCnt - 1; i++) {
-        LineNumbersState * state = unit->mStates + i;
-        LineNumbersState * next = unit->mStates + i + 1;
-        ContextAddress state_addr = elf_map_to_run_time_address(ctx, unit->mFile, state->mAddress);
-        ContextAddress next_addr = elf_map_to_run_time_address(ctx, unit->mFile, next->mAddress);
+        LineNumbersState st;
+        LineNumbersState * state = &st;
+        LineNumbersState * next = &reader.mState;
+        ContextAddress state_addr = 0;
+        ContextAddress next_addr = 0;
+        if (i % LINE_BLOCK_STATES == 0) {
+            /* Skip blocks outside of the address range */
+            LineNumbersBlock * block = unit->mStatesBlocks + i / LINE_BLOCK_STATES;
+            ContextAddress min_addr = elf_map_to_run_time_address(ctx, unit->mFile, block->mMinAddress);
+            ContextAddress max_addr = elf_map_to_run_time_address(ctx, unit->mFile, block->mMaxAddress);
+            if (min_addr != 0 && max_addr - min_addr == block->mMaxAddress - block->mMinAddress &&
+                    (max_addr <= addr0 || min_addr >= addr1)) {
+                i += LINE_BLOCK_STATES - 1;
+                continue;
+            }
+            seek_line_state(&reader, unit, i);
+        }
+        st = reader.mState;
+        next_line_state(&reader);
         if (state->mFlags & LINE_EndSequence) continue;
+        state_addr = elf_map_to_run_time_address(ctx, unit->mFile, state->mAddress);
+        next_addr = elf_map_to_run_time_address(ctx, unit->mFile, next->mAddress);
         if (next_addr > addr0 && state_addr < addr1) {
             if (*cnt > 0) write_stream(out, ',');
             write_stream(out, '{');
@@ -203,61 +217,70 @@ static void write_line_info(Context * ctx, OutputStream * out, CompUnit * unit,
     }
 }
 
-int line_to_address(Context * ctx, char * file_name, int line, int column, LineToAddressCallBack * callback, void * user_args) {
+static void unit_line_to_address(Context * ctx, CompUnit * unit, U4_T file, unsigned line, LineToAddressCallBack * callback, void * user_args) {
+    LineRefsBlock * blocks = unit->mLineRefsBlocks;
+    LineRefsReader reader;
+    unsigned l = 0;
+    unsigned h = (unit->mLineRefsCnt + LINE_BLOCK_REFS - 1) / LINE_BLOCK_REFS;
+
+    if (unit->mLineRefsCnt == 0) return;
+    /*
+     * Entries are ordered by (file, line) and by (file, max next line), so entries with line ranges
+     * that contain the line start in the last block which begins with (file, max next line) <= (file, line)
+     */
+    while (l < h) {
+        unsigned m = (l + h) / 2;
+        LineNumbersRef * ref = &blocks[m].mRef;
+        if (ref->mFile < file || (ref->mFile == file && ref->mMaxNextLine <= line)) l = m + 1;
+        else h = m;
+    }
+    seek_line_ref(&reader, unit, l > 0 ? (l - 1) * LINE_BLOCK_REFS : 0);
+    for (;;) {
+        LineNumbersRef * ref = &reader.mRef;
+        if (ref->mFile > file || (ref->mFile == file && ref->mLine > line)) break;
+        if (ref->mFile == file && ref->mNextLine > line) {
+            LineNumbersReader state;
+            ContextAddress addr = 0;
+            seek_line_state(&state, unit, ref->mState);
+            addr = elf_map_to_run_time_address(ctx, unit->mFile, state.mState.mAddress);
+            if (addr != 0) callback(user_args, addr);
+        }
+        if (reader.mIndex + 1 >= unit->mLineRefsCnt) break;
+        next_line_ref(&reader);
+    }
+}
+
+int line_to_address_in_range(Context * ctx, ContextAddress addr0, ContextAddress addr1,
+                             char * file_name, int line, int column, LineToAddressCallBack * callback, void * user_args) {
     int err = 0;
 
     if (ctx == NULL) err = ERR_INV_CONTEXT;
     else if (ctx->exited) err = ERR_ALREADY_EXITED;
 
     if (err == 0) {
-        ELF_File * file = elf_list_first(ctx, 0, ~(ContextAddress)0);
+        ELF_File * file = elf_list_first(ctx, addr0, addr1);
         if (file == NULL) err = errno;
         while (file != NULL) {
             Trap trap;
             if (set_trap(&trap)) {
                 U4_T i;
                 DWARFCache * cache = get_dwarf_cache(file);
-                for (i = 0; i < cache->mCompUnitsCnt; i++) {
-                    CompUnit * unit = cache->mCompUnits[i];
-                    int equ = 0;
+                UnitFileName * name = find_unit_file_name(cache, file_name);
+                if (name != NULL) load_units_line_numbers(cache, name->mUnits, name->mUnitsCnt);
+                for (i = 0; name != NULL && i < name->mUnitsCnt; i++) {
+                    CompUnit * unit = name->mUnits[i];
+                    U4_T j;
                     assert(unit->mFile == file);
-                    if (unit->mDir != NULL && unit->mName != NULL) {
-                        equ = cmp_file(file_name, unit->mDir, unit->mName);
-                    }
-                    if (!equ) {
-                        U4_T j;
-                        for (j = 0; j < unit->mFilesCnt; j++) {
-                            FileInfo * f = unit->mFiles + j;
-                            if (f->mDir != NULL && f->mName != NULL) {
-                                equ = cmp_file(file_name, f->mDir, f->mName);
-                                if (equ) break;
-                            }
-                        }
-                    }
-                    if (equ) {
-                        load_line_numbers(cache, unit);
-                        if (unit->mStatesCnt >= 2) {
-                            U4_T j;
-                            for (j = 0; j < unit->mStatesCnt - 1; j++) {
-                                LineNumbersState * state = unit->mStates + j;
-                                LineNumbersState * next = unit->mStates + j + 1;
-                                char * state_dir = unit->mDir;
-                                char * state_name = unit->mName;
-                                ContextAddress addr = 0;
-                                if (state->mFlags & LINE_EndSequence) continue;
-                                if ((unsigned)line < state->mLine) continue;
-                                if ((unsigned)line >= next->mLine) continue;
-                                if (state->mFile >= 1 && state->mFile <= unit->mFilesCnt) {
-                                    FileInfo * f = unit->mFiles + (state->mFile - 1);
-                                    state_dir = f->mDir;
-                                    state_name = f->mName;
-                                }
-                                if (!cmp_file(file_name, state_dir, state_name)) continue;
-                                addr = elf_map_to_run_time_address(ctx, file, state->mAddress);
-                                if (addr == 0) continue;
-                                callback(user_args, addr);
-                            }
+                    for (j = 0; j <= unit->mFilesCnt; j++) {
+                        char * dir = unit->mDir;
+                        char * nm = unit->mName;
+                        if (j > 0) {
+                            FileInfo * f = unit->mFiles + (j - 1);
+                            dir = f->mDir;
+                            nm = f->mName;
                         }
+                        if (!cmp_file(file_name, dir, nm)) continue;
+                        unit_line_to_address(ctx, unit, j, (unsigned)line, callback, user_args);
                     }
                 }
                 clear_trap(&trap);
@@ -279,6 +302,10 @@ int line_to_address(Context * ctx, char * file_name, int line, int column, LineT
     return 0;
 }
 
+int line_to_address(Context * ctx, char * file_name, int line, int column, LineToAddressCallBack * callback, void * user_args) {
+    return line_to_address_in_range(ctx, 0, ~(ContextAddress)0, file_name, line, column, callback, user_args);
+}
+
 static void command_map_to_source(char * token, Channel * c) {
     int err = 0;
     char id[256];
@@ -37,7 +37,8 @@
 static const char * LINENUMBERS = "LineNumbers";
 
 
-int line_to_address(Context * ctx, char * file, int line, int column, LineToAddressCallBack * callback, void * user_args) {
+int line_to_address_in_range(Context * ctx, ContextAddress addr0, ContextAddress addr1,
+                             char * file, int line, int column, LineToAddressCallBack * callback, void * user_args) {
     int err = 0;
 
     if (ctx == NULL) err = ERR_INV_CONTEXT;
@@ -55,7 +56,7 @@ int line_to_address(Context * ctx, char * file, int line, int column, LineToAddr
                 err = set_win32_errno(win_err);
             }
         }
-        else {
+        else if (img_line.Address >= addr0 && img_line.Address <= addr1) {
             callback(user_args, img_line.Address);
         }
     }
@@ -67,6 +68,10 @@ int line_to_address(Context * ctx, char * file, int line, int column, LineToAddr
     return 0;
 }
 
+int line_to_address(Context * ctx, char * file, int line, int column, LineToAddressCallBack * callback, void * user_args) {
+    return line_to_address_in_range(ctx, 0, ~(ContextAddress)0, file, line, column, callback, user_args);
+}
+
 static int read_mem(Context * ctx, ContextAddress address, void * buf, size_t size) {
     int err = 0;
     if (context_read_mem(ctx, address, buf, size) < 0) err = errno;
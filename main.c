@@ -32,6 +32,8 @@
 #include "cmdline.h"
 #include "plugins.h"
 #include "channel_tcp.h"
+#include "dwarfcache.h"
+#include "dwarfindex.h"
 
 static char * progname;
 static Protocol * proto;
@@ -138,6 +140,8 @@ int main(int argc, char ** argv) {
             case 'l':
             case 'L':
             case 's':
+            case 'C':
+            case 'M':
                 if (*s == '\0') {
                     if (++ind >= argc) {
                         fprintf(stderr, "%s: error: no argument given to option '%c'\n", progname, c);
@@ -158,6 +162,22 @@ int main(int argc, char ** argv) {
                     url = s;
                     break;
 
+                case 'C':
+#if ENABLE_DwarfIndex
+                    set_dwarf_index_dir(s);
+#else
+                    fprintf(stderr, "Warning: This version does not support symbol index files.\n");
+#endif
+                    break;
+
+                case 'M':
+#if ENABLE_ELF
+                    set_dwarf_cache_size_limit((size_t)strtoul(s, 0, 0) << 20);
+#else
+                    fprintf(stderr, "Warning: This version does not support symbol files.\n");
+#endif
+                    break;
+
                 default:
                     fprintf(stderr, "%s: error: illegal option '%c'\n", progname, c);
                     exit(1);
@@ -0,0 +1,133 @@
+/*******************************************************************************
+ * Copyright (c) 2026 TCF Target Agent for ARM contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *     TCF Target Agent for ARM contributors - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Unit tests main module.
+ *
+ * Runs all unit tests one by one on the dispatch thread and exits with non-zero code if any of them failed.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "asyncreq.h"
+#include "events.h"
+#include "trace.h"
+#include "exceptions.h"
+#include "errors.h"
+#include "unittest.h"
+
+typedef void UnitTest(void);
+
+typedef struct UnitTestInfo {
+    const char * name;
+    UnitTest * test;
+} UnitTestInfo;
+
+static UnitTestInfo tests[] = {
+    { "json", test_json },
+    { "elf_hash", test_elf_hash },
+    { "line_numbers", test_line_numbers },
+    { "safe_events", test_safe_events },
+    { NULL, NULL }
+};
+
+#define TEST_TIMEOUT 30000000
+
+static int failures = 0;
+static int test_failures = 0;
+static unsigned test_pos = 0;
+static int test_pending = 0;
+
+void unit_test_failed(const char * file, int line, const char * cond) {
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, cond);
+    failures++;
+}
+
+void test_swap_bytes(void * buf, size_t size) {
+    size_t i, j;
+    char * p = (char *)buf;
+    for (i = 0, j = size - 1; i < size / 2; i++, j--) {
+        char x = p[i];
+        p[i] = p[j];
+        p[j] = x;
+    }
+}
+
+static void run_next_test(void * args);
+
+static void test_finished(void) {
+    printf("%s: %s\n", tests[test_pos].name, failures == test_failures ? "passed" : "FAILED");
+    test_pos++;
+    post_event(run_next_test, NULL);
+}
+
+static void test_timeout(void * args) {
+    if ((uintptr_t)args != test_pos || !test_pending) return;
+    fprintf(stderr, "%s: timeout\n", tests[test_pos].name);
+    failures++;
+    /* Events of the test can still be pending, other tests are not run */
+    printf("%s: FAILED\n", tests[test_pos].name);
+    cancel_event_loop();
+}
+
+void unit_test_wait(void) {
+    assert(!test_pending);
+    test_pending = 1;
+    post_event_with_delay(test_timeout, (void *)(uintptr_t)test_pos, TEST_TIMEOUT);
+}
+
+void unit_test_done(void) {
+    assert(test_pending);
+    test_pending = 0;
+    test_finished();
+}
+
+static void run_next_test(void * args) {
+    Trap trap;
+
+    if (tests[test_pos].test == NULL) {
+        cancel_event_loop();
+        return;
+    }
+    test_failures = failures;
+    if (set_trap(&trap)) {
+        tests[test_pos].test();
+        clear_trap(&trap);
+    }
+    else {
+        fprintf(stderr, "%s: exception: %s\n", tests[test_pos].name, errno_to_str(trap.error));
+        failures++;
+        test_pending = 0;
+    }
+    if (!test_pending) test_finished();
+}
+
+int main(int argc, char ** argv) {
+    ini_mdep();
+    ini_trace();
+    ini_asyncreq();
+    ini_events_queue();
+
+    post_event(run_next_test, NULL);
+    run_event_loop();
+
+    if (failures > 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -460,11 +460,21 @@ int clock_gettime(clockid_t clock_id, struct timespec * tp) {
     FILETIME ft;
     __int64 tim;
 
-    assert(clock_id == CLOCK_REALTIME);
+    assert(clock_id == CLOCK_REALTIME || clock_id == CLOCK_MONOTONIC);
     if (!tp) {
         errno = EINVAL;
         return -1;
     }
+    if (clock_id == CLOCK_MONOTONIC) {
+        LARGE_INTEGER cnt, freq;
+        if (!QueryPerformanceFrequency(&freq) || !QueryPerformanceCounter(&cnt)) {
+            set_win32_errno(GetLastError());
+            return -1;
+        }
+        tp->tv_sec  = (long)(cnt.QuadPart / freq.QuadPart);
+        tp->tv_nsec = (long)(cnt.QuadPart % freq.QuadPart * 1000000000 / freq.QuadPart);
+        return 0;
+    }
     GetSystemTimeAsFileTime(&ft);
     tim = file_time_to_unix_time(&ft);
     tp->tv_sec  = (long)(tim / 1000000L);
@@ -813,17 +823,27 @@ void ini_mdep(void) {
 #elif defined(__APPLE__)
 #include <pwd.h>
 #include <sys/utsname.h>
+#include <mach/mach_time.h>
 
 unsigned char BREAK_INST[] = { 0xcc };
 
 int clock_gettime(clockid_t clock_id, struct timespec * tp) {
     struct timeval tv;
 
-    assert(clock_id == CLOCK_REALTIME);
+    assert(clock_id == CLOCK_REALTIME || clock_id == CLOCK_MONOTONIC);
     if (!tp) {
         errno = EINVAL;
         return -1;
     }
+    if (clock_id == CLOCK_MONOTONIC) {
+        static mach_timebase_info_data_t info;
+        uint64_t t;
+        if (info.denom == 0) mach_timebase_info(&info);
+        t = mach_absolute_time() * info.numer / info.denom;
+        tp->tv_sec  = (long)(t / 1000000000);
+        tp->tv_nsec = (long)(t % 1000000000);
+        return 0;
+    }
     if (gettimeofday(&tv, NULL) < 0) {
         return -1;
     }
@@ -859,6 +879,7 @@ void ini_mdep(void) {
 #else
 
 #include <pwd.h>
+#include <signal.h>
 #include <sys/utsname.h>
 #include <asm/unistd.h>
 
@@ -898,9 +919,24 @@ int tkill(pid_t pid, int signal) {
     return syscall(__NR_tkill, pid, signal);
 }
 
+static void sigchld_mask(int how) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    pthread_sigmask(how, &set, NULL);
+}
+
+static void sigchld_unblock(void) {
+    sigchld_mask(SIG_UNBLOCK);
+}
+
 void ini_mdep(void) {
     pthread_attr_init(&pthread_create_attr);
     pthread_attr_setstacksize(&pthread_create_attr, 0x8000);
+    /* SIGCHLD is read by waitpid.c through signalfd, it must stay blocked in all agent threads,
+     * but not in child processes */
+    sigchld_mask(SIG_BLOCK);
+    pthread_atfork(NULL, NULL, sigchld_unblock);
 }
 
 #endif
@@ -1207,6 +1243,7 @@ void become_daemon(void) {
 #else
 
 #include <syslog.h>
+#include <signal.h>
 
 static int running_as_daemon = 0;
 
@@ -1215,12 +1252,16 @@ int is_daemon(void) {
 }
 
 void become_daemon(void) {
+    sigset_t mask;
     assert(!running_as_daemon);
     openlog("tcf-agent", LOG_PID, LOG_DAEMON);
+    /* daemon() forks, and fork handlers of child processes unblock SIGCHLD, see ini_mdep() */
+    pthread_sigmask(SIG_BLOCK, NULL, &mask);
     if (daemon(0, 0) < 0) {
         syslog(LOG_MAKEPRI(LOG_DAEMON, LOG_ERR), "Cannot become a daemon: %m");
         exit(1);
     }
+    pthread_sigmask(SIG_SETMASK, &mask, NULL);
     running_as_daemon = 1;
 }
 #endif
@@ -118,6 +118,7 @@ typedef unsigned long useconds_t;
 #endif
 
 #define CLOCK_REALTIME 1
+#define CLOCK_MONOTONIC 2
 typedef int clockid_t;
 extern int clock_gettime(clockid_t clock_id, struct timespec * tp);
 extern void usleep(useconds_t useconds);
@@ -401,6 +402,7 @@ extern unsigned char BREAK_INST[];  /* breakpoint instruction */
 #define BREAK_SIZE 1                /* breakpoint instruction size */
 
 #define CLOCK_REALTIME 1
+#define CLOCK_MONOTONIC 2
 typedef int clockid_t;
 extern int clock_gettime(clockid_t clock_id, struct timespec * tp);
 
@@ -504,6 +506,13 @@ static size_t get_sa_len(const struct sockaddr * addr) {
 
 extern pthread_attr_t pthread_create_attr;
 
+/* Storage class of thread local variables */
+#if defined(_MSC_VER)
+#  define THREAD_LOCAL __declspec(thread)
+#else
+#  define THREAD_LOCAL __thread
+#endif
+
 /* Return Operating System name */
 extern char * get_os_name(void);
 
@@ -56,6 +56,8 @@ typedef struct MemoryCommandArgs {
     Context * ctx;
 } MemoryCommandArgs;
 
+static MemPool * args_pool = NULL;
+
 static void write_context(OutputStream * out, Context * ctx) {
     assert(!ctx->exited);
     assert(ctx->parent == NULL);
@@ -255,7 +257,7 @@ static MemoryCommandArgs * read_command_args(char * token, Channel * c, int cmd)
         return NULL;
     }
     else {
-        MemoryCommandArgs * args = (MemoryCommandArgs *)loc_alloc(sizeof(MemoryCommandArgs));
+        MemoryCommandArgs * args = (MemoryCommandArgs *)pool_alloc(args_pool);
         *args = buf;
         args->c = c;
         strncpy(args->token, token, sizeof(args->token) - 1);
@@ -359,7 +361,7 @@ static void safe_memory_set(void * parm) {
     }
     stream_unlock(c);
     context_unlock(ctx);
-    loc_free(args);
+    pool_free(args_pool, args);
 }
 
 static void command_set(char * token, Channel * c) {
@@ -423,7 +425,7 @@ static void safe_memory_get(void * parm) {
     }
     stream_unlock(c);
     context_unlock(ctx);
-    loc_free(args);
+    pool_free(args_pool, args);
 }
 
 static void command_get(char * token, Channel * c) {
@@ -522,7 +524,7 @@ static void safe_memory_fill(void * parm) {
     }
     stream_unlock(c);
     context_unlock(ctx);
-    loc_free(args);
+    pool_free(args_pool, args);
 }
 
 static void command_fill(char * token, Channel * c) {
@@ -604,6 +606,7 @@ void ini_memory_service(Protocol * proto, TCFBroadcastGroup * bcg) {
         NULL,
         event_context_changed
     };
+    args_pool = mem_pool_create("MemoryCommandArgs", sizeof(MemoryCommandArgs), 0);
     add_context_event_listener(&listener, bcg);
     add_command_handler(proto, MEMORY, "getContext", command_get_context);
     add_command_handler(proto, MEMORY, "getChildren", command_get_children);
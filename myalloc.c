@@ -18,9 +18,285 @@
 
 #include "config.h"
 #include <string.h>
+#include "errors.h"
 #include "trace.h"
 #include "myalloc.h"
 
+#if ENABLE_AllocStats
+#  undef loc_alloc
+#  undef loc_alloc_zero
+#  undef loc_realloc
+#  undef loc_strdup
+#  undef loc_strdup2
+#  undef loc_strndup
+#endif
+
+#define ARENA_BLOCK_SIZE 0x2000
+#define ARENA_ALIGN 8
+
+struct MemArenaBlock {
+    MemArenaBlock * next;
+    size_t size;
+    size_t pos;
+};
+
+/* Block header size, rounded up to keep objects aligned */
+#define ARENA_HEADER_SIZE ((sizeof(MemArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+#define POOL_SLAB_SIZE 0x1000
+#define POOL_SLAB_MIN_OBJS 8
+
+typedef struct MemPoolObject MemPoolObject;
+
+struct MemPoolObject {
+    MemPoolObject * next;
+};
+
+struct MemPool {
+    MemPool * next;
+    MemPoolObject * free_list;
+    int flags;
+    pthread_mutex_t lock;
+    MemPoolStats stats;
+};
+
+static AllocStats stats;
+
+/* Allocation functions can be called by worker threads, counters are updated atomically */
+#if defined(__GNUC__)
+#  define stats_inc(x) __sync_fetch_and_add(&(x), 1)
+#elif defined(_MSC_VER)
+#  define stats_inc(x) InterlockedIncrement((volatile LONG *)&(x))
+#else
+#  define stats_inc(x) ((x)++)
+#endif
+
+static MemArena tmp_arena;
+static MemPool * pools = NULL;
+static pthread_mutex_t pools_lock;
+static int pools_lock_inited = 0;
+
+#if ENABLE_AllocStats
+
+#define SITE_HASH_SIZE 1021
+
+typedef struct AllocSite AllocSite;
+
+struct AllocSite {
+    AllocSite * next;
+    AllocSiteStats stats;
+    unsigned long snapshot_cnt;
+    size_t snapshot_bytes;
+};
+
+/* Allocation header, the union keeps user data aligned for any type */
+typedef union AllocHeader {
+    struct {
+        AllocSite * site;
+        size_t size;
+    } h;
+    long double align;
+} AllocHeader;
+
+static AllocSite * site_hash[SITE_HASH_SIZE];
+static unsigned site_cnt = 0;
+static pthread_mutex_t site_lock;
+static int site_lock_inited = 0;
+
+static void lock_sites(void) {
+    /* First allocation is done by the initial thread, before any other threads are created */
+    if (!site_lock_inited) {
+        check_error(pthread_mutex_init(&site_lock, NULL));
+        site_lock_inited = 1;
+    }
+    check_error(pthread_mutex_lock(&site_lock));
+}
+
+static void unlock_sites(void) {
+    check_error(pthread_mutex_unlock(&site_lock));
+}
+
+static AllocSite * find_site(const char * file, int line) {
+    AllocSite ** hp = &site_hash[(unsigned)line % SITE_HASH_SIZE];
+    AllocSite * site;
+
+    for (site = *hp; site != NULL; site = site->next) {
+        if (site->stats.line != line) continue;
+        if (site->stats.file == file || strcmp(site->stats.file, file) == 0) return site;
+    }
+    if ((site = (AllocSite *)calloc(1, sizeof(AllocSite))) == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    site->stats.file = file;
+    site->stats.line = line;
+    site->next = *hp;
+    *hp = site;
+    site_cnt++;
+    return site;
+}
+
+static void add_live_bytes(AllocSite * site, size_t add, size_t sub) {
+    site->stats.live_bytes = site->stats.live_bytes + add - sub;
+    if (site->stats.live_bytes > site->stats.max_live_bytes) site->stats.max_live_bytes = site->stats.live_bytes;
+    stats.live_bytes = stats.live_bytes + add - sub;
+    if (stats.live_bytes > stats.max_live_bytes) stats.max_live_bytes = stats.live_bytes;
+}
+
+static void * site_alloc(size_t size, const char * file, int line) {
+    AllocHeader * h;
+
+    if (size == 0) {
+        size = 1;
+    }
+    if ((h = (AllocHeader *)malloc(sizeof(AllocHeader) + size)) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    lock_sites();
+    h->h.site = find_site(file, line);
+    h->h.size = size;
+    h->h.site->stats.alloc_cnt++;
+    add_live_bytes(h->h.site, size, 0);
+    stats.alloc_cnt++;
+    unlock_sites();
+    return h + 1;
+}
+
+void * loc_alloc_site(size_t size, const char * file, int line) {
+    void * p = site_alloc(size, file, line);
+    trace(LOG_ALLOC, "loc_alloc(%zd) = %#lx", size, p);
+    return p;
+}
+
+void * loc_alloc_zero_site(size_t size, const char * file, int line) {
+    void * p = site_alloc(size, file, line);
+    memset(p, 0, size);
+    trace(LOG_ALLOC, "loc_alloc_zero(%zd) = %#lx", size, p);
+    return p;
+}
+
+void * loc_realloc_site(void * ptr, size_t size, const char * file, int line) {
+    AllocHeader * h;
+    size_t old_size;
+
+    if (ptr == NULL) return loc_alloc_site(size, file, line);
+    if (size == 0) {
+        size = 1;
+    }
+    h = (AllocHeader *)ptr - 1;
+    old_size = h->h.size;
+    if ((h = (AllocHeader *)realloc(h, sizeof(AllocHeader) + size)) == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+    /* Block stays attributed to the call site that allocated it */
+    lock_sites();
+    h->h.size = size;
+    add_live_bytes(h->h.site, size, old_size);
+    stats.realloc_cnt++;
+    unlock_sites();
+    trace(LOG_ALLOC, "loc_realloc(%#lx, %zd) = %#lx", ptr, size, h + 1);
+    return h + 1;
+}
+
+void loc_free(void * p) {
+    AllocHeader * h;
+
+    trace(LOG_ALLOC, "loc_free %#lx", p);
+    if (p == NULL) return;
+    h = (AllocHeader *)p - 1;
+    lock_sites();
+    h->h.site->stats.free_cnt++;
+    add_live_bytes(h->h.site, 0, h->h.size);
+    stats.free_cnt++;
+    unlock_sites();
+    free(h);
+}
+
+char * loc_strdup_site(const char * s, const char * file, int line) {
+    char * rval = (char *)loc_alloc_site(strlen(s) + 1, file, line);
+    strcpy(rval, s);
+    return rval;
+}
+
+char * loc_strdup2_site(const char * s1, const char * s2, const char * file, int line) {
+    char * rval = (char *)loc_alloc_site(strlen(s1) + strlen(s2) + 1, file, line);
+    strcpy(rval, s1);
+    strcat(rval, s2);
+    return rval;
+}
+
+char * loc_strndup_site(const char * s, size_t len, const char * file, int line) {
+    char * rval = (char *)loc_alloc_site(len + 1, file, line);
+    strncpy(rval, s, len);
+    rval[len] = '\0';
+    return rval;
+}
+
+/* Out-of-line versions, for callers that don't see the macros */
+
+void * loc_alloc(size_t size) {
+    return loc_alloc_site(size, "?", 0);
+}
+
+void * loc_alloc_zero(size_t size) {
+    return loc_alloc_zero_site(size, "?", 0);
+}
+
+void * loc_realloc(void * ptr, size_t size) {
+    return loc_realloc_site(ptr, size, "?", 0);
+}
+
+char * loc_strdup(const char * s) {
+    return loc_strdup_site(s, "?", 0);
+}
+
+char * loc_strdup2(const char * s1, const char * s2) {
+    return loc_strdup2_site(s1, s2, "?", 0);
+}
+
+char * loc_strndup(const char * s, size_t len) {
+    return loc_strndup_site(s, len, "?", 0);
+}
+
+AllocSiteStats * get_alloc_site_stats(unsigned * cnt) {
+    AllocSiteStats * buf;
+    unsigned n = 0;
+    unsigned i;
+
+    lock_sites();
+    buf = (AllocSiteStats *)tmp_alloc(sizeof(AllocSiteStats) * (site_cnt + 1));
+    for (i = 0; i < SITE_HASH_SIZE; i++) {
+        AllocSite * site;
+        for (site = site_hash[i]; site != NULL; site = site->next) {
+            AllocSiteStats * s = buf + n++;
+            *s = site->stats;
+            s->live_cnt_delta = (long)(s->alloc_cnt - s->free_cnt) - (long)site->snapshot_cnt;
+            s->live_bytes_delta = (long)s->live_bytes - (long)site->snapshot_bytes;
+        }
+    }
+    unlock_sites();
+    *cnt = n;
+    return buf;
+}
+
+void alloc_stats_snapshot(void) {
+    unsigned i;
+
+    lock_sites();
+    for (i = 0; i < SITE_HASH_SIZE; i++) {
+        AllocSite * site;
+        for (site = site_hash[i]; site != NULL; site = site->next) {
+            site->snapshot_cnt = site->stats.alloc_cnt - site->stats.free_cnt;
+            site->snapshot_bytes = site->stats.live_bytes;
+        }
+    }
+    unlock_sites();
+}
+
+#else
+
 void * loc_alloc(size_t size) {
     void * p;
 
@@ -31,6 +307,7 @@ void * loc_alloc(size_t size) {
         perror("malloc");
         exit(1);
     }
+    stats_inc(stats.alloc_cnt);
     trace(LOG_ALLOC, "loc_alloc(%zd) = %#lx", size, p);
     return p;
 }
@@ -46,6 +323,7 @@ void * loc_alloc_zero(size_t size) {
         exit(1);
     }
     memset(p, 0, size);
+    stats_inc(stats.alloc_cnt);
     trace(LOG_ALLOC, "loc_alloc_zero(%zd) = %#lx", size, p);
     return p;
 }
@@ -60,15 +338,213 @@ void * loc_realloc(void * ptr, size_t size) {
         perror("realloc");
         exit(1);
     }
+    stats_inc(stats.realloc_cnt);
     trace(LOG_ALLOC, "loc_realloc(%#lx, %zd) = %#lx", ptr, size,p);
     return p;
 }
 
 void loc_free(void *p) {
     trace(LOG_ALLOC, "loc_free %#lx", p);
+    if (p != NULL) stats_inc(stats.free_cnt);
     free(p);
 }
 
+#endif /* ENABLE_AllocStats */
+
+void * arena_alloc(MemArena * arena, size_t size) {
+    MemArenaBlock * b = arena->blocks;
+    void * p;
+
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (size == 0) size = ARENA_ALIGN;
+    if (b == NULL || b->size - b->pos < size) {
+        size_t block_size = ARENA_BLOCK_SIZE;
+        if (size > block_size - ARENA_HEADER_SIZE) block_size = size + ARENA_HEADER_SIZE;
+        if ((b = (MemArenaBlock *)malloc(block_size)) == NULL) {
+            perror("malloc");
+            exit(1);
+        }
+        b->size = block_size;
+        b->pos = ARENA_HEADER_SIZE;
+        if (arena->blocks != NULL && block_size > ARENA_BLOCK_SIZE) {
+            /* Oversized block: keep current block first, so its free space is still used */
+            b->next = arena->blocks->next;
+            arena->blocks->next = b;
+        }
+        else {
+            b->next = arena->blocks;
+            arena->blocks = b;
+        }
+        stats_inc(stats.arena_block_cnt);
+    }
+    p = (char *)b + b->pos;
+    b->pos += size;
+    stats_inc(stats.tmp_cnt);
+    return p;
+}
+
+void arena_reset(MemArena * arena) {
+    MemArenaBlock * b = arena->blocks;
+    if (b == NULL) return;
+    while (b->next != NULL) {
+        MemArenaBlock * n = b->next;
+        b->next = n->next;
+        free(n);
+    }
+    if (b->size > ARENA_BLOCK_SIZE) {
+        free(b);
+        arena->blocks = NULL;
+        return;
+    }
+    b->pos = ARENA_HEADER_SIZE;
+}
+
+void arena_dispose(MemArena * arena) {
+    while (arena->blocks != NULL) {
+        MemArenaBlock * b = arena->blocks;
+        arena->blocks = b->next;
+        free(b);
+    }
+}
+
+void * tmp_alloc(size_t size) {
+    return arena_alloc(&tmp_arena, size);
+}
+
+void * tmp_alloc_zero(size_t size) {
+    void * p = arena_alloc(&tmp_arena, size);
+    memset(p, 0, size);
+    return p;
+}
+
+void tmp_gc(void) {
+    arena_reset(&tmp_arena);
+}
+
+MemPool * mem_pool_create(const char * name, size_t obj_size, int flags) {
+    MemPool * pool = (MemPool *)loc_alloc_zero(sizeof(MemPool));
+
+    if (obj_size < sizeof(MemPoolObject)) obj_size = sizeof(MemPoolObject);
+    obj_size = (obj_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    pool->flags = flags;
+    pool->stats.name = name;
+    pool->stats.obj_size = obj_size;
+    if (flags & MEM_POOL_SHARED) check_error(pthread_mutex_init(&pool->lock, NULL));
+
+    /* Pools are normally created during agent initialization, before other threads are started */
+    if (!pools_lock_inited) {
+        check_error(pthread_mutex_init(&pools_lock, NULL));
+        pools_lock_inited = 1;
+    }
+    check_error(pthread_mutex_lock(&pools_lock));
+    pool->next = pools;
+    pools = pool;
+    check_error(pthread_mutex_unlock(&pools_lock));
+    return pool;
+}
+
+#if ENABLE_MemPool
+
+static void add_slab(MemPool * pool) {
+    size_t size = pool->stats.obj_size;
+    size_t cnt = POOL_SLAB_SIZE / size;
+    char * slab;
+    size_t i;
+
+    if (cnt < POOL_SLAB_MIN_OBJS) cnt = POOL_SLAB_MIN_OBJS;
+    if ((slab = (char *)malloc(cnt * size)) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (i = cnt; i > 0; i--) {
+        MemPoolObject * obj = (MemPoolObject *)(slab + (i - 1) * size);
+        obj->next = pool->free_list;
+        pool->free_list = obj;
+    }
+    pool->stats.slab_cnt++;
+    pool->stats.obj_cnt += cnt;
+}
+
+void * pool_alloc(MemPool * pool) {
+    MemPoolObject * obj;
+
+    if (pool->flags & MEM_POOL_SHARED) check_error(pthread_mutex_lock(&pool->lock));
+    if (pool->free_list == NULL) add_slab(pool);
+    obj = pool->free_list;
+    pool->free_list = obj->next;
+    pool->stats.alloc_cnt++;
+    if (pool->flags & MEM_POOL_SHARED) check_error(pthread_mutex_unlock(&pool->lock));
+    trace(LOG_ALLOC, "pool_alloc(%s) = %#lx", pool->stats.name, obj);
+    return obj;
+}
+
+void pool_free(MemPool * pool, void * p) {
+    MemPoolObject * obj = (MemPoolObject *)p;
+
+    if (obj == NULL) return;
+    trace(LOG_ALLOC, "pool_free(%s) %#lx", pool->stats.name, obj);
+    if (pool->flags & MEM_POOL_SHARED) check_error(pthread_mutex_lock(&pool->lock));
+    obj->next = pool->free_list;
+    pool->free_list = obj;
+    pool->stats.free_cnt++;
+    if (pool->flags & MEM_POOL_SHARED) check_error(pthread_mutex_unlock(&pool->lock));
+}
+
+#else
+
+void * pool_alloc(MemPool * pool) {
+    void * p = loc_alloc(pool->stats.obj_size);
+    if (pool->flags & MEM_POOL_SHARED) check_error(pthread_mutex_lock(&pool->lock));
+    pool->stats.alloc_cnt++;
+    pool->stats.obj_cnt++;
+    if (pool->flags & MEM_POOL_SHARED) check_error(pthread_mutex_unlock(&pool->lock));
+    return p;
+}
+
+void pool_free(MemPool * pool, void * p) {
+    if (p == NULL) return;
+    loc_free(p);
+    if (pool->flags & MEM_POOL_SHARED) check_error(pthread_mutex_lock(&pool->lock));
+    pool->stats.free_cnt++;
+    pool->stats.obj_cnt--;
+    if (pool->flags & MEM_POOL_SHARED) check_error(pthread_mutex_unlock(&pool->lock));
+}
+
+#endif /* ENABLE_MemPool */
+
+void * pool_alloc_zero(MemPool * pool) {
+    void * p = pool_alloc(pool);
+    memset(p, 0, pool->stats.obj_size);
+    return p;
+}
+
+void iterate_mem_pools(MemPoolStatsCallBack * call_back, void * arg) {
+    MemPool * pool;
+
+    if (!pools_lock_inited) return;
+    check_error(pthread_mutex_lock(&pools_lock));
+    for (pool = pools; pool != NULL; pool = pool->next) {
+        MemPoolStats s;
+        if (pool->flags & MEM_POOL_SHARED) check_error(pthread_mutex_lock(&pool->lock));
+        s = pool->stats;
+        if (pool->flags & MEM_POOL_SHARED) check_error(pthread_mutex_unlock(&pool->lock));
+        call_back(&s, arg);
+    }
+    check_error(pthread_mutex_unlock(&pools_lock));
+}
+
+void get_alloc_stats(AllocStats * s) {
+#if ENABLE_AllocStats
+    lock_sites();
+    *s = stats;
+    unlock_sites();
+#else
+    *s = stats;
+#endif
+}
+
+
+#if !ENABLE_AllocStats
 
 /*
  * strdup() with end-of-memory checking.
@@ -100,3 +576,5 @@ char * loc_strndup(const char * s, size_t len) {
     rval[len] = '\0';
     return rval;
 }
+
+#endif /* ENABLE_AllocStats */
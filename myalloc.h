@@ -19,6 +19,7 @@
 #ifndef D_myalloc
 #define D_myalloc
 
+#include "config.h"
 #include <stdlib.h>
 
 extern void * loc_alloc(size_t size);
@@ -30,4 +31,132 @@ extern char * loc_strndup(const char * s, size_t len);
 
 extern void loc_free(void * p);
 
+/*
+ * Memory arena.
+ * Objects are carved sequentially from large blocks and are released all at once
+ * by arena_reset() or arena_dispose(). Individual objects cannot be freed.
+ * arena_reset() keeps one block, so an arena that is reset regularly does not
+ * call malloc() in steady state.
+ * A zero-filled MemArena is a valid empty arena.
+ */
+typedef struct MemArenaBlock MemArenaBlock;
+
+typedef struct MemArena {
+    MemArenaBlock * blocks;
+} MemArena;
+
+extern void * arena_alloc(MemArena * arena, size_t size);
+extern void arena_reset(MemArena * arena);
+extern void arena_dispose(MemArena * arena);
+
+/*
+ * Temporary memory allocation.
+ * Memory returned by tmp_*() functions belongs to the current dispatch cycle.
+ * It is released automatically when the current event handler returns, e.g. after
+ * a command is handled and its reply is written, or after a safe event is done.
+ * Such memory must not be passed to loc_free() and must not be kept across events:
+ * a command that is deferred by post_safe_command() gets a copy of its arguments.
+ * Can be used by dispatch thread only.
+ */
+extern void * tmp_alloc(size_t size);
+extern void * tmp_alloc_zero(size_t size);
+
+/* Release all temporary memory, called by the event dispatcher after each event */
+extern void tmp_gc(void);
+
+/*
+ * Fixed size object pools.
+ * Objects are carved from slabs of several objects and are recycled through a free list,
+ * slab memory is never returned to the heap.
+ * A pool created with MEM_POOL_SHARED flag can be used by any thread, otherwise
+ * the pool must be used by dispatch thread only, or guarded by a lock owned by the caller.
+ * If ENABLE_MemPool is 0, pool_alloc() and pool_free() are plain heap allocations,
+ * which is useful with heap debugging tools.
+ */
+#define MEM_POOL_SHARED 1
+
+typedef struct MemPool MemPool;
+
+extern MemPool * mem_pool_create(const char * name, size_t obj_size, int flags);
+extern void * pool_alloc(MemPool * pool);
+extern void * pool_alloc_zero(MemPool * pool);
+extern void pool_free(MemPool * pool, void * p);
+
+typedef struct MemPoolStats {
+    const char * name;
+    size_t obj_size;
+    unsigned long alloc_cnt;        /* number of pool_alloc() calls */
+    unsigned long free_cnt;         /* number of pool_free() calls */
+    unsigned long slab_cnt;         /* number of slabs allocated from the heap */
+    unsigned long obj_cnt;          /* number of objects in all slabs */
+} MemPoolStats;
+
+typedef void MemPoolStatsCallBack(const MemPoolStats *, void *);
+
+/* Call "call_back" with statistics of every pool */
+extern void iterate_mem_pools(MemPoolStatsCallBack * call_back, void * arg);
+
+/*
+ * Allocation counters.
+ * Unless ENABLE_AllocStats is set, counters are updated with atomic increments,
+ * reading them while other threads allocate memory gives a snapshot.
+ */
+typedef struct AllocStats {
+    unsigned long alloc_cnt;        /* number of loc_alloc() and loc_alloc_zero() calls */
+    unsigned long realloc_cnt;      /* number of loc_realloc() calls */
+    unsigned long free_cnt;         /* number of loc_free() calls */
+    unsigned long tmp_cnt;          /* number of objects allocated from arenas, including tmp_*() */
+    unsigned long arena_block_cnt;  /* number of arena blocks allocated */
+    size_t live_bytes;              /* bytes allocated by loc_*() and not freed, if ENABLE_AllocStats */
+    size_t max_live_bytes;          /* high-water mark of live_bytes, if ENABLE_AllocStats */
+} AllocStats;
+
+extern void get_alloc_stats(AllocStats * stats);
+
+#if ENABLE_AllocStats
+
+/*
+ * Per call site allocation accounting.
+ * Every loc_*() allocation is attributed to the source file and line that called it,
+ * each block carries a small header with its size and call site.
+ * All memory passed to loc_free() and loc_realloc() must be allocated by loc_*() functions.
+ * Counters are protected by a lock, so this is noticeably slower than the default allocator,
+ * and is intended for leak hunting and cache sizing, not for production builds.
+ */
+extern void * loc_alloc_site(size_t size, const char * file, int line);
+extern void * loc_alloc_zero_site(size_t size, const char * file, int line);
+extern void * loc_realloc_site(void * ptr, size_t size, const char * file, int line);
+extern char * loc_strdup_site(const char * s, const char * file, int line);
+extern char * loc_strdup2_site(const char * s1, const char * s2, const char * file, int line);
+extern char * loc_strndup_site(const char * s, size_t len, const char * file, int line);
+
+#define loc_alloc(size) loc_alloc_site(size, __FILE__, __LINE__)
+#define loc_alloc_zero(size) loc_alloc_zero_site(size, __FILE__, __LINE__)
+#define loc_realloc(ptr, size) loc_realloc_site(ptr, size, __FILE__, __LINE__)
+#define loc_strdup(s) loc_strdup_site(s, __FILE__, __LINE__)
+#define loc_strdup2(s1, s2) loc_strdup2_site(s1, s2, __FILE__, __LINE__)
+#define loc_strndup(s, len) loc_strndup_site(s, len, __FILE__, __LINE__)
+
+typedef struct AllocSiteStats {
+    const char * file;
+    int line;
+    unsigned long alloc_cnt;        /* number of blocks allocated */
+    unsigned long free_cnt;         /* number of blocks freed */
+    size_t live_bytes;              /* size of blocks that are not freed yet */
+    size_t max_live_bytes;          /* high-water mark of live_bytes */
+    long live_cnt_delta;            /* change of live block count since last alloc_stats_snapshot() */
+    long live_bytes_delta;          /* change of live_bytes since last alloc_stats_snapshot() */
+} AllocSiteStats;
+
+/*
+ * Return statistics of all call sites, in an array allocated with tmp_alloc().
+ * Can be used by dispatch thread only.
+ */
+extern AllocSiteStats * get_alloc_site_stats(unsigned * cnt);
+
+/* Remember current live counters of every call site, used to compute deltas */
+extern void alloc_stats_snapshot(void);
+
+#endif /* ENABLE_AllocStats */
+
 #endif /* D_myalloc */
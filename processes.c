@@ -403,16 +403,17 @@ static void command_detach(char * token, Channel * c) {
     exception(ERR_PROTOCOL);
 }
 
-static void command_terminate(char * token, Channel * c) {
-    int err = 0;
+typedef struct SignalArgs {
     char id[256];
-    pid_t pid, parent;
+    int signal;
+} SignalArgs;
 
-    json_read_string(&c->inp, id, sizeof(id));
-    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-    if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
+static void terminate_command(Channel * c, char * token, void * x) {
+    SignalArgs * args = (SignalArgs *)x;
+    int err = 0;
+    pid_t pid, parent;
 
-    pid = id2pid(id, &parent);
+    pid = id2pid(args->id, &parent);
     write_stringz(&c->out, "R");
     write_stringz(&c->out, token);
 
@@ -438,19 +439,25 @@ static void command_terminate(char * token, Channel * c) {
     write_stream(&c->out, MARKER_EOM);
 }
 
-static void command_signal(char * token, Channel * c) {
-    int err = 0;
-    char id[256];
-    int signal = 0;
-    pid_t pid, parent;
+static void command_terminate(char * token, Channel * c) {
+    SignalArgs args;
 
-    json_read_string(&c->inp, id, sizeof(id));
-    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-    signal = (int)json_read_long(&c->inp);
+    memset(&args, 0, sizeof(args));
+    json_read_string(&c->inp, args.id, sizeof(args.id));
     if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
     if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
 
-    pid = id2pid(id, &parent);
+    /* Memory and register changes requested earlier are done before the process gets the signal */
+    post_safe_command(c, token, id2ctx(args.id), terminate_command, &args, sizeof(args));
+}
+
+static void signal_command(Channel * c, char * token, void * x) {
+    SignalArgs * args = (SignalArgs *)x;
+    int err = 0;
+    int signal = args->signal;
+    pid_t pid, parent;
+
+    pid = id2pid(args->id, &parent);
     write_stringz(&c->out, "R");
     write_stringz(&c->out, token);
 
@@ -473,6 +480,19 @@ static void command_signal(char * token, Channel * c) {
     write_stream(&c->out, MARKER_EOM);
 }
 
+static void command_signal(char * token, Channel * c) {
+    SignalArgs args;
+
+    memset(&args, 0, sizeof(args));
+    json_read_string(&c->inp, args.id, sizeof(args.id));
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    args.signal = (int)json_read_long(&c->inp);
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
+
+    post_safe_command(c, token, id2ctx(args.id), signal_command, &args, sizeof(args));
+}
+
 static void command_get_signal_list(char * token, Channel * c) {
     int err = 0;
     char id[256];
@@ -1188,67 +1208,58 @@ static void command_start(char * token, Channel * c) {
     int selfattach = 0;
     int pending = 0;
     ChildProcess * prs = NULL;
-    Trap trap;
-
-    if (set_trap(&trap)) {
-        json_read_string(&c->inp, dir, sizeof(dir));
-        if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-        json_read_string(&c->inp, exe, sizeof(exe));
-        if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-        args = json_read_alloc_string_array(&c->inp, &args_len);
-        if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-        envp = json_read_alloc_string_array(&c->inp, &envp_len);
-        if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-        attach = json_read_boolean(&c->inp);
-        if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-        if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
-
-        if (dir[0] != 0 && chdir(dir) < 0) err = errno;
-        if (err == 0 && start_process(c, envp, dir, exe, args, attach, &pid, &selfattach, &prs) < 0) err = errno;
-        if (prs != NULL) {
-            write_process_input(prs);
-            prs->out_struct = read_process_output(prs, prs->out, prs->out_id, sizeof(prs->out_id));
-            if (prs->out != prs->err) prs->err_struct = read_process_output(prs, prs->err, prs->err_id, sizeof(prs->err_id));
-            strncpy(prs->name, exe, sizeof(prs->name) - 1);
-        }
-        if (!err) {
-            if (attach) {
-                AttachDoneArgs * data = loc_alloc_zero(sizeof *data);
-                data->c = c;
-                strcpy(data->token, token);
-                pending = context_attach(pid, start_done, data, selfattach) == 0;
-                if (pending) {
-                    stream_lock(c);
-                }
-                else {
-                    err = errno;
-                    loc_free(data);
-                }
+
+    json_read_string(&c->inp, dir, sizeof(dir));
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    json_read_string(&c->inp, exe, sizeof(exe));
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    args = json_read_tmp_string_array(&c->inp, &args_len);
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    envp = json_read_tmp_string_array(&c->inp, &envp_len);
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    attach = json_read_boolean(&c->inp);
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
+
+    if (dir[0] != 0 && chdir(dir) < 0) err = errno;
+    if (err == 0 && start_process(c, envp, dir, exe, args, attach, &pid, &selfattach, &prs) < 0) err = errno;
+    if (prs != NULL) {
+        write_process_input(prs);
+        prs->out_struct = read_process_output(prs, prs->out, prs->out_id, sizeof(prs->out_id));
+        if (prs->out != prs->err) prs->err_struct = read_process_output(prs, prs->err, prs->err_id, sizeof(prs->err_id));
+        strncpy(prs->name, exe, sizeof(prs->name) - 1);
+    }
+    if (!err) {
+        if (attach) {
+            AttachDoneArgs * data = loc_alloc_zero(sizeof *data);
+            data->c = c;
+            strcpy(data->token, token);
+            pending = context_attach(pid, start_done, data, selfattach) == 0;
+            if (pending) {
+                stream_lock(c);
             }
             else {
-                add_waitpid_process(pid);
+                err = errno;
+                loc_free(data);
             }
         }
-        if (!pending) {
-            write_stringz(&c->out, "R");
-            write_stringz(&c->out, token);
-            write_errno(&c->out, err);
-            if (err || pid == 0) {
-                write_stringz(&c->out, "null");
-            }
-            else {
-                write_context(&c->out, pid);
-                write_stream(&c->out, 0);
-            }
-            write_stream(&c->out, MARKER_EOM);
+        else {
+            add_waitpid_process(pid);
         }
-        clear_trap(&trap);
     }
-
-    loc_free(args);
-    loc_free(envp);
-
-    if (trap.error) exception(trap.error);
+    if (!pending) {
+        write_stringz(&c->out, "R");
+        write_stringz(&c->out, token);
+        write_errno(&c->out, err);
+        if (err || pid == 0) {
+            write_stringz(&c->out, "null");
+        }
+        else {
+            write_context(&c->out, pid);
+            write_stream(&c->out, 0);
+        }
+        write_stream(&c->out, MARKER_EOM);
+    }
 }
 
 static void waitpid_listener(int pid, int exited, int exit_code, int signal, int event_code, int syscall, void * args) {
@@ -78,6 +78,7 @@ struct ReplyHandlerInfo {
 static MessageHandlerInfo * message_handlers[MESSAGE_HASH_SIZE];
 static EventHandlerInfo * event_handlers[EVENT_HASH_SIZE];
 static ReplyHandlerInfo * reply_handlers[REPLY_HASH_SIZE];
+static MemPool * reply_pool = NULL;
 static ServiceInfo * services;
 static int ini_done = 0;
 
@@ -273,7 +274,7 @@ void handle_protocol_message(Protocol * p, Channel * c) {
                     error = ERR_INV_COMMAND;
                 }
                 rh->handler(c, rh->client_data, error);
-                if (type[0] != 'P') loc_free(rh);
+                if (type[0] != 'P') pool_free(reply_pool, rh);
             }
             clear_trap(&trap);
         }
@@ -418,7 +419,7 @@ ReplyHandlerInfo * protocol_send_command(Protocol * p, Channel * c, const char *
     write_stringz(&c->out, token);
     write_stringz(&c->out, service);
     write_stringz(&c->out, name);
-    rh = loc_alloc(sizeof *rh);
+    rh = (ReplyHandlerInfo *)pool_alloc(reply_pool);
     rh->tokenid = tokenid;
     rh->c = c;
     rh->handler = handler;
@@ -533,13 +534,13 @@ static void channel_closed(Channel * c) {
                 *rhp = rh->next;
                 if (set_trap(&trap)) {
                     rh->handler(c, rh->client_data, ERR_CHANNEL_CLOSED);
-                    loc_free(rh);
+                    pool_free(reply_pool, rh);
                     clear_trap(&trap);
                 }
                 else {
                     trace(LOG_ALWAYS, "Exception handling reply %ul: %d %s",
                           rh->tokenid, trap.error, errno_to_str(trap.error));
-                    loc_free(rh);
+                    pool_free(reply_pool, rh);
                 }
             }
             else {
@@ -564,6 +565,7 @@ Protocol * protocol_alloc(void) {
     assert(is_dispatch_thread());
     if (!ini_done) {
         add_channel_close_listener(channel_closed);
+        reply_pool = mem_pool_create("ReplyHandlerInfo", sizeof(ReplyHandlerInfo), 0);
         ini_done = 1;
     }
     p->lock_cnt = 1;
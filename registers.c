@@ -29,6 +29,7 @@
 #include "context.h"
 #include "json.h"
 #include "exceptions.h"
+#include "runctrl.h"
 #include "registers.h"
 
 static const char * REGISTERS = "Registers";
@@ -335,40 +336,31 @@ static void command_get(char * token, Channel * c) {
     write_stream(&c->out, MARKER_EOM);
 }
 
-static void command_set(char * token, Channel * c) {
-    int err = 0;
+typedef struct SetArgs {
     char id[256];
     char val[256];
-    int val_len = 0;
-    JsonReadBinaryState state;
+    int val_len;
+} SetArgs;
+
+static void set_command(Channel * c, char * token, void * x) {
+    SetArgs * args = (SetArgs *)x;
+    int err = 0;
     Context * ctx = NULL;
     REG_INDEX * idx = NULL;
 
-    json_read_string(&c->inp, id, sizeof(id));
-    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-    json_read_binary_start(&state, &c->inp);
-    for (;;) {
-        int rd = json_read_binary_data(&state, val + val_len, sizeof(val) - val_len);
-        if (rd == 0) break;
-        val_len += rd;
-    }
-    json_read_binary_end(&state);
-    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-    if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
-
-    if (id2register(id, &ctx, &idx) < 0) err = errno;
+    if (id2register(args->id, &ctx, &idx) < 0) err = errno;
     else if (!ctx->intercepted) err = ERR_IS_RUNNING;
 
     if (err == 0) {
         char * data = (char *)&ctx->regs + idx->regOff;
         int size = REG_WIDTH(*idx);
-        if (val_len != size) {
+        if (args->val_len != size) {
             err = ERR_INV_DATA_SIZE;
         }
         else {
-            memcpy(data, val, val_len);
+            memcpy(data, args->val, args->val_len);
             ctx->regs_dirty = 1;
-            send_event_register_changed(c, id);
+            send_event_register_changed(c, args->id);
         }
     }
 
@@ -378,6 +370,29 @@ static void command_set(char * token, Channel * c) {
     write_stream(&c->out, MARKER_EOM);
 }
 
+static void command_set(char * token, Channel * c) {
+    SetArgs args;
+    JsonReadBinaryState state;
+    Context * ctx = NULL;
+    REG_INDEX * idx = NULL;
+
+    memset(&args, 0, sizeof(args));
+    json_read_string(&c->inp, args.id, sizeof(args.id));
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    json_read_binary_start(&state, &c->inp);
+    for (;;) {
+        int rd = json_read_binary_data(&state, args.val + args.val_len, sizeof(args.val) - args.val_len);
+        if (rd == 0) break;
+        args.val_len += rd;
+    }
+    json_read_binary_end(&state);
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
+
+    id2register(args.id, &ctx, &idx);
+    post_safe_command(c, token, ctx, set_command, &args, sizeof(args));
+}
+
 struct Location {
     char id[256];
     Context * ctx;
@@ -469,36 +484,86 @@ static void command_getm(char * token, Channel * c) {
     write_stream(&c->out, MARKER_EOM);
 }
 
+/*
+ * Registers.setm arguments: header, array of locations and register data of the locations.
+ * Contexts are looked up again when the command is executed, since it can be deferred by post_safe_command().
+ */
+typedef struct SetmArgs {
+    int cnt;
+    unsigned data_size;
+} SetmArgs;
+
+static void setm_command(Channel * c, char * token, void * x) {
+    SetmArgs * args = (SetmArgs *)x;
+    Location * locs = (Location *)(args + 1);
+    char * data = (char *)(locs + args->cnt);
+    int err = 0;
+    int i;
+
+    for (i = 0; i < args->cnt && err == 0; i++) {
+        Location * l = locs + i;
+        if (id2register(l->id, &l->ctx, &l->idx) < 0) err = errno;
+        else if (!l->ctx->intercepted) err = ERR_IS_RUNNING;
+    }
+    for (i = 0; i < args->cnt && err == 0; i++) {
+        Location * l = locs + i;
+        memcpy((char *)&l->ctx->regs + l->idx->regOff + l->offs, data, l->size);
+        data += l->size;
+        send_event_register_changed(c, l->id);
+    }
+
+    write_stringz(&c->out, "R");
+    write_stringz(&c->out, token);
+    write_errno(&c->out, err);
+    write_stream(&c->out, MARKER_EOM);
+}
+
 static void command_setm(char * token, Channel * c) {
     int i = 0;
-    char tmp[256];
+    unsigned data_size = 0;
+    size_t size = 0;
+    char * data = NULL;
+    SetmArgs * args = NULL;
     JsonReadBinaryState state;
     int err = read_location_list(&c->inp);
     if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+
+    for (i = 0; i < buf_pos; i++) data_size += buf[i].size;
+    size = sizeof(SetmArgs) + sizeof(Location) * buf_pos + data_size;
+    args = (SetmArgs *)tmp_alloc_zero(size);
+    args->cnt = buf_pos;
+    args->data_size = data_size;
+    memcpy(args + 1, buf, sizeof(Location) * buf_pos);
+    data = (char *)((Location *)(args + 1) + buf_pos);
+
     json_read_binary_start(&state, &c->inp);
     for (i = 0; i < buf_pos; i++) {
         unsigned rd_done = 0;
         Location * l = buf + i;
-        char * data = (char *)&l->ctx->regs + l->idx->regOff + l->offs;
         while (rd_done < l->size) {
-            int rd = json_read_binary_data(&state, err ? tmp : (data + rd_done), l->size - rd_done);
+            int rd = json_read_binary_data(&state, data + rd_done, l->size - rd_done);
             if (rd == 0) break;
             rd_done += rd;
         }
-        if (!err) send_event_register_changed(c, l->id);
+        data += l->size;
     }
     json_read_binary_end(&state);
     if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
     if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
 
-    write_stringz(&c->out, "R");
-    write_stringz(&c->out, token);
-    write_errno(&c->out, err);
-    write_stream(&c->out, MARKER_EOM);
+    if (err) {
+        write_stringz(&c->out, "R");
+        write_stringz(&c->out, token);
+        write_errno(&c->out, err);
+        write_stream(&c->out, MARKER_EOM);
+    }
+    else {
+        post_safe_command(c, token, buf_pos > 0 ? buf[0].ctx : NULL, setm_command, args, size);
+    }
 }
 
 static void read_filter_attrs(InputStream * inp, char * nm, void * arg) {
-    loc_free(json_skip_object(inp));
+    json_skip_object(inp);
 }
 
 static void command_search(char * token, Channel * c) {
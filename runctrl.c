@@ -57,18 +57,31 @@
 #define STOP_ALL_TIMEOUT 1000000
 #define STOP_ALL_MAX_CNT 20
 
+#define CONTAINER_SUSPEND_TIMEOUT 1000000
+
 static const char RUN_CONTROL[] = "RunControl";
 static TCFSuspendGroup * suspend_group = NULL;
 
 typedef struct SafeEvent SafeEvent;
+typedef struct SafeEventQueue SafeEventQueue;
 
 struct SafeEvent {
-    pid_t mem;
     EventCallBack * done;
     void * arg;
     SafeEvent * next;
 };
 
+/* Safe events of one memory space, 'mem' = 0 means all memory spaces */
+struct SafeEventQueue {
+    LINK link_all;
+    pid_t mem;
+    SafeEvent * first;
+    SafeEvent * last;
+    uintptr_t generation;
+};
+
+#define link_all2seq(A) ((SafeEventQueue *)((char *)(A) - offsetof(SafeEventQueue, link_all)))
+
 typedef struct GetContextArgs GetContextArgs;
 
 struct GetContextArgs {
@@ -78,9 +91,35 @@ struct GetContextArgs {
     pid_t parent;
 };
 
-static SafeEvent * safe_event_list = NULL;
-static int safe_event_pid_count = 0;
+/* Command that waits for earlier safe events of the context memory space, see post_safe_command() */
+typedef struct SafeCommand {
+    Channel * c;
+    char token[256];
+    SafeCommandCallBack * done;
+    void * args;
+} SafeCommand;
+
+typedef struct ResumeArgs {
+    char id[256];
+    long mode;
+    long count;
+} ResumeArgs;
+
+/* Suspend of all threads of a process, the threads are reported in one containerSuspended event */
+typedef struct ContainerSuspend {
+    LINK link_all;
+    Context * ctx;
+    TCFBroadcastGroup * bcg;
+    uintptr_t generation;
+} ContainerSuspend;
+
+#define link_all2cs(A) ((ContainerSuspend *)((char *)(A) - offsetof(ContainerSuspend, link_all)))
+
+static LINK safe_event_queues;
+static LINK container_suspends;
+static MemPool * safe_event_pool = NULL;
 static uintptr_t safe_event_generation = 0;
+static uintptr_t container_suspend_generation = 0;
 
 #if !defined(WIN32) && !defined(_WRS_KERNEL)
 static char * get_executable(pid_t pid) {
@@ -147,6 +186,17 @@ static void write_context(OutputStream * out, Context * ctx, int is_thread) {
         write_stream(out, ':');
         json_write_boolean(out, 1);
     }
+    else {
+        write_stream(out, ',');
+        json_write_string(out, "CanSuspend");
+        write_stream(out, ':');
+        json_write_boolean(out, 1);
+
+        write_stream(out, ',');
+        json_write_string(out, "CanResume");
+        write_stream(out, ':');
+        json_write_long(out, 1 << RM_RESUME);
+    }
 
 #ifdef WIN32
     if (!is_thread)
@@ -161,7 +211,11 @@ static void write_context(OutputStream * out, Context * ctx, int is_thread) {
     write_stream(out, '}');
 }
 
-static void write_context_state(OutputStream * out, Context * ctx) {
+/*
+ * Write PC, suspend reason and state params of 'ctx'.
+ * If 'arr' is not NULL, params include PCs of the 'cnt' suspended contexts of a container.
+ */
+static void write_context_state(OutputStream * out, Context * ctx, Context ** arr, int cnt) {
     int fst = 1;
     assert(!ctx->exited);
 
@@ -194,7 +248,7 @@ static void write_context_state(OutputStream * out, Context * ctx) {
         }
         fst = 0;
     }
-    if (ctx->stopped_by_bp && ctx->bp_ids != NULL && ctx->bp_ids[0] != NULL) {
+    if ((ctx->stopped_by_bp || ctx->stopped_by_wp) && ctx->bp_ids != NULL && ctx->bp_ids[0] != NULL) {
         int i = 0;
         if (!fst) write_stream(out, ',');
         json_write_string(out, "BPs");
@@ -207,6 +261,22 @@ static void write_context_state(OutputStream * out, Context * ctx) {
         write_stream(out, ']');
         fst = 0;
     }
+    if (arr != NULL) {
+        int i;
+        if (!fst) write_stream(out, ',');
+        json_write_string(out, "PCs");
+        write_stream(out, ':');
+        write_stream(out, '{');
+        for (i = 0; i < cnt; i++) {
+            if (i > 0) write_stream(out, ',');
+            json_write_string(out, thread_id(arr[i]));
+            write_stream(out, ':');
+            if (arr[i]->regs_error) write_string(out, "null");
+            else json_write_ulong(out, get_regs_PC(arr[i]->regs));
+        }
+        write_stream(out, '}');
+        fst = 0;
+    }
     write_stream(out, '}');
     write_stream(out, 0);
 }
@@ -356,7 +426,7 @@ static void command_get_state(char * token, Channel * c) {
         write_stringz(&c->out, "null");
     }
     else {
-        write_context_state(&c->out, ctx);
+        write_context_state(&c->out, ctx, NULL, 0);
     }
 
     write_stream(&c->out, MARKER_EOM);
@@ -370,87 +440,248 @@ static void send_simple_result(Channel * c, char * token, int err) {
 }
 
 static void send_event_context_resumed(OutputStream * out, Context * ctx);
+static Context ** get_intercepted_threads(Context * ctx, int * cnt);
+static void send_event_container_resumed(OutputStream * out, Context ** arr, int cnt);
+static ContainerSuspend * find_container_suspend(Context * ctx);
+static void end_container_suspend(ContainerSuspend * cs, OutputStream * out);
+static int is_safe_event_pending(pid_t mem);
+
+static int resume_container(TCFBroadcastGroup * bcg, Context * ctx) {
+    int i;
+    int cnt = 0;
+    int err = 0;
+    Context ** arr = get_intercepted_threads(ctx, &cnt);
+
+    if (cnt == 0) {
+        err = ERR_ALREADY_RUNNING;
+    }
+    else {
+        for (i = 0; i < cnt; i++) {
+            if (arr[i]->regs_error) err = arr[i]->regs_error;
+        }
+    }
+    if (err == 0) {
+        send_event_container_resumed(&bcg->out, arr, cnt);
+        for (i = 0; i < cnt; i++) {
+            /* A thread can be stepping over a removed breakpoint, others are continued
+             * after the breakpoint is restored, see continue_temporary_stopped() */
+            if (is_safe_event_pending(arr[i]->mem)) continue;
+            if (context_continue(arr[i]) < 0) err = errno;
+        }
+    }
+    loc_free(arr);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
 
 static void resume_params_callback(InputStream * inp, char * name, void * args) {
     int * err = (int *)args;
     /* Current agent implementation does not support resume parameters */
-    loc_free(json_skip_object(inp));
+    json_skip_object(inp);
     *err = ERR_UNSUPPORTED;
 }
 
+static void event_safe_command(void * arg) {
+    SafeCommand * cmd = (SafeCommand *)arg;
+    Channel * c = cmd->c;
+
+    if (!is_stream_closed(c)) {
+        cmd->done(c, cmd->token, cmd->args);
+        flush_stream(&c->out);
+    }
+    stream_unlock(c);
+    loc_free(cmd);
+}
+
+/*
+ * Safe events of a memory space run after all its threads are stopped, while incoming messages are
+ * still handled. A command that changes run state or registers of the memory space must not overtake them,
+ * so it is posted as a safe event of the same queue.
+ */
+void post_safe_command(Channel * c, char * token, Context * ctx, SafeCommandCallBack * done, void * args, size_t size) {
+    SafeCommand * cmd = NULL;
+
+    if (ctx == NULL || !is_safe_event_pending(ctx->mem)) {
+        done(c, token, args);
+        return;
+    }
+    /* Arguments are copied right after the command */
+    cmd = (SafeCommand *)loc_alloc_zero(sizeof(SafeCommand) + size);
+    cmd->c = c;
+    strncpy(cmd->token, token, sizeof(cmd->token) - 1);
+    cmd->done = done;
+    cmd->args = cmd + 1;
+    memcpy(cmd->args, args, size);
+    stream_lock(c);
+    post_safe_event(ctx->mem, event_safe_command, cmd);
+}
+
+static void resume_command(Channel * c, char * token, void * x) {
+    ResumeArgs * args = (ResumeArgs *)x;
+    char * id = args->id;
+    long mode = args->mode;
+    long count = args->count;
+    Context * ctx = id2ctx(id);
+    ContainerSuspend * cs = NULL;
+    pid_t parent = 0;
+    int err = 0;
+
+    id2pid(id, &parent);
+    /* Threads of a pending container suspend are reported before any of them is resumed */
+    if (ctx != NULL && (cs = find_container_suspend(ctx)) != NULL) end_container_suspend(cs, &c->bcg->out);
+    if (ctx == NULL) {
+        err = ERR_INV_CONTEXT;
+    }
+    else if (ctx->parent == NULL && parent == 0) {
+        /* Container: resume all intercepted threads of the process */
+        if (mode != RM_RESUME || count != 1) err = EINVAL;
+        else if (resume_container(c->bcg, ctx) < 0) err = errno;
+    }
+    else if (ctx->exited) {
+        err = ERR_ALREADY_EXITED;
+    }
+    else if (!ctx->intercepted) {
+        err = ERR_ALREADY_RUNNING;
+    }
+    else if (ctx->regs_error) {
+        err = ctx->regs_error;
+    }
+    else if (count != 1) {
+        err = EINVAL;
+    }
+    else if (mode == RM_RESUME || mode == RM_STEP_INTO) {
+        send_event_context_resumed(&c->bcg->out, ctx);
+        if (mode == RM_STEP_INTO) {
+            if (context_single_step(ctx) < 0) {
+                err = errno;
+            }
+            else {
+                ctx->pending_intercept = 1;
+            }
+        }
+        else if (context_continue(ctx) < 0) {
+            err = errno;
+        }
+    }
+    else {
+        err = EINVAL;
+    }
+    send_simple_result(c, token, err);
+}
+
 static void command_resume(char * token, Channel * c) {
-    char id[256];
-    long mode;
-    long count;
-    Context * ctx;
+    ResumeArgs args;
     int err = 0;
 
-    json_read_string(&c->inp, id, sizeof(id));
+    memset(&args, 0, sizeof(args));
+    json_read_string(&c->inp, args.id, sizeof(args.id));
     if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-    mode = json_read_long(&c->inp);
+    args.mode = json_read_long(&c->inp);
     if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-    count = json_read_long(&c->inp);
+    args.count = json_read_long(&c->inp);
     if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
     if (peek_stream(&c->inp) != MARKER_EOM) {
         json_read_struct(&c->inp, resume_params_callback, &err);
         if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
     }
     if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
-    if (err == 0) {
-        ctx = id2ctx(id);
-        assert(safe_event_list == NULL);
-
-        if (ctx == NULL) {
-            err = ERR_INV_CONTEXT;
-        }
-        else if (ctx->exited) {
-            err = ERR_ALREADY_EXITED;
-        }
-        else if (!ctx->intercepted) {
-            err = ERR_ALREADY_RUNNING;
-        }
-        else if (ctx->regs_error) {
-            err = ctx->regs_error;
-        }
-        else if (count != 1) {
-            err = EINVAL;
-        }
-        else if (mode == RM_RESUME || mode == RM_STEP_INTO) {
-            send_event_context_resumed(&c->bcg->out, ctx);
-            if (mode == RM_STEP_INTO) {
-                if (context_single_step(ctx) < 0) {
-                    err = errno;
-                }
-                else {
-                    ctx->pending_intercept = 1;
-                }
-            }
-            else if (context_continue(ctx) < 0) {
-                err = errno;
-            }
-        }
-        else {
-            err = EINVAL;
-        }
+    if (err != 0) {
+        send_simple_result(c, token, err);
+    }
+    else {
+        post_safe_command(c, token, id2ctx(args.id), resume_command, &args, sizeof(args));
     }
-    send_simple_result(c, token, err);
 }
 
 static void send_event_context_suspended(OutputStream * out, Context * ctx);
+static void intercept_context(Context * ctx);
+static void check_container_suspended(ContainerSuspend * cs, OutputStream * out);
 
-static void command_suspend(char * token, Channel * c) {
-    char id[256];
-    Context * ctx;
+/* Threads that did not stop in time are reported one by one when they stop */
+static void container_suspend_timeout(void * arg) {
+    LINK * qp;
+    for (qp = container_suspends.next; qp != &container_suspends; qp = qp->next) {
+        ContainerSuspend * cs = link_all2cs(qp);
+        if (cs->generation != (uintptr_t)arg) continue;
+        trace(LOG_CONTEXT, "Not all threads of pid %d are suspended, reporting the stopped ones", cs->ctx->pid);
+        end_container_suspend(cs, &cs->bcg->out);
+        return;
+    }
+}
+
+static int suspend_thread(Context * ctx) {
+    if (ctx->exited || ctx->intercepted) return 0;
+    ctx->pending_intercept = 1;
+    if (ctx->stopped) return 0;
+    return context_stop(ctx);
+}
+
+static int suspend_container(TCFBroadcastGroup * bcg, Context * ctx) {
+    LINK * qp;
+    int cnt = 0;
     int err = 0;
+    ContainerSuspend * cs = NULL;
 
-    json_read_string(&c->inp, id, sizeof(id));
-    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
-    if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
-    ctx = id2ctx(id);
+    for (qp = container_suspends.next; qp != &container_suspends; qp = qp->next) {
+        if (link_all2cs(qp)->ctx == ctx) return 0;
+    }
+    if (!ctx->exited && !ctx->intercepted) cnt++;
+    for (qp = ctx->children.next; qp != &ctx->children; qp = qp->next) {
+        if (!cldl2ctxp(qp)->intercepted) cnt++;
+    }
+    if (cnt == 0) {
+        errno = ctx->exited ? ERR_ALREADY_EXITED : ERR_ALREADY_STOPPED;
+        return -1;
+    }
+    if (suspend_thread(ctx) < 0) err = errno;
+    for (qp = ctx->children.next; qp != &ctx->children; qp = qp->next) {
+        if (suspend_thread(cldl2ctxp(qp)) < 0 && err == 0) err = errno;
+    }
+    if (err) {
+        /* Some threads cannot be stopped: no container event, threads are reported one by one */
+        if (!ctx->exited && ctx->stopped && !ctx->intercepted) send_event_context_suspended(&bcg->out, ctx);
+        for (qp = ctx->children.next; qp != &ctx->children; qp = qp->next) {
+            Context * c = cldl2ctxp(qp);
+            if (!c->exited && c->stopped && !c->intercepted) send_event_context_suspended(&bcg->out, c);
+        }
+        flush_stream(&bcg->out);
+        errno = err;
+        return -1;
+    }
+    /* Threads are reported when all of them are intercepted, see event_context_stopped() */
+    cs = (ContainerSuspend *)loc_alloc_zero(sizeof(ContainerSuspend));
+    cs->ctx = ctx;
+    cs->bcg = bcg;
+    cs->generation = ++container_suspend_generation;
+    context_lock(ctx);
+    list_add_last(&cs->link_all, &container_suspends);
+    post_event_with_delay(container_suspend_timeout, (void *)cs->generation, CONTAINER_SUSPEND_TIMEOUT);
+    if (!ctx->exited && ctx->stopped && !ctx->intercepted) intercept_context(ctx);
+    for (qp = ctx->children.next; qp != &ctx->children; qp = qp->next) {
+        Context * c = cldl2ctxp(qp);
+        if (!c->exited && c->stopped && !c->intercepted) intercept_context(c);
+    }
+    check_container_suspended(cs, &bcg->out);
+    return 0;
+}
+
+static void suspend_command(Channel * c, char * token, void * args) {
+    char * id = (char *)args;
+    Context * ctx = id2ctx(id);
+    pid_t parent = 0;
+    int err = 0;
 
+    id2pid(id, &parent);
     if (ctx == NULL) {
         err = ERR_INV_CONTEXT;
     }
+    else if (ctx->parent == NULL && parent == 0) {
+        /* Container: suspend all threads of the process */
+        if (suspend_container(c->bcg, ctx) < 0) err = errno;
+    }
     else if (ctx->exited) {
         err = ERR_ALREADY_EXITED;
     }
@@ -468,6 +699,16 @@ static void command_suspend(char * token, Channel * c) {
     send_simple_result(c, token, err);
 }
 
+static void command_suspend(char * token, Channel * c) {
+    char id[256];
+
+    json_read_string(&c->inp, id, sizeof(id));
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
+
+    post_safe_command(c, token, id2ctx(id), suspend_command, id, sizeof(id));
+}
+
 typedef struct TerminateArgs {
     Context * ctx;
     TCFBroadcastGroup * bcg;
@@ -477,15 +718,20 @@ static void event_terminate(void * x) {
     TerminateArgs * args = (TerminateArgs *)x;
     Context * ctx = args->ctx;
     TCFBroadcastGroup * bcg = args->bcg;
+    ContainerSuspend * cs = find_container_suspend(ctx);
+    int cnt = 0;
+    Context ** arr = NULL;
     LINK * qp = ctx->children.next;
+    if (cs != NULL) end_container_suspend(cs, &bcg->out);
+    arr = get_intercepted_threads(ctx, &cnt);
+    if (cnt > 0) send_event_container_resumed(&bcg->out, arr, cnt);
+    loc_free(arr);
     while (qp != &ctx->children) {
         Context * c = cldl2ctxp(qp);
-        if (c->intercepted) send_event_context_resumed(&bcg->out, c);
         c->pending_intercept = 0;
         c->pending_signals |= 1 << SIGKILL;
         qp = qp->next;
     }
-    if (ctx->intercepted) send_event_context_resumed(&bcg->out, ctx);
     ctx->pending_intercept = 0;
     ctx->pending_signals |= 1 << SIGKILL;
     context_unlock(ctx);
@@ -514,17 +760,22 @@ int terminate_debug_context(TCFBroadcastGroup * bcg, Context * ctx) {
     return 0;
 }
 
+static void terminate_command(Channel * c, char * token, void * args) {
+    int err = 0;
+
+    if (terminate_debug_context(c->bcg, id2ctx((char *)args)) != 0) err = errno;
+
+    send_simple_result(c, token, err);
+}
+
 static void command_terminate(char * token, Channel * c) {
     char id[256];
-    int err = 0;
 
     json_read_string(&c->inp, id, sizeof(id));
     if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
     if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
 
-    if (terminate_debug_context(c->bcg, id2ctx(id)) != 0) err = errno;
-
-    send_simple_result(c, token, err);
+    post_safe_command(c, token, id2ctx(id), terminate_command, id, sizeof(id));
 }
 
 static void send_event_context_added(OutputStream * out, Context * ctx) {
@@ -585,12 +836,16 @@ static void send_event_context_removed(OutputStream * out, Context * ctx) {
     write_stream(out, MARKER_EOM);
 }
 
-static void send_event_context_suspended(OutputStream * out, Context * ctx) {
+static void intercept_context(Context * ctx) {
     assert(!ctx->exited);
     assert(!ctx->intercepted);
     ctx->intercepted = 1;
     ctx->pending_intercept = 0;
     ctx->pending_step = 0;
+}
+
+static void write_event_context_suspended(OutputStream * out, Context * ctx) {
+    assert(ctx->intercepted);
 
     write_stringz(out, "E");
     write_stringz(out, RUN_CONTROL);
@@ -600,7 +855,37 @@ static void send_event_context_suspended(OutputStream * out, Context * ctx) {
     json_write_string(out, thread_id(ctx));
     write_stream(out, 0);
 
-    write_context_state(out, ctx);
+    write_context_state(out, ctx, NULL, 0);
+    write_stream(out, MARKER_EOM);
+}
+
+static void send_event_context_suspended(OutputStream * out, Context * ctx) {
+    intercept_context(ctx);
+    write_event_context_suspended(out, ctx);
+}
+
+static void send_event_container_suspended(OutputStream * out, Context * ctx, Context ** arr, int cnt) {
+    int i;
+
+    write_stringz(out, "E");
+    write_stringz(out, RUN_CONTROL);
+    write_stringz(out, "containerSuspended");
+
+    /* String: ID of the context that caused the suspend */
+    json_write_string(out, thread_id(ctx));
+    write_stream(out, 0);
+
+    write_context_state(out, ctx, arr, cnt);
+
+    /* <array of suspended context IDs> */
+    write_stream(out, '[');
+    for (i = 0; i < cnt; i++) {
+        if (i > 0) write_stream(out, ',');
+        json_write_string(out, thread_id(arr[i]));
+    }
+    write_stream(out, ']');
+    write_stream(out, 0);
+
     write_stream(out, MARKER_EOM);
 }
 
@@ -620,6 +905,35 @@ static void send_event_context_resumed(OutputStream * out, Context * ctx) {
     write_stream(out, MARKER_EOM);
 }
 
+static void send_event_container_resumed(OutputStream * out, Context ** arr, int cnt) {
+    int i;
+
+    assert(cnt > 0);
+    if (cnt == 1) {
+        send_event_context_resumed(out, arr[0]);
+        return;
+    }
+
+    write_stringz(out, "E");
+    write_stringz(out, RUN_CONTROL);
+    write_stringz(out, "containerResumed");
+
+    /* <array of resumed context IDs> */
+    write_stream(out, '[');
+    for (i = 0; i < cnt; i++) {
+        Context * ctx = arr[i];
+        assert(ctx->intercepted);
+        assert(!ctx->pending_intercept);
+        ctx->intercepted = 0;
+        if (i > 0) write_stream(out, ',');
+        json_write_string(out, thread_id(ctx));
+    }
+    write_stream(out, ']');
+    write_stream(out, 0);
+
+    write_stream(out, MARKER_EOM);
+}
+
 static void send_event_context_exception(OutputStream * out, Context * ctx) {
     char buf[128];
 
@@ -639,6 +953,75 @@ static void send_event_context_exception(OutputStream * out, Context * ctx) {
     write_stream(out, MARKER_EOM);
 }
 
+/* Get intercepted threads of 'ctx' and its children, the array should be freed by caller */
+static Context ** get_intercepted_threads(Context * ctx, int * cnt) {
+    LINK * qp;
+    int n = 1;
+    Context ** arr = NULL;
+
+    for (qp = ctx->children.next; qp != &ctx->children; qp = qp->next) n++;
+    arr = (Context **)loc_alloc(sizeof(Context *) * n);
+    *cnt = 0;
+    if (!ctx->exited && ctx->intercepted) arr[(*cnt)++] = ctx;
+    for (qp = ctx->children.next; qp != &ctx->children; qp = qp->next) {
+        Context * c = cldl2ctxp(qp);
+        if (!c->exited && c->intercepted) arr[(*cnt)++] = c;
+    }
+    return arr;
+}
+
+static ContainerSuspend * find_container_suspend(Context * ctx) {
+    LINK * qp;
+    if (ctx->parent != NULL) ctx = ctx->parent;
+    for (qp = container_suspends.next; qp != &container_suspends; qp = qp->next) {
+        ContainerSuspend * cs = link_all2cs(qp);
+        if (cs->ctx == ctx) return cs;
+    }
+    return NULL;
+}
+
+/*
+ * Report intercepted threads of a container suspend in one event and remove the suspend.
+ * Threads that are not intercepted yet keep pending_intercept and are reported one by one.
+ */
+static void end_container_suspend(ContainerSuspend * cs, OutputStream * out) {
+    int i;
+    int cnt = 0;
+    Context * ctx = cs->ctx;
+    Context ** arr = get_intercepted_threads(ctx, &cnt);
+
+    if (cnt > 0) {
+        /* Report a thread stopped by breakpoint as the cause of the suspend, if any */
+        ctx = arr[0];
+        for (i = 0; i < cnt; i++) {
+            if (arr[i]->stopped_by_bp || arr[i]->stopped_by_wp) {
+                ctx = arr[i];
+                break;
+            }
+        }
+        if (cnt == 1) write_event_context_suspended(out, ctx);
+        else send_event_container_suspended(out, ctx, arr, cnt);
+        flush_stream(out);
+    }
+    loc_free(arr);
+    list_remove(&cs->link_all);
+    context_unlock(cs->ctx);
+    loc_free(cs);
+}
+
+/* Send one event for all threads of the process when the last of them is intercepted */
+static void check_container_suspended(ContainerSuspend * cs, OutputStream * out) {
+    LINK * qp;
+    Context * ctx = cs->ctx;
+
+    if (!ctx->exited && !ctx->intercepted) return;
+    for (qp = ctx->children.next; qp != &ctx->children; qp = qp->next) {
+        Context * c = cldl2ctxp(qp);
+        if (!c->exited && !c->intercepted) return;
+    }
+    end_container_suspend(cs, out);
+}
+
 int is_all_stopped(pid_t mem) {
     LINK * qp;
     for (qp = context_root.next; qp != &context_root; qp = qp->next) {
@@ -648,17 +1031,48 @@ int is_all_stopped(pid_t mem) {
         if (mem > 0 && ctx->mem != mem) continue;
         if (!ctx->stopped) return 0;
     }
-    return are_channels_suspended(suspend_group);
+    return 1;
+}
+
+/* Return 1 if safe events are waiting for contexts of memory space 'mem' to be stopped */
+static int is_safe_event_pending(pid_t mem) {
+    LINK * l;
+    for (l = safe_event_queues.next; l != &safe_event_queues; l = l->next) {
+        SafeEventQueue * q = link_all2seq(l);
+        if (q->mem == 0 || q->mem == mem) return 1;
+    }
+    return 0;
+}
+
+int is_safe_event_ready(pid_t mem) {
+    return !is_safe_event_pending(mem) && is_all_stopped(mem);
+}
+
+static SafeEventQueue * find_safe_event_queue(uintptr_t generation) {
+    LINK * l;
+    for (l = safe_event_queues.next; l != &safe_event_queues; l = l->next) {
+        SafeEventQueue * q = link_all2seq(l);
+        if (q->generation == generation) return q;
+    }
+    return NULL;
+}
+
+static void run_safe_events(void * arg);
+
+static void post_safe_event_queue(SafeEventQueue * q, unsigned long delay) {
+    q->generation = ++safe_event_generation;
+    if (delay > 0) post_event_with_delay(run_safe_events, (void *)q->generation, delay);
+    else post_event(run_safe_events, (void *)q->generation);
 }
 
 static void continue_temporary_stopped(void * arg) {
     LINK * qp;
 
-    if ((uintptr_t)arg != safe_event_generation) return;
-    assert(safe_event_list == NULL);
-
+    /* Channels are suspended while a safe event for all memory spaces is pending,
+     * run_safe_events() posts this function again when it resumes them */
+    if (are_channels_suspended(suspend_group)) return;
     if (channels_get_message_count(suspend_group) > 0) {
-        post_event(continue_temporary_stopped, (void *)safe_event_generation);
+        post_event(continue_temporary_stopped, NULL);
         return;
     }
 
@@ -667,31 +1081,26 @@ static void continue_temporary_stopped(void * arg) {
         if (ctx->exited) continue;
         if (!ctx->stopped) continue;
         if (ctx->intercepted) continue;
+        if (!ctx->exiting && is_safe_event_pending(ctx->mem)) continue;
         context_continue(ctx);
     }
 }
 
 static void run_safe_events(void * arg) {
     LINK * qp;
-    pid_t mem;
-
-    if ((uintptr_t)arg != safe_event_generation) return;
-    assert(safe_event_list != NULL);
-    assert(are_channels_suspended(suspend_group));
+    int cnt = 0;
+    SafeEventQueue * q = find_safe_event_queue((uintptr_t)arg);
 
-    safe_event_pid_count = 0;
-    mem = safe_event_list->mem;
+    if (q == NULL) return;
+    assert(q->first != NULL);
 
     for (qp = context_root.next; qp != &context_root; qp = qp->next) {
         Context * ctx = ctxl2ctxp(qp);
+        if (q->mem > 0 && ctx->mem != q->mem) continue;
         if (ctx->exited || ctx->exiting || ctx->stopped || !context_has_state(ctx)) {
             ctx->pending_safe_event = 0;
             continue;
         }
-        if (mem > 0 && ctx->mem != mem) {
-            ctx->pending_safe_event = 0;
-            continue;
-        }
         if (!ctx->pending_step || ctx->pending_safe_event >= STOP_ALL_MAX_CNT / 2) {
             if (context_stop(ctx) < 0) {
                 int error = errno;
@@ -717,24 +1126,20 @@ static void run_safe_events(void * arg) {
         }
         else {
             ctx->pending_safe_event++;
-            safe_event_pid_count++;
+            cnt++;
         }
     }
 
-    while (safe_event_list) {
+    while (q->first) {
         Trap trap;
-        SafeEvent * i = safe_event_list;
-        assert((uintptr_t)arg == safe_event_generation);
-        if (safe_event_pid_count > 0) {
-            post_event_with_delay(run_safe_events, (void *)++safe_event_generation, STOP_ALL_TIMEOUT);
+        SafeEvent * i = q->first;
+        assert((uintptr_t)arg == q->generation);
+        if (cnt > 0 || !is_all_stopped(q->mem)) {
+            post_safe_event_queue(q, STOP_ALL_TIMEOUT);
             return;
         }
-        if (mem > 0 && i->mem != mem) {
-            post_event(run_safe_events, (void *)++safe_event_generation);
-            return;
-        }
-        assert(is_all_stopped(i->mem));
-        safe_event_list = i->next;
+        q->first = i->next;
+        if (q->first == NULL) q->last = NULL;
         if (set_trap(&trap)) {
             i->done(i->arg);
             clear_trap(&trap);
@@ -743,44 +1148,60 @@ static void run_safe_events(void * arg) {
             trace(LOG_ALWAYS, "Unhandled exception in \"safe\" event dispatch: %d %s",
                   trap.error, errno_to_str(trap.error));
         }
-        loc_free(i);
-        if ((uintptr_t)arg != safe_event_generation) return;
+        tmp_gc();
+        pool_free(safe_event_pool, i);
+        if ((uintptr_t)arg != q->generation) return;
     }
 
-    channels_resume(suspend_group);
-    cmdline_resume();
+    list_remove(&q->link_all);
+    if (q->mem == 0) {
+        channels_resume(suspend_group);
+        cmdline_resume();
+    }
+    loc_free(q);
     /* Lazily continue execution of temporary stopped contexts */
-    post_event(continue_temporary_stopped, (void *)safe_event_generation);
+    post_event(continue_temporary_stopped, NULL);
 }
 
 static void check_safe_events(Context * ctx) {
+    LINK * l;
     assert(ctx->stopped || ctx->exited);
     assert(ctx->pending_safe_event);
-    assert(safe_event_list != NULL);
-    assert(safe_event_pid_count > 0);
     ctx->pending_safe_event = 0;
-    safe_event_pid_count--;
-    if (safe_event_pid_count == 0) {
-        post_event(run_safe_events, (void *)++safe_event_generation);
+    for (l = safe_event_queues.next; l != &safe_event_queues; l = l->next) {
+        SafeEventQueue * q = link_all2seq(l);
+        if (q->mem != 0 && q->mem != ctx->mem) continue;
+        if (is_all_stopped(q->mem)) post_safe_event_queue(q, 0);
     }
 }
 
 void post_safe_event(int mem, EventCallBack * done, void * arg) {
-    SafeEvent * i = (SafeEvent *)loc_alloc(sizeof(SafeEvent));
-    i->mem = mem;
+    LINK * l;
+    SafeEventQueue * q = NULL;
+    SafeEvent * i = (SafeEvent *)pool_alloc(safe_event_pool);
     i->done = done;
     i->arg = arg;
-    if (safe_event_list == NULL) {
-        assert(safe_event_pid_count == 0);
-        if (!are_channels_suspended(suspend_group)) {
+    i->next = NULL;
+    for (l = safe_event_queues.next; l != &safe_event_queues; l = l->next) {
+        if (link_all2seq(l)->mem == mem) {
+            q = link_all2seq(l);
+            break;
+        }
+    }
+    if (q == NULL) {
+        q = (SafeEventQueue *)loc_alloc_zero(sizeof(SafeEventQueue));
+        q->mem = mem;
+        list_add_last(&q->link_all, &safe_event_queues);
+        if (mem == 0) {
+            /* Stopping all memory spaces also suspends handling of incoming messages */
             channels_suspend(suspend_group);
             cmdline_suspend();
-            post_event(run_safe_events, (void *)++safe_event_generation);
         }
+        post_safe_event_queue(q, 0);
     }
-    assert(are_channels_suspended(suspend_group));
-    i->next = safe_event_list;
-    safe_event_list = i;
+    if (q->last == NULL) q->first = i;
+    else q->last->next = i;
+    q->last = i;
 }
 
 static void event_context_created(Context * ctx, void * client_data) {
@@ -801,49 +1222,59 @@ static void event_context_changed(Context * ctx, void * client_data) {
 
 static void event_context_stopped(Context * ctx, void * client_data) {
     TCFBroadcastGroup * bcg = client_data;
+    ContainerSuspend * cs = NULL;
 
     assert(ctx->stopped);
     assert(!ctx->intercepted);
     assert(!ctx->exited);
     if (ctx->pending_safe_event) check_safe_events(ctx);
-    if (ctx->pending_signals != 0) {
+    if ((ctx->pending_signals & ~ctx->sig_resent) != 0) {
+        /* A re-sent signal stops the thread again only to be delivered, it is not reported twice */
         send_event_context_exception(&bcg->out, ctx);
     }
-    if (ctx->pending_intercept) {
+    if ((cs = find_container_suspend(ctx)) != NULL) {
+        /* All threads of the process are being suspended, they are reported together */
+        intercept_context(ctx);
+        check_container_suspended(cs, &bcg->out);
+    }
+    else if (ctx->pending_intercept) {
         send_event_context_suspended(&bcg->out, ctx);
         flush_stream(&bcg->out);
     }
-    if (!ctx->intercepted && safe_event_list == NULL) {
+    /* Exiting threads are not waited for by safe events, and other threads of the process
+     * cannot finish exiting while they are stopped, so they are continued anyway */
+    if (!ctx->intercepted && (ctx->exiting || !is_safe_event_pending(ctx->mem))) {
         context_continue(ctx);
     }
 }
 
 static void event_context_started(Context * ctx, void * client_data) {
     TCFBroadcastGroup * bcg = client_data;
+    ContainerSuspend * cs = NULL;
 
     assert(!ctx->stopped);
     if (ctx->intercepted) {
+        if ((cs = find_container_suspend(ctx)) != NULL) end_container_suspend(cs, &bcg->out);
         send_event_context_resumed(&bcg->out, ctx);
     }
-    if (safe_event_list) {
+    if (!ctx->exiting && is_safe_event_pending(ctx->mem)) {
         if (!ctx->pending_step) {
             context_stop(ctx);
         }
-        if (!ctx->pending_safe_event) {
-            ctx->pending_safe_event = 1;
-            safe_event_pid_count++;
-        }
+        ctx->pending_safe_event = 1;
     }
 }
 
 static void event_context_exited(Context * ctx, void * client_data) {
     TCFBroadcastGroup * bcg = client_data;
+    ContainerSuspend * cs = NULL;
 
     assert(!ctx->stopped);
     assert(!ctx->intercepted);
     if (ctx->pending_safe_event) check_safe_events(ctx);
     send_event_context_removed(&bcg->out, ctx);
     flush_stream(&bcg->out);
+    if ((cs = find_container_suspend(ctx)) != NULL) check_container_suspended(cs, &bcg->out);
 }
 
 void ini_run_ctrl_service(Protocol * proto, TCFBroadcastGroup * bcg, TCFSuspendGroup * spg) {
@@ -855,6 +1286,9 @@ void ini_run_ctrl_service(Protocol * proto, TCFBroadcastGroup * bcg, TCFSuspendG
         event_context_changed
     };
     suspend_group = spg;
+    safe_event_pool = mem_pool_create("SafeEvent", sizeof(SafeEvent), 0);
+    list_init(&safe_event_queues);
+    list_init(&container_suspends);
     add_context_event_listener(&listener, bcg);
     add_command_handler(proto, RUN_CONTROL, "getContext", command_get_context);
     add_command_handler(proto, RUN_CONTROL, "getChildren", command_get_children);
@@ -26,11 +26,12 @@
 
 /*
  * Add "safe" event.
- * Temporary suspends handling of incoming messages and stops all debuggee threads.
- * Callback function 'done' will be called when everything is stopped and
+ * Temporary stops debuggee threads that belong to memory 'mem'.
+ * Callback function 'done' will be called when the threads are stopped and
  * it is safe to access debuggee memory, plant breakpoints, etc.
- * 'mem' is memory ID, only threads that belong to that memory are stopped.
- * if 'mem' = 0, stopp all threads.
+ * Each memory has its own queue of safe events, the events are called in the order they are posted,
+ * and threads of other memories are not stopped.
+ * if 'mem' = 0, stop all threads and temporary suspend handling of incoming messages.
  */
 #if SERVICE_RunControl
 extern void post_safe_event(int mem, EventCallBack * done, void * arg);
@@ -39,13 +40,43 @@ extern void post_safe_event(int mem, EventCallBack * done, void * arg);
 #endif
 
 /*
- * Return 1 if all threads in debuggee are stopped and handling of incoming messages
- * is suspended and it is safe to access debuggee memory, plant breakpoints, etc.
+ * Handler of a command that changes run state or registers of a debug context.
+ * 'args' points to command arguments, the handler writes the command result to channel 'c'.
+ */
+typedef void SafeCommandCallBack(Channel * c, char * token, void * args);
+
+/*
+ * Call command handler 'done' now if no safe events of the memory of 'ctx' are pending,
+ * otherwise post it as a safe event of that memory, so the command is executed after
+ * the commands that were received earlier and are waiting in the queue, like Memory.set.
+ * 'args' are copied, 'size' bytes, and must not contain pointers to data owned by the caller.
+ * 'ctx' can be NULL, then the handler is called now.
+ */
+#if SERVICE_RunControl
+extern void post_safe_command(Channel * c, char * token, Context * ctx,
+                              SafeCommandCallBack * done, void * args, size_t size);
+#else
+#define post_safe_command(c, token, ctx, done, args, size) (done)(c, token, args)
+#endif
+
+/*
+ * Return 1 if all threads in debuggee are stopped and
+ * it is safe to access debuggee memory, plant breakpoints, etc.
  * 'mem' is memory ID, only threads that belong to that memory are checked.
  * if 'mem' = 0, check all threads.
  */
 extern int is_all_stopped(pid_t mem);
 
+/*
+ * Return 1 if a safe event of memory 'mem' can be called right away instead of being posted:
+ * all threads of the memory are stopped and no safe events of the memory are waiting.
+ */
+#if SERVICE_RunControl
+extern int is_safe_event_ready(pid_t mem);
+#else
+#define is_safe_event_ready(mem) 0
+#endif
+
 /*
  * Terminate debug context - thread or process.
  * Returns 0 if no errors, otherwise returns -1 and sets errno.
@@ -583,7 +583,7 @@ static void command_get_context(char * token, Channel * c) {
     int id_cnt = 0;
     int i;
 
-    ids = json_read_alloc_string_array(&c->inp, &id_cnt);
+    ids = json_read_tmp_string_array(&c->inp, &id_cnt);
     if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
     if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
 
@@ -616,7 +616,6 @@ static void command_get_context(char * token, Channel * c) {
     write_stream(&c->out, 0);
     write_errno(&c->out, err);
     write_stream(&c->out, MARKER_EOM);
-    loc_free(ids);
 }
 
 static void command_get_children(char * token, Channel * c) {
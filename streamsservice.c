@@ -106,6 +106,8 @@ static LINK clients;
 static LINK streams;
 static LINK subscriptions;
 static unsigned id_cnt = 0;
+static MemPool * read_request_pool = NULL;
+static MemPool * write_request_pool = NULL;
 
 static unsigned get_client_hash(unsigned id, Channel * c) {
     return (id + (unsigned)(uintptr_t)c) % HANDLE_HASH_SIZE;
@@ -194,7 +196,7 @@ static void delete_read_request(ReadRequest * r) {
               trap.error, errno_to_str(trap.error));
     }
     list_remove(&r->link_client);
-    loc_free(r);
+    pool_free(read_request_pool, r);
 }
 
 static void delete_write_request(WriteRequest * r, int error) {
@@ -215,7 +217,7 @@ static void delete_write_request(WriteRequest * r, int error) {
     }
     list_remove(&r->link_client);
     loc_free(r->data);
-    loc_free(r);
+    pool_free(write_request_pool, r);
 }
 
 static void delete_stream(void * args) {
@@ -474,7 +476,7 @@ int virtual_stream_add_data(VirtualStream * stream, char * buf, size_t buf_size,
                     ReadRequest * r = client2read_request(client->read_requests.next);
                     list_remove(&r->link_client);
                     send_read_reply(client, r->token, r->size);
-                    loc_free(r);
+                    pool_free(read_request_pool, r);
                 }
             }
             advance_stream_buffer(stream);
@@ -546,6 +548,12 @@ int virtual_stream_is_empty(VirtualStream * stream) {
     return stream->buf_out == stream->buf_inp;
 }
 
+size_t virtual_stream_get_space(VirtualStream * stream) {
+    assert(stream->magic == STREAM_MAGIC);
+    if (stream->eos) return 0;
+    return (stream->buf_out + stream->buf_len - stream->buf_inp - 1) % stream->buf_len;
+}
+
 void virtual_stream_delete(VirtualStream * stream) {
     assert(stream->magic == STREAM_MAGIC);
     assert(!stream->deleted);
@@ -632,7 +640,7 @@ static void command_read(char * token, Channel * c) {
     if (err == 0) {
         VirtualStream * stream = client->stream;
         if (client->pos == stream->pos && !stream->eos) {
-            ReadRequest * r = loc_alloc_zero(sizeof(ReadRequest));
+            ReadRequest * r = (ReadRequest *)pool_alloc_zero(read_request_pool);
             list_init(&r->link_client);
             r->client = client;
             r->size = size;
@@ -713,7 +721,7 @@ static void command_write(char * token, Channel * c) {
     if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
 
     if (data != NULL) {
-        WriteRequest * r = loc_alloc_zero(sizeof(WriteRequest));
+        WriteRequest * r = (WriteRequest *)pool_alloc_zero(write_request_pool);
         list_init(&r->link_client);
         r->client = client;
         r->data = data;
@@ -743,7 +751,7 @@ static void command_eos(char * token, Channel * c) {
     client = find_client(id, c);
     if (client == NULL) err = errno;
     if (!err && (client->stream->access & VS_ENABLE_REMOTE_WRITE) == 0) err = ERR_UNSUPPORTED;
-    if (!err && !list_is_empty(&client->write_requests)) r = loc_alloc_zero(sizeof(WriteRequest));
+    if (!err && !list_is_empty(&client->write_requests)) r = (WriteRequest *)pool_alloc_zero(write_request_pool);
     if (!err && r == NULL && virtual_stream_add_data(client->stream, NULL, 0, &done, 1) < 0) err = errno;
 
     if (r != NULL) {
@@ -824,6 +832,8 @@ static void channel_close_listener(Channel * c) {
 void ini_streams_service(Protocol * proto) {
     int i;
 
+    read_request_pool = mem_pool_create("ReadRequest", sizeof(ReadRequest), 0);
+    write_request_pool = mem_pool_create("WriteRequest", sizeof(WriteRequest), 0);
     list_init(&clients);
     list_init(&streams);
     list_init(&subscriptions);
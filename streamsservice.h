@@ -42,6 +42,9 @@ extern int virtual_stream_add_data(VirtualStream * stream, char * buf, size_t bu
 extern int virtual_stream_get_data(VirtualStream * stream, char * buf, size_t buf_size, size_t * data_size, int * eos);
 extern int virtual_stream_is_empty(VirtualStream * stream);
 
+/* Return number of bytes that can be added to the stream buffer */
+extern size_t virtual_stream_get_space(VirtualStream * stream);
+
 /*
  * Initialize streams service.
  */
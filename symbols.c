@@ -121,11 +121,13 @@ static void command_get_context(char * token, Channel * c) {
                 json_write_long(&c->out, offset);
                 write_stream(&c->out, ',');
             }
+        }
 
+        if (sym.sym_class == SYM_CLASS_REFERENCE || sym.sym_class == SYM_CLASS_FUNCTION) {
             if (get_symbol_address(&sym, frame, &address) == 0) {
                 json_write_string(&c->out, "Address");
                 write_stream(&c->out, ':');
-                json_write_long(&c->out, address);
+                json_write_uint64(&c->out, address);
                 write_stream(&c->out, ',');
             }
         }
@@ -187,12 +189,46 @@ static void command_get_children(char * token, Channel * c) {
     loc_free(list);
 }
 
+static void command_find_by_addr(char * token, Channel * c) {
+    int err = 0;
+    char id[256];
+    ContextAddress addr;
+    Context * ctx;
+    Symbol sym;
+
+    json_read_string(&c->inp, id, sizeof(id));
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    addr = (ContextAddress)json_read_uint64(&c->inp);
+    if (read_stream(&c->inp) != 0) exception(ERR_JSON_SYNTAX);
+    if (read_stream(&c->inp) != MARKER_EOM) exception(ERR_JSON_SYNTAX);
+
+    ctx = id2ctx(id);
+    if (ctx == NULL) err = ERR_INV_CONTEXT;
+    else if (ctx->exited) err = ERR_ALREADY_EXITED;
+    else if (find_symbol_by_address(ctx, addr, &sym) < 0) err = errno;
+
+    write_stringz(&c->out, "R");
+    write_stringz(&c->out, token);
+    write_errno(&c->out, err);
+
+    if (err == 0) {
+        json_write_string(&c->out, symbol2id(&sym));
+        write_stream(&c->out, 0);
+    }
+    else {
+        write_stringz(&c->out, "null");
+    }
+
+    write_stream(&c->out, MARKER_EOM);
+}
+
 extern void ini_symbols_lib(void);
 
 void ini_symbols_service(Protocol * proto) {
     ini_symbols_lib();
     add_command_handler(proto, SYMBOLS, "getContext", command_get_context);
     add_command_handler(proto, SYMBOLS, "getChildren", command_get_children);
+    add_command_handler(proto, SYMBOLS, "findByAddr", command_find_by_addr);
 }
 
 #endif /* SERVICE_Symbols */
@@ -60,6 +60,14 @@ typedef void EnumerateSymbolsCallBack(void *, char * name, Symbol *);
  */
 extern int find_symbol(Context * ctx, int frame, char * name, Symbol * sym);
 
+/*
+ * Find function or data object symbol that contains given run-time address.
+ * If no symbol contains the address, the nearest preceding symbol without size is returned.
+ * On error, returns -1 and sets errno.
+ * On success returns 0.
+ */
+extern int find_symbol_by_address(Context * ctx, ContextAddress addr, Symbol * sym);
+
 /*
  * Enumerate symbols in given context.
  * If frame >= 0 enumerates local symbols and function arguments.
@@ -134,6 +142,25 @@ extern int get_symbol_pointer(const Symbol * sym, Symbol * ptr);
  */
 extern ContextAddress is_plt_section(Context * ctx, ContextAddress addr);
 
+/*
+ * Return symbols generation number.
+ * The number changes when symbol data can be disposed, Symbol objects
+ * obtained with a different generation number should not be used.
+ */
+extern unsigned get_symbols_generation(void);
+
+/*
+ * Statistics of find_symbol() results cache.
+ */
+typedef struct SymbolCacheStats {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long flushes;
+    unsigned long entries;
+} SymbolCacheStats;
+
+extern void get_symbol_cache_stats(SymbolCacheStats * stats);
+
 /*
  * Initialize symbol service.
  */
@@ -39,6 +39,8 @@
 #include "dwarfexpr.h"
 #include "stacktrace.h"
 #include "test.h"
+#include "link.h"
+#include "memorymap.h"
 #include "symbols.h"
 
 typedef struct SymLocation {
@@ -104,7 +106,25 @@ static void object2symbol(Context * ctx, ObjectInfo * obj, Symbol * sym) {
     }
 }
 
-static int find_in_object_tree(Context * ctx, ObjectInfo * list, ContextAddress ip, char * name, Symbol * sym) {
+/*
+ * Narrow lookup scope 'scope' (run-time address range [scope[0], scope[1]) that contains 'ip')
+ * to exclude or intersect the address range of a block, so that lookups at any address inside the scope
+ * see the same set of enclosing blocks as a lookup at 'ip'.
+ */
+static void narrow_scope(ContextAddress * scope, ContextAddress ip, ContextAddress addr0, ContextAddress addr1) {
+    if (addr0 <= ip && addr1 > ip) {
+        if (scope[0] < addr0) scope[0] = addr0;
+        if (scope[1] > addr1) scope[1] = addr1;
+    }
+    else if (addr1 <= ip) {
+        if (scope[0] < addr1) scope[0] = addr1;
+    }
+    else if (scope[1] > addr0) {
+        scope[1] = addr0;
+    }
+}
+
+static int find_in_object_tree(Context * ctx, ObjectInfo * list, ContextAddress ip, char * name, Symbol * sym, ContextAddress * scope) {
     int found = 0;
     ObjectInfo * obj = list;
     while (obj != NULL) {
@@ -114,7 +134,7 @@ static int find_in_object_tree(Context * ctx, ObjectInfo * list, ContextAddress
         }
         switch (obj->mTag) {
         case TAG_enumeration_type:
-            found = find_in_object_tree(ctx, obj->mChildren, ip, name, sym);
+            found = find_in_object_tree(ctx, obj->mChildren, ip, name, sym, scope);
             break;
         case TAG_global_subroutine:
         case TAG_subroutine:
@@ -124,8 +144,9 @@ static int find_in_object_tree(Context * ctx, ObjectInfo * list, ContextAddress
             {
                 ContextAddress addr0 = elf_map_to_run_time_address(ctx, obj->mCompUnit->mFile, obj->mLowPC);
                 ContextAddress addr1 = obj->mHighPC - obj->mLowPC + addr0;
+                if (addr0 != 0) narrow_scope(scope, ip, addr0, addr1);
                 if (addr0 != 0 && addr0 <= ip && addr1 > ip) {
-                    if (find_in_object_tree(ctx, obj->mChildren, ip, name, sym)) return 1;
+                    if (find_in_object_tree(ctx, obj->mChildren, ip, name, sym, scope)) return 1;
                 }
             }
             break;
@@ -135,30 +156,49 @@ static int find_in_object_tree(Context * ctx, ObjectInfo * list, ContextAddress
     return found;
 }
 
-static int find_in_dwarf(DWARFCache * cache, Context * ctx, char * name, ContextAddress ip, Symbol * sym) {
-    unsigned i;
-    for (i = 0; i < cache->mCompUnitsCnt; i++) {
-        CompUnit * unit = cache->mCompUnits[i];
-        ContextAddress addr0 = elf_map_to_run_time_address(ctx, unit->mFile, unit->mLowPC);
-        ContextAddress addr1 = unit->mHighPC - unit->mLowPC + addr0;
-        if (addr0 != 0 && addr0 <= ip && addr1 > ip) {
-            if (find_in_object_tree(ctx, unit->mChildren, ip, name, sym)) return 1;
-            if (unit->mBaseTypes != NULL) {
-                if (find_in_object_tree(ctx, unit->mBaseTypes->mChildren, ip, name, sym)) return 1;
-            }
-            return 0;
-        }
+static CompUnit * find_unit(DWARFCache * cache, Context * ctx, ContextAddress ip, ContextAddress * scope) {
+    ContextAddress link_ip = elf_map_to_link_time_address(ctx, cache->mFile, ip);
+    UnitAddressRange * range = NULL;
+    ContextAddress addr0 = 0;
+    if (link_ip != 0) range = find_unit_addr_range(cache, link_ip, link_ip + 1);
+    if (range != NULL) addr0 = elf_map_to_run_time_address(ctx, cache->mFile, range->mAddr);
+    if (addr0 == 0) {
+        narrow_scope(scope, ip, ip, ip + 1);
+        return NULL;
+    }
+    narrow_scope(scope, ip, addr0, addr0 + range->mSize);
+    load_unit_objects(cache, range->mUnit);
+    return range->mUnit;
+}
+
+static int find_in_dwarf(DWARFCache * cache, Context * ctx, char * name, ContextAddress ip, Symbol * sym, ContextAddress * scope) {
+    CompUnit * unit = find_unit(cache, ctx, ip, scope);
+    if (unit == NULL) return 0;
+    if (find_in_object_tree(ctx, unit->mChildren, ip, name, sym, scope)) return 1;
+    if (unit->mBaseTypes != NULL) {
+        load_unit_objects(cache, unit->mBaseTypes);
+        if (find_in_object_tree(ctx, unit->mBaseTypes->mChildren, ip, name, sym, scope)) return 1;
     }
     return 0;
 }
 
+static int find_in_pub_names(DWARFCache * cache, Context * ctx, char * name, Symbol * sym) {
+    ObjectInfo * obj = find_pub_object(cache, name);
+    if (obj == NULL) return 0;
+    object2symbol(ctx, obj, sym);
+    return 1;
+}
+
 static int find_in_sym_table(DWARFCache * cache, Context * ctx, char * name, Symbol * sym) {
     unsigned m = 0;
     unsigned h = calc_symbol_name_hash(name);
     SymLocation * loc = (SymLocation *)sym->location;
+    wait_symbol_tables(cache);
     while (m < cache->mSymSectionsCnt) {
         SymbolSection * tbl = cache->mSymSections[m];
-        unsigned n = tbl->mSymbolHash[h];
+        unsigned n = 0;
+        if (tbl->mHashSection == NULL) n = tbl->mSymbolHash[h];
+        else if (elf_find_hashed_symbol(tbl->mHashSection, name, &n) <= 0) n = 0;
         while (n) {
             U8_T st_name = cache->mFile->elf64 ?
                 ((Elf64_Sym *)tbl->mSymPool + n)->st_name :
@@ -181,13 +221,137 @@ static int find_in_sym_table(DWARFCache * cache, Context * ctx, char * name, Sym
                 loc->index = n;
                 return 1;
             }
-            n = tbl->mHashNext[n];
+            n = tbl->mHashNext != NULL ? tbl->mHashNext[n] : 0;
         }
         m++;
     }
     return 0;
 }
 
+/*
+ * Cache of find_symbol() results.
+ * An entry holds lookup result of a name in a context, and is valid for any frame address inside
+ * the entry scope - a run-time address range where the set of enclosing DWARF blocks is same.
+ * Entries don't keep pointers to debug info entries, since those can be disposed, see load_unit_objects(),
+ * DWARF objects are looked up again by ID when an entry is used.
+ * The cache is flushed when a memory map changes, and entries are removed when ELF file is closed or context exits.
+ */
+
+#define FIND_CACHE_HASH_SIZE 511
+#define MAX_FIND_CACHE_ENTRIES 2048
+
+typedef struct FindCacheEntry {
+    LINK link_hash;
+    LINK link_lru;
+    Context * ctx;
+    char * name;
+    ContextAddress scope_addr0;     /* scope range, [0, 0) for lookups without a frame */
+    ContextAddress scope_addr1;
+    int error;                      /* 0 or ERR_SYM_NOT_FOUND */
+    ELF_File * file;                /* file of the symbol, NULL for test symbols */
+    U8_T obj_id;                    /* DWARF object ID, 0 if the symbol is not a DWARF object */
+    Symbol sym;                     /* the symbol if it is not a DWARF object */
+} FindCacheEntry;
+
+#define hash2entry(A) ((FindCacheEntry *)((char *)(A) - offsetof(FindCacheEntry, link_hash)))
+#define lru2entry(A) ((FindCacheEntry *)((char *)(A) - offsetof(FindCacheEntry, link_lru)))
+
+static LINK find_cache_hash[FIND_CACHE_HASH_SIZE];
+static LINK find_cache_lru;
+static SymbolCacheStats find_cache_stats;
+
+static unsigned find_cache_hash_index(Context * ctx, char * name) {
+    return (calc_symbol_name_hash(name) + (unsigned)((unsigned long)ctx >> 4)) % FIND_CACHE_HASH_SIZE;
+}
+
+static void free_find_cache_entry(FindCacheEntry * e) {
+    list_remove(&e->link_hash);
+    list_remove(&e->link_lru);
+    loc_free(e->name);
+    loc_free(e);
+    find_cache_stats.entries--;
+}
+
+static void flush_find_cache(Context * ctx, ELF_File * file) {
+    LINK * l = find_cache_lru.next;
+    while (l != &find_cache_lru) {
+        FindCacheEntry * e = lru2entry(l);
+        l = l->next;
+        if (ctx != NULL && e->ctx != ctx) continue;
+        if (file != NULL && e->file != file) continue;
+        free_find_cache_entry(e);
+    }
+    find_cache_stats.flushes++;
+}
+
+static FindCacheEntry * find_cache_get(Context * ctx, char * name, ContextAddress ip) {
+    LINK * h = find_cache_hash + find_cache_hash_index(ctx, name);
+    LINK * l = h->next;
+    while (l != h) {
+        FindCacheEntry * e = hash2entry(l);
+        if (e->ctx == ctx && strcmp(e->name, name) == 0 &&
+                (ip == 0 ? e->scope_addr1 == 0 : e->scope_addr0 <= ip && e->scope_addr1 > ip)) {
+            list_remove(&e->link_lru);
+            list_add_first(&e->link_lru, &find_cache_lru);
+            return e;
+        }
+        l = l->next;
+    }
+    return NULL;
+}
+
+static void find_cache_add(Context * ctx, char * name, ContextAddress * scope, int error, Symbol * sym) {
+    FindCacheEntry * e = NULL;
+    if (find_cache_stats.entries >= MAX_FIND_CACHE_ENTRIES) {
+        free_find_cache_entry(lru2entry(find_cache_lru.prev));
+    }
+    e = (FindCacheEntry *)loc_alloc_zero(sizeof(FindCacheEntry));
+    e->ctx = ctx;
+    e->name = loc_strdup(name);
+    e->scope_addr0 = scope[0];
+    e->scope_addr1 = scope[1];
+    e->error = error;
+    if (error == 0) {
+        SymLocation * loc = (SymLocation *)sym->location;
+        if (loc->obj != NULL) {
+            e->file = loc->obj->mCompUnit->mFile;
+            e->obj_id = loc->obj->mID;
+        }
+        else {
+            if (loc->tbl != NULL) e->file = loc->tbl->mFile;
+            e->sym = *sym;
+        }
+    }
+    list_add_first(&e->link_hash, find_cache_hash + find_cache_hash_index(ctx, name));
+    list_add_first(&e->link_lru, &find_cache_lru);
+    find_cache_stats.entries++;
+}
+
+/* Copy cached lookup result into 'sym', return 0 if the entry cannot be used */
+static int find_cache_use(FindCacheEntry * e, Symbol * sym) {
+    Trap trap;
+    ObjectInfo * obj = NULL;
+    if (e->obj_id == 0) {
+        *sym = e->sym;
+        return 1;
+    }
+    if (set_trap(&trap)) {
+        obj = find_object(get_dwarf_cache(e->file), e->obj_id);
+        clear_trap(&trap);
+    }
+    if (obj == NULL) return 0;
+    object2symbol(e->ctx, obj, sym);
+    return 1;
+}
+
+unsigned get_symbols_generation(void) {
+    return get_dwarf_cache_generation();
+}
+
+void get_symbol_cache_stats(SymbolCacheStats * stats) {
+    *stats = find_cache_stats;
+}
+
 int find_symbol(Context * ctx, int frame, char * name, Symbol * sym) {
     int error = 0;
     int found = 0;
@@ -222,11 +386,28 @@ int find_symbol(Context * ctx, int frame, char * name, Symbol * sym) {
 
     if (error == 0 && !found) {
         ContextAddress ip = 0;
+        ContextAddress scope[2];
+        FindCacheEntry * e = NULL;
 
         if (frame != STACK_NO_FRAME) {
             if (get_frame_info(ctx, frame, &ip, NULL, NULL) < 0) error = errno;
         }
 
+        if (error == 0) e = find_cache_get(ctx, name, ip);
+        if (e != NULL) {
+            if (find_cache_use(e, sym)) {
+                find_cache_stats.hits++;
+                if (e->error) {
+                    errno = e->error;
+                    return -1;
+                }
+                return 0;
+            }
+            free_find_cache_entry(e);
+        }
+
+        scope[0] = 0;
+        scope[1] = ~(ContextAddress)0;
         if (error == 0) {
             ELF_File * file = elf_list_first(ctx, ip, ip == 0 ? ~(ContextAddress)0 : ip + 1);
             if (file == NULL) error = errno;
@@ -234,7 +415,8 @@ int find_symbol(Context * ctx, int frame, char * name, Symbol * sym) {
                 Trap trap;
                 if (set_trap(&trap)) {
                     DWARFCache * cache = get_dwarf_cache(file);
-                    if (ip != 0) found = find_in_dwarf(cache, ctx, name, ip, sym);
+                    if (ip != 0) found = find_in_dwarf(cache, ctx, name, ip, sym, scope);
+                    if (!found) found = find_in_pub_names(cache, ctx, name, sym);
                     if (!found) found = find_in_sym_table(cache, ctx, name, sym);
                     clear_trap(&trap);
                 }
@@ -248,12 +430,66 @@ int find_symbol(Context * ctx, int frame, char * name, Symbol * sym) {
             }
             elf_list_done(ctx);
         }
+
+        if (!found) {
+            SymLocation * loc = (SymLocation *)sym->location;
+            found = find_test_symbol(ctx, name, sym, &loc->address) >= 0;
+        }
+
+        if (error == 0) {
+            if (ip == 0) {
+                scope[0] = scope[1] = 0;
+            }
+            else if (scope[0] == 0 && scope[1] == ~(ContextAddress)0) {
+                scope[0] = ip;
+                scope[1] = ip + 1;
+            }
+            find_cache_stats.misses++;
+            find_cache_add(ctx, name, scope, found ? 0 : ERR_SYM_NOT_FOUND, sym);
+        }
     }
 
-    if (!found) {
-        SymLocation * loc = (SymLocation *)sym->location;
-        found = find_test_symbol(ctx, name, sym, &loc->address) >= 0;
+    if (error == 0 && !found) error = ERR_SYM_NOT_FOUND;
+
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+int find_symbol_by_address(Context * ctx, ContextAddress addr, Symbol * sym) {
+    int error = 0;
+    int found = 0;
+    ELF_File * file = elf_list_first(ctx, addr, addr + 1);
+
+    if (file == NULL) error = errno;
+    while (error == 0 && file != NULL) {
+        Trap trap;
+        if (set_trap(&trap)) {
+            DWARFCache * cache = get_dwarf_cache(file);
+            ContextAddress link_addr = elf_map_to_link_time_address(ctx, file, addr);
+            SymbolAddress * s = link_addr == 0 ? NULL : find_symbol_address(cache, link_addr);
+            if (s != NULL) {
+                SymLocation * loc = (SymLocation *)sym->location;
+                memset(sym, 0, sizeof(Symbol));
+                sym->ctx = ctx;
+                sym->sym_class = s->mType == STT_FUNC ? SYM_CLASS_FUNCTION : SYM_CLASS_REFERENCE;
+                loc->tbl = cache->mSymSections[s->mSection];
+                loc->index = s->mIndex;
+                found = 1;
+            }
+            clear_trap(&trap);
+        }
+        else {
+            error = trap.error;
+            break;
+        }
+        if (found) break;
+        file = elf_list_next(ctx);
+        if (file == NULL) error = errno;
     }
+    elf_list_done(ctx);
 
     if (error == 0 && !found) error = ERR_SYM_NOT_FOUND;
 
@@ -310,16 +546,12 @@ int enumerate_symbols(Context * ctx, int frame, EnumerateSymbolsCallBack * call_
             if (set_trap(&trap)) {
                 DWARFCache * cache = get_dwarf_cache(file);
                 if (ip != 0) {
-                    unsigned i;
-                    for (i = 0; i < cache->mCompUnitsCnt; i++) {
-                        CompUnit * unit = cache->mCompUnits[i];
-                        ContextAddress addr0 = elf_map_to_run_time_address(ctx, unit->mFile, unit->mLowPC);
-                        ContextAddress addr1 = unit->mHighPC - unit->mLowPC + addr0;
-                        if (addr0 != 0 && addr0 <= ip && addr1 > ip) {
-                            enumerate_local_vars(ctx, unit->mChildren, ip, 0, call_back, args);
-                            break;
-                        }
-                    }
+                    ContextAddress scope[2];
+                    CompUnit * unit = NULL;
+                    scope[0] = 0;
+                    scope[1] = ~(ContextAddress)0;
+                    unit = find_unit(cache, ctx, ip, scope);
+                    if (unit != NULL) enumerate_local_vars(ctx, unit->mChildren, ip, 0, call_back, args);
                 }
                 clear_trap(&trap);
             }
@@ -476,8 +708,47 @@ ContextAddress is_plt_section(Context * ctx, ContextAddress addr) {
 
 extern void ini_symbols_lib(void);
 
+static void event_context_exited(Context * ctx, void * client_data) {
+    flush_find_cache(ctx, NULL);
+}
+
+#if SERVICE_MemoryMap
+static void event_module_changed(Context * ctx, void * client_data) {
+    flush_find_cache(NULL, NULL);
+}
+
+static void event_code_unmapped(Context * ctx, ContextAddress addr, ContextAddress size, void * client_data) {
+    flush_find_cache(NULL, NULL);
+}
+#endif
+
+static void elf_file_closed(ELF_File * file) {
+    flush_find_cache(NULL, file);
+}
+
 void ini_symbols_lib(void) {
+    int i;
     assert(sizeof(SymLocation) <= sizeof(((Symbol *)0)->location));
+    for (i = 0; i < FIND_CACHE_HASH_SIZE; i++) list_init(find_cache_hash + i);
+    list_init(&find_cache_lru);
+    {
+        static ContextEventListener listener = {
+            NULL,
+            event_context_exited,
+        };
+        add_context_event_listener(&listener, NULL);
+    }
+#if SERVICE_MemoryMap
+    {
+        static MemoryMapEventListener listener = {
+            event_module_changed,
+            event_code_unmapped,
+            event_module_changed,
+        };
+        add_memory_map_event_listener(&listener, NULL);
+    }
+#endif
+    elf_add_close_listener(elf_file_closed);
 }
 
 /*************** Functions for retrieving symbol properties ***************************************/
@@ -598,6 +598,24 @@ int find_symbol(Context * ctx, int frame, char * name, Symbol * sym) {
     return 0;
 }
 
+int find_symbol_by_address(Context * ctx, ContextAddress addr, Symbol * sym) {
+    ULONG64 buffer[(sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(TCHAR) + sizeof(ULONG64) - 1) / sizeof(ULONG64)];
+    SYMBOL_INFO * info = (SYMBOL_INFO *)buffer;
+    HANDLE process = ctx->parent == NULL ? ctx->handle : ctx->parent->handle;
+    DWORD64 displacement = 0;
+
+    memset(info, 0, sizeof(SYMBOL_INFO));
+    info->SizeOfStruct = sizeof(SYMBOL_INFO);
+    info->MaxNameLen = MAX_SYM_NAME;
+
+    if (!SymFromAddr(process, addr, &displacement, info)) {
+        if (set_win32_errno(GetLastError()) == 0) errno = ERR_SYM_NOT_FOUND;
+        return -1;
+    }
+    syminfo2symbol(ctx, info, sym);
+    return 0;
+}
+
 typedef struct EnumerateSymbolsContext {
     Context * ctx;
     EnumerateSymbolsCallBack * call_back;
@@ -654,6 +672,14 @@ ContextAddress is_plt_section(Context * ctx, ContextAddress addr) {
     return 0;
 }
 
+unsigned get_symbols_generation(void) {
+    return 0;
+}
+
+void get_symbol_cache_stats(SymbolCacheStats * stats) {
+    memset(stats, 0, sizeof(SymbolCacheStats));
+}
+
 static void event_context_created(Context * ctx, void * client_data) {
     if (ctx->parent != NULL) return;
     assert(ctx->pid == ctx->mem);
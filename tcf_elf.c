@@ -562,6 +562,214 @@ ContextAddress elf_map_to_run_time_address(Context * ctx, ELF_File * file, Conte
     return 0;
 }
 
+ContextAddress elf_map_to_link_time_address(Context * ctx, ELF_File * file, ContextAddress addr) {
+    unsigned i, j;
+    MemoryRegion * regions;
+    unsigned region_cnt;
+
+    if (!file->pic) return addr;
+    memory_map_get_regions(ctx, &regions, &region_cnt);
+    for (i = 0; i < region_cnt; i++) {
+        MemoryRegion * r = regions + i;
+        if (r->dev != file->dev || r->ino != file->ino) continue;
+        if (addr < r->addr || addr >= r->addr + r->size) continue;
+        for (j = 0; j < file->pheader_cnt; j++) {
+            ELF_PHeader * p = file->pheaders + j;
+            ContextAddress offs = (ContextAddress)(addr - r->addr + r->file_offs);
+            if (p->type != PT_LOAD) continue;
+            if (p->offset < r->file_offs || p->offset + p->mem_size > r->file_offs + r->size) continue;
+            if (offs < p->offset || offs >= p->offset + p->mem_size) continue;
+            if (!(p->flags & PF_W) != !(r->flags & MM_FLAG_W)) continue;
+            return (ContextAddress)(offs - p->offset + p->address);
+        }
+    }
+    return 0;
+}
+
+int elf_map_to_link_time_range(Context * ctx, ELF_File * file, ContextAddress addr0, ContextAddress addr1,
+                               ContextAddress * rt_addr, ContextAddress * lt_addr, ContextAddress * size) {
+    unsigned i, j;
+    MemoryRegion * regions;
+    unsigned region_cnt;
+    int found = 0;
+
+    if (addr0 >= addr1) return 0;
+    if (!file->pic) {
+        *rt_addr = *lt_addr = addr0;
+        *size = addr1 - addr0;
+        return 1;
+    }
+    memory_map_get_regions(ctx, &regions, &region_cnt);
+    for (i = 0; i < region_cnt; i++) {
+        MemoryRegion * r = regions + i;
+        if (r->dev != file->dev || r->ino != file->ino) continue;
+        if (addr1 <= r->addr || addr0 >= r->addr + r->size) continue;
+        for (j = 0; j < file->pheader_cnt; j++) {
+            ELF_PHeader * p = file->pheaders + j;
+            ContextAddress seg0 = 0;
+            ContextAddress seg1 = 0;
+            if (p->type != PT_LOAD) continue;
+            if (p->offset < r->file_offs || p->offset + p->mem_size > r->file_offs + r->size) continue;
+            if (!(p->flags & PF_W) != !(r->flags & MM_FLAG_W)) continue;
+            /* Run-time address range of the segment, clipped to [addr0, addr1) */
+            seg0 = (ContextAddress)(r->addr + (p->offset - r->file_offs));
+            seg1 = (ContextAddress)(seg0 + p->mem_size);
+            if (seg0 < addr0) seg0 = addr0;
+            if (seg1 > addr1) seg1 = addr1;
+            if (seg0 >= seg1) continue;
+            if (found && *rt_addr <= seg0) continue;
+            *rt_addr = seg0;
+            *lt_addr = (ContextAddress)(seg0 - r->addr + r->file_offs - p->offset + p->address);
+            *size = seg1 - seg0;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+ELF_Section * elf_find_hash_section(ELF_Section * sym_sec) {
+    unsigned i;
+    ELF_File * file = sym_sec->file;
+    ELF_Section * hash = NULL;
+
+    for (i = 1; i < file->section_cnt; i++) {
+        ELF_Section * sec = file->sections + i;
+        if (sec->size == 0 || sec->link != sym_sec->index) continue;
+        if (sec->type == SHT_GNU_HASH) return sec;
+        if (sec->type == SHT_HASH) hash = sec;
+    }
+    return hash;
+}
+
+static U4_T get_hash_word(ELF_File * file, U1_T * p) {
+    U4_T x = *(U4_T *)p;
+    if (file->byte_swap) SWAP(x);
+    return x;
+}
+
+static U4_T calc_gnu_hash(const char * s) {
+    U4_T h = 5381;
+    while (*s) h = h * 33 + (U1_T)*s++;
+    return h;
+}
+
+static U4_T calc_sysv_hash(const char * s) {
+    U4_T h = 0;
+    while (*s) {
+        U4_T g;
+        h = (h << 4) + (U1_T)*s++;
+        if (g = h & 0xf0000000) h ^= g >> 24;
+        h &= ~g;
+    }
+    return h;
+}
+
+static int cmp_hashed_symbol_name(ELF_Section * sym_sec, ELF_Section * str_sec, unsigned index, const char * name) {
+    ELF_File * file = sym_sec->file;
+    U4_T offs = file->elf64 ?
+        get_hash_word(file, (U1_T *)&((Elf64_Sym *)sym_sec->data + index)->st_name) :
+        get_hash_word(file, (U1_T *)&((Elf32_Sym *)sym_sec->data + index)->st_name);
+    if (offs >= str_sec->size) return 0;
+    return strcmp((char *)str_sec->data + offs, name) == 0;
+}
+
+int elf_find_hashed_symbol(ELF_Section * hash_sec, const char * name, unsigned * index) {
+    ELF_File * file = hash_sec->file;
+    ELF_Section * sym_sec = NULL;
+    ELF_Section * str_sec = NULL;
+    U1_T * data = NULL;
+    unsigned sym_cnt = 0;
+
+    if (hash_sec->link == 0 || hash_sec->link >= file->section_cnt) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    sym_sec = file->sections + hash_sec->link;
+    if (sym_sec->link == 0 || sym_sec->link >= file->section_cnt) {
+        errno = ERR_INV_FORMAT;
+        return -1;
+    }
+    str_sec = file->sections + sym_sec->link;
+    if (elf_load(hash_sec) < 0) return -1;
+    if (elf_load(sym_sec) < 0) return -1;
+    if (elf_load(str_sec) < 0) return -1;
+    data = (U1_T *)hash_sec->data;
+    sym_cnt = (unsigned)(sym_sec->size / (file->elf64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym)));
+
+    if (hash_sec->type == SHT_GNU_HASH) {
+        unsigned word_size = file->elf64 ? 8 : 4;
+        U4_T bucket_cnt, sym_offs, bloom_size, bloom_shift;
+        U4_T h = calc_gnu_hash(name);
+        U1_T * bloom = data + 16;
+        U1_T * buckets = NULL;
+        U1_T * chain = NULL;
+        U8_T chain_cnt = 0;
+        U8_T word = 0;
+        U8_T mask = 0;
+        U4_T n = 0;
+
+        if (hash_sec->size < 16) goto invalid;
+        bucket_cnt = get_hash_word(file, data);
+        sym_offs = get_hash_word(file, data + 4);
+        bloom_size = get_hash_word(file, data + 8);
+        bloom_shift = get_hash_word(file, data + 12);
+        if (bucket_cnt == 0 || bloom_size == 0 || bloom_shift >= 32) goto invalid;
+        if (16 + (U8_T)bloom_size * word_size + (U8_T)bucket_cnt * 4 > hash_sec->size) goto invalid;
+        buckets = bloom + (size_t)bloom_size * word_size;
+        chain = buckets + (size_t)bucket_cnt * 4;
+        chain_cnt = (hash_sec->size - (chain - data)) / 4;
+
+        /* Bloom filter */
+        bloom += (size_t)((h / (word_size * 8)) % bloom_size) * word_size;
+        if (word_size == 8) {
+            word = *(U8_T *)bloom;
+            if (file->byte_swap) SWAP(word);
+        }
+        else {
+            word = get_hash_word(file, bloom);
+        }
+        mask = ((U8_T)1 << (h % (word_size * 8))) | ((U8_T)1 << ((h >> bloom_shift) % (word_size * 8)));
+        if ((word & mask) != mask) return 0;
+
+        n = get_hash_word(file, buckets + (size_t)(h % bucket_cnt) * 4);
+        if (n < sym_offs) return 0;
+        for (;;) {
+            U4_T h2;
+            if (n >= sym_cnt || n - sym_offs >= chain_cnt) goto invalid;
+            h2 = get_hash_word(file, chain + (size_t)(n - sym_offs) * 4);
+            if ((h | 1) == (h2 | 1) && cmp_hashed_symbol_name(sym_sec, str_sec, n, name)) {
+                *index = n;
+                return 1;
+            }
+            if (h2 & 1) break;
+            n++;
+        }
+        return 0;
+    }
+    else {
+        U4_T bucket_cnt, chain_cnt, n, i;
+        if (hash_sec->size < 8) goto invalid;
+        bucket_cnt = get_hash_word(file, data);
+        chain_cnt = get_hash_word(file, data + 4);
+        if (bucket_cnt == 0) goto invalid;
+        if (8 + ((U8_T)bucket_cnt + chain_cnt) * 4 > hash_sec->size) goto invalid;
+        n = get_hash_word(file, data + 8 + (size_t)(calc_sysv_hash(name) % bucket_cnt) * 4);
+        for (i = 0; n != 0; i++) {
+            if (n >= chain_cnt || n >= sym_cnt || i >= chain_cnt) goto invalid;
+            if (cmp_hashed_symbol_name(sym_sec, str_sec, n, name)) {
+                *index = n;
+                return 1;
+            }
+            n = get_hash_word(file, data + 8 + ((size_t)bucket_cnt + n) * 4);
+        }
+        return 0;
+    }
+
+invalid:
+    errno = ERR_INV_FORMAT;
+    return -1;
+}
+
 #if SERVICE_Expressions && ENABLE_DebugContext
 
 static int get_dynamic_tag(Context * ctx, ELF_File * file, int tag, ContextAddress * addr) {
@@ -635,6 +843,39 @@ static int sym_name_cmp(char * x, char * y) {
 static int get_global_symbol_address(Context * ctx, ELF_File * file, char * name, ContextAddress * addr) {
     unsigned i, j;
 
+    /* Exported symbols are looked up in dynamic symbol table hash first */
+    for (i = 1; i < file->section_cnt; i++) {
+        ELF_Section * sec = file->sections + i;
+        ELF_Section * hash = NULL;
+        int bind = 0;
+        int type = 0;
+        U8_T value = 0;
+        if (sec->size == 0) continue;
+        if (sec->type != SHT_DYNSYM) continue;
+        hash = elf_find_hash_section(sec);
+        if (hash == NULL || elf_find_hashed_symbol(hash, name, &j) <= 0) continue;
+        if (file->elf64) {
+            Elf64_Sym * sym = (Elf64_Sym *)sec->data + j;
+            Elf64_Addr x = sym->st_value;
+            if (file->byte_swap) SWAP(x);
+            bind = ELF64_ST_BIND(sym->st_info);
+            type = ELF64_ST_TYPE(sym->st_info);
+            value = x;
+        }
+        else {
+            Elf32_Sym * sym = (Elf32_Sym *)sec->data + j;
+            Elf32_Addr x = sym->st_value;
+            if (file->byte_swap) SWAP(x);
+            bind = ELF32_ST_BIND(sym->st_info);
+            type = ELF32_ST_TYPE(sym->st_info);
+            value = x;
+        }
+        if (bind != STB_GLOBAL) continue;
+        if (type != STT_OBJECT && type != STT_FUNC) continue;
+        *addr = elf_map_to_run_time_address(ctx, file, (ContextAddress)value);
+        if (*addr != 0) return 0;
+    }
+
     for (i = 1; i < file->section_cnt; i++) {
         ELF_Section * sec = file->sections + i;
         if (sec->size == 0) continue;
@@ -72,6 +72,12 @@
 #define SHT_PROGBITS    1
 #define SHT_SYMTAB      2
 #define SHT_STRTAB      3
+#define SHT_RELA        4
+#define SHT_HASH        5
+#define SHT_DYNAMIC     6
+#define SHT_NOTE        7
+#define SHT_DYNSYM      11
+#define SHT_GNU_HASH    0x6ffffff6
 
 #define STB_LOCAL       0
 #define STB_GLOBAL      1
@@ -413,6 +419,35 @@ extern void elf_add_close_listener(ELFCloseListener listener);
  */
 extern ContextAddress elf_map_to_run_time_address(Context * ctx, ELF_File * file, ContextAddress addr);
 
+/*
+ * Map run-time address in a context to link-time address in an ELF file.
+ * Return 0 if the address does not belong to the file.
+ */
+extern ContextAddress elf_map_to_link_time_address(Context * ctx, ELF_File * file, ContextAddress addr);
+
+/*
+ * Find lowest part of run-time address range [addr0, addr1) in a context that is mapped
+ * to one segment of an ELF file, addresses of the range that are not mapped are skipped.
+ * On return, "rt_addr" is run-time address of the part, "lt_addr" is its link-time address
+ * and "size" is its size. Return 0 if no part of the range belongs to the file.
+ */
+extern int elf_map_to_link_time_range(Context * ctx, ELF_File * file, ContextAddress addr0, ContextAddress addr1,
+                                      ContextAddress * rt_addr, ContextAddress * lt_addr, ContextAddress * size);
+
+/*
+ * Return hash section that indexes symbol table section "sym_sec":
+ * .gnu.hash if the file has one, otherwise .hash. Return NULL if the table has no hash section.
+ */
+extern ELF_Section * elf_find_hash_section(ELF_Section * sym_sec);
+
+/*
+ * Find symbol by name using ELF hash section "hash_sec", see elf_find_hash_section().
+ * GNU hash bloom filter rejects most of names that are not in the table without reading the table.
+ * Return 1 and set "index" to symbol index in the table if found, 0 if not found.
+ * If error, returns -1 and sets errno.
+ */
+extern int elf_find_hashed_symbol(ELF_Section * hash_sec, const char * name, unsigned * index);
+
 /*
  * Initialize ELF support module.
  */
@@ -0,0 +1,368 @@
+/*******************************************************************************
+ * Copyright (c) 2026 TCF Target Agent for ARM contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *     TCF Target Agent for ARM contributors - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Unit tests of ELF symbol hash lookup: elf_find_hash_section() and elf_find_hashed_symbol().
+ *
+ * Symbol, string and hash sections are built in memory for both ELF classes and both byte orders,
+ * then hash section headers and chains are corrupted to check bounds checks.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include "tcf_elf.h"
+#include "myalloc.h"
+#include "errors.h"
+#include "unittest.h"
+
+#define SYM_CNT     40
+#define SEC_STR     1
+#define SEC_SYM     2
+#define SEC_GNU     3
+#define SEC_SYSV    4
+#define SEC_CNT     5
+
+typedef struct HashTestFile {
+    ELF_File file;
+    ELF_Section sections[SEC_CNT];
+    char * names[SYM_CNT];      /* names[i] is name of symbol i, names[0] is NULL */
+} HashTestFile;
+
+static U4_T gnu_hash(const char * s) {
+    U4_T h = 5381;
+    while (*s) h = h * 33 + (U1_T)*s++;
+    return h;
+}
+
+static U4_T sysv_hash(const char * s) {
+    U4_T h = 0;
+    while (*s) {
+        U4_T g;
+        h = (h << 4) + (U1_T)*s++;
+        if (g = h & 0xf0000000) h ^= g >> 24;
+        h &= ~g;
+    }
+    return h;
+}
+
+static void put_u4(ELF_File * file, U1_T * p, U4_T x) {
+    if (file->byte_swap) TEST_SWAP(x);
+    memcpy(p, &x, 4);
+}
+
+static U4_T get_u4(ELF_File * file, U1_T * p) {
+    U4_T x;
+    memcpy(&x, p, 4);
+    if (file->byte_swap) TEST_SWAP(x);
+    return x;
+}
+
+static void put_word(ELF_File * file, U1_T * p, U8_T x) {
+    if (!file->elf64) {
+        put_u4(file, p, (U4_T)x);
+        return;
+    }
+    if (file->byte_swap) TEST_SWAP(x);
+    memcpy(p, &x, 8);
+}
+
+static void * alloc_section(HashTestFile * f, unsigned index, U4_T type, U4_T link, size_t size) {
+    ELF_Section * sec = f->sections + index;
+    sec->file = &f->file;
+    sec->index = index;
+    sec->type = type;
+    sec->link = link;
+    sec->size = size;
+    sec->data = loc_alloc_zero(size);
+    return sec->data;
+}
+
+/*
+ * Build a dynamic symbol table with names "sym0".."symN", ordered by GNU hash bucket like the linker does,
+ * with GNU hash table of "bucket_cnt" buckets and SysV hash table.
+ */
+static void create_file(HashTestFile * f, int elf64, int byte_swap, U4_T bucket_cnt) {
+    ELF_File * file = &f->file;
+    unsigned word_size = elf64 ? 8 : 4;
+    unsigned sym_size = elf64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+    U4_T bloom_size = 4;
+    U4_T bloom_shift = 6;
+    char * str = NULL;
+    U1_T * sym = NULL;
+    U1_T * gnu = NULL;
+    U1_T * sysv = NULL;
+    unsigned str_pos = 1;
+    unsigned i, b, n;
+
+    memset(f, 0, sizeof(HashTestFile));
+    file->elf64 = elf64;
+    file->byte_swap = byte_swap;
+    file->section_cnt = SEC_CNT;
+    file->sections = f->sections;
+
+    /* Order symbols by bucket */
+    n = 1;
+    for (b = 0; b < bucket_cnt; b++) {
+        for (i = 1; i < SYM_CNT; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "sym%u", i);
+            if (gnu_hash(name) % bucket_cnt != b) continue;
+            f->names[n++] = loc_strdup(name);
+        }
+    }
+
+    str = (char *)alloc_section(f, SEC_STR, SHT_STRTAB, 0, SYM_CNT * 8);
+    sym = (U1_T *)alloc_section(f, SEC_SYM, SHT_DYNSYM, SEC_STR, SYM_CNT * sym_size);
+    for (i = 1; i < SYM_CNT; i++) {
+        U1_T * s = sym + i * sym_size;
+        strcpy(str + str_pos, f->names[i]);
+        if (elf64) put_u4(file, s + offsetof(Elf64_Sym, st_name), str_pos);
+        else put_u4(file, s + offsetof(Elf32_Sym, st_name), str_pos);
+        str_pos += strlen(f->names[i]) + 1;
+    }
+
+    gnu = (U1_T *)alloc_section(f, SEC_GNU, SHT_GNU_HASH, SEC_SYM,
+        16 + bloom_size * word_size + bucket_cnt * 4 + (SYM_CNT - 1) * 4);
+    put_u4(file, gnu, bucket_cnt);
+    put_u4(file, gnu + 4, 1);
+    put_u4(file, gnu + 8, bloom_size);
+    put_u4(file, gnu + 12, bloom_shift);
+    for (i = 1; i < SYM_CNT; i++) {
+        U4_T h = gnu_hash(f->names[i]);
+        U1_T * bloom = gnu + 16 + (h / (word_size * 8)) % bloom_size * word_size;
+        U1_T * bucket = gnu + 16 + bloom_size * word_size + h % bucket_cnt * 4;
+        U1_T * chain = gnu + 16 + bloom_size * word_size + bucket_cnt * 4 + (i - 1) * 4;
+        U8_T word = elf64 ? 0 : get_u4(file, bloom);
+        if (elf64) {
+            memcpy(&word, bloom, 8);
+            if (byte_swap) TEST_SWAP(word);
+        }
+        word |= (U8_T)1 << (h % (word_size * 8));
+        word |= (U8_T)1 << ((h >> bloom_shift) % (word_size * 8));
+        put_word(file, bloom, word);
+        if (get_u4(file, bucket) == 0) put_u4(file, bucket, i);
+        /* Last symbol of a bucket has bit 0 set */
+        if (i + 1 == SYM_CNT || gnu_hash(f->names[i + 1]) % bucket_cnt != h % bucket_cnt) h |= 1;
+        else h &= ~1;
+        put_u4(file, chain, h);
+    }
+
+    sysv = (U1_T *)alloc_section(f, SEC_SYSV, SHT_HASH, SEC_SYM, 8 + (bucket_cnt + SYM_CNT) * 4);
+    put_u4(file, sysv, bucket_cnt);
+    put_u4(file, sysv + 4, SYM_CNT);
+    for (i = 1; i < SYM_CNT; i++) {
+        U1_T * bucket = sysv + 8 + sysv_hash(f->names[i]) % bucket_cnt * 4;
+        /* Insert at head of the bucket chain */
+        put_u4(file, sysv + 8 + (bucket_cnt + i) * 4, get_u4(file, bucket));
+        put_u4(file, bucket, i);
+    }
+}
+
+static void dispose_file(HashTestFile * f) {
+    unsigned i;
+    for (i = 0; i < SEC_CNT; i++) loc_free(f->sections[i].data);
+    for (i = 0; i < SYM_CNT; i++) loc_free(f->names[i]);
+}
+
+static void check_lookup(HashTestFile * f, unsigned sec) {
+    ELF_Section * hash = f->sections + sec;
+    unsigned i;
+    for (i = 1; i < SYM_CNT; i++) {
+        unsigned index = 0;
+        test_check(elf_find_hashed_symbol(hash, f->names[i], &index) == 1);
+        test_check(index == i);
+    }
+    for (i = 0; i < 100; i++) {
+        char name[32];
+        unsigned index = 0;
+        snprintf(name, sizeof(name), "missing%u", i);
+        test_check(elf_find_hashed_symbol(hash, name, &index) == 0);
+    }
+}
+
+/* Check that lookup of every symbol reports invalid format or not found, but never succeeds with wrong index */
+static void check_invalid(HashTestFile * f, unsigned sec, int all) {
+    ELF_Section * hash = f->sections + sec;
+    unsigned i;
+    int errors = 0;
+    for (i = 1; i < SYM_CNT; i++) {
+        unsigned index = 0;
+        int r = elf_find_hashed_symbol(hash, f->names[i], &index);
+        if (r < 0) {
+            test_check(errno == ERR_INV_FORMAT);
+            errors++;
+        }
+        else if (r > 0) {
+            test_check(index == i);
+        }
+    }
+    if (all) test_check(errors == SYM_CNT - 1);
+    else test_check(errors > 0);
+}
+
+static void test_lookup(int elf64, int byte_swap) {
+    HashTestFile f;
+    U4_T bucket_cnt;
+
+    for (bucket_cnt = 1; bucket_cnt <= 17; bucket_cnt += 4) {
+        create_file(&f, elf64, byte_swap, bucket_cnt);
+        test_check(elf_find_hash_section(f.sections + SEC_SYM) == f.sections + SEC_GNU);
+        check_lookup(&f, SEC_GNU);
+        check_lookup(&f, SEC_SYSV);
+        f.sections[SEC_GNU].size = 0;
+        test_check(elf_find_hash_section(f.sections + SEC_SYM) == f.sections + SEC_SYSV);
+        f.sections[SEC_SYSV].link = SEC_STR;
+        test_check(elf_find_hash_section(f.sections + SEC_SYM) == NULL);
+        dispose_file(&f);
+    }
+}
+
+static void test_gnu_bounds(int elf64) {
+    HashTestFile f;
+    ELF_Section * hash = NULL;
+    U1_T * data = NULL;
+    U8_T size = 0;
+    unsigned word_size = elf64 ? 8 : 4;
+    U4_T bucket_cnt = 5;
+    U4_T b;
+
+    create_file(&f, elf64, 0, bucket_cnt);
+    hash = f.sections + SEC_GNU;
+    data = (U1_T *)hash->data;
+    size = hash->size;
+
+    /* Bloom shift must be less than 32, bigger shift is undefined behavior */
+    put_u4(&f.file, data + 12, 32);
+    check_invalid(&f, SEC_GNU, 1);
+    put_u4(&f.file, data + 12, 0xffffffff);
+    check_invalid(&f, SEC_GNU, 1);
+    put_u4(&f.file, data + 12, 31);
+    for (b = 1; b < SYM_CNT; b++) {
+        /* Valid shift, the bloom filter was built for other shift, so a symbol can be not found */
+        unsigned index = 0;
+        test_check(elf_find_hashed_symbol(hash, f.names[b], &index) >= 0);
+    }
+    put_u4(&f.file, data + 12, 6);
+    check_lookup(&f, SEC_GNU);
+
+    /* Zero bucket or bloom count */
+    put_u4(&f.file, data, 0);
+    check_invalid(&f, SEC_GNU, 1);
+    put_u4(&f.file, data, bucket_cnt);
+    put_u4(&f.file, data + 8, 0);
+    check_invalid(&f, SEC_GNU, 1);
+    put_u4(&f.file, data + 8, 4);
+
+    /* Bloom filter and buckets past the end of the section */
+    put_u4(&f.file, data + 8, 0x40000000);
+    check_invalid(&f, SEC_GNU, 1);
+    put_u4(&f.file, data + 8, 4);
+    put_u4(&f.file, data, 0xffffffff);
+    check_invalid(&f, SEC_GNU, 1);
+    put_u4(&f.file, data, bucket_cnt);
+    hash->size = 12;
+    check_invalid(&f, SEC_GNU, 1);
+    hash->size = 16 + 4 * word_size + bucket_cnt * 4 - 1;
+    check_invalid(&f, SEC_GNU, 1);
+
+    /* Truncated chain table: lookups that reach the end of it fail */
+    hash->size = size - 8;
+    check_invalid(&f, SEC_GNU, 0);
+    hash->size = size;
+    check_lookup(&f, SEC_GNU);
+
+    /* Chain without end bit runs past the symbol table */
+    for (b = 0; b < SYM_CNT - 1; b++) {
+        U1_T * chain = data + 16 + 4 * word_size + bucket_cnt * 4 + b * 4;
+        put_u4(&f.file, chain, get_u4(&f.file, chain) & ~1);
+    }
+    {
+        unsigned index = 0;
+        char * name = f.names[SYM_CNT - 1];
+        /* Last symbol is found before the end of the table */
+        test_check(elf_find_hashed_symbol(hash, name, &index) == 1);
+        test_check(index == SYM_CNT - 1);
+        test_check(elf_find_hashed_symbol(hash, "missing", &index) <= 0);
+    }
+    dispose_file(&f);
+
+    /* Bucket refers past the symbol table */
+    create_file(&f, elf64, 0, bucket_cnt);
+    data = (U1_T *)f.sections[SEC_GNU].data;
+    for (b = 0; b < bucket_cnt; b++) {
+        U1_T * bucket = data + 16 + 4 * word_size + b * 4;
+        put_u4(&f.file, bucket, SYM_CNT + 100);
+    }
+    check_invalid(&f, SEC_GNU, 1);
+    dispose_file(&f);
+
+    /* Broken section links */
+    create_file(&f, elf64, 0, bucket_cnt);
+    f.sections[SEC_GNU].link = SEC_CNT;
+    check_invalid(&f, SEC_GNU, 1);
+    f.sections[SEC_GNU].link = 0;
+    check_invalid(&f, SEC_GNU, 1);
+    f.sections[SEC_GNU].link = SEC_SYM;
+    f.sections[SEC_SYM].link = SEC_CNT + 1;
+    check_invalid(&f, SEC_GNU, 1);
+    dispose_file(&f);
+}
+
+static void test_sysv_bounds(void) {
+    HashTestFile f;
+    U1_T * data = NULL;
+    U4_T bucket_cnt = 3;
+    U4_T i;
+
+    create_file(&f, 0, 0, bucket_cnt);
+    data = (U1_T *)f.sections[SEC_SYSV].data;
+
+    put_u4(&f.file, data, 0);
+    check_invalid(&f, SEC_SYSV, 1);
+    put_u4(&f.file, data, 0x40000000);
+    check_invalid(&f, SEC_SYSV, 1);
+    put_u4(&f.file, data, bucket_cnt);
+    put_u4(&f.file, data + 4, 0xffffffff);
+    check_invalid(&f, SEC_SYSV, 1);
+    put_u4(&f.file, data + 4, SYM_CNT);
+    check_lookup(&f, SEC_SYSV);
+
+    /* Chain loop must not hang the lookup */
+    for (i = 1; i < SYM_CNT; i++) put_u4(&f.file, data + 8 + (bucket_cnt + i) * 4, i);
+    for (i = 0; i < bucket_cnt; i++) put_u4(&f.file, data + 8 + i * 4, 1);
+    {
+        unsigned index = 0;
+        test_check(elf_find_hashed_symbol(f.sections + SEC_SYSV, "missing", &index) < 0);
+        test_check(errno == ERR_INV_FORMAT);
+    }
+
+    /* Chain refers past the symbol table */
+    for (i = 0; i < bucket_cnt; i++) put_u4(&f.file, data + 8 + i * 4, SYM_CNT);
+    check_invalid(&f, SEC_SYSV, 1);
+    dispose_file(&f);
+}
+
+void test_elf_hash(void) {
+    test_lookup(0, 0);
+    test_lookup(0, 1);
+    test_lookup(1, 0);
+    test_lookup(1, 1);
+    test_gnu_bounds(0);
+    test_gnu_bounds(1);
+    test_sysv_bounds();
+}
@@ -0,0 +1,212 @@
+/*******************************************************************************
+ * Copyright (c) 2026 TCF Target Agent for ARM contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *     TCF Target Agent for ARM contributors - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Unit tests of JSON reader: json_skip_object(), json_read_object() and json_read_struct_members().
+ *
+ * Input is read from memory in windows of few bytes, so values span window boundaries
+ * like they do when a message is split between channel input buffers.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "json.h"
+#include "myalloc.h"
+#include "exceptions.h"
+#include "errors.h"
+#include "unittest.h"
+
+typedef struct TestInputStream {
+    InputStream inp;
+    unsigned char * buf;
+    size_t len;
+    size_t chunk;
+} TestInputStream;
+
+typedef struct TestStruct {
+    char id[8];
+    char * name;
+    int enabled;
+    int count;
+    long offset;
+    int64_t big;
+    double ratio;
+    char ** list;
+    int list_cnt;
+    int unknown_cnt;
+} TestStruct;
+
+static const JsonStructMember test_members[] = {
+    { "ID", JSON_MEMBER_STRING, offsetof(TestStruct, id), sizeof(((TestStruct *)0)->id) },
+    { "Name", JSON_MEMBER_ALLOC_STRING, offsetof(TestStruct, name), 0 },
+    { "Enabled", JSON_MEMBER_BOOLEAN, offsetof(TestStruct, enabled), 0 },
+    { "Count", JSON_MEMBER_INT, offsetof(TestStruct, count), 0 },
+    { "Offset", JSON_MEMBER_LONG, offsetof(TestStruct, offset), 0 },
+    { "Big", JSON_MEMBER_INT64, offsetof(TestStruct, big), 0 },
+    { "Ratio", JSON_MEMBER_DOUBLE, offsetof(TestStruct, ratio), 0 },
+    { "List", JSON_MEMBER_STRING_ARRAY, offsetof(TestStruct, list), offsetof(TestStruct, list_cnt) },
+    { NULL, 0, 0, 0 }
+};
+
+static int next_window(InputStream * inp) {
+    TestInputStream * s = (TestInputStream *)inp;
+    size_t pos = inp->end - s->buf;
+    if (pos >= s->len) return 0;
+    inp->cur = inp->end;
+    inp->end = pos + s->chunk < s->len ? inp->end + s->chunk : s->buf + s->len;
+    return 1;
+}
+
+static int test_read(InputStream * inp) {
+    if (!next_window(inp)) return MARKER_EOS;
+    return *inp->cur++;
+}
+
+static int test_peek(InputStream * inp) {
+    if (!next_window(inp)) return MARKER_EOS;
+    return *inp->cur;
+}
+
+static InputStream * open_input(TestInputStream * s, const char * str, size_t chunk) {
+    s->buf = (unsigned char *)str;
+    s->len = strlen(str);
+    s->chunk = chunk;
+    s->inp.cur = s->buf;
+    s->inp.end = s->buf;
+    s->inp.read = test_read;
+    s->inp.peek = test_peek;
+    return &s->inp;
+}
+
+/* Return error code of an exception thrown by json_skip_object(), 0 if none */
+static int skip_error(const char * str, size_t chunk) {
+    TestInputStream s;
+    Trap trap;
+    if (set_trap(&trap)) {
+        json_skip_object(open_input(&s, str, chunk));
+        clear_trap(&trap);
+        return 0;
+    }
+    return trap.error;
+}
+
+static void unknown_member(InputStream * inp, char * name, void * args) {
+    TestStruct * obj = (TestStruct *)args;
+    test_check(strcmp(name, "Extra") == 0);
+    json_skip_object(inp);
+    obj->unknown_cnt++;
+}
+
+static void test_skip(void) {
+    static const char * values[] = {
+        "null", "true", "false", "0", "-12", "3.25", "-1.5e+10", "2E-3",
+        "\"\"", "\"abc\"", "\"a\\\"b\\\\\"", "\"\\\\\\\"\\\\\"",
+        "[]", "[1,\"x\",[null],{}]", "{}",
+        "{\"a\":\"x\\\"y\",\"b\":[1,-2.5e+3,true,false,null],\"c\":{\"d\":{}}}",
+        NULL
+    };
+    static const char * errors[] = {
+        "nul", "tru", "fals", "\"abc", "\"ab\\", "[1,2", "[1 2]", "{\"a\"}", "{\"a\":1,}", "?",
+        NULL
+    };
+    size_t chunk;
+    int i;
+
+    for (chunk = 1; chunk <= 8; chunk++) {
+        for (i = 0; values[i] != NULL; i++) {
+            TestInputStream s;
+            char buf[256];
+            InputStream * inp = NULL;
+
+            /* Value must be skipped up to the following separator */
+            snprintf(buf, sizeof(buf), "%s,", values[i]);
+            inp = open_input(&s, buf, chunk);
+            json_skip_object(inp);
+            test_check(read_stream(inp) == ',');
+
+            /* Copy of the value must be same as input text */
+            inp = open_input(&s, buf, chunk);
+            {
+                char * str = json_read_object(inp);
+                test_check(strcmp(str, values[i]) == 0);
+                loc_free(str);
+            }
+            test_check(read_stream(inp) == ',');
+        }
+        for (i = 0; errors[i] != NULL; i++) {
+            test_check(skip_error(errors[i], chunk) == ERR_JSON_SYNTAX);
+        }
+    }
+}
+
+static void test_struct_members(void) {
+    static const char * input =
+        "{\"ID\":\"0123456789\",\"Extra\":{\"x\":[1,2]},\"Name\":\"b\\\"p\",\"Enabled\":true,"
+        "\"Count\":-7,\"Offset\":123456,\"Big\":-9007199254740993,\"Ratio\":0.5,"
+        "\"List\":[\"a\",\"\",\"b\\\\c\"],\"Extra\":null}";
+    size_t chunk;
+
+    for (chunk = 1; chunk <= 8; chunk++) {
+        TestStruct obj;
+        TestInputStream s;
+        InputStream * inp = NULL;
+
+        memset(&obj, 0, sizeof(obj));
+        obj.name = loc_strdup("previous");
+        inp = open_input(&s, input, chunk);
+        test_check(json_read_struct_members(inp, test_members, &obj, unknown_member, &obj) == 1);
+        test_check(peek_stream(inp) == MARKER_EOS);
+        /* JSON_MEMBER_STRING is truncated to the field size */
+        test_check(strcmp(obj.id, "0123456") == 0);
+        test_check(obj.name != NULL && strcmp(obj.name, "b\"p") == 0);
+        test_check(obj.enabled == 1);
+        test_check(obj.count == -7);
+        test_check(obj.offset == 123456);
+        test_check(obj.big == -(int64_t)9007199254740993ll);
+        test_check(obj.ratio == 0.5);
+        test_check(obj.list_cnt == 3);
+        test_check(obj.list != NULL && obj.list[3] == NULL);
+        if (obj.list != NULL && obj.list_cnt == 3) {
+            test_check(strcmp(obj.list[0], "a") == 0);
+            test_check(strcmp(obj.list[1], "") == 0);
+            test_check(strcmp(obj.list[2], "b\\c") == 0);
+        }
+        test_check(obj.unknown_cnt == 2);
+
+        /* Null array clears previous value, unknown members are skipped if there is no call back */
+        inp = open_input(&s, "{\"Extra\":[{\"a\":\"]\"}],\"List\":null,\"Name\":null}", chunk);
+        test_check(json_read_struct_members(inp, test_members, &obj, NULL, NULL) == 1);
+        test_check(obj.list == NULL);
+        test_check(obj.list_cnt == 0);
+        test_check(obj.name == NULL);
+        test_check(obj.unknown_cnt == 2);
+
+        inp = open_input(&s, "null", chunk);
+        test_check(json_read_struct_members(inp, test_members, &obj, NULL, NULL) == 0);
+        inp = open_input(&s, "{}", chunk);
+        test_check(json_read_struct_members(inp, test_members, &obj, NULL, NULL) == 1);
+        test_check(peek_stream(inp) == MARKER_EOS);
+
+        loc_free(obj.name);
+        loc_free(obj.list);
+    }
+}
+
+void test_json(void) {
+    test_skip();
+    test_struct_members();
+}
@@ -0,0 +1,480 @@
+/*******************************************************************************
+ * Copyright (c) 2026 TCF Target Agent for ARM contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *     TCF Target Agent for ARM contributors - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Unit tests of compressed line number tables of DWARF cache.
+ *
+ * A DWARF line number program is generated from pseudo-random states, decoded by load_line_numbers(),
+ * then the delta encoded states and file/line index are read back with seek and next functions
+ * and compared with the generated states.
+ * Lookups in the unit address range index are compared with a scan of all units.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include "dwarfcache.h"
+#include "dwarf.h"
+#include "myalloc.h"
+#include "unittest.h"
+
+#define LINE_BASE       (-5)
+#define LINE_RANGE      14
+#define OPCODE_BASE     13
+#define FILES_CNT       3
+
+typedef struct LineProgram {
+    ELF_File * file;
+    int addr_size;
+    U1_T * data;
+    size_t size;
+    size_t max;
+    LineNumbersState * states;  /* expected states */
+    U4_T states_cnt;
+    U4_T states_max;
+    LineNumbersState state;     /* line number state machine registers */
+} LineProgram;
+
+static U4_T rnd_seed = 1;
+
+static U4_T rnd(U4_T n) {
+    rnd_seed = rnd_seed * 1103515245 + 12345;
+    return (rnd_seed >> 8) % n;
+}
+
+static void put_bytes(LineProgram * p, const void * buf, size_t size) {
+    if (p->size + size > p->max) {
+        p->max = p->max == 0 ? 0x1000 : p->max * 2;
+        if (p->size + size > p->max) p->max = p->size + size;
+        p->data = (U1_T *)loc_realloc(p->data, p->max);
+    }
+    memcpy(p->data + p->size, buf, size);
+    p->size += size;
+}
+
+static void put_u1(LineProgram * p, unsigned x) {
+    U1_T b = (U1_T)x;
+    put_bytes(p, &b, 1);
+}
+
+static void put_u2(LineProgram * p, U2_T x) {
+    if (p->file->byte_swap) TEST_SWAP(x);
+    put_bytes(p, &x, 2);
+}
+
+static void put_u4(LineProgram * p, U4_T x) {
+    if (p->file->byte_swap) TEST_SWAP(x);
+    put_bytes(p, &x, 4);
+}
+
+static void put_addr(LineProgram * p, U8_T x) {
+    if (p->addr_size == 4) {
+        put_u4(p, (U4_T)x);
+        return;
+    }
+    if (p->file->byte_swap) TEST_SWAP(x);
+    put_bytes(p, &x, 8);
+}
+
+static void put_uleb(LineProgram * p, U8_T x) {
+    while (x >= 0x80) {
+        put_u1(p, (unsigned)(x & 0x7f) | 0x80);
+        x >>= 7;
+    }
+    put_u1(p, (unsigned)x);
+}
+
+static void put_sleb(LineProgram * p, I8_T x) {
+    while (x < -0x40 || x >= 0x40) {
+        put_u1(p, (unsigned)(x & 0x7f) | 0x80);
+        x >>= 7;
+    }
+    put_u1(p, (unsigned)(x & 0x7f));
+}
+
+static void put_str(LineProgram * p, const char * s) {
+    put_bytes(p, s, strlen(s) + 1);
+}
+
+static void reset_state(LineProgram * p) {
+    memset(&p->state, 0, sizeof(p->state));
+    p->state.mFile = 1;
+    p->state.mLine = 1;
+    p->state.mFlags = LINE_IsStmt;
+}
+
+/* Append current state to the expected states, like DW_LNS_copy and special opcodes do */
+static void add_state(LineProgram * p) {
+    if (p->states_cnt >= p->states_max) {
+        p->states_max = p->states_max == 0 ? 256 : p->states_max * 2;
+        p->states = (LineNumbersState *)loc_realloc(p->states, sizeof(LineNumbersState) * p->states_max);
+    }
+    p->states[p->states_cnt++] = p->state;
+    p->state.mFlags &= ~(LINE_BasicBlock | LINE_PrologueEnd | LINE_EpilogueBegin);
+}
+
+/* Emit opcodes that change the state machine registers and add a state */
+static void emit_row(LineProgram * p, U4_T addr_delta, I4_T line_delta) {
+    int special = line_delta >= LINE_BASE && line_delta < LINE_BASE + LINE_RANGE &&
+        (line_delta - LINE_BASE) + LINE_RANGE * addr_delta + OPCODE_BASE <= 255;
+
+    if (special && rnd(2)) {
+        put_u1(p, (line_delta - LINE_BASE) + LINE_RANGE * addr_delta + OPCODE_BASE);
+    }
+    else {
+        if (addr_delta > 0) {
+            if (addr_delta < 0x10000 && rnd(2)) {
+                put_u1(p, DW_LNS_fixed_advance_pc);
+                put_u2(p, (U2_T)addr_delta);
+            }
+            else {
+                put_u1(p, DW_LNS_advance_pc);
+                put_uleb(p, addr_delta);
+            }
+        }
+        if (line_delta != 0) {
+            put_u1(p, DW_LNS_advance_line);
+            put_sleb(p, line_delta);
+        }
+        put_u1(p, DW_LNS_copy);
+    }
+    p->state.mAddress += addr_delta;
+    p->state.mLine += line_delta;
+    add_state(p);
+}
+
+static void emit_sequence(LineProgram * p, ContextAddress addr, U4_T cnt) {
+    U4_T i;
+
+    put_u1(p, 0);
+    put_uleb(p, 1 + p->addr_size);
+    put_u1(p, DW_LNE_set_address);
+    put_addr(p, addr);
+    p->state.mAddress = addr;
+    for (i = 0; i < cnt; i++) {
+        U4_T addr_delta = rnd(8) == 0 ? 0 : rnd(40);
+        I4_T line_delta = (I4_T)rnd(41) - 20;
+        if (rnd(16) == 0) addr_delta = 0x10000 + rnd(0x100000);
+        if (rnd(16) == 0) line_delta = 100000 + rnd(100000);
+        if ((I4_T)p->state.mLine + line_delta < 1) line_delta = -line_delta;
+        if (rnd(5) == 0) {
+            /* File 7 is not in the file table, index entries of it refer to the unit file */
+            static const U4_T files[] = { 1, 2, 3, 7 };
+            p->state.mFile = files[rnd(4)];
+            put_u1(p, DW_LNS_set_file);
+            put_uleb(p, p->state.mFile);
+        }
+        if (rnd(5) == 0) {
+            p->state.mColumn = (U2_T)rnd(200);
+            put_u1(p, DW_LNS_set_column);
+            put_uleb(p, p->state.mColumn);
+        }
+        if (rnd(20) == 0) {
+            p->state.mISA = (U1_T)rnd(4);
+            put_u1(p, DW_LNS_set_isa);
+            put_uleb(p, p->state.mISA);
+        }
+        if (rnd(10) == 0) {
+            p->state.mFlags ^= LINE_IsStmt;
+            put_u1(p, DW_LNS_negate_stmt);
+        }
+        if (rnd(20) == 0) {
+            p->state.mFlags |= LINE_BasicBlock;
+            put_u1(p, DW_LNS_set_basic_block);
+        }
+        if (rnd(20) == 0) {
+            p->state.mFlags |= LINE_PrologueEnd;
+            put_u1(p, DW_LNS_set_prologue_end);
+        }
+        if (rnd(20) == 0) {
+            p->state.mFlags |= LINE_EpilogueBegin;
+            put_u1(p, DW_LNS_set_epilogue_begin);
+        }
+        emit_row(p, addr_delta, line_delta);
+    }
+    put_u1(p, DW_LNS_advance_pc);
+    put_uleb(p, 4);
+    p->state.mAddress += 4;
+    put_u1(p, 0);
+    put_uleb(p, 1);
+    put_u1(p, DW_LNE_end_sequence);
+    p->state.mFlags |= LINE_EndSequence;
+    add_state(p);
+    reset_state(p);
+}
+
+/* Generate line number program of one unit with sequences of "cnt" states each */
+static void create_program(LineProgram * p, const U4_T * cnt, unsigned seq_cnt) {
+    static const U1_T opcode_size[OPCODE_BASE - 1] = { 0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1 };
+    size_t header_pos = 0;
+    size_t program_pos = 0;
+    unsigned i;
+
+    put_u4(p, 0);   /* unit length */
+    put_u2(p, 3);   /* version */
+    put_u4(p, 0);   /* header length */
+    header_pos = p->size;
+    put_u1(p, 1);   /* minimum instruction length */
+    put_u1(p, 1);   /* default is_stmt */
+    put_u1(p, (U1_T)LINE_BASE);
+    put_u1(p, LINE_RANGE);
+    put_u1(p, OPCODE_BASE);
+    put_bytes(p, opcode_size, sizeof(opcode_size));
+    put_str(p, "/usr/src");
+    put_u1(p, 0);
+    put_str(p, "main.c");
+    put_uleb(p, 1);
+    put_uleb(p, 0);
+    put_uleb(p, 0);
+    put_str(p, "util.h");
+    put_uleb(p, 0);
+    put_uleb(p, 0);
+    put_uleb(p, 0);
+    put_str(p, "/usr/include/stdio.h");
+    put_uleb(p, 0);
+    put_uleb(p, 0);
+    put_uleb(p, 0);
+    put_u1(p, 0);
+    program_pos = p->size;
+
+    reset_state(p);
+    for (i = 0; i < seq_cnt; i++) {
+        ContextAddress addr = (ContextAddress)(0x8000 + i * 0x10000000u);
+        if (p->addr_size == 8 && sizeof(ContextAddress) >= 8) addr += (ContextAddress)0x7f0000000000ull;
+        emit_sequence(p, addr, cnt[i]);
+    }
+
+    /* Patch unit and header length */
+    {
+        size_t size = p->size;
+        p->size = 0;
+        put_u4(p, (U4_T)(size - 4));
+        p->size = 6;
+        put_u4(p, (U4_T)(program_pos - header_pos));
+        p->size = size;
+    }
+}
+
+static int cmp_state(LineNumbersState * x, LineNumbersState * y) {
+    return x->mAddress == y->mAddress && x->mFile == y->mFile && x->mLine == y->mLine &&
+        x->mColumn == y->mColumn && x->mFlags == y->mFlags && x->mISA == y->mISA;
+}
+
+static int ref_sort_func(const void * X, const void * Y) {
+    const LineNumbersRef * x = (const LineNumbersRef *)X;
+    const LineNumbersRef * y = (const LineNumbersRef *)Y;
+    if (x->mFile != y->mFile) return x->mFile < y->mFile ? -1 : +1;
+    if (x->mLine != y->mLine) return x->mLine < y->mLine ? -1 : +1;
+    if (x->mState != y->mState) return x->mState < y->mState ? -1 : +1;
+    return 0;
+}
+
+static void check_states(LineProgram * p, CompUnit * unit) {
+    LineNumbersReader reader;
+    U4_T i;
+
+    test_check(unit->mStatesCnt == p->states_cnt);
+    if (unit->mStatesCnt != p->states_cnt) return;
+
+    /* Sequential read */
+    seek_line_state(&reader, unit, 0);
+    for (i = 0; i < p->states_cnt; i++) {
+        if (i > 0) next_line_state(&reader);
+        test_check(reader.mIndex == i);
+        test_check(cmp_state(&reader.mState, p->states + i));
+    }
+
+    /* Random seek */
+    for (i = 0; i < 200; i++) {
+        U4_T n = rnd(p->states_cnt);
+        seek_line_state(&reader, unit, n);
+        test_check(cmp_state(&reader.mState, p->states + n));
+    }
+
+    /* Block address ranges include the block states and first state of next block */
+    for (i = 0; i < p->states_cnt; i++) {
+        LineNumbersBlock * block = unit->mStatesBlocks + i / LINE_BLOCK_STATES;
+        test_check(block->mMinAddress <= p->states[i].mAddress);
+        test_check(block->mMaxAddress >= p->states[i].mAddress);
+        if (i > 0 && i % LINE_BLOCK_STATES == 0) {
+            block--;
+            test_check(block->mMinAddress <= p->states[i].mAddress);
+            test_check(block->mMaxAddress >= p->states[i].mAddress);
+        }
+    }
+}
+
+static void check_refs(LineProgram * p, CompUnit * unit) {
+    LineNumbersRef * refs = (LineNumbersRef *)loc_alloc_zero(sizeof(LineNumbersRef) * p->states_cnt);
+    LineRefsReader reader;
+    U4_T cnt = 0;
+    U4_T i;
+
+    /* Expected index: states except end of sequence, sorted by file, line and state index */
+    for (i = 0; i + 1 < p->states_cnt; i++) {
+        LineNumbersState * s = p->states + i;
+        LineNumbersRef * r = NULL;
+        if (s->mFlags & LINE_EndSequence) continue;
+        r = refs + cnt++;
+        r->mFile = s->mFile >= 1 && s->mFile <= FILES_CNT ? s->mFile : 0;
+        r->mLine = s->mLine;
+        r->mNextLine = s[1].mLine;
+        r->mState = i;
+    }
+    qsort(refs, cnt, sizeof(LineNumbersRef), ref_sort_func);
+    for (i = 0; i < cnt; i++) {
+        LineNumbersRef * r = refs + i;
+        r->mMaxNextLine = r->mNextLine;
+        if (i > 0 && r[-1].mFile == r->mFile && r[-1].mMaxNextLine > r->mMaxNextLine) r->mMaxNextLine = r[-1].mMaxNextLine;
+    }
+
+    test_check(unit->mLineRefsCnt == cnt);
+    if (unit->mLineRefsCnt == cnt && cnt > 0) {
+        seek_line_ref(&reader, unit, 0);
+        for (i = 0; i < cnt; i++) {
+            if (i > 0) next_line_ref(&reader);
+            test_check(reader.mIndex == i);
+            test_check(memcmp(&reader.mRef, refs + i, sizeof(LineNumbersRef)) == 0);
+        }
+        for (i = 0; i < 200; i++) {
+            U4_T n = rnd(cnt);
+            seek_line_ref(&reader, unit, n);
+            test_check(memcmp(&reader.mRef, refs + n, sizeof(LineNumbersRef)) == 0);
+        }
+    }
+    loc_free(refs);
+}
+
+static void test_program(int addr_size, int byte_swap, const U4_T * cnt, unsigned seq_cnt) {
+    ELF_File file;
+    ELF_Section section;
+    DWARFCache cache;
+    CompUnit unit;
+    LineProgram p;
+
+    memset(&file, 0, sizeof(file));
+    memset(&section, 0, sizeof(section));
+    memset(&cache, 0, sizeof(cache));
+    memset(&unit, 0, sizeof(unit));
+    memset(&p, 0, sizeof(p));
+
+    file.byte_swap = byte_swap;
+    p.file = &file;
+    p.addr_size = addr_size;
+    create_program(&p, cnt, seq_cnt);
+
+    section.file = &file;
+    section.data = p.data;
+    section.size = p.size;
+    cache.mFile = &file;
+    cache.mDebugLine = &section;
+    unit.mDesc.mFile = &file;
+    unit.mDesc.mSection = &section;
+    unit.mDesc.mAddressSize = (U1_T)addr_size;
+    unit.mLineInfoOffs = 0;
+
+    load_line_numbers(&cache, &unit);
+    test_check(unit.mLineInfoLoaded);
+    test_check(unit.mDirsCnt == 1);
+    test_check(unit.mFilesCnt == FILES_CNT);
+    if (unit.mFilesCnt == FILES_CNT) {
+        test_check(strcmp(unit.mFiles[0].mName, "main.c") == 0);
+        test_check(unit.mFiles[0].mDir != NULL && strcmp(unit.mFiles[0].mDir, "/usr/src") == 0);
+        test_check(unit.mFiles[1].mDir == NULL);
+    }
+    check_states(&p, &unit);
+    check_refs(&p, &unit);
+
+    loc_free(unit.mFiles);
+    loc_free(unit.mDirs);
+    loc_free(unit.mStatesBlocks);
+    loc_free(unit.mStatesData);
+    loc_free(unit.mLineRefsBlocks);
+    loc_free(unit.mLineRefsData);
+    loc_free(p.data);
+    loc_free(p.states);
+}
+
+/* Unit ranges that nest and overlap must be found by address like a scan of all units would find them */
+static void test_unit_addr_ranges(void) {
+    enum { UNITS_CNT = 40, ADDR_BASE = 0x1000, ADDR_SPACE = 600 };
+    CompUnit units[UNITS_CNT];
+    CompUnit * list[UNITS_CNT];
+    DWARFCache cache;
+    unsigned pass;
+
+    for (pass = 0; pass < 20; pass++) {
+        ContextAddress addr;
+        unsigned i;
+
+        memset(&cache, 0, sizeof(cache));
+        memset(units, 0, sizeof(units));
+        cache.magic = SYM_CACHE_MAGIC;
+        cache.mCompUnits = list;
+        cache.mCompUnitsCnt = UNITS_CNT;
+        for (i = 0; i < UNITS_CNT; i++) {
+            CompUnit * u = units + i;
+            u->mUnitPos = i;
+            u->mDebugRangesOffs = ~(U8_T)0;
+            u->mLowPC = ADDR_BASE + rnd(ADDR_SPACE);
+            /* Mostly short ranges, some long ones that cover many others */
+            u->mHighPC = u->mLowPC + (rnd(4) == 0 ? rnd(ADDR_SPACE / 2) : rnd(10));
+            list[i] = u;
+        }
+
+        for (addr = ADDR_BASE - 10; addr < ADDR_BASE + ADDR_SPACE * 3 / 2; addr++) {
+            UnitAddressRange * range = find_unit_addr_range(&cache, addr, addr + 1);
+            CompUnit * exp = NULL;
+            /* The covering range that starts last wins, then the shorter one, then the first unit */
+            for (i = 0; i < UNITS_CNT; i++) {
+                CompUnit * u = units + i;
+                if (addr < u->mLowPC || addr >= u->mHighPC) continue;
+                if (exp != NULL && u->mLowPC < exp->mLowPC) continue;
+                if (exp != NULL && u->mLowPC == exp->mLowPC && u->mHighPC >= exp->mHighPC) continue;
+                exp = u;
+            }
+            test_check((range != NULL ? range->mUnit : NULL) == exp);
+            if (range != NULL) test_check(range->mAddr <= addr && addr - range->mAddr < range->mSize);
+        }
+
+        for (i = 1; i < cache.mAddrRangesCnt; i++) {
+            UnitAddressRange * r = cache.mAddrRanges + i;
+            test_check(r[-1].mAddr + r[-1].mSize <= r->mAddr);
+        }
+        loc_free(cache.mAddrRanges);
+    }
+}
+
+void test_line_numbers(void) {
+    /* Sequence lengths around block size, single state units and multiple sequences */
+    static const U4_T cnt1[] = { 0 };
+    static const U4_T cnt2[] = { 1 };
+    static const U4_T cnt3[] = { LINE_BLOCK_STATES - 1 };
+    static const U4_T cnt4[] = { LINE_BLOCK_STATES * 3 };
+    static const U4_T cnt5[] = { 70, 5, 0, 300, LINE_BLOCK_REFS + 1 };
+    int addr_size;
+    int byte_swap;
+
+    for (addr_size = 4; addr_size <= 8; addr_size += 4) {
+        for (byte_swap = 0; byte_swap <= 1; byte_swap++) {
+            test_program(addr_size, byte_swap, cnt1, 1);
+            test_program(addr_size, byte_swap, cnt2, 1);
+            test_program(addr_size, byte_swap, cnt3, 1);
+            test_program(addr_size, byte_swap, cnt4, 1);
+            test_program(addr_size, byte_swap, cnt5, 5);
+        }
+    }
+    test_unit_addr_ranges();
+}
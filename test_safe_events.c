@@ -0,0 +1,184 @@
+/*******************************************************************************
+ * Copyright (c) 2026 TCF Target Agent for ARM contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *     TCF Target Agent for ARM contributors - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Unit tests of safe events: post_safe_event() and post_safe_command().
+ *
+ * A fake running thread of memory space TEST_MEM_RUNNING keeps safe events of that memory waiting,
+ * while events of other memory spaces must run. The thread does not get stopped: it is stepping,
+ * so run_safe_events() does not call context_stop(), and it is marked exited to let the queue run.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "runctrl.h"
+#include "context.h"
+#include "channel.h"
+#include "protocol.h"
+#include "events.h"
+#include "myalloc.h"
+#include "unittest.h"
+
+#if SERVICE_RunControl
+
+#define TEST_MEM_RUNNING    1001
+#define TEST_MEM_STOPPED    1002
+#define TEST_MEM_IDLE       1003
+
+typedef struct TestChannel {
+    Channel c;
+    int lock_cnt;
+    int closed;
+    int flush_cnt;
+} TestChannel;
+
+static TCFSuspendGroup * spg = NULL;
+static TestChannel channel;
+static Context thread;          /* running thread of TEST_MEM_RUNNING */
+static Context idle_ctx;        /* context of TEST_MEM_IDLE, not in the context list */
+static char log_buf[256];
+
+static void log_event(const char * name) {
+    size_t len = strlen(log_buf);
+    snprintf(log_buf + len, sizeof(log_buf) - len, "%s%s", len > 0 ? " " : "", name);
+}
+
+static void channel_lock(Channel * c) {
+    ((TestChannel *)c)->lock_cnt++;
+}
+
+static void channel_unlock(Channel * c) {
+    ((TestChannel *)c)->lock_cnt--;
+}
+
+static int channel_is_closed(Channel * c) {
+    return ((TestChannel *)c)->closed;
+}
+
+static void channel_flush(OutputStream * out) {
+    channel.flush_cnt++;
+}
+
+static void event_log(void * arg) {
+    log_event((const char *)arg);
+}
+
+static void command_log(Channel * c, char * token, void * args) {
+    test_check(c == &channel.c);
+    log_event(token);
+    log_event((const char *)args);
+}
+
+static void event_finish(void * arg);
+
+static void command_closed(Channel * c, char * token, void * args) {
+    test_check(0);
+}
+
+static void command_last(Channel * c, char * token, void * args) {
+    test_check(strcmp(log_buf, "c1 idle c0 idle b1 b2 b3 a1 c2 x a2 c3 x z c4 idle") == 0);
+    test_check(!are_channels_suspended(spg));
+    /* Closed channel: command handler is not called, the channel is unlocked */
+    channel.closed = 1;
+    post_safe_event(TEST_MEM_STOPPED, event_log, "b4");
+    post_safe_command(&channel.c, "c6", &idle_ctx, command_closed, "", 1);
+    idle_ctx.mem = TEST_MEM_STOPPED;
+    post_safe_command(&channel.c, "c7", &idle_ctx, command_closed, "", 1);
+    post_safe_event(TEST_MEM_STOPPED, event_finish, NULL);
+}
+
+static void event_second_stopped(void * arg) {
+    log_event("b2");
+    /* Events posted by a safe event run after the events already in the queue */
+    post_safe_event(TEST_MEM_STOPPED, event_log, "b3");
+    /* The thread is still running, its memory space events must wait */
+    test_check(strcmp(log_buf, "c1 idle c0 idle b1 b2") == 0);
+    thread.exited = 1;
+}
+
+static void event_all_stopped(void * arg) {
+    log_event("z");
+    test_check(are_channels_suspended(spg));
+    /* A command of any memory space waits for the safe event of all memory spaces */
+    post_safe_command(&channel.c, "c4", &idle_ctx, command_log, "idle", 5);
+    post_safe_command(&channel.c, "c5", &idle_ctx, command_last, "", 1);
+    test_check(channel.lock_cnt == 2);
+}
+
+static void event_second_running(void * arg) {
+    log_event("a2");
+    post_safe_command(&channel.c, "c3", &thread, command_log, "x", 2);
+    post_safe_event(0, event_all_stopped, NULL);
+    test_check(channel.lock_cnt == 1);
+}
+
+static void event_finish(void * arg) {
+    test_check(strcmp(log_buf, "c1 idle c0 idle b1 b2 b3 a1 c2 x a2 c3 x z c4 idle b4") == 0);
+    test_check(channel.lock_cnt == 0);
+    test_check(channel.flush_cnt == 4);
+    list_remove(&thread.ctxl);
+    unit_test_done();
+}
+
+void test_safe_events(void) {
+    static int ini = 0;
+
+    if (!ini) {
+        /* Unit tests don't call ini_contexts(), the context list contains only fake contexts */
+        if (context_root.next == NULL) list_init(&context_root);
+        spg = suspend_group_alloc();
+        ini_run_ctrl_service(protocol_alloc(), broadcast_group_alloc(), spg);
+        ini = 1;
+    }
+
+    memset(&channel, 0, sizeof(channel));
+    channel.c.lock = channel_lock;
+    channel.c.unlock = channel_unlock;
+    channel.c.is_closed = channel_is_closed;
+    channel.c.out.flush = channel_flush;
+    memset(&thread, 0, sizeof(thread));
+    thread.pid = thread.mem = TEST_MEM_RUNNING;
+    thread.pending_step = 1;
+    list_add_last(&thread.ctxl, &context_root);
+    memset(&idle_ctx, 0, sizeof(idle_ctx));
+    idle_ctx.pid = idle_ctx.mem = TEST_MEM_IDLE;
+    log_buf[0] = 0;
+
+    /* No safe events are pending: the command is executed immediately */
+    post_safe_command(&channel.c, "c1", &idle_ctx, command_log, "idle", 5);
+    test_check(strcmp(log_buf, "c1 idle") == 0);
+    test_check(channel.lock_cnt == 0);
+
+    post_safe_event(TEST_MEM_RUNNING, event_log, "a1");
+    post_safe_event(TEST_MEM_STOPPED, event_log, "b1");
+    post_safe_command(&channel.c, "c2", &thread, command_log, "x", 2);
+    post_safe_event(TEST_MEM_STOPPED, event_second_stopped, NULL);
+    post_safe_event(TEST_MEM_RUNNING, event_second_running, NULL);
+    test_check(channel.lock_cnt == 1);
+
+    /* Commands of other memory spaces are not delayed */
+    post_safe_command(&channel.c, "c0", &idle_ctx, command_log, "idle", 5);
+    test_check(strcmp(log_buf, "c1 idle c0 idle") == 0);
+
+    unit_test_wait();
+}
+
+#else
+
+void test_safe_events(void) {
+}
+
+#endif /* SERVICE_RunControl */
@@ -0,0 +1,57 @@
+/*******************************************************************************
+ * Copyright (c) 2026 TCF Target Agent for ARM contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ * The Eclipse Public License is available at
+ * http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *     TCF Target Agent for ARM contributors - initial API and implementation
+ *******************************************************************************/
+
+/*
+ * Agent unit tests.
+ *
+ * Tests are linked with the agent library into "unittest" program, see "make check".
+ * Each test_*.c file implements tests of one agent module.
+ * Tests are called on the dispatch thread, an exception thrown by a test is reported as a failure.
+ */
+
+#ifndef D_unittest
+#define D_unittest
+
+#include "config.h"
+
+/* Report failed check, the program exit code will be non-zero */
+extern void unit_test_failed(const char * file, int line, const char * cond);
+
+#define test_check(cond) do { if (!(cond)) unit_test_failed(__FILE__, __LINE__, #cond); } while (0)
+
+/* Reverse byte order of a number, used to build test data of other endianness */
+extern void test_swap_bytes(void * buf, size_t size);
+
+#define TEST_SWAP(x) test_swap_bytes(&(x), sizeof(x))
+
+/*
+ * A test that needs the event loop calls unit_test_wait() before it returns,
+ * then unit_test_done() from an event when it is finished. Next test is not started until then.
+ */
+extern void unit_test_wait(void);
+extern void unit_test_done(void);
+
+/* Tests of JSON reader, see test_json.c */
+extern void test_json(void);
+
+/* Tests of ELF symbol hash lookup, see test_elf_hash.c */
+extern void test_elf_hash(void);
+
+/* Tests of line number states and refs encoding, see test_line_numbers.c */
+extern void test_line_numbers(void);
+
+/* Tests of safe events and commands order, see test_safe_events.c */
+extern void test_safe_events(void);
+
+#endif /* D_unittest */
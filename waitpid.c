@@ -164,21 +164,48 @@ void add_waitpid_process(int pid) {
 #else
 
 #include <sys/wait.h>
+#if defined(__linux__)
+#include <signal.h>
+#include <sys/signalfd.h>
+#endif
+
+#if defined(__APPLE__)
+#define WAITPID_OPTIONS 0
+#else
+#define WAITPID_OPTIONS __WALL
+#endif
+
+#define MAX_WAITPID_BATCH 256
 
 static unsigned long waitpid_poll_period = 100000;
 static AsyncReqInfo req;
 static int posted = 0;
+static int drain_posted = 0;
+
+#if defined(__linux__)
+/* When available, SIGCHLD is read from signalfd, and statuses are reaped with WNOHANG */
+static int sigchld_fd = -1;
+static struct signalfd_siginfo sigchld_info[16];
+#endif
 
 static void waitpid_post(void) {
     assert(!posted);
     req.error = 0;
+#if defined(__linux__)
+    if (sigchld_fd >= 0) {
+        req.type = AsyncReqRead;
+        req.u.fio.fd = sigchld_fd;
+        req.u.fio.bufp = sigchld_info;
+        req.u.fio.bufsz = sizeof(sigchld_info);
+        posted = 1;
+        async_req_post(&req);
+        return;
+    }
+#endif
+    req.type = AsyncReqWaitpid;
     req.u.wpid.pid = -1;
     req.u.wpid.status = 0;
-#if defined(__APPLE__)
-    req.u.wpid.options = 0;
-#else
-    req.u.wpid.options = __WALL;
-#endif
+    req.u.wpid.options = WAITPID_OPTIONS;
     posted = 1;
     async_req_post(&req);
 }
@@ -187,24 +214,8 @@ static void waitpid_poll_event(void * arg) {
     if (!posted) waitpid_post();
 }
 
-static void waitpid_done(void * arg) {
+static void waitpid_status(pid_t pid, int status) {
     int i;
-    pid_t pid = req.u.wpid.rval;
-    int status = req.u.wpid.status;
-    int error = req.error;
-
-    assert(arg == &req);
-    assert(posted);
-    posted = 0;
-
-    if (pid == (pid_t)-1) {
-        if (error == ECHILD) {
-            post_event_with_delay(waitpid_poll_event, NULL, waitpid_poll_period);
-            if (waitpid_poll_period < 30 * 1000000) waitpid_poll_period *= 2;
-            return;
-        }
-        check_error(error);
-    }
 
     trace(LOG_WAITPID, "waitpid: pid %d status %#x", pid, status);
     if (WIFEXITED(status)) {
@@ -225,7 +236,60 @@ static void waitpid_done(void * arg) {
     else {
         trace(LOG_ALWAYS, "unexpected status (0x%x) from waitpid (pid %d)", status, pid);
     }
-    waitpid_post();
+}
+
+static void waitpid_drain(void * arg) {
+    /* Stopping all threads of a process produces a burst of notifications,
+     * reap the ones already pending without a round trip through the async request thread.
+     * If there are more than MAX_WAITPID_BATCH, the rest is reaped in next event
+     * to let other events run. */
+    int cnt = 0;
+
+    drain_posted = 0;
+    while (cnt < MAX_WAITPID_BATCH) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, WAITPID_OPTIONS | WNOHANG);
+        if (pid <= 0) break;
+        waitpid_status(pid, status);
+        cnt++;
+    }
+    if (cnt > 1) trace(LOG_WAITPID, "waitpid: %d notifications reaped in a batch", cnt);
+    if (cnt == MAX_WAITPID_BATCH) {
+        drain_posted = 1;
+        post_event(waitpid_drain, NULL);
+    }
+}
+
+static void waitpid_done(void * arg) {
+    pid_t pid = req.u.wpid.rval;
+    int status = req.u.wpid.status;
+    int error = req.error;
+
+    assert(arg == &req);
+    assert(posted);
+    posted = 0;
+
+#if defined(__linux__)
+    if (req.type == AsyncReqRead) {
+        if (req.u.fio.rval < 0 && error != EINTR) check_error(error);
+        if (!drain_posted) waitpid_drain(NULL);
+        if (!posted) waitpid_post();
+        return;
+    }
+#endif
+
+    if (pid == (pid_t)-1) {
+        if (error == ECHILD) {
+            post_event_with_delay(waitpid_poll_event, NULL, waitpid_poll_period);
+            if (waitpid_poll_period < 30 * 1000000) waitpid_poll_period *= 2;
+            return;
+        }
+        check_error(error);
+    }
+
+    waitpid_status(pid, status);
+    if (!posted && !drain_posted) waitpid_drain(NULL);
+    if (!posted) waitpid_post();
 }
 
 void add_waitpid_process(int pid) {
@@ -239,9 +303,22 @@ static void init(void) {
     memset(&req, 0, sizeof(req));
     req.done = waitpid_done;
     req.client_data = NULL;
-    req.type = AsyncReqWaitpid;
     posted = 0;
+    drain_posted = 0;
     waitpid_poll_period = 100000;
+#if defined(__linux__)
+    {
+        sigset_t set;
+        sigset_t mask;
+        sigemptyset(&set);
+        sigaddset(&set, SIGCHLD);
+        /* signalfd gets SIGCHLD only if it is blocked, see ini_mdep() */
+        if (pthread_sigmask(SIG_BLOCK, NULL, &mask) == 0 && sigismember(&mask, SIGCHLD)) {
+            sigchld_fd = signalfd(-1, &set, SFD_CLOEXEC);
+        }
+        if (sigchld_fd < 0) trace(LOG_WAITPID, "waitpid: SIGCHLD is not available through signalfd, using blocking waitpid");
+    }
+#endif
     waitpid_post();
 }
 